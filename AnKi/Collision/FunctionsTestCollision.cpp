@@ -161,6 +161,44 @@ Bool testCollision(const Aabb& aabb, const LineSegment& ls)
 	return true;
 }
 
+Bool testCollision(const Aabb& aabb, const Ray& ray)
+{
+	// Slab test. Same as the line segment but the far end is at infinity
+	F32 maxS = 0.0f;
+	F32 minT = kMaxF32;
+
+	for(U32 i = 0; i < 3; ++i)
+	{
+		if(isZero(ray.getDirection()[i]))
+		{
+			// Ray is parallel to the slab
+			if(ray.getOrigin()[i] < aabb.getMin()[i] || ray.getOrigin()[i] > aabb.getMax()[i])
+			{
+				return false;
+			}
+		}
+		else
+		{
+			F32 s = (aabb.getMin()[i] - ray.getOrigin()[i]) / ray.getDirection()[i];
+			F32 t = (aabb.getMax()[i] - ray.getOrigin()[i]) / ray.getDirection()[i];
+			if(s > t)
+			{
+				swapValues(s, t);
+			}
+
+			maxS = max(maxS, s);
+			minT = min(minT, t);
+
+			if(maxS > minT)
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
 Bool testCollision([[maybe_unused]] const Aabb& aabb, [[maybe_unused]] const Cone& cone)
 {
 	ANKI_ASSERT(!"TODO");
@@ -155,6 +155,7 @@ App::~App()
 
 void App::cleanup()
 {
+	CoreBackgroundThreadJobManager::freeSingleton(); // 1st so the jobs in flight finish while everything they use is alive
 	SceneGraph::freeSingleton();
 	ScriptManager::freeSingleton();
 	Renderer::freeSingleton();
@@ -245,6 +246,7 @@ Error App::init()
 	//
 	const Bool pinThreads = !ANKI_OS_ANDROID;
 	CoreThreadJobManager::allocateSingleton(U32(g_cvarCoreJobThreadCount), pinThreads);
+	CoreBackgroundThreadJobManager::allocateSingleton(U32(g_cvarCoreBackgroundJobThreadCount));
 
 	//
 	// Graphics API
@@ -392,6 +394,100 @@ Error App::initDirs()
 	return Error::kNone;
 }
 
+// Calls GrManager::endFrame in a separate thread so the present of a frame overlaps with the input, the user code and the scene update of the
+// next one. Between kick() and wait() the present thread owns the frame calls of the GrManager and the main thread is only allowed to use the
+// thread-safe part of it (see GrManager::beginFrame). Nothing else is overlapped: the recording of the render graph reads the scene directly so
+// the scene update of the next frame still runs after it.
+class PresentThread
+{
+public:
+	PresentThread()
+		: m_thread("AnKiPresent")
+	{
+	}
+
+	~PresentThread()
+	{
+		if(m_started)
+		{
+			{
+				LockGuard lock(m_mtx);
+				m_quit = true;
+			}
+			m_cvar.notifyAll();
+
+			[[maybe_unused]] const Error err = m_thread.join();
+		}
+	}
+
+	// Present the current frame. Call it after the command buffers of the frame got submitted
+	void kick()
+	{
+		if(!m_started)
+		{
+			m_thread.start(this, [](ThreadCallbackInfo& info) -> Error {
+				return static_cast<PresentThread*>(info.m_userData)->threadWorker();
+			});
+			m_started = true;
+		}
+
+		{
+			LockGuard lock(m_mtx);
+			ANKI_ASSERT(!m_pending);
+			m_pending = true;
+		}
+		m_cvar.notifyAll();
+	}
+
+	// Wait for the last present to finish. Call it before GrManager::beginFrame
+	void wait()
+	{
+		ANKI_TRACE_SCOPED_EVENT(WaitPresent);
+		LockGuard lock(m_mtx);
+		while(m_pending)
+		{
+			m_cvar.wait(m_mtx);
+		}
+	}
+
+private:
+	Thread m_thread;
+	Mutex m_mtx;
+	ConditionVariable m_cvar;
+	Bool m_pending = false;
+	Bool m_quit = false;
+	Bool m_started = false;
+
+	Error threadWorker()
+	{
+		while(true)
+		{
+			{
+				LockGuard lock(m_mtx);
+				while(!m_pending && !m_quit)
+				{
+					m_cvar.wait(m_mtx);
+				}
+
+				if(!m_pending)
+				{
+					break;
+				}
+			}
+
+			GrManager::getSingleton().endFrame();
+
+			{
+				LockGuard lock(m_mtx);
+				m_pending = false;
+			}
+			m_cvar.notifyAll();
+		}
+
+		return Error::kNone;
+	}
+};
+
 Error App::mainLoop()
 {
 	ANKI_CORE_LOGI("Starting application. Build config: %s", kAnKiBuildConfigString);
@@ -445,33 +541,49 @@ Error App::mainLoop()
 	const Bool benchmarkMode = g_cvarCoreBenchmarkMode;
 	Second aggregatedCpuTime = 0.0;
 	Second aggregatedGpuTime = 0.0;
+	Second aggregatedFrameTime = 0.0;
 	constexpr U32 kBenchmarkFramesToGatherBeforeFlush = 60;
 	U32 benchmarkFramesGathered = 0;
+	U32 benchmarkFlushCount = 0;
 	File benchmarkCsvFile;
 	CoreString benchmarkCsvFileFilename;
 	if(benchmarkMode)
 	{
 		benchmarkCsvFileFilename.sprintf("%s/Benchmark.csv", m_settingsDir.cstr());
 		ANKI_CHECK(benchmarkCsvFile.open(benchmarkCsvFileFilename, FileOpenFlag::kWrite));
-		ANKI_CHECK(benchmarkCsvFile.writeText("CPU, GPU\n"));
+		ANKI_CHECK(benchmarkCsvFile.writeText("CPU, GPU, Frame, AsyncPresent\n"));
 	}
 
+	PresentThread presentThread;
+
 	while(!quit)
 	{
 		{
 			ANKI_TRACE_SCOPED_EVENT(Frame);
 			const Second startTime = HighRezTimer::getCurrentTime();
 
+			// In benchmark mode alternate between the two ways to present so they can be compared under the same conditions
+			const Bool asyncPresent = g_cvarCoreAsyncPresent && (!benchmarkMode || (benchmarkFlushCount & 1) == 0);
+
 			prevUpdateTime = crntTime;
 			crntTime = (!benchmarkMode) ? HighRezTimer::getCurrentTime() : (prevUpdateTime + 1.0_sec / 60.0_sec);
 
+			// If we get stats exclude the time of GR because it forces some GPU-CPU serialization. We don't want to count that. With the async
+			// present that's only the time it didn't manage to hide
+			Second grTime = 0.0;
+			const Bool measureGrTime = benchmarkMode || g_cvarCoreDisplayStats > 0;
+
 			ANKI_CHECK(Input::getSingleton().handleEvents());
 			if(Input::getSingleton().getEvent(InputEvent::kWindowClosed))
 			{
 				quit = true;
 			}
 
-			GrManager::getSingleton().beginFrame();
+			if(!asyncPresent)
+			{
+				presentThread.wait(); // In case the previous frame was presented asynchronously
+				GrManager::getSingleton().beginFrame();
+			}
 
 			GpuSceneMicroPatcher::getSingleton().beginPatching();
 			Bool userQuit = false;
@@ -481,23 +593,37 @@ Error App::mainLoop()
 			SceneGraph::getSingleton().update(prevUpdateTime, crntTime);
 			GpuSceneMicroPatcher::getSingleton().endPatching();
 
+			if(asyncPresent)
+			{
+				const Second waitStartTime = (measureGrTime) ? HighRezTimer::getCurrentTime() : 0.0;
+				presentThread.wait();
+				if(measureGrTime) [[unlikely]]
+				{
+					grTime = HighRezTimer::getCurrentTime() - waitStartTime;
+				}
+
+				GrManager::getSingleton().beginFrame();
+			}
+
 			FencePtr renderFence;
 			ANKI_CHECK(Renderer::getSingleton().render(renderFence));
 
-			// If we get stats exclude the time of GR because it forces some GPU-CPU serialization. We don't want to count that
-			Second grTime = 0.0;
-			if(benchmarkMode || g_cvarCoreDisplayStats > 0) [[unlikely]]
+			if(!asyncPresent)
 			{
-				grTime = HighRezTimer::getCurrentTime();
-			}
+				if(measureGrTime) [[unlikely]]
+				{
+					grTime = HighRezTimer::getCurrentTime();
+				}
 
-			GrManager::getSingleton().endFrame();
+				GrManager::getSingleton().endFrame();
 
-			if(benchmarkMode || g_cvarCoreDisplayStats > 0) [[unlikely]]
-			{
-				grTime = HighRezTimer::getCurrentTime() - grTime;
+				if(measureGrTime) [[unlikely]]
+				{
+					grTime = HighRezTimer::getCurrentTime() - grTime;
+				}
 			}
 
+			// The pools need the main thread (for the stats) and don't depend on the present
 			RebarTransientMemoryPool::getSingleton().endFrame(renderFence.get());
 			UnifiedGeometryBuffer::getSingleton().endFrame(renderFence.get());
 			GpuSceneBuffer::getSingleton().endFrame(renderFence.get());
@@ -505,6 +631,11 @@ Error App::mainLoop()
 			GpuReadbackMemoryPool::getSingleton().endFrame(renderFence.get());
 			TextureMemoryPool::getSingleton().endFrame(renderFence.get());
 
+			if(asyncPresent)
+			{
+				presentThread.kick();
+			}
+
 			// Sleep
 			const Second endTime = HighRezTimer::getCurrentTime();
 			const Second frameTime = endTime - startTime;
@@ -523,16 +654,21 @@ Error App::mainLoop()
 			{
 				aggregatedCpuTime += frameTime - grTime;
 				aggregatedGpuTime += 0; // TODO
+				aggregatedFrameTime += frameTime;
 				++benchmarkFramesGathered;
 				if(benchmarkFramesGathered >= kBenchmarkFramesToGatherBeforeFlush)
 				{
 					aggregatedCpuTime = aggregatedCpuTime / Second(kBenchmarkFramesToGatherBeforeFlush) * 1000.0;
 					aggregatedGpuTime = aggregatedGpuTime / Second(kBenchmarkFramesToGatherBeforeFlush) * 1000.0;
-					ANKI_CHECK(benchmarkCsvFile.writeTextf("%f,%f\n", aggregatedCpuTime, aggregatedGpuTime));
+					aggregatedFrameTime = aggregatedFrameTime / Second(kBenchmarkFramesToGatherBeforeFlush) * 1000.0;
+					ANKI_CHECK(benchmarkCsvFile.writeTextf("%f,%f,%f,%u\n", aggregatedCpuTime, aggregatedGpuTime, aggregatedFrameTime,
+														   U32(asyncPresent)));
 
 					benchmarkFramesGathered = 0;
+					++benchmarkFlushCount;
 					aggregatedCpuTime = 0.0;
 					aggregatedGpuTime = 0.0;
+					aggregatedFrameTime = 0.0;
 				}
 			}
 
@@ -567,6 +703,8 @@ Error App::mainLoop()
 #endif
 	}
 
+	presentThread.wait();
+
 	if(benchmarkMode) [[unlikely]]
 	{
 		ANKI_CORE_LOGI("Benchmark file saved in: %s", benchmarkCsvFileFilename.cstr());
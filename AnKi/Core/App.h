@@ -16,11 +16,16 @@ namespace anki {
 
 ANKI_CVAR(NumericCVar<U32>, Core, TargetFps, 60u, 1u, kMaxU32, "Target FPS")
 ANKI_CVAR(NumericCVar<U32>, Core, JobThreadCount, clamp(getCpuCoresCount() / 2u, 2u, 16u), 2u, 1024u, "Number of job thread")
+ANKI_CVAR(NumericCVar<U32>, Core, BackgroundJobThreadCount, clamp(getCpuCoresCount() / 4u, 1u, 4u), 1u, 1024u,
+		  "Number of threads for the jobs the frame doesn't wait for")
 ANKI_CVAR(NumericCVar<U32>, Core, DisplayStats, 0, 0, 2, "Display stats, 0: None, 1: Simple, 2: Detailed")
 ANKI_CVAR(BoolCVar, Core, ClearCaches, false, "Clear all caches")
 ANKI_CVAR(BoolCVar, Core, VerboseLog, false, "Verbose logging")
 ANKI_CVAR(BoolCVar, Core, BenchmarkMode, false, "Run in a benchmark mode. Fixed timestep, unlimited target FPS")
 ANKI_CVAR(NumericCVar<U32>, Core, BenchmarkModeFrameCount, 60 * 60 * 2, 1, kMaxU32, "How many frames the benchmark will run before it quits")
+ANKI_CVAR(BoolCVar, Core, AsyncPresent, false,
+		  "Call GrManager::endFrame in a separate thread. Only the present overlaps with the next frame. In benchmark mode it alternates with the "
+		  "synchronous present")
 ANKI_CVAR(BoolCVar, Core, MeshletRendering, false, "Do meshlet culling and rendering")
 ANKI_CVAR(StringCVar, Core, StartupScene, "", "Load this scene at startup")
 #if ANKI_WITH_EDITOR
@@ -45,6 +45,20 @@ public:
 	}
 };
 
+// Runs work that may span multiple frames, like the creation of shader variants and pipelines. Unlike CoreThreadJobManager nothing in the frame
+// waits for it to finish.
+class CoreBackgroundThreadJobManager : public ThreadJobManager, public MakeSingleton<CoreBackgroundThreadJobManager>
+{
+	template<typename>
+	friend class MakeSingleton;
+
+public:
+	CoreBackgroundThreadJobManager(U32 threadCount)
+		: ThreadJobManager(threadCount, false)
+	{
+	}
+};
+
 class GlobalFrameIndex : public MakeSingleton<GlobalFrameIndex>
 {
 public:
@@ -189,11 +189,12 @@ public:
 		if(!!(m_flags & StatFlag::kMainThreadUpdates))
 		{
 			orig = m_u;
-			m_u = value;
+			m_u = (U64(value) > m_u) ? U64(value) : m_u;
 		}
 		else
 		{
-			orig = m_atomic.max(value);
+			orig = m_atomic.load();
+			m_atomic.max(U64(value));
 		}
 		return orig;
 #else
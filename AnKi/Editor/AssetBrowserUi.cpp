@@ -212,7 +212,7 @@ void AssetBrowserUi::buildAssetStructure(DynamicArray<AssetDir>& dirs)
 			{
 				filetype = AssetFileType::kParticleEmitter;
 			}
-			else if(extension == "ankiscene")
+			else if(extension == "ankiscene" || extension == "ankiscenebin")
 			{
 				filetype = AssetFileType::kScene;
 			}
@@ -14,6 +14,10 @@ namespace anki {
 ANKI_SVAR(GpuSceneBufferAllocatedSize, StatCategory::kGpuMem, "GPU scene allocated", StatFlag::kBytes | StatFlag::kMainThreadUpdates)
 ANKI_SVAR(GpuSceneBufferTotal, StatCategory::kGpuMem, "GPU scene total", StatFlag::kBytes | StatFlag::kMainThreadUpdates)
 ANKI_SVAR(GpuSceneBufferFragmentation, StatCategory::kGpuMem, "GPU scene fragmentation", StatFlag::kFloat | StatFlag::kMainThreadUpdates);
+ANKI_SVAR(GpuSceneMicroPatchesSubmitted, StatCategory::kGpuMisc, "GPU scene patches submitted", StatFlag::kMainThreadUpdates)
+ANKI_SVAR(GpuSceneMicroPatchesUploaded, StatCategory::kGpuMisc, "GPU scene patches uploaded", StatFlag::kMainThreadUpdates)
+
+static Atomic<U64> g_nextPatchingGeneration = {1};
 
 void GpuSceneBuffer::init()
 {
@@ -50,6 +54,31 @@ public:
 	U32 m_dstDwordOffset;
 };
 
+// The copies a single thread recorded in a frame.
+class GpuSceneMicroPatcher::ThreadCopies
+{
+public:
+	class Copy
+	{
+	public:
+		U32 m_dstDwordOffset;
+		U32 m_dwordCount;
+		U32 m_srcDwordOffset; // Offset in m_data
+	};
+
+	DynamicArray<Copy, MemoryPoolPtrWrapper<StackMemoryPool>> m_copies;
+	DynamicArray<U32, MemoryPoolPtrWrapper<StackMemoryPool>> m_data;
+
+	ThreadCopies(StackMemoryPool* pool)
+		: m_copies(pool)
+		, m_data(pool)
+	{
+	}
+};
+
+thread_local GpuSceneMicroPatcher::ThreadCopies* GpuSceneMicroPatcher::m_tlsThreadCopies = nullptr;
+thread_local U64 GpuSceneMicroPatcher::m_tlsPatchingGeneration = 0;
+
 GpuSceneMicroPatcher::GpuSceneMicroPatcher()
 {
 }
@@ -77,10 +106,103 @@ void GpuSceneMicroPatcher::beginPatching()
 {
 	ANKI_ASSERT(m_bPatchingMode.fetchAdd(1) == 0);
 
+	// The memory is owned by the stack pool so just forget about it
+	ThreadCopies** data;
+	U32 size, storage;
+	m_threadCopies.moveAndReset(data, size, storage);
+
 	m_stackMemPool.reset();
 
 	m_crntFramePatchHeaders = DynamicArray<PatchHeader, MemoryPoolPtrWrapper<StackMemoryPool>>(&m_stackMemPool);
 	m_crntFramePatchData = DynamicArray<U32, MemoryPoolPtrWrapper<StackMemoryPool>>(&m_stackMemPool);
+	m_threadCopies = DynamicArray<ThreadCopies*, MemoryPoolPtrWrapper<StackMemoryPool>>(&m_stackMemPool);
+
+	m_patchingGeneration = g_nextPatchingGeneration.fetchAdd(1);
+}
+
+void GpuSceneMicroPatcher::endPatching()
+{
+	ANKI_ASSERT(m_bPatchingMode.fetchSub(1) == 1);
+	ANKI_TRACE_SCOPED_EVENT(GpuSceneMicroPatchMerge);
+
+	// Gather the copies of all threads. The order is the order of the writes inside a thread. Writes of different threads to the same memory
+	// have no order
+	class MergeCopy
+	{
+	public:
+		U32 m_dstDwordOffset;
+		U32 m_dwordCount;
+		const U32* m_data;
+		U32 m_order;
+	};
+
+	DynamicArray<MergeCopy, MemoryPoolPtrWrapper<StackMemoryPool>> copies(&m_stackMemPool);
+	U32 submittedPatchCount = 0;
+	for(ThreadCopies* threadCopies : m_threadCopies)
+	{
+		for(const ThreadCopies::Copy& copy : threadCopies->m_copies)
+		{
+			MergeCopy& mcopy = *copies.emplaceBack();
+			mcopy.m_dstDwordOffset = copy.m_dstDwordOffset;
+			mcopy.m_dwordCount = copy.m_dwordCount;
+			mcopy.m_data = &threadCopies->m_data[copy.m_srcDwordOffset];
+			mcopy.m_order = copies.getSize() - 1;
+
+			submittedPatchCount += (copy.m_dwordCount + kDwordsPerPatch - 1) / kDwordsPerPatch;
+		}
+	}
+
+	std::sort(copies.getBegin(), copies.getEnd(), [](const MergeCopy& a, const MergeCopy& b) {
+		return (a.m_dstDwordOffset != b.m_dstDwordOffset) ? a.m_dstDwordOffset < b.m_dstDwordOffset : a.m_order < b.m_order;
+	});
+
+	// Coalesce copies that overlap or touch into a single range and then break it into patches
+	U32 i = 0;
+	while(i < copies.getSize())
+	{
+		const U32 rangeBegin = copies[i].m_dstDwordOffset;
+		U32 rangeEnd = rangeBegin + copies[i].m_dwordCount;
+		U32 j = i + 1;
+		while(j < copies.getSize() && copies[j].m_dstDwordOffset <= rangeEnd)
+		{
+			rangeEnd = max(rangeEnd, copies[j].m_dstDwordOffset + copies[j].m_dwordCount);
+			++j;
+		}
+
+		if(j - i > 1)
+		{
+			// Apply them in the order they were written so the last one wins
+			std::sort(copies.getBegin() + i, copies.getBegin() + j, [](const MergeCopy& a, const MergeCopy& b) {
+				return a.m_order < b.m_order;
+			});
+		}
+
+		const U32 srcDwordOffset = m_crntFramePatchData.getSize();
+		m_crntFramePatchData.resize(srcDwordOffset + rangeEnd - rangeBegin);
+		for(U32 k = i; k < j; ++k)
+		{
+			memcpy(&m_crntFramePatchData[srcDwordOffset + copies[k].m_dstDwordOffset - rangeBegin], copies[k].m_data, copies[k].m_dwordCount * 4);
+		}
+
+		for(U32 dwordOffset = 0; dwordOffset < rangeEnd - rangeBegin; dwordOffset += kDwordsPerPatch)
+		{
+			const U32 patchDwords = min(kDwordsPerPatch, rangeEnd - rangeBegin - dwordOffset);
+
+			PatchHeader& header = *m_crntFramePatchHeaders.emplaceBack();
+			ANKI_ASSERT(((patchDwords - 1) & 0b111111) == (patchDwords - 1));
+			header.m_dwordSizeMinusOne = (patchDwords - 1) & ((1u << kDwordsPerPatchBitCount) - 1);
+			ANKI_ASSERT(((srcDwordOffset + dwordOffset) & 0x3FFFFFF) == srcDwordOffset + dwordOffset);
+			header.m_srcDwordOffset = (srcDwordOffset + dwordOffset) & ((1u << (32 - kDwordsPerPatchBitCount)) - 1);
+			header.m_dstDwordOffset = rangeBegin + dwordOffset;
+		}
+
+		i = j;
+	}
+
+	ANKI_TRACE_INC_COUNTER(GpuSceneMicroPatchesSubmitted, submittedPatchCount);
+	g_svarGpuSceneMicroPatchesSubmitted.set(submittedPatchCount);
+	g_svarGpuSceneMicroPatchesUploaded.set(m_crntFramePatchHeaders.getSize());
+
 }
 
 void GpuSceneMicroPatcher::newCopy(PtrSize gpuSceneDestOffset, PtrSize dataSize, const void* data)
@@ -91,33 +213,25 @@ void GpuSceneMicroPatcher::newCopy(PtrSize gpuSceneDestOffset, PtrSize dataSize,
 	ANKI_ASSERT((gpuSceneDestOffset % 4) == 0 && gpuSceneDestOffset / 4 < kMaxU32);
 	ANKI_ASSERT(gpuSceneDestOffset + dataSize <= GpuSceneBuffer::getSingleton().getBufferView().getRange());
 
-	const U32 dataDwords = U32(dataSize / 4);
-	U32 gpuSceneDestDwordOffset = U32(gpuSceneDestOffset / 4);
-
-	const U32* patchIt = static_cast<const U32*>(data);
-	const U32* const patchEnd = patchIt + dataDwords;
-
-	// Break the data into multiple copies
-	LockGuard lock(m_mtx);
-
-	while(patchIt < patchEnd)
+	// Get the copies of this thread. The 1st time a thread records something in a frame it needs to lock
+	if(m_tlsPatchingGeneration != m_patchingGeneration) [[unlikely]]
 	{
-		const U32 patchDwords = min(kDwordsPerPatch, U32(patchEnd - patchIt));
+		m_tlsThreadCopies = newInstance<ThreadCopies>(m_stackMemPool, &m_stackMemPool);
+		m_tlsPatchingGeneration = m_patchingGeneration;
 
-		PatchHeader& header = *m_crntFramePatchHeaders.emplaceBack();
-		ANKI_ASSERT(((patchDwords - 1) & 0b111111) == (patchDwords - 1));
-		header.m_dwordSizeMinusOne = patchDwords - 1;
-		ANKI_ASSERT((m_crntFramePatchData.getSize() & 0x3FFFFFF) == m_crntFramePatchData.getSize());
-		header.m_srcDwordOffset = m_crntFramePatchData.getSize();
-		header.m_dstDwordOffset = gpuSceneDestDwordOffset;
+		LockGuard lock(m_mtx);
+		m_threadCopies.emplaceBack(m_tlsThreadCopies);
+	}
 
-		const U32 srcOffset = m_crntFramePatchData.getSize();
-		m_crntFramePatchData.resize(srcOffset + patchDwords);
-		memcpy(&m_crntFramePatchData[srcOffset], patchIt, patchDwords * 4);
+	ThreadCopies& threadCopies = *m_tlsThreadCopies;
 
-		patchIt += patchDwords;
-		gpuSceneDestDwordOffset += patchDwords;
-	}
+	ThreadCopies::Copy& copy = *threadCopies.m_copies.emplaceBack();
+	copy.m_dstDwordOffset = U32(gpuSceneDestOffset / 4);
+	copy.m_dwordCount = U32(dataSize / 4);
+	copy.m_srcDwordOffset = threadCopies.m_data.getSize();
+
+	threadCopies.m_data.resize(copy.m_srcDwordOffset + copy.m_dwordCount);
+	memcpy(&threadCopies.m_data[copy.m_srcDwordOffset], data, dataSize);
 }
 
 void GpuSceneMicroPatcher::patchGpuScene(CommandBuffer& cmdb)
@@ -92,7 +92,7 @@ public:
 	void beginPatching();
 
 	// 2nd thing to call
-	// Copy data for the GPU scene to a staging buffer.
+	// Copy data for the GPU scene to a staging buffer. Every thread records to its own buffer so there is no locking
 	// Note: It's thread-safe against other newCopy()
 	void newCopy(PtrSize gpuSceneDestOffset, PtrSize dataSize, const void* data);
 
@@ -118,12 +118,10 @@ public:
 		newCopy(dest.getOffset(), sizeof(value), &value);
 	}
 
-	// 3rd thing to call after all newCopy() calls have be done
+	// 3rd thing to call after all newCopy() calls have be done. It merges the copies of all threads into the final patches. Copies that overlap
+	// or touch are coalesced and the later write wins, so writing the same offset many times in a frame uploads it once
 	// Note: Not thread-safe
-	void endPatching()
-	{
-		ANKI_ASSERT(m_bPatchingMode.fetchSub(1) == 1);
-	}
+	void endPatching();
 
 	// 4th optional thing to call. Check if there is a need to call patchGpuScene or if no copies are needed
 	// Note: Not thread-safe
@@ -142,10 +140,16 @@ private:
 	static constexpr U32 kDwordsPerPatchBitCount = 6;
 
 	class PatchHeader;
+	class ThreadCopies;
 
 	DynamicArray<PatchHeader, MemoryPoolPtrWrapper<StackMemoryPool>> m_crntFramePatchHeaders;
 	DynamicArray<U32, MemoryPoolPtrWrapper<StackMemoryPool>> m_crntFramePatchData;
-	Mutex m_mtx;
+	DynamicArray<ThreadCopies*, MemoryPoolPtrWrapper<StackMemoryPool>> m_threadCopies; // What newCopy recorded. One for each thread
+	U64 m_patchingGeneration = 0; // Unique for every beginPatching. Tells the threads that their m_tlsThreadCopies are stale
+	Mutex m_mtx; // Protects m_threadCopies
+
+	static thread_local ThreadCopies* m_tlsThreadCopies;
+	static thread_local U64 m_tlsPatchingGeneration;
 
 	ShaderProgramResourcePtr m_copyProgram;
 	ShaderProgramPtr m_grProgram;
@@ -51,6 +51,12 @@ public:
 
 	operator BufferView() const;
 
+	PtrSize getSize() const
+	{
+		ANKI_ASSERT(!!(*this));
+		return m_size;
+	}
+
 	void* getMappedMemory() const;
 
 	void free();
@@ -185,6 +185,22 @@ void SegregatedListsSingleBufferGpuMemoryPool::deferredFree(SegregatedListsSingl
 		m_garbage[m_activeGarbage].m_tokens.emplace(std::move(token));
 	}
 }
+void SegregatedListsSingleBufferGpuMemoryPool::immediateFree(SegregatedListsSingleBufferGpuMemoryPoolAllocation& token)
+{
+	ANKI_ASSERT(isInitialized());
+
+	if(token)
+	{
+		LockGuard lock(m_lock);
+
+		m_builder->free(m_chunk, token.m_offset, token.m_size);
+
+		ANKI_ASSERT(m_allocatedSize >= token.m_size);
+		m_allocatedSize -= token.m_size;
+
+		token.reset();
+	}
+}
 
 void SegregatedListsSingleBufferGpuMemoryPool::endFrame(Fence* fence)
 {
@@ -243,6 +259,16 @@ void SegregatedListsSingleBufferGpuMemoryPool::getStats(F32& externalFragmentati
 	totalSize = (m_gpuBuffer) ? m_gpuBuffer->getSize() : 0;
 }
 
+void SegregatedListsSingleBufferGpuMemoryPool::getFragmentationStats(F32& sawickiFragmentation, PtrSize& largestFreeBlockSize) const
+{
+	ANKI_ASSERT(isInitialized());
+
+	LockGuard lock(m_lock);
+
+	sawickiFragmentation = m_builder->computeExternalFragmentationSawicki();
+	largestFreeBlockSize = m_builder->computeLargestFreeBlockSize();
+}
+
 SegregatedListsSingleBufferGpuMemoryPoolAllocation::operator BufferView() const
 {
 	ANKI_ASSERT(!!(*this));
@@ -122,6 +122,10 @@ public:
 	// It's thread-safe.
 	void deferredFree(SegregatedListsSingleBufferGpuMemoryPoolAllocation& token);
 
+	// Free memory now. Only for memory that the GPU never accessed.
+	// It's thread-safe.
+	void immediateFree(SegregatedListsSingleBufferGpuMemoryPoolAllocation& token);
+
 	// It's thread-safe.
 	void endFrame(Fence* fence);
 
@@ -143,6 +147,10 @@ public:
 	// It's thread-safe.
 	void getStats(F32& externalFragmentation, PtrSize& userAllocatedSize, PtrSize& totalSize) const;
 
+	// More expensive stats than getStats.
+	// It's thread-safe.
+	void getFragmentationStats(F32& sawickiFragmentation, PtrSize& largestFreeBlockSize) const;
+
 private:
 	class BuilderInterface;
 	class Chunk;
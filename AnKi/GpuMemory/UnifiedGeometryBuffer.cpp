@@ -5,13 +5,24 @@
 
 #include <AnKi/GpuMemory/UnifiedGeometryBuffer.h>
 #include <AnKi/Gr/GrManager.h>
+#include <AnKi/Gr/CommandBuffer.h>
 #include <AnKi/Core/StatsSet.h>
+#include <AnKi/Util/Tracer.h>
 
 namespace anki {
 
 ANKI_SVAR(UnifiedGeomBufferAllocatedSize, StatCategory::kGpuMem, "UGB allocated", StatFlag::kBytes | StatFlag::kMainThreadUpdates)
 ANKI_SVAR(UnifiedGeomBufferTotal, StatCategory::kGpuMem, "UGB total", StatFlag::kBytes | StatFlag::kMainThreadUpdates)
 ANKI_SVAR(UnifiedGeomBufferFragmentation, StatCategory::kGpuMem, "UGB fragmentation", StatFlag::kFloat | StatFlag::kMainThreadUpdates)
+ANKI_SVAR(UnifiedGeomBufferFragmentationSawicki, StatCategory::kGpuMem, "UGB fragmentation #2", StatFlag::kFloat | StatFlag::kMainThreadUpdates)
+ANKI_SVAR(UnifiedGeomBufferLargestFreeBlock, StatCategory::kGpuMem, "UGB largest free block", StatFlag::kBytes | StatFlag::kMainThreadUpdates)
+ANKI_SVAR(UnifiedGeomBufferRelocations, StatCategory::kGpuMem, "UGB relocations/frame", StatFlag::kMainThreadUpdates)
+ANKI_SVAR(UnifiedGeomBufferRelocatedSize, StatCategory::kGpuMem, "UGB relocated/frame", StatFlag::kBytes | StatFlag::kMainThreadUpdates)
+
+UnifiedGeometryBuffer::~UnifiedGeometryBuffer()
+{
+	ANKI_ASSERT(m_relocatables.getSize() == 0 && "Someone forgot to free a relocatable allocation");
+}
 
 void UnifiedGeometryBuffer::init()
 {
@@ -19,7 +30,9 @@ void UnifiedGeometryBuffer::init()
 
 	const Array classes = {1_KB, 8_KB, 32_KB, 128_KB, 512_KB, 4_MB, 8_MB, 16_MB, poolSize};
 
-	BufferUsageBit buffUsage = BufferUsageBit::kVertexOrIndex | BufferUsageBit::kCopyDestination | BufferUsageBit::kAllSrv;
+	// Copy source is for the defragmentation
+	BufferUsageBit buffUsage =
+		BufferUsageBit::kVertexOrIndex | BufferUsageBit::kCopyDestination | BufferUsageBit::kCopySource | BufferUsageBit::kAllSrv;
 
 	if(GrManager::getSingleton().getDeviceCapabilities().m_rayTracing)
 	{
@@ -39,9 +52,193 @@ void UnifiedGeometryBuffer::updateStats() const
 	PtrSize userAllocatedSize, totalSize;
 	m_pool.getStats(externalFragmentation, userAllocatedSize, totalSize);
 
+	F32 sawickiFragmentation;
+	PtrSize largestFreeBlockSize;
+	m_pool.getFragmentationStats(sawickiFragmentation, largestFreeBlockSize);
+
 	g_svarUnifiedGeomBufferAllocatedSize.set(userAllocatedSize);
 	g_svarUnifiedGeomBufferTotal.set(totalSize);
 	g_svarUnifiedGeomBufferFragmentation.set(externalFragmentation);
+	g_svarUnifiedGeomBufferFragmentationSawicki.set(sawickiFragmentation);
+	g_svarUnifiedGeomBufferLargestFreeBlock.set(largestFreeBlockSize);
+	g_svarUnifiedGeomBufferRelocations.set(m_relocationCount);
+	g_svarUnifiedGeomBufferRelocatedSize.set(m_relocatedBytes);
+}
+
+void UnifiedGeometryBuffer::makeRelocatable(UnifiedGeometryBufferAllocation& alloc, UnifiedGeometryBufferRelocationCallback callback, void* userData)
+{
+	ANKI_ASSERT(!!alloc && !alloc.isRelocatable() && callback);
+
+	LockGuard lock(m_relocatablesMtx);
+
+	auto it = m_relocatables.emplace();
+	it->m_alloc = &alloc;
+	it->m_callback = callback;
+	it->m_userData = userData;
+	alloc.m_relocatableIdx = it.getArrayIndex();
+}
+
+void UnifiedGeometryBuffer::removeRelocatable(UnifiedGeometryBufferAllocation& alloc)
+{
+	LockGuard lock(m_relocatablesMtx);
+
+	ANKI_ASSERT(m_relocatables[alloc.m_relocatableIdx].m_alloc == &alloc);
+	m_relocatables.erase(alloc.m_relocatableIdx);
+	alloc.m_relocatableIdx = kMaxU32;
+}
+
+void UnifiedGeometryBuffer::moveRelocatable(UnifiedGeometryBufferAllocation& to, UnifiedGeometryBufferAllocation& from)
+{
+	LockGuard lock(m_relocatablesMtx);
+
+	ANKI_ASSERT(m_relocatables[from.m_relocatableIdx].m_alloc == &from);
+	to.moveFrom(from);
+	m_relocatables[to.m_relocatableIdx].m_alloc = &to;
+}
+
+void UnifiedGeometryBuffer::defragment()
+{
+	m_relocationCount = 0;
+	m_relocatedBytes = 0;
+
+	const PtrSize budget = g_cvarGpuMemUnifiedGeometryBufferDefragBudget;
+	if(budget == 0)
+	{
+		return;
+	}
+
+	F32 externalFragmentation;
+	PtrSize userAllocatedSize, totalSize;
+	m_pool.getStats(externalFragmentation, userAllocatedSize, totalSize);
+	if(externalFragmentation < g_cvarGpuMemUnifiedGeometryBufferDefragThreshold)
+	{
+		return;
+	}
+
+	ANKI_TRACE_SCOPED_EVENT(UgbDefragment);
+
+	LockGuard lock(m_relocatablesMtx);
+
+	// Start from the allocations that are at the end of the buffer. Moving them to holes further down is what creates big free blocks
+	class Candidate
+	{
+	public:
+		PtrSize m_offset;
+		U32 m_relocatableIdx;
+	};
+
+	DynamicArray<Candidate> candidates;
+	candidates.resizeStorage(m_relocatables.getSize());
+	for(auto it = m_relocatables.getBegin(); it != m_relocatables.getEnd(); ++it)
+	{
+		candidates.emplaceBack(Candidate{it->m_alloc->m_alloc.getOffset(), it.getArrayIndex()});
+	}
+
+	std::sort(candidates.getBegin(), candidates.getEnd(), [](const Candidate& a, const Candidate& b) {
+		return a.m_offset > b.m_offset;
+	});
+
+	// Find new homes. The pool is best fit so the new allocation will fill the smallest hole that fits. If that hole is not lower than the
+	// current offset there is no point in moving
+	class Relocation
+	{
+	public:
+		U32 m_relocatableIdx;
+		U32 m_newFakeOffset;
+		SegregatedListsSingleBufferGpuMemoryPoolAllocation m_newAlloc;
+	};
+
+	DynamicArray<Relocation> relocations;
+	DynamicArray<CopyBufferToBufferInfo> copies;
+
+	F32 sawickiFragmentation;
+	PtrSize largestFreeBlockSize;
+	m_pool.getFragmentationStats(sawickiFragmentation, largestFreeBlockSize);
+
+	constexpr U32 kMaxRelocationsPerFrame = 256;
+	for(const Candidate& candidate : candidates)
+	{
+		if(m_relocatedBytes >= budget || relocations.getSize() >= kMaxRelocationsPerFrame)
+		{
+			break;
+		}
+
+		UnifiedGeometryBufferAllocation& alloc = *m_relocatables[candidate.m_relocatableIdx].m_alloc;
+		const PtrSize size = alloc.m_alloc.getSize();
+		const U32 fixedAlignment = max(4u, nextPowerOfTwo(alloc.m_alignment));
+		if(size + fixedAlignment > largestFreeBlockSize)
+		{
+			// Don't even try, it won't fit anywhere
+			continue;
+		}
+
+		SegregatedListsSingleBufferGpuMemoryPoolAllocation newAlloc = m_pool.allocate(size, fixedAlignment);
+		if(newAlloc.getOffset() >= alloc.m_alloc.getOffset())
+		{
+			m_pool.immediateFree(newAlloc);
+			continue;
+		}
+
+		const U32 remainder = U32(newAlloc.getOffset() % alloc.m_alignment);
+		const U32 newFakeOffset = U32(newAlloc.getOffset() + (alloc.m_alignment - remainder));
+		ANKI_ASSERT(PtrSize(newFakeOffset) + alloc.m_fakeAllocatedSize <= newAlloc.getOffset() + newAlloc.getSize());
+
+		CopyBufferToBufferInfo& copy = *copies.emplaceBack();
+		copy.m_sourceOffset = alloc.m_fakeOffset;
+		copy.m_destinationOffset = newFakeOffset;
+		copy.m_range = alloc.m_fakeAllocatedSize;
+
+		Relocation& relocation = *relocations.emplaceBack();
+		relocation.m_relocatableIdx = candidate.m_relocatableIdx;
+		relocation.m_newFakeOffset = newFakeOffset;
+		relocation.m_newAlloc = std::move(newAlloc);
+
+		m_relocatedBytes += alloc.m_fakeAllocatedSize;
+
+		m_pool.getFragmentationStats(sawickiFragmentation, largestFreeBlockSize);
+	}
+
+	if(relocations.getSize() == 0)
+	{
+		return;
+	}
+
+	// Move the data. The copies read and write the same buffer but the ranges never overlap since the old memory is still allocated
+	Buffer& buffer = m_pool.getGpuBuffer();
+	const BufferUsageBit copyUsage = BufferUsageBit::kCopySource | BufferUsageBit::kCopyDestination;
+	const BufferUsageBit nonCopyUsage = buffer.getBufferUsage() ^ copyUsage;
+
+	CommandBufferInitInfo cmdbInit(CommandBufferFlag::kSmallBatch | CommandBufferFlag::kGeneralWork, "UGB defragment");
+	CommandBufferPtr cmdb = GrManager::getSingleton().newCommandBuffer(cmdbInit);
+
+	BufferBarrierInfo barrier = {BufferView(&buffer), nonCopyUsage, copyUsage};
+	cmdb->setPipelineBarrier({}, {&barrier, 1}, {});
+
+	cmdb->copyBufferToBuffer(&buffer, &buffer, copies);
+
+	barrier = {BufferView(&buffer), copyUsage, nonCopyUsage};
+	cmdb->setPipelineBarrier({}, {&barrier, 1}, {});
+
+	cmdb->endRecording();
+	GrManager::getSingleton().submit(cmdb.get());
+
+	// Patch the allocations. The old memory goes to the garbage and it will be released after the GPU work of the next frame is done. That work
+	// is submitted after the copies
+	for(Relocation& relocation : relocations)
+	{
+		Relocatable& relocatable = m_relocatables[relocation.m_relocatableIdx];
+		UnifiedGeometryBufferAllocation& alloc = *relocatable.m_alloc;
+
+		SegregatedListsSingleBufferGpuMemoryPoolAllocation oldAlloc = std::move(alloc.m_alloc);
+		alloc.m_alloc = std::move(relocation.m_newAlloc);
+		alloc.m_fakeOffset = relocation.m_newFakeOffset;
+		m_pool.deferredFree(oldAlloc);
+
+		relocatable.m_callback(relocatable.m_userData);
+	}
+
+	m_relocationCount = relocations.getSize();
+	m_relocationEpoch.fetchAdd(1);
 }
 
 } // end namespace anki
@@ -12,6 +12,14 @@
 namespace anki {
 
 ANKI_CVAR(NumericCVar<PtrSize>, GpuMem, UnifiedGeometryBufferSize, 512_MB, 16_MB, 2_GB, "Global index and vertex buffer size")
+ANKI_CVAR(NumericCVar<PtrSize>, GpuMem, UnifiedGeometryBufferDefragBudget, 4_MB, 0, 256_MB,
+		  "Max bytes of the unified geometry buffer to move every frame in order to defragment it. 0 disables defragmentation")
+ANKI_CVAR(NumericCVar<F32>, GpuMem, UnifiedGeometryBufferDefragThreshold, 0.3f, 0.0f, 1.0f,
+		  "Start defragmenting the unified geometry buffer when its external fragmentation goes above that")
+
+// Gets called after the defragmentation moved an allocation. It's called from UnifiedGeometryBuffer::endFrame while the UGB is locked so don't
+// call back into the UnifiedGeometryBuffer
+using UnifiedGeometryBufferRelocationCallback = void (*)(void* userData);
 
 class UnifiedGeometryBufferAllocation
 {
@@ -31,16 +39,7 @@ public:
 
 	UnifiedGeometryBufferAllocation& operator=(const UnifiedGeometryBufferAllocation&) = delete;
 
-	UnifiedGeometryBufferAllocation& operator=(UnifiedGeometryBufferAllocation&& b)
-	{
-		ANKI_ASSERT(!(*this) && "Forgot to delete");
-		m_alloc = std::move(b.m_alloc);
-		m_fakeOffset = b.m_fakeOffset;
-		m_fakeAllocatedSize = b.m_fakeAllocatedSize;
-		b.m_fakeAllocatedSize = 0;
-		b.m_fakeOffset = kMaxU32;
-		return *this;
-	}
+	UnifiedGeometryBufferAllocation& operator=(UnifiedGeometryBufferAllocation&& b);
 
 	operator Bool() const
 	{
@@ -52,7 +51,7 @@ public:
 	// This will return an exaggerated view compared to the above that it's properly aligned.
 	BufferView getCompleteBufferView() const;
 
-	// Get offset in the Unified Geometry Buffer buffer.
+	// Get offset in the Unified Geometry Buffer buffer. If the allocation is relocatable it might change at the end of the frame.
 	U32 getOffset() const
 	{
 		ANKI_ASSERT(!!(*this));
@@ -65,10 +64,30 @@ public:
 		return m_fakeAllocatedSize;
 	}
 
+	Bool isRelocatable() const
+	{
+		return m_relocatableIdx != kMaxU32;
+	}
+
 private:
 	SegregatedListsSingleBufferGpuMemoryPoolAllocation m_alloc;
 	U32 m_fakeOffset = kMaxU32; // In some allocations with weird alignments we need a different offset.
 	U32 m_fakeAllocatedSize = 0;
+	U32 m_alignment = 0; // The alignment the user asked for. Needed to re-compute the fake offset after a relocation.
+	U32 m_relocatableIdx = kMaxU32; // Index in UnifiedGeometryBuffer::m_relocatables
+
+	void moveFrom(UnifiedGeometryBufferAllocation& b)
+	{
+		m_alloc = std::move(b.m_alloc);
+		m_fakeOffset = b.m_fakeOffset;
+		m_fakeAllocatedSize = b.m_fakeAllocatedSize;
+		m_alignment = b.m_alignment;
+		m_relocatableIdx = b.m_relocatableIdx;
+		b.m_fakeAllocatedSize = 0;
+		b.m_fakeOffset = kMaxU32;
+		b.m_alignment = 0;
+		b.m_relocatableIdx = kMaxU32;
+	}
 };
 
 // Manages vertex and index memory for the WHOLE application.
@@ -76,6 +95,7 @@ class UnifiedGeometryBuffer : public MakeSingleton<UnifiedGeometryBuffer>
 {
 	template<typename>
 	friend class MakeSingleton;
+	friend class UnifiedGeometryBufferAllocation;
 
 public:
 	UnifiedGeometryBuffer(const UnifiedGeometryBuffer&) = delete; // Non-copyable
@@ -101,6 +121,7 @@ public:
 		ANKI_ASSERT(isAligned(alignment, out.m_fakeOffset));
 
 		out.m_fakeAllocatedSize = U32(size);
+		out.m_alignment = alignment;
 		ANKI_ASSERT(PtrSize(out.m_fakeOffset) + out.m_fakeAllocatedSize <= out.m_alloc.getOffset() + out.m_alloc.getSize());
 
 		return out;
@@ -115,14 +136,32 @@ public:
 
 	void deferredFree(UnifiedGeometryBufferAllocation& alloc)
 	{
+		if(alloc.isRelocatable())
+		{
+			removeRelocatable(alloc);
+		}
+
 		m_pool.deferredFree(alloc.m_alloc);
 		alloc.m_fakeAllocatedSize = 0;
 		alloc.m_fakeOffset = kMaxU32;
 	}
 
+	// Allow the defragmentation to move the allocation to another offset. Call it when the GPU work that populates the allocation has been
+	// submitted. The callback will be called every time the allocation moves. The new offset can be used by GPU work submitted after the callback
+	// and the old one stays valid for GPU work that got submitted before.
+	// Note: It's thread-safe
+	void makeRelocatable(UnifiedGeometryBufferAllocation& alloc, UnifiedGeometryBufferRelocationCallback callback, void* userData);
+
+	// Incremented every time the defragmentation moves something.
+	U32 getRelocationEpoch() const
+	{
+		return m_relocationEpoch.load();
+	}
+
 	void endFrame(Fence* fence)
 	{
 		m_pool.endFrame(fence);
+		defragment();
 #if ANKI_STATS_ENABLED
 		updateStats();
 #endif
@@ -139,15 +178,53 @@ public:
 	}
 
 private:
+	class Relocatable
+	{
+	public:
+		UnifiedGeometryBufferAllocation* m_alloc = nullptr;
+		UnifiedGeometryBufferRelocationCallback m_callback = nullptr;
+		void* m_userData = nullptr;
+	};
+
 	SegregatedListsSingleBufferGpuMemoryPool m_pool;
 
+	BlockArray<Relocatable> m_relocatables;
+	Mutex m_relocatablesMtx;
+	Atomic<U32> m_relocationEpoch = {0};
+
+	// Defragmentation stats of the last frame
+	U32 m_relocationCount = 0;
+	PtrSize m_relocatedBytes = 0;
+
 	UnifiedGeometryBuffer() = default;
 
-	~UnifiedGeometryBuffer() = default;
+	~UnifiedGeometryBuffer();
+
+	void removeRelocatable(UnifiedGeometryBufferAllocation& alloc);
+
+	void moveRelocatable(UnifiedGeometryBufferAllocation& to, UnifiedGeometryBufferAllocation& from);
+
+	// Move some allocations to lower offsets to create bigger free blocks at the end of the buffer.
+	void defragment();
 
 	void updateStats() const;
 };
 
+inline UnifiedGeometryBufferAllocation& UnifiedGeometryBufferAllocation::operator=(UnifiedGeometryBufferAllocation&& b)
+{
+	ANKI_ASSERT(!(*this) && "Forgot to delete");
+	if(b.isRelocatable())
+	{
+		// The defragmentation might be touching it and it also needs to know the new address
+		UnifiedGeometryBuffer::getSingleton().moveRelocatable(*this, b);
+	}
+	else
+	{
+		moveFrom(b);
+	}
+	return *this;
+}
+
 inline UnifiedGeometryBufferAllocation::~UnifiedGeometryBufferAllocation()
 {
 	UnifiedGeometryBuffer::getSingleton().deferredFree(*this);
@@ -314,6 +314,9 @@ public:
 	// Copy a buffer to a texture surface or volume.
 	void copyBufferToTexture(const BufferView& buff, const TextureView& texView, const TextureRect& rect = TextureRect());
 
+	// Copy a texture surface or volume to another one with the same size and format.
+	void copyTextureToTexture(const TextureView& srcView, const TextureView& dstView);
+
 	// Fill a buffer with zeros. It's a copy operation.
 	void zeroBuffer(const BufferView& buff);
 
@@ -58,6 +58,9 @@ ANKI_CVAR(NumericCVar<U16>, Gr, MaxGpuSamplerDescriptors, 2 * 1024, 8, kMaxU16,
 ANKI_CVAR(BoolCVar, Gr, Dred, false, "Enable DRED")
 #else
 ANKI_CVAR(NumericCVar<PtrSize>, Gr, DiskShaderCacheMaxSize, 128_MB, 1_MB, 1_GB, "Max size of the pipeline cache file")
+ANKI_CVAR(BoolCVar, Gr, RecordPipelineManifest, false,
+		  "Record the graphics pipelines that get created to a manifest next to the pipeline cache. Next runs use it to warm-up")
+ANKI_CVAR(BoolCVar, Gr, PipelineWarmup, true, "Create the graphics pipelines of the manifest in the background when the shader programs load")
 ANKI_CVAR(BoolCVar, Gr, DebugPrintf, false, "Enable or not debug printf")
 ANKI_CVAR(BoolCVar, Gr, SamplerFilterMinMax, true, "Enable or not min/max sample filtering")
 ANKI_CVAR(StringCVar, Gr, VkLayers, "", "VK layers to enable. Seperated by :")
@@ -465,9 +468,10 @@ enum class TextureUsageBit : U32
 	kRtvDsvWrite = 1 << 9,
 	kShadingRate = 1 << 10,
 
-	kCopyDestination = 1 << 11,
+	kCopySource = 1 << 11,
+	kCopyDestination = 1 << 12,
 
-	kPresent = 1 << 12,
+	kPresent = 1 << 13,
 
 	// Derived
 	kAllSrv = kSrvGeometry | kSrvPixel | kSrvCompute | kSrvDispatchRays,
@@ -478,9 +482,9 @@ enum class TextureUsageBit : U32
 	kAllPixel = kSrvPixel | kUavPixel,
 	kAllGraphics = kAllGeometry | kAllPixel | kRtvDsvRead | kRtvDsvWrite | kShadingRate,
 	kAllCompute = kSrvCompute | kUavCompute,
-	kAllCopy = kCopyDestination,
+	kAllCopy = kCopySource | kCopyDestination,
 
-	kAllRead = kAllSrv | kAllUav | kRtvDsvRead | kShadingRate | kPresent,
+	kAllRead = kAllSrv | kAllUav | kRtvDsvRead | kShadingRate | kCopySource | kPresent,
 	kAllWrite = kAllUav | kRtvDsvWrite | kCopyDestination,
 	kAll = kAllRead | kAllWrite,
 	kAllShaderResource = kAllSrv | kAllUav,
@@ -748,6 +748,31 @@ void CommandBuffer::copyBufferToTexture(const BufferView& buff, const TextureVie
 	self.m_cmdList->CopyTextureRegion(&dstLocation, rect.m_offsetX, rect.m_offsetY, rect.m_offsetZ, &srcLocation, nullptr);
 }
 
+void CommandBuffer::copyTextureToTexture(const TextureView& srcView, const TextureView& dstView)
+{
+	ANKI_ASSERT(srcView.isGoodForCopySource() && dstView.isGoodForCopyBufferToTexture());
+	ANKI_ASSERT(srcView.getTexture().getFormat() == dstView.getTexture().getFormat());
+
+	ANKI_D3D_SELF(CommandBufferImpl);
+
+	self.commandCommon();
+
+	const TextureImpl& srcTexImpl = static_cast<const TextureImpl&>(srcView.getTexture());
+	const TextureImpl& dstTexImpl = static_cast<const TextureImpl&>(dstView.getTexture());
+
+	D3D12_TEXTURE_COPY_LOCATION srcLocation = {};
+	srcLocation.pResource = &srcTexImpl.getD3DResource();
+	srcLocation.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+	srcLocation.SubresourceIndex = srcTexImpl.calcD3DSubresourceIndex(srcView.getSubresource());
+
+	D3D12_TEXTURE_COPY_LOCATION dstLocation = {};
+	dstLocation.pResource = &dstTexImpl.getD3DResource();
+	dstLocation.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+	dstLocation.SubresourceIndex = dstTexImpl.calcD3DSubresourceIndex(dstView.getSubresource());
+
+	self.m_cmdList->CopyTextureRegion(&dstLocation, 0, 0, 0, &srcLocation, nullptr);
+}
+
 void CommandBuffer::zeroBuffer(const BufferView& buff)
 {
 	ANKI_ASSERT((buff.getRange() % sizeof(U32)) == 0);
@@ -123,19 +123,26 @@ Error GrManager::init(GrManagerInitInfo& inf)
 void GrManager::beginFrame()
 {
 	ANKI_D3D_SELF(GrManagerImpl);
+	ANKI_ASSERT(m_frameCallsInFlight.fetchAdd(1) == 0 && "Frame calls can't run in parallel");
 	self.beginFrameInternal();
+	ANKI_ASSERT(m_frameCallsInFlight.fetchSub(1) == 1);
 }
 
 TexturePtr GrManager::acquireNextPresentableTexture()
 {
 	ANKI_D3D_SELF(GrManagerImpl);
-	return self.acquireNextPresentableTextureInternal();
+	ANKI_ASSERT(m_frameCallsInFlight.fetchAdd(1) == 0 && "Frame calls can't run in parallel");
+	TexturePtr tex = self.acquireNextPresentableTextureInternal();
+	ANKI_ASSERT(m_frameCallsInFlight.fetchSub(1) == 1);
+	return tex;
 }
 
 void GrManager::endFrame()
 {
 	ANKI_D3D_SELF(GrManagerImpl);
+	ANKI_ASSERT(m_frameCallsInFlight.fetchAdd(1) == 0 && "Frame calls can't run in parallel");
 	self.endFrameInternal();
+	ANKI_ASSERT(m_frameCallsInFlight.fetchSub(1) == 1);
 }
 
 void GrManager::finish()
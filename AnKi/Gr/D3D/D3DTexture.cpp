@@ -710,6 +710,12 @@ void TextureImpl::computeBarrierInfo(TextureUsageBit usage, D3D12_BARRIER_SYNC&
 			accesses |= D3D12_BARRIER_ACCESS_SHADING_RATE_SOURCE;
 		}
 
+		if(!!(usage & TextureUsageBit::kCopySource))
+		{
+			stages |= D3D12_BARRIER_SYNC_COPY;
+			accesses |= D3D12_BARRIER_ACCESS_COPY_SOURCE;
+		}
+
 		if(!!(usage & TextureUsageBit::kCopyDestination))
 		{
 			stages |= D3D12_BARRIER_SYNC_COPY;
@@ -779,6 +785,10 @@ D3D12_BARRIER_LAYOUT TextureImpl::computeLayout(TextureUsageBit usage) const
 		// SRV
 		out = D3D12_BARRIER_LAYOUT_SHADER_RESOURCE;
 	}
+	else if(usage == TextureUsageBit::kCopySource)
+	{
+		out = D3D12_BARRIER_LAYOUT_COPY_SOURCE;
+	}
 	else if(usage == TextureUsageBit::kCopyDestination)
 	{
 		out = D3D12_BARRIER_LAYOUT_COPY_DEST;
@@ -40,6 +40,11 @@ public:
 		return m_capabilities;
 	}
 
+	// Threading: beginFrame(), acquireNextPresentableTexture() and endFrame() are the frame calls. They can't run in parallel with each other but
+	// they don't have to run in the main thread. Everything else (object creation and release, command buffer recording, submit() and finish()) is
+	// thread-safe and can run in parallel with the frame calls. That way endFrame() can present a frame in one thread while another thread
+	// prepares the next frame, as long as the later calls beginFrame() after endFrame() returns.
+
 	// First call in the frame. Do that before everything else.
 	void beginFrame();
 
@@ -100,6 +105,10 @@ protected:
 	Atomic<U32> m_uuidIndex = {1};
 	GpuDeviceCapabilities m_capabilities;
 
+#if ANKI_ASSERTIONS_ENABLED
+	Atomic<U32> m_frameCallsInFlight = {0}; // To validate that the frame calls don't run in parallel
+#endif
+
 	GrManager();
 
 	virtual ~GrManager();
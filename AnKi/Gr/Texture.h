@@ -404,6 +404,14 @@ public:
 			   && !!(m_tex->getTextureUsage() & TextureUsageBit::kCopyDestination);
 	}
 
+	// Return true if the subresource can be the source of CommandBuffer::copyTextureToTexture.
+	[[nodiscard]] Bool isGoodForCopySource() const
+	{
+		validate();
+		return isSingleSurfaceOrVolume() && m_subresource.m_depthStencilAspect == DepthStencilAspectBit::kNone
+			   && !!(m_tex->getTextureUsage() & TextureUsageBit::kCopySource);
+	}
+
 	[[nodiscard]] Bool isGoodForStorage() const
 	{
 		validate();
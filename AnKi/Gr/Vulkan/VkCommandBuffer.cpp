@@ -791,6 +791,39 @@ void CommandBuffer::copyBufferToTexture(const BufferView& buff, const TextureVie
 	vkCmdCopyBufferToImage(self.m_handle, static_cast<const BufferImpl&>(buff.getBuffer()).getHandle(), tex.getVkImage(), layout, 1, &region);
 }
 
+void CommandBuffer::copyTextureToTexture(const TextureView& srcView, const TextureView& dstView)
+{
+	ANKI_TRACE_FUNCTION();
+	ANKI_ASSERT(srcView.isGoodForCopySource() && dstView.isGoodForCopyBufferToTexture());
+
+	ANKI_VK_SELF(CommandBufferImpl);
+	self.commandCommon();
+
+	const TextureImpl& srcTex = static_cast<const TextureImpl&>(srcView.getTexture());
+	const TextureImpl& dstTex = static_cast<const TextureImpl&>(dstView.getTexture());
+	ANKI_ASSERT(srcTex.getFormat() == dstTex.getFormat());
+	const VkImageSubresourceRange srcRange = srcTex.computeVkImageSubresourceRange(srcView.getSubresource());
+	const VkImageSubresourceRange dstRange = dstTex.computeVkImageSubresourceRange(dstView.getSubresource());
+
+	VkImageCopy region = {};
+	region.srcSubresource.aspectMask = srcRange.aspectMask;
+	region.srcSubresource.mipLevel = srcRange.baseMipLevel;
+	region.srcSubresource.baseArrayLayer = srcRange.baseArrayLayer;
+	region.srcSubresource.layerCount = 1;
+	region.dstSubresource.aspectMask = dstRange.aspectMask;
+	region.dstSubresource.mipLevel = dstRange.baseMipLevel;
+	region.dstSubresource.baseArrayLayer = dstRange.baseArrayLayer;
+	region.dstSubresource.layerCount = 1;
+	region.extent.width = srcTex.getWidth() >> srcRange.baseMipLevel;
+	region.extent.height = srcTex.getHeight() >> srcRange.baseMipLevel;
+	region.extent.depth = (srcTex.getTextureType() == TextureType::k3D) ? srcTex.getDepth() >> srcRange.baseMipLevel : 1u;
+	ANKI_ASSERT(region.extent.width == dstTex.getWidth() >> dstRange.baseMipLevel
+				&& region.extent.height == dstTex.getHeight() >> dstRange.baseMipLevel);
+
+	vkCmdCopyImage(self.m_handle, srcTex.getVkImage(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, dstTex.getVkImage(),
+				   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+}
+
 void CommandBuffer::zeroBuffer(const BufferView& buff)
 {
 	ANKI_TRACE_FUNCTION();
@@ -83,19 +83,26 @@ Error GrManager::init(GrManagerInitInfo& inf)
 void GrManager::beginFrame()
 {
 	ANKI_VK_SELF(GrManagerImpl);
+	ANKI_ASSERT(m_frameCallsInFlight.fetchAdd(1) == 0 && "Frame calls can't run in parallel");
 	self.beginFrameInternal();
+	ANKI_ASSERT(m_frameCallsInFlight.fetchSub(1) == 1);
 }
 
 TexturePtr GrManager::acquireNextPresentableTexture()
 {
 	ANKI_VK_SELF(GrManagerImpl);
-	return self.acquireNextPresentableTexture();
+	ANKI_ASSERT(m_frameCallsInFlight.fetchAdd(1) == 0 && "Frame calls can't run in parallel");
+	TexturePtr tex = self.acquireNextPresentableTexture();
+	ANKI_ASSERT(m_frameCallsInFlight.fetchSub(1) == 1);
+	return tex;
 }
 
 void GrManager::endFrame()
 {
 	ANKI_VK_SELF(GrManagerImpl);
+	ANKI_ASSERT(m_frameCallsInFlight.fetchAdd(1) == 0 && "Frame calls can't run in parallel");
 	self.endFrameInternal();
+	ANKI_ASSERT(m_frameCallsInFlight.fetchSub(1) == 1);
 }
 
 void GrManager::finish()
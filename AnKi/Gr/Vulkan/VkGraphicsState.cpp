@@ -8,9 +8,16 @@
 #include <AnKi/Gr/Vulkan/VkGrManager.h>
 #include <AnKi/Gr/Vulkan/VkShaderProgram.h>
 #include <AnKi/Util/Filesystem.h>
+#include <AnKi/Core/Common.h>
 
 namespace anki {
 
+ANKI_SVAR(PipelinesWarmedUp, StatCategory::kGr, "PSOs created by the warm-up", StatFlag::kNone)
+ANKI_SVAR(PipelineWarmHits, StatCategory::kGr, "PSOs the warm-up created on time", StatFlag::kNone)
+ANKI_SVAR(PipelineRuntimeMisses, StatCategory::kGr, "PSOs created at draw time", StatFlag::kNone)
+
+static constexpr Array<Char, 8> kPipelineManifestMagic = {'A', 'N', 'K', 'I', 'P', 'S', 'O', 'M'};
+
 static VkViewport computeViewport(const U32 viewport[], U32 fbWidth, U32 fbHeight)
 {
 	const U32 minx = viewport[0];
@@ -47,9 +54,18 @@ static VkRect2D computeScissor(const U32 scissor[], U32 fbWidth, U32 fbHeight)
 
 GraphicsPipelineFactory::~GraphicsPipelineFactory()
 {
-	for(auto pso : m_map)
+	// The warm-up jobs reference the factory and the program
 	{
-		vkDestroyPipeline(getVkDevice(), pso, nullptr);
+		LockGuard lock(m_pendingWarmupJobsMtx);
+		while(m_pendingWarmupJobCount > 0)
+		{
+			m_pendingWarmupJobsCvar.wait(m_pendingWarmupJobsMtx);
+		}
+	}
+
+	for(const Pipeline& pso : m_map)
+	{
+		vkDestroyPipeline(getVkDevice(), pso.m_handle, nullptr);
 	}
 }
 
@@ -154,13 +170,28 @@ void GraphicsPipelineFactory::flushState(GraphicsStateTracker& state, VkCommandB
 
 	// Find the PSO
 	VkPipeline pso = VK_NULL_HANDLE;
+	Bool warm = false;
 	{
 		RLockGuard lock(m_mtx);
 
 		auto it = m_map.find(state.m_globalHash);
 		if(it != m_map.getEnd())
 		{
-			pso = *it;
+			pso = it->m_handle;
+			warm = it->m_warm;
+		}
+	}
+
+	if(warm) [[unlikely]]
+	{
+		// 1st time a PSO of the warm-up is used
+		WLockGuard lock(m_mtx);
+
+		auto it = m_map.find(state.m_globalHash);
+		if(it->m_warm)
+		{
+			it->m_warm = false;
+			g_svarPipelineWarmHits.increment(1);
 		}
 	}
 
@@ -175,8 +206,56 @@ void GraphicsPipelineFactory::flushState(GraphicsStateTracker& state, VkCommandB
 	}
 
 	// PSO not found, proactively create it WITHOUT a lock (we dont't want to serialize pipeline creation)
+	pso = createPipeline(staticState);
+	g_svarPipelineRuntimeMisses.increment(1);
+
+	if(g_cvarGrRecordPipelineManifest)
+	{
+		const ShaderProgramImpl& prog = static_cast<const ShaderProgramImpl&>(*staticState.m_shaderProg);
+		PipelineCache::getSingleton().recordManifestPipeline(prog.getGraphicsBinaryHash(), staticState);
+	}
+
+	// Now try to add the PSO to the hashmap
+	{
+		WLockGuard lock(m_mtx);
+
+		auto it = m_map.find(state.m_globalHash);
+		if(it == m_map.getEnd())
+		{
+			// Not found, add it
+			m_map.emplace(state.m_globalHash, Pipeline{pso, false});
+		}
+		else
+		{
+			// Found, remove the PSO that was proactively created and use the old one
+			vkDestroyPipeline(getVkDevice(), pso, nullptr);
+			pso = it->m_handle;
+			it->m_warm = false;
+		}
+	}
+
+	// Final thing, bind the PSO
+	vkCmdBindPipeline(cmdb, VK_PIPELINE_BIND_POINT_GRAPHICS, pso);
+}
+
+VkPipeline GraphicsPipelineFactory::createPipeline(const GraphicsStateTracker::StaticState& staticState)
+{
+	const auto& ss = staticState.m_stencil;
+	const Bool stencilTestEnabled = anki::stencilTestEnabled(ss.m_face[0].m_fail, ss.m_face[0].m_stencilPassDepthFail,
+															 ss.m_face[0].m_stencilPassDepthPass, ss.m_face[0].m_compare)
+									|| anki::stencilTestEnabled(ss.m_face[1].m_fail, ss.m_face[1].m_stencilPassDepthFail,
+																ss.m_face[1].m_stencilPassDepthPass, ss.m_face[1].m_compare);
+
+	const Bool hasStencilRt =
+		staticState.m_misc.m_depthStencilFormat != Format::kNone && getFormatInfo(staticState.m_misc.m_depthStencilFormat).isStencil();
+
+	const Bool hasDepthRt =
+		staticState.m_misc.m_depthStencilFormat != Format::kNone && getFormatInfo(staticState.m_misc.m_depthStencilFormat).isDepth();
+
+	const Bool depthTestEnabled = anki::depthTestEnabled(staticState.m_depth.m_compare, staticState.m_depth.m_writeEnabled);
 
 	const ShaderProgramImpl& prog = static_cast<const ShaderProgramImpl&>(*staticState.m_shaderProg);
+	VkPipeline pso = VK_NULL_HANDLE;
 
 	VkGraphicsPipelineCreateInfo ci = {};
 	ci.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
@@ -377,26 +456,76 @@ void GraphicsPipelineFactory::flushState(GraphicsStateTracker& state, VkCommandB
 #endif
 	}
 
-	// Now try to add the PSO to the hashmap
+	return pso;
+}
+
+void GraphicsPipelineFactory::warmup(const ShaderProgramImpl& prog)
+{
+	if(!g_cvarGrPipelineWarmup)
 	{
-		WLockGuard lock(m_mtx);
+		return;
+	}
 
-		auto it = m_map.find(state.m_globalHash);
-		if(it == m_map.getEnd())
+	const ConstWeakArray<GraphicsStateTracker::StaticState> states = PipelineCache::getSingleton().getManifestPipelines(prog.getGraphicsBinaryHash());
+	for(const GraphicsStateTracker::StaticState& staticState : states)
+	{
+		if(CoreBackgroundThreadJobManager::isAllocated())
 		{
-			// Not found, add it
-			m_map.emplace(state.m_globalHash, pso);
+			{
+				LockGuard lock(m_pendingWarmupJobsMtx);
+				++m_pendingWarmupJobCount;
+			}
+
+			CoreBackgroundThreadJobManager::getSingleton().dispatchTask([this, &prog, &staticState]([[maybe_unused]] U32 tid) {
+				warmupPipeline(prog, staticState);
+
+				// Notify while holding the lock because the destructor might be waiting and it will delete the cvar as soon as it can
+				LockGuard lock(m_pendingWarmupJobsMtx);
+				--m_pendingWarmupJobCount;
+				if(m_pendingWarmupJobCount == 0)
+				{
+					m_pendingWarmupJobsCvar.notifyAll();
+				}
+			});
 		}
 		else
 		{
-			// Found, remove the PSO that was proactively created and use the old one
-			vkDestroyPipeline(getVkDevice(), pso, nullptr);
-			pso = *it;
+			warmupPipeline(prog, staticState);
 		}
 	}
+}
 
-	// Final thing, bind the PSO
-	vkCmdBindPipeline(cmdb, VK_PIPELINE_BIND_POINT_GRAPHICS, pso);
+void GraphicsPipelineFactory::warmupPipeline(const ShaderProgramImpl& prog, const GraphicsStateTracker::StaticState& staticState)
+{
+	ANKI_TRACE_SCOPED_EVENT(VkPipelineWarmup);
+
+	// Compute the hash the same way flushState() does
+	GraphicsStateTracker state;
+	state.m_staticState = staticState;
+	state.m_staticState.m_shaderProg = const_cast<ShaderProgramImpl*>(&prog);
+	state.updateHashes();
+
+	{
+		RLockGuard lock(m_mtx);
+		if(m_map.find(state.m_globalHash) != m_map.getEnd())
+		{
+			return;
+		}
+	}
+
+	VkPipeline pso = createPipeline(state.m_staticState);
+
+	WLockGuard lock(m_mtx);
+	if(m_map.find(state.m_globalHash) == m_map.getEnd())
+	{
+		m_map.emplace(state.m_globalHash, Pipeline{pso, true});
+		g_svarPipelinesWarmedUp.increment(1);
+	}
+	else
+	{
+		// A draw needed it before the warm-up was done
+		vkDestroyPipeline(getVkDevice(), pso, nullptr);
+	}
 }
 
 Error PipelineCache::init(CString cacheDir)
@@ -454,6 +583,10 @@ Error PipelineCache::init(CString cacheDir)
 
 	ANKI_VK_CHECK(vkCreatePipelineCache(getVkDevice(), &ci, nullptr, &m_cacheHandle));
 
+	// Load the manifest
+	m_manifestFilename.sprintf("%s/VkPipelineManifest", cacheDir.cstr());
+	ANKI_CHECK(loadManifest());
+
 #if ANKI_PLATFORM_MOBILE
 	ANKI_ASSERT(GrManager::getSingleton().getDeviceCapabilities().m_gpuVendor != GpuVendor::kUnknown);
 	if(GrManager::getSingleton().getDeviceCapabilities().m_gpuVendor == GpuVendor::kQualcomm)
@@ -469,13 +602,27 @@ Error PipelineCache::init(CString cacheDir)
 
 void PipelineCache::destroy()
 {
-	const Error err = destroyInternal();
+	Error err = destroyInternal();
 	if(err)
 	{
 		ANKI_VK_LOGE("An error occurred while storing the pipeline cache to disk. Will ignore");
 	}
 
+	if(g_cvarGrRecordPipelineManifest && m_manifestFilename)
+	{
+		err = storeManifest();
+		if(err)
+		{
+			ANKI_VK_LOGE("An error occurred while storing the pipeline manifest to disk. Will ignore");
+		}
+	}
+
 	m_dumpFilename.destroy();
+	m_manifestFilename.destroy();
+	m_manifestProgramHashes.destroy();
+	m_manifestStates.destroy();
+	m_recordedManifest.destroy();
+	m_manifestPipelineHashes.destroy();
 }
 
 Error PipelineCache::destroyInternal()
@@ -519,4 +666,205 @@ Error PipelineCache::destroyInternal()
 	return Error::kNone;
 }
 
+U64 PipelineCache::computeManifestPipelineHash(U64 programHash, const GraphicsStateTracker::StaticState& staticState)
+{
+	// Use the hashing of the state tracker but replace the UUID of the program with something that is the same between runs
+	GraphicsStateTracker state;
+	state.m_staticState = staticState;
+	state.m_hashes.m_shaderProg = programHash;
+	state.updateHashes();
+	return state.m_globalHash;
+}
+
+template<typename TFunc>
+void PipelineCache::visitManifestState(GraphicsStateTracker::StaticState& state, TFunc func)
+{
+	auto& vert = state.m_vert;
+	vert.m_activeAttribs = func(vert.m_activeAttribs);
+	vert.m_attribsSetMask = func(vert.m_attribsSetMask);
+	vert.m_bindingsSetMask = func(vert.m_bindingsSetMask);
+	for(U32 i = 0; i < vert.m_bindings.getSize(); ++i)
+	{
+		if(vert.m_bindingsSetMask.get(i))
+		{
+			auto& binding = vert.m_bindings[i];
+			binding.m_stride = func(binding.m_stride);
+			binding.m_stepRate = func(binding.m_stepRate);
+		}
+	}
+	for(VertexAttributeSemantic i : EnumBitsIterable<VertexAttributeSemantic, VertexAttributeSemanticBit>(vert.m_attribsSetMask))
+	{
+		auto& attrib = vert.m_attribs[i];
+		attrib.m_relativeOffset = func(attrib.m_relativeOffset);
+		attrib.m_fmt = func(attrib.m_fmt);
+		attrib.m_binding = func(attrib.m_binding);
+		attrib.m_semanticToVertexAttributeLocation = func(attrib.m_semanticToVertexAttributeLocation);
+	}
+
+	state.m_ia.m_topology = func(state.m_ia.m_topology);
+	state.m_ia.m_primitiveRestartEnabled = func(state.m_ia.m_primitiveRestartEnabled);
+
+	state.m_rast.m_fillMode = func(state.m_rast.m_fillMode);
+	state.m_rast.m_cullMode = func(state.m_rast.m_cullMode);
+	state.m_rast.m_depthBiasEnabled = func(state.m_rast.m_depthBiasEnabled);
+
+	for(auto& face : state.m_stencil.m_face)
+	{
+		face.m_fail = func(face.m_fail);
+		face.m_stencilPassDepthFail = func(face.m_stencilPassDepthFail);
+		face.m_stencilPassDepthPass = func(face.m_stencilPassDepthPass);
+		face.m_compare = func(face.m_compare);
+	}
+
+	state.m_depth.m_compare = func(state.m_depth.m_compare);
+	state.m_depth.m_writeEnabled = func(state.m_depth.m_writeEnabled);
+
+	for(auto& rt : state.m_blend.m_colorRts)
+	{
+		rt.m_channelWriteMask = func(rt.m_channelWriteMask);
+		rt.m_srcRgb = func(rt.m_srcRgb);
+		rt.m_dstRgb = func(rt.m_dstRgb);
+		rt.m_srcA = func(rt.m_srcA);
+		rt.m_dstA = func(rt.m_dstA);
+		rt.m_funcRgb = func(rt.m_funcRgb);
+		rt.m_funcA = func(rt.m_funcA);
+	}
+	state.m_blend.m_alphaToCoverage = func(state.m_blend.m_alphaToCoverage);
+
+	for(U32 i = 0; i < state.m_misc.m_colorRtFormats.getSize(); ++i)
+	{
+		state.m_misc.m_colorRtFormats[i] = func(state.m_misc.m_colorRtFormats[i]);
+	}
+	state.m_misc.m_depthStencilFormat = func(state.m_misc.m_depthStencilFormat);
+	state.m_misc.m_colorRtMask = func(state.m_misc.m_colorRtMask);
+	state.m_misc.m_pipelineStatisticsEnabled = func(state.m_misc.m_pipelineStatisticsEnabled);
+}
+
+Error PipelineCache::loadManifest()
+{
+	if(!fileExists(m_manifestFilename.toCString()))
+	{
+		ANKI_VK_LOGI("Pipeline manifest not found: %s", m_manifestFilename.cstr());
+		return Error::kNone;
+	}
+
+	File file;
+	ANKI_CHECK(file.open(m_manifestFilename.toCString(), FileOpenFlag::kBinary | FileOpenFlag::kRead));
+
+	Array<Char, kPipelineManifestMagic.getSize()> magic;
+	U32 version, count;
+	ANKI_CHECK(file.read(magic.getBegin(), magic.getSizeInBytes()));
+	ANKI_CHECK(file.read(&version, sizeof(version)));
+	ANKI_CHECK(file.read(&count, sizeof(count)));
+
+	if(magic != kPipelineManifestMagic || version != kManifestVersion)
+	{
+		ANKI_VK_LOGI("Pipeline manifest is not compatible with this build. Will ignore it: %s", m_manifestFilename.cstr());
+		return Error::kNone;
+	}
+
+	GrDynamicArray<ManifestPipeline> pipelines;
+	pipelines.resize(count);
+	for(ManifestPipeline& pipeline : pipelines)
+	{
+		ANKI_CHECK(file.read(&pipeline.m_programHash, sizeof(pipeline.m_programHash)));
+
+		zeroMemory(pipeline.m_state); // The members that are not stored and the m_shaderProg
+		Error err = Error::kNone;
+		visitManifestState(pipeline.m_state, [&](auto value) {
+			if(!err)
+			{
+				err = file.read(&value, sizeof(value));
+			}
+			return value;
+		});
+		ANKI_CHECK(err);
+	}
+
+	// Sort them by program so the pipelines of a program are contiguous
+	std::sort(pipelines.getBegin(), pipelines.getEnd(), [](const ManifestPipeline& a, const ManifestPipeline& b) {
+		return a.m_programHash < b.m_programHash;
+	});
+
+	m_manifestProgramHashes.resize(count);
+	m_manifestStates.resize(count);
+	for(U32 i = 0; i < count; ++i)
+	{
+		m_manifestProgramHashes[i] = pipelines[i].m_programHash;
+		m_manifestStates[i] = pipelines[i].m_state;
+		m_manifestPipelineHashes.emplace(computeManifestPipelineHash(pipelines[i].m_programHash, pipelines[i].m_state), true);
+	}
+
+	ANKI_VK_LOGI("Loaded a pipeline manifest with %u pipelines", count);
+	return Error::kNone;
+}
+
+Error PipelineCache::storeManifest()
+{
+	const U32 count = m_manifestStates.getSize() + m_recordedManifest.getSize();
+
+	File file;
+	ANKI_CHECK(file.open(m_manifestFilename.toCString(), FileOpenFlag::kBinary | FileOpenFlag::kWrite));
+
+	const U32 version = kManifestVersion;
+	ANKI_CHECK(file.write(kPipelineManifestMagic.getBegin(), kPipelineManifestMagic.getSizeInBytes()));
+	ANKI_CHECK(file.write(&version, sizeof(version)));
+	ANKI_CHECK(file.write(&count, sizeof(count)));
+
+	auto writePipeline = [&](U64 programHash, const GraphicsStateTracker::StaticState& staticState) -> Error {
+		ANKI_CHECK(file.write(&programHash, sizeof(programHash)));
+
+		GraphicsStateTracker::StaticState copy = staticState;
+		Error err = Error::kNone;
+		visitManifestState(copy, [&](auto value) {
+			if(!err)
+			{
+				err = file.write(&value, sizeof(value));
+			}
+			return value;
+		});
+		return err;
+	};
+
+	for(U32 i = 0; i < m_manifestStates.getSize(); ++i)
+	{
+		ANKI_CHECK(writePipeline(m_manifestProgramHashes[i], m_manifestStates[i]));
+	}
+
+	for(const ManifestPipeline& pipeline : m_recordedManifest)
+	{
+		ANKI_CHECK(writePipeline(pipeline.m_programHash, pipeline.m_state));
+	}
+
+	ANKI_VK_LOGI("Stored a pipeline manifest with %u pipelines (%u new)", count, m_recordedManifest.getSize());
+	return Error::kNone;
+}
+
+ConstWeakArray<GraphicsStateTracker::StaticState> PipelineCache::getManifestPipelines(U64 programHash) const
+{
+	const U64* begin = std::lower_bound(m_manifestProgramHashes.getBegin(), m_manifestProgramHashes.getEnd(), programHash);
+	const U64* end = std::upper_bound(begin, m_manifestProgramHashes.getEnd(), programHash);
+
+	const U32 first = U32(begin - m_manifestProgramHashes.getBegin());
+	const U32 count = U32(end - begin);
+	return (count) ? ConstWeakArray<GraphicsStateTracker::StaticState>(&m_manifestStates[first], count)
+				   : ConstWeakArray<GraphicsStateTracker::StaticState>();
+}
+
+void PipelineCache::recordManifestPipeline(U64 programHash, const GraphicsStateTracker::StaticState& staticState)
+{
+	const U64 pipelineHash = computeManifestPipelineHash(programHash, staticState);
+
+	LockGuard lock(m_manifestMtx);
+
+	if(m_manifestPipelineHashes.find(pipelineHash) == m_manifestPipelineHashes.getEnd())
+	{
+		m_manifestPipelineHashes.emplace(pipelineHash, true);
+		ManifestPipeline& pipeline = *m_recordedManifest.emplaceBack();
+		pipeline.m_programHash = programHash;
+		pipeline.m_state = staticState;
+		pipeline.m_state.m_shaderProg = nullptr;
+	}
+}
+
 } // end namespace anki
@@ -15,6 +15,10 @@ namespace anki {
 /// @addtogroup vulkan
 /// @{
 
+// Forward
+class ShaderProgramImpl;
+
+/// Creates and caches the graphics pipelines of a single shader program.
 class GraphicsPipelineFactory
 {
 public:
@@ -24,12 +28,31 @@ public:
 	/// @note It's thread-safe.
 	void flushState(GraphicsStateTracker& state, VkCommandBuffer& cmdb);
 
+	/// Start creating the pipelines that the pipeline manifest has for this program. They are created by the background job threads so the frame
+	/// doesn't wait for them.
+	void warmup(const ShaderProgramImpl& prog);
+
 private:
-	GrHashMap<U64, VkPipeline> m_map;
+	class Pipeline
+	{
+	public:
+		VkPipeline m_handle = VK_NULL_HANDLE;
+		Bool m_warm = false; ///< Created by the warm-up and not used yet.
+	};
+
+	GrHashMap<U64, Pipeline> m_map;
 	RWMutex m_mtx;
+
+	U32 m_pendingWarmupJobCount = 0;
+	Mutex m_pendingWarmupJobsMtx;
+	ConditionVariable m_pendingWarmupJobsCvar; ///< Signaled when m_pendingWarmupJobCount reaches zero.
+
+	static VkPipeline createPipeline(const GraphicsStateTracker::StaticState& staticState);
+
+	void warmupPipeline(const ShaderProgramImpl& prog, const GraphicsStateTracker::StaticState& staticState);
 };
 
-/// On disk pipeline cache.
+/// On disk pipeline cache. It also holds the pipeline manifest, the graphics pipelines previous runs created.
 class PipelineCache : public MakeSingleton<PipelineCache>
 {
 public:
@@ -46,12 +69,48 @@ public:
 
 	Error init(CString cacheDir);
 
+	/// Get the states of the pipelines that the manifest has for a program.
+	/// @param programHash See ShaderProgramImpl::getGraphicsBinaryHash.
+	ConstWeakArray<GraphicsStateTracker::StaticState> getManifestPipelines(U64 programHash) const;
+
+	/// Add a pipeline to the manifest. It will be written to disk at shutdown. Thread-safe.
+	void recordManifestPipeline(U64 programHash, const GraphicsStateTracker::StaticState& staticState);
+
 private:
+	static constexpr U32 kManifestVersion = 2;
+
+	class ManifestPipeline
+	{
+	public:
+		U64 m_programHash;
+		GraphicsStateTracker::StaticState m_state;
+	};
+
 	GrString m_dumpFilename;
 	PtrSize m_dumpSize = 0;
 
+	/// What was loaded from the disk. Sorted by program hash. Immutable after init.
+	GrString m_manifestFilename;
+	GrDynamicArray<U64> m_manifestProgramHashes;
+	GrDynamicArray<GraphicsStateTracker::StaticState> m_manifestStates;
+
+	GrDynamicArray<ManifestPipeline> m_recordedManifest; ///< Pipelines this run created that the loaded manifest doesn't have.
+	GrHashMap<U64, Bool> m_manifestPipelineHashes; ///< All pipelines of the manifest, loaded and recorded. See computeManifestPipelineHash.
+	Mutex m_manifestMtx;
+
 	void destroy();
 	Error destroyInternal();
+
+	Error loadManifest();
+	Error storeManifest();
+
+	/// Compute a hash for a pipeline that doesn't depend on run-time things like the shader program UUID.
+	static U64 computeManifestPipelineHash(U64 programHash, const GraphicsStateTracker::StaticState& staticState);
+
+	/// Call func for all the members of a StaticState that the manifest stores. The manifest is serialized member by member so the file doesn't
+	/// depend on the layout and the padding of StaticState. func gets the value of a member and returns the value to store back to it.
+	template<typename TFunc>
+	static void visitManifestState(GraphicsStateTracker::StaticState& state, TFunc func);
 };
 /// @}
 
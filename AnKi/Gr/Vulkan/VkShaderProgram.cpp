@@ -121,6 +121,12 @@ ConstWeakArray<U8> ShaderProgram::getShaderGroupHandles() const
 
 ShaderProgramImpl::~ShaderProgramImpl()
 {
+	// Delete the factory first because it waits for the warm-up jobs that use the shader modules
+	if(m_graphics.m_pplineFactory)
+	{
+		deleteInstance(GrMemoryPool::getSingleton(), m_graphics.m_pplineFactory);
+	}
+
 	const Bool graphicsProg = !!(m_shaderTypes & ShaderTypeBit::kAllGraphics);
 	if(graphicsProg)
 	{
@@ -133,11 +139,6 @@ ShaderProgramImpl::~ShaderProgramImpl()
 		}
 	}
 
-	if(m_graphics.m_pplineFactory)
-	{
-		deleteInstance(GrMemoryPool::getSingleton(), m_graphics.m_pplineFactory);
-	}
-
 	if(m_compute.m_ppline)
 	{
 		vkDestroyPipeline(getVkDevice(), m_compute.m_ppline, nullptr);
@@ -285,11 +286,21 @@ Error ShaderProgramImpl::init(const ShaderProgramInitInfo& inf)
 		}
 	}
 
-	// Create the factory
+	// Create the factory and start creating the pipelines that previous runs used
 	//
 	if(graphicsProg)
 	{
+		U64 hash = 0xC0FEE;
+		for(const ShaderInternalPtr& shader : m_shaders)
+		{
+			const ShaderImpl& shaderImpl = static_cast<const ShaderImpl&>(*shader);
+			hash = appendObjectHash(shaderImpl.getShaderType(), hash);
+			hash = appendHash(shaderImpl.m_spirvBin.getBegin(), shaderImpl.m_spirvBin.getSizeInBytes(), hash);
+		}
+		m_graphics.m_binaryHash = hash;
+
 		m_graphics.m_pplineFactory = anki::newInstance<GraphicsPipelineFactory>(GrMemoryPool::getSingleton());
+		m_graphics.m_pplineFactory->warmup(*this);
 	}
 
 	// Create the pipeline if compute
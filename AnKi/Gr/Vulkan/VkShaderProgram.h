@@ -54,6 +54,13 @@ public:
 		return *m_graphics.m_pplineFactory;
 	}
 
+	/// A hash of the SPIR-V of all the shaders. Unlike the UUID it's the same between runs. Only for graphics programs.
+	U64 getGraphicsBinaryHash() const
+	{
+		ANKI_ASSERT(m_graphics.m_binaryHash);
+		return m_graphics.m_binaryHash;
+	}
+
 	VkPipeline getComputePipelineHandle() const
 	{
 		ANKI_ASSERT(m_compute.m_ppline);
@@ -95,6 +102,7 @@ private:
 		Array<VkPipelineShaderStageCreateInfo, U32(ShaderType::kPixel - ShaderType::kVertex) + 1> m_shaderCreateInfos = {};
 		U32 m_shaderCreateInfoCount = 0;
 		GraphicsPipelineFactory* m_pplineFactory = nullptr;
+		U64 m_binaryHash = 0;
 	} m_graphics;
 
 	class
@@ -451,6 +451,12 @@ void TextureImpl::computeBarrierInfo(TextureUsageBit usage, VkPipelineStageFlags
 		accesses |= VK_ACCESS_FRAGMENT_SHADING_RATE_ATTACHMENT_READ_BIT_KHR;
 	}
 
+	if(!!(usage & TextureUsageBit::kCopySource))
+	{
+		stages |= VK_PIPELINE_STAGE_TRANSFER_BIT;
+		accesses |= VK_ACCESS_TRANSFER_READ_BIT;
+	}
+
 	if(!!(usage & TextureUsageBit::kCopyDestination))
 	{
 		stages |= VK_PIPELINE_STAGE_TRANSFER_BIT;
@@ -543,6 +549,10 @@ VkImageLayout TextureImpl::computeLayout(TextureUsageBit usage) const
 		// Only sampled
 		out = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 	}
+	else if(usage == TextureUsageBit::kCopySource)
+	{
+		out = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	}
 	else if(usage == TextureUsageBit::kCopyDestination)
 	{
 		out = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
@@ -4,31 +4,23 @@
 // http://www.anki3d.org/LICENSE
 
 #include <AnKi/Importer/GltfImporter.h>
-#include <AnKi/Util/Xml.h>
+#include <AnKi/Resource/AnimationResource.h>
 
 namespace anki {
 
-template<typename T>
-class GltfAnimKey
-{
-public:
-	Second m_time;
-	T m_value;
-};
-
 class GltfAnimChannel
 {
 public:
 	ImporterString m_name;
-	ImporterDynamicArray<GltfAnimKey<Vec3>> m_positions;
-	ImporterDynamicArray<GltfAnimKey<Quat>> m_rotations;
-	ImporterDynamicArray<GltfAnimKey<F32>> m_scales;
+	ImporterDynamicArray<AnimationKeyframe<Vec3>> m_positions;
+	ImporterDynamicArray<AnimationKeyframe<Quat>> m_rotations;
+	ImporterDynamicArray<AnimationKeyframe<F32>> m_scales;
 	const cgltf_node* m_targetNode;
 };
 
 /// Optimize out same animation keys.
 template<typename T, typename TIsIdentityFunc, typename TAlmostEqualFunc, typename TLerpFunc>
-static void optimizeChannel(ImporterDynamicArray<GltfAnimKey<T>>& arr, TIsIdentityFunc isIdentityFunc, TAlmostEqualFunc almostEqualFunc,
+static void optimizeChannel(ImporterDynamicArray<AnimationKeyframe<T>>& arr, TIsIdentityFunc isIdentityFunc, TAlmostEqualFunc almostEqualFunc,
 							TLerpFunc lerpFunc)
 {
 	constexpr F32 kMinSkippedToTotalRatio = 0.1f;
@@ -41,13 +33,13 @@ static void optimizeChannel(ImporterDynamicArray<GltfAnimKey<T>>& arr, TIsIdenti
 			break;
 		}
 
-		ImporterDynamicArray<GltfAnimKey<T>> newArr;
+		ImporterDynamicArray<AnimationKeyframe<T>> newArr;
 		U32 it = 0;
 		while(true)
 		{
-			const GltfAnimKey<T>& left = arr[it];
-			const GltfAnimKey<T>& middle = arr[it + 1];
-			const GltfAnimKey<T>& right = arr[it + 2];
+			const AnimationKeyframe<T>& left = arr[it];
+			const AnimationKeyframe<T>& middle = arr[it + 1];
+			const AnimationKeyframe<T>& right = arr[it + 2];
 
 			newArr.emplaceBack(left);
 
@@ -182,7 +174,7 @@ Error GltfImporter::writeAnimation(const cgltf_animation& anim)
 
 			for(U32 i = 0; i < keys.getSize(); ++i)
 			{
-				GltfAnimKey<Vec3> key;
+				AnimationKeyframe<Vec3> key;
 				key.m_time = keys[i];
 				key.m_value = Vec3(positions[i].x, positions[i].y, positions[i].z);
 
@@ -206,7 +198,7 @@ Error GltfImporter::writeAnimation(const cgltf_animation& anim)
 
 			for(U32 i = 0; i < keys.getSize(); ++i)
 			{
-				GltfAnimKey<Quat> key;
+				AnimationKeyframe<Quat> key;
 				key.m_time = keys[i];
 				key.m_value = Quat(rotations[i].x, rotations[i].y, rotations[i].z, rotations[i].w);
 
@@ -242,7 +234,7 @@ Error GltfImporter::writeAnimation(const cgltf_animation& anim)
 					scaleErrorReported = true;
 				}
 
-				GltfAnimKey<F32> key;
+				AnimationKeyframe<F32> key;
 				key.m_time = keys[i];
 				key.m_value = scales[i][0];
 
@@ -300,56 +292,38 @@ Error GltfImporter::writeAnimation(const cgltf_animation& anim)
 		}
 	}
 
+	// Sample the keys uniformly
+	AnimationBinaryHeader header;
+	ImporterDynamicArray<AnimationBinaryChannel> channels;
+	ImporterDynamicArray<Vec3> positions;
+	ImporterDynamicArray<I16Vec4> rotations;
+	ImporterDynamicArray<F32> scales;
+	ANKI_CHECK(sampleAnimationKeyframes(ConstWeakArray<GltfAnimChannel>(tempChannels), header, channels, positions, rotations, scales));
+
+	ANKI_IMPORTER_LOGV("Animation has %u channels, %u frames, %u position, %u rotation and %u scale tracks", header.m_channelCount,
+					   header.m_frameCount, header.m_positionTrackCount, header.m_rotationTrackCount, header.m_scaleTrackCount);
+
 	// Write file
 	File file;
-	ANKI_CHECK(file.open(fname.toCString(), FileOpenFlag::kWrite));
+	ANKI_CHECK(file.open(fname.toCString(), FileOpenFlag::kWrite | FileOpenFlag::kBinary));
 
-	ANKI_CHECK(file.writeTextf("%s\n<animation>\n", XmlDocument<MemoryPoolPtrWrapper<BaseMemoryPool>>::kXmlHeader.cstr()));
-	ANKI_CHECK(file.writeText("\t<channels>\n"));
+	ANKI_CHECK(file.write(&header, sizeof(header)));
+	ANKI_CHECK(file.write(channels.getBegin(), channels.getSizeInBytes()));
 
-	for(const GltfAnimChannel& channel : tempChannels)
+	if(positions.getSize())
 	{
-		ANKI_CHECK(file.writeTextf("\t\t<channel name=\"%s\">\n", channel.m_name.cstr()));
-
-		// Positions
-		if(channel.m_positions.getSize())
-		{
-			ANKI_CHECK(file.writeText("\t\t\t<positionKeys>\n"));
-			for(const GltfAnimKey<Vec3>& key : channel.m_positions)
-			{
-				ANKI_CHECK(file.writeTextf("\t\t\t\t<key time=\"%f\">%f %f %f</key>\n", key.m_time, key.m_value.x, key.m_value.y, key.m_value.z));
-			}
-			ANKI_CHECK(file.writeText("\t\t\t</positionKeys>\n"));
-		}
-
-		// Rotations
-		if(channel.m_rotations.getSize())
-		{
-			ANKI_CHECK(file.writeText("\t\t\t<rotationKeys>\n"));
-			for(const GltfAnimKey<Quat>& key : channel.m_rotations)
-			{
-				ANKI_CHECK(file.writeTextf("\t\t\t\t<key time=\"%f\">%f %f %f %f</key>\n", key.m_time, key.m_value.x, key.m_value.y, key.m_value.z,
-										   key.m_value.w));
-			}
-			ANKI_CHECK(file.writeText("\t\t\t</rotationKeys>\n"));
-		}
-
-		// Scales
-		if(channel.m_scales.getSize())
-		{
-			ANKI_CHECK(file.writeText("\t\t\t<scaleKeys>\n"));
-			for(const GltfAnimKey<F32>& key : channel.m_scales)
-			{
-				ANKI_CHECK(file.writeTextf("\t\t\t\t<key time=\"%f\">%f</key>\n", key.m_time, key.m_value));
-			}
-			ANKI_CHECK(file.writeText("\t\t\t</scaleKeys>\n"));
-		}
+		ANKI_CHECK(file.write(positions.getBegin(), positions.getSizeInBytes()));
+	}
 
-		ANKI_CHECK(file.writeText("\t\t</channel>\n"));
+	if(rotations.getSize())
+	{
+		ANKI_CHECK(file.write(rotations.getBegin(), rotations.getSizeInBytes()));
 	}
 
-	ANKI_CHECK(file.writeText("\t</channels>\n"));
-	ANKI_CHECK(file.writeText("</animation>\n"));
+	if(scales.getSize())
+	{
+		ANKI_CHECK(file.write(scales.getBegin(), scales.getSizeInBytes()));
+	}
 
 	// Hook up the animation to the scene
 	for(const GltfAnimChannel& channel : tempChannels)
@@ -857,9 +857,21 @@ public:
 	template<typename Y>
 	explicit TVec(const TVec<Y, kTComponentCount>& b) requires(!std::is_same<Y, T>::value)
 	{
-		for(U32 i = 0; i < kTComponentCount; i++)
+		if constexpr(kVec4Simd && std::is_same<Y, I16>::value)
+		{
+			// Used to unpack 16bit snorm data so make it fast
+#if ANKI_SIMD_SSE
+			m_simd = _mm_cvtepi32_ps(_mm_cvtepi16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(&b.m_arr[0]))));
+#else
+			m_simd = vcvtq_f32_s32(vmovl_s16(vld1_s16(&b.m_arr[0])));
+#endif
+		}
+		else
 		{
-			m_arr[i] = T(b[i]);
+			for(U32 i = 0; i < kTComponentCount; i++)
+			{
+				m_arr[i] = T(b[i]);
+			}
 		}
 	}
 
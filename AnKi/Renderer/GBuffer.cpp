@@ -15,6 +15,8 @@
 #include <AnKi/Core/App.h>
 #include <AnKi/Scene/Components/GlobalIlluminationProbeComponent.h>
 #include <AnKi/Scene/Components/ReflectionProbeComponent.h>
+#include <AnKi/Scene/SceneGraph.h>
+#include <AnKi/GpuMemory/RebarTransientMemoryPool.h>
 
 namespace anki {
 
@@ -95,6 +97,7 @@ void GBuffer::populateRenderGraph()
 	// Visibility
 	GpuVisibilityOutput& visOut = m_runCtx.m_visOut;
 	FrustumGpuVisibilityInput visIn;
+	RenderTargetHandle cpuHzbRt;
 	{
 		const CommonMatrices& matrices = getRenderingContext().m_matrices;
 		const Array<F32, kMaxLodCount - 1> lodDistances = {g_cvarRenderLod0MaxDistance, g_cvarRenderLod1MaxDistance};
@@ -110,6 +113,15 @@ void GBuffer::populateRenderGraph()
 		visIn.m_viewportSize = getRenderer().getInternalResolution();
 		visIn.m_twoPhaseOcclusionCulling = getRenderer().getMeshletRenderingType() != MeshletRenderingType::kNone;
 
+		// The HZB of the previous frame lags behind the camera. If the scene rasterized the occluders for this frame use them instead. The 2 phase
+		// occlusion culling fixes the lag on its own so leave it be
+		const SoftwareRasterizer* rasterizer = SceneGraph::getSingleton().getOcclusionRasterizer();
+		if(rasterizer && !visIn.m_twoPhaseOcclusionCulling)
+		{
+			cpuHzbRt = uploadCpuOcclusionDepth(*rasterizer);
+			visIn.m_hzbRt = &cpuHzbRt;
+		}
+
 		getRenderer().getGpuVisibility().populateRenderGraph(visIn, visOut);
 	}
 
@@ -268,6 +280,55 @@ void GBuffer::populateRenderGraph()
 	}
 }
 
+RenderTargetHandle GBuffer::uploadCpuOcclusionDepth(const SoftwareRasterizer& rasterizer)
+{
+	RenderGraphBuilder& rgraph = getRenderingContext().m_renderGraphDescr;
+
+	RenderTargetDesc rtDesc = getRenderer().create2DRenderTargetDescription(rasterizer.getSize().x, rasterizer.getSize().y, Format::kR32_Sfloat,
+																			 "GBuffer CPU HZB");
+	rtDesc.m_mipmapCount = U8(rasterizer.getMipCount());
+	rtDesc.bake();
+	const RenderTargetHandle rt = rgraph.newRenderTarget(rtDesc);
+
+	// Copy the depth now. The rasterizer will be overwritten by the next scene update. All mips go to the same buffer one after the other
+	U32 texelCount = 0;
+	for(U32 mip = 0; mip < rasterizer.getMipCount(); ++mip)
+	{
+		texelCount += rasterizer.getHierarchicalDepth(mip).getSize();
+	}
+
+	WeakArray<F32> texels;
+	const BufferView buff = RebarTransientMemoryPool::getSingleton().allocateCopyBuffer(texelCount, texels);
+	U32 texelOffset = 0;
+	for(U32 mip = 0; mip < rasterizer.getMipCount(); ++mip)
+	{
+		const ConstWeakArray<F32> src = rasterizer.getHierarchicalDepth(mip);
+		memcpy(&texels[texelOffset], src.getBegin(), src.getSizeInBytes());
+		texelOffset += src.getSize();
+	}
+
+	NonGraphicsRenderPass& pass = rgraph.newNonGraphicsRenderPass("GBuffer CPU HZB upload");
+	pass.newTextureDependency(rt, TextureUsageBit::kCopyDestination);
+
+	pass.setWork([buff, rt](RenderPassWorkContext& rgraphCtx) {
+		ANKI_TRACE_SCOPED_EVENT(GBufferCpuHzbUpload);
+		CommandBuffer& cmdb = *rgraphCtx.m_commandBuffer;
+
+		Texture* tex;
+		rgraphCtx.getRenderTargetState(rt, TextureSubresourceDesc::all(), tex);
+		PtrSize offset = 0;
+		for(U32 mip = 0; mip < tex->getMipmapCount(); ++mip)
+		{
+			const PtrSize mipSize = PtrSize(tex->getWidth() >> mip) * (tex->getHeight() >> mip) * sizeof(F32);
+			cmdb.copyBufferToTexture(BufferView(buff).incrementOffset(offset).setRange(mipSize),
+									 TextureView(tex, TextureSubresourceDesc::surface(mip, 0, 0)));
+			offset += mipSize;
+		}
+	});
+
+	return rt;
+}
+
 void GBuffer::getDebugRenderTarget(CString rtName, Array<RenderTargetHandle, U32(DebugRenderTargetRegister::kCount)>& handles,
 								   DebugRenderTargetDrawStyle& drawStyle) const
 {
@@ -85,6 +85,8 @@ private:
 
 		GpuVisibilityOutput m_visOut;
 	} m_runCtx;
+
+	RenderTargetHandle uploadCpuOcclusionDepth(const SoftwareRasterizer& rasterizer);
 };
 
 } // end namespace anki
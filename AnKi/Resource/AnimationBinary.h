@@ -0,0 +1,132 @@
+// Copyright (C) 2009-present, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+// WARNING: This file is auto generated.
+
+#pragma once
+
+#include <AnKi/Resource/Common.h>
+#include <AnKi/Math.h>
+
+namespace anki {
+
+inline constexpr const char* kAnimationMagic = "ANKIANI1";
+
+// The tracks are sampled uniformly. The rate is derived from the smallest distance between keyframes and it's clamped to this range
+inline constexpr F64 kMinAnimationSampleRate = 30.0;
+inline constexpr F64 kMaxAnimationSampleRate = 120.0;
+
+inline constexpr U32 kMaxAnimationChannelNameLength = 128;
+
+// After the AnimationBinaryChannel array come the samples of all the position tracks (Vec3), then the rotation tracks (I16Vec4) and then the
+// scale tracks (F32). The samples are frame major: all the position tracks of the 1st frame, then all the position tracks of the 2nd etc
+
+// The track of a channel that is constant
+inline constexpr U32 kConstantAnimationTrack = kMaxU32;
+
+// Rotations are stored as 16bit snorm quaternions. The rotations of a track are in the same hemisphere so that they can be lerped
+inline I16Vec4 packAnimationRotation(const Quat& q)
+{
+	return I16Vec4((Vec4(q).clamp(-1.0f, 1.0f) * 32767.0f).round());
+}
+
+inline Quat unpackAnimationRotation(I16Vec4 q)
+{
+	return Quat(Vec4(q).normalize());
+}
+
+// The 1st thing that appears in an animation binary.
+class AnimationBinaryHeader
+{
+public:
+	Array<U8, 8> m_magic;
+	U32 m_channelCount;
+
+	// The number of samples of every non-constant track.
+	U32 m_frameCount;
+
+	U32 m_positionTrackCount;
+	U32 m_rotationTrackCount;
+	U32 m_scaleTrackCount;
+	F32 m_startTime;
+	F32 m_duration;
+
+	template<typename TSerializer, typename TClass>
+	static void serializeCommon(TSerializer& s, TClass self)
+	{
+		s.doArray("m_magic", offsetof(AnimationBinaryHeader, m_magic), &self.m_magic[0], self.m_magic.getSize());
+		s.doValue("m_channelCount", offsetof(AnimationBinaryHeader, m_channelCount), self.m_channelCount);
+		s.doValue("m_frameCount", offsetof(AnimationBinaryHeader, m_frameCount), self.m_frameCount);
+		s.doValue("m_positionTrackCount", offsetof(AnimationBinaryHeader, m_positionTrackCount), self.m_positionTrackCount);
+		s.doValue("m_rotationTrackCount", offsetof(AnimationBinaryHeader, m_rotationTrackCount), self.m_rotationTrackCount);
+		s.doValue("m_scaleTrackCount", offsetof(AnimationBinaryHeader, m_scaleTrackCount), self.m_scaleTrackCount);
+		s.doValue("m_startTime", offsetof(AnimationBinaryHeader, m_startTime), self.m_startTime);
+		s.doValue("m_duration", offsetof(AnimationBinaryHeader, m_duration), self.m_duration);
+	}
+
+	template<typename TDeserializer>
+	void deserialize(TDeserializer& deserializer)
+	{
+		serializeCommon<TDeserializer, AnimationBinaryHeader&>(deserializer, *this);
+	}
+
+	template<typename TSerializer>
+	void serialize(TSerializer& serializer) const
+	{
+		serializeCommon<TSerializer, const AnimationBinaryHeader&>(serializer, *this);
+	}
+};
+
+// The 2nd thing that appears in an animation binary. One per channel.
+class AnimationBinaryChannel
+{
+public:
+	// Null terminated.
+	Array<Char, kMaxAnimationChannelNameLength> m_name;
+
+	// Index of the position track or kConstantAnimationTrack.
+	U32 m_positionTrack;
+
+	// Index of the rotation track or kConstantAnimationTrack.
+	U32 m_rotationTrack;
+
+	// Index of the scale track or kConstantAnimationTrack.
+	U32 m_scaleTrack;
+
+	// Used if the position track is constant.
+	Vec3 m_constantPosition;
+
+	// Used if the rotation track is constant.
+	Vec4 m_constantRotation;
+
+	// Used if the scale track is constant.
+	F32 m_constantScale;
+
+	template<typename TSerializer, typename TClass>
+	static void serializeCommon(TSerializer& s, TClass self)
+	{
+		s.doArray("m_name", offsetof(AnimationBinaryChannel, m_name), &self.m_name[0], self.m_name.getSize());
+		s.doValue("m_positionTrack", offsetof(AnimationBinaryChannel, m_positionTrack), self.m_positionTrack);
+		s.doValue("m_rotationTrack", offsetof(AnimationBinaryChannel, m_rotationTrack), self.m_rotationTrack);
+		s.doValue("m_scaleTrack", offsetof(AnimationBinaryChannel, m_scaleTrack), self.m_scaleTrack);
+		s.doValue("m_constantPosition", offsetof(AnimationBinaryChannel, m_constantPosition), self.m_constantPosition);
+		s.doValue("m_constantRotation", offsetof(AnimationBinaryChannel, m_constantRotation), self.m_constantRotation);
+		s.doValue("m_constantScale", offsetof(AnimationBinaryChannel, m_constantScale), self.m_constantScale);
+	}
+
+	template<typename TDeserializer>
+	void deserialize(TDeserializer& deserializer)
+	{
+		serializeCommon<TDeserializer, AnimationBinaryChannel&>(deserializer, *this);
+	}
+
+	template<typename TSerializer>
+	void serialize(TSerializer& serializer) const
+	{
+		serializeCommon<TSerializer, const AnimationBinaryChannel&>(serializer, *this);
+	}
+};
+
+} // end namespace anki
@@ -4,26 +4,128 @@
 // http://www.anki3d.org/LICENSE
 
 #include <AnKi/Resource/AnimationResource.h>
+#include <AnKi/Resource/ResourceFilesystem.h>
 #include <AnKi/Util/Xml.h>
 
 namespace anki {
 
+/// The keyframes of a channel of a text animation.
+class AnimationTextChannel
+{
+public:
+	ResourceString m_name;
+	ResourceDynamicArray<AnimationKeyframe<Vec3>> m_positions;
+	ResourceDynamicArray<AnimationKeyframe<Quat>> m_rotations;
+	ResourceDynamicArray<AnimationKeyframe<F32>> m_scales;
+};
+
+template<typename T, typename TReadValueFunc>
+static Error readKeyframes(const XmlElement& chEl, CString tag, ResourceDynamicArray<AnimationKeyframe<T>>& keys, TReadValueFunc readValue)
+{
+	XmlElement keysEl, keyEl;
+	ANKI_CHECK(chEl.getChildElementOptional(tag, keysEl));
+	if(!keysEl)
+	{
+		return Error::kNone;
+	}
+
+	ANKI_CHECK(keysEl.getChildElement("key", keyEl));
+
+	U32 count = 0;
+	ANKI_CHECK(keyEl.getSiblingElementsCount(count));
+	++count;
+	keys.resize(count);
+
+	count = 0;
+	do
+	{
+		AnimationKeyframe<T>& key = keys[count++];
+		ANKI_CHECK(keyEl.getAttributeNumber("time", key.m_time));
+		ANKI_CHECK(readValue(keyEl, key.m_value));
+
+		// Move to next
+		ANKI_CHECK(keyEl.getNextSiblingElement("key", keyEl));
+	} while(keyEl);
+
+	return Error::kNone;
+}
+
 Error AnimationResource::load(const ResourceFilename& filename, [[maybe_unused]] Bool async)
 {
-	m_startTime = kMaxSecond;
-	Second maxTime = kMinSecond;
+	// Binary animations start with the magic, text ones with the XML header
+	ResourceFilePtr file;
+	ANKI_CHECK(openFile(filename, file));
 
+	Array<U8, 8> magic = {};
+	if(file->getSize() >= sizeof(AnimationBinaryHeader))
+	{
+		ANKI_CHECK(file->read(&magic[0], sizeof(magic)));
+	}
+
+	if(memcmp(&magic[0], kAnimationMagic, sizeof(magic)) == 0)
+	{
+		ANKI_CHECK(file->seek(0, FileSeekOrigin::kBeginning));
+		ANKI_CHECK(loadBinary(*file));
+	}
+	else
+	{
+		file.reset(nullptr);
+		ANKI_CHECK(loadText(filename));
+	}
+
+	setCpuMemoryUsage(m_positions.getSizeInBytes() + m_rotations.getSizeInBytes() + m_scales.getSizeInBytes() + m_channels.getSizeInBytes());
+
+	return Error::kNone;
+}
+
+Error AnimationResource::loadBinary(ResourceFile& file)
+{
+	AnimationBinaryHeader header;
+	ANKI_CHECK(file.read(&header, sizeof(header)));
+
+	if(header.m_channelCount == 0 || header.m_frameCount == 0 || header.m_positionTrackCount > header.m_channelCount
+	   || header.m_rotationTrackCount > header.m_channelCount || header.m_scaleTrackCount > header.m_channelCount || !(header.m_duration >= 0.0f)
+	   || (header.m_frameCount > 1 && header.m_duration == 0.0f))
+	{
+		ANKI_RESOURCE_LOGE("Incorrect animation header");
+		return Error::kUserData;
+	}
+
+	ResourceDynamicArray<AnimationBinaryChannel> channels;
+	channels.resize(header.m_channelCount);
+	ANKI_CHECK(file.read(channels.getBegin(), channels.getSizeInBytes()));
+
+	m_positions.resize(header.m_frameCount * header.m_positionTrackCount);
+	m_rotations.resize(header.m_frameCount * header.m_rotationTrackCount);
+	m_scales.resize(header.m_frameCount * header.m_scaleTrackCount);
+	if(m_positions.getSize())
+	{
+		ANKI_CHECK(file.read(m_positions.getBegin(), m_positions.getSizeInBytes()));
+	}
+
+	if(m_rotations.getSize())
+	{
+		ANKI_CHECK(file.read(m_rotations.getBegin(), m_rotations.getSizeInBytes()));
+	}
+
+	if(m_scales.getSize())
+	{
+		ANKI_CHECK(file.read(m_scales.getBegin(), m_scales.getSizeInBytes()));
+	}
+
+	ANKI_CHECK(init(header, channels));
+
+	return Error::kNone;
+}
+
+Error AnimationResource::loadText(const ResourceFilename& filename)
+{
 	// Document
 	ResourceXmlDocument doc;
 	ANKI_CHECK(openFileParseXml(filename, doc));
 	XmlElement rootel;
 	ANKI_CHECK(doc.getChildElement("animation", rootel));
 
-	// Count the number of identity keys. If all of the keys are identities drop a vector
-	U identPosCount = 0;
-	U identRotCount = 0;
-	U identScaleCount = 0;
-
 	// <channels>
 	XmlElement channelsEl;
 	ANKI_CHECK(rootel.getChildElement("channels", channelsEl));
@@ -33,225 +135,243 @@ Error AnimationResource::load(const ResourceFilename& filename, [[maybe_unused]]
 	U32 channelCount = 0;
 	ANKI_CHECK(chEl.getSiblingElementsCount(channelCount));
 	++channelCount;
-	if(channelCount == 0)
-	{
-		ANKI_RESOURCE_LOGE("Didn't found any channels");
-		return Error::kUserData;
-	}
-	m_channels.resize(channelCount);
+	ResourceDynamicArray<AnimationTextChannel> textChannels;
+	textChannels.resize(channelCount);
 
 	// For all channels
 	channelCount = 0;
 	do
 	{
-		AnimationChannel& ch = m_channels[channelCount];
+		AnimationTextChannel& ch = textChannels[channelCount];
 
 		// <name>
 		CString strtmp;
 		ANKI_CHECK(chEl.getAttributeText("name", strtmp));
 		ch.m_name = strtmp;
 
-		XmlElement keysEl, keyEl;
-
 		// <positionKeys>
-		ANKI_CHECK(chEl.getChildElementOptional("positionKeys", keysEl));
-		if(keysEl)
-		{
-			ANKI_CHECK(keysEl.getChildElement("key", keyEl));
-
-			U32 count = 0;
-			ANKI_CHECK(keyEl.getSiblingElementsCount(count));
-			++count;
-			ch.m_positions.resize(count);
+		ANKI_CHECK(readKeyframes(chEl, "positionKeys", ch.m_positions, [](const XmlElement& el, Vec3& value) {
+			return el.getNumbers(value);
+		}));
 
-			count = 0;
-			do
-			{
-				AnimationKeyframe<Vec3>& key = ch.m_positions[count++];
+		// <rotationKeys>
+		ANKI_CHECK(readKeyframes(chEl, "rotationKeys", ch.m_rotations, [](const XmlElement& el, Quat& value) {
+			return el.getNumbers(value);
+		}));
 
-				// time
-				ANKI_CHECK(keyEl.getAttributeNumber("time", key.m_time));
-				m_startTime = min(m_startTime, key.m_time);
-				maxTime = max(maxTime, key.m_time);
+		// <scaleKeys>
+		ANKI_CHECK(readKeyframes(chEl, "scaleKeys", ch.m_scales, [](const XmlElement& el, F32& value) {
+			return el.getNumber(value);
+		}));
 
-				// value
-				ANKI_CHECK(keyEl.getNumbers(key.m_value));
+		// Move to next channel
+		++channelCount;
+		ANKI_CHECK(chEl.getNextSiblingElement("channel", chEl));
+	} while(chEl);
 
-				// Check ident
-				if(key.m_value == Vec3(0.0))
-				{
-					++identPosCount;
-				}
+	// Sample them the same way the importer does
+	AnimationBinaryHeader header;
+	ResourceDynamicArray<AnimationBinaryChannel> channels;
+	ANKI_CHECK(sampleAnimationKeyframes(ConstWeakArray<AnimationTextChannel>(textChannels), header, channels, m_positions, m_rotations, m_scales));
 
-				// Move to next
-				ANKI_CHECK(keyEl.getNextSiblingElement("key", keyEl));
-			} while(keyEl);
-		}
+	ANKI_CHECK(init(header, channels));
 
-		// <rotationKeys>
-		ANKI_CHECK(chEl.getChildElementOptional("rotationKeys", keysEl));
-		if(keysEl)
-		{
-			ANKI_CHECK(keysEl.getChildElement("key", keyEl));
-
-			U32 count = 0;
-			ANKI_CHECK(keyEl.getSiblingElementsCount(count));
-			++count;
-			ch.m_rotations.resize(count);
+	return Error::kNone;
+}
 
-			count = 0;
-			do
-			{
-				AnimationKeyframe<Quat>& key = ch.m_rotations[count++];
+Error AnimationResource::init(const AnimationBinaryHeader& header, ConstWeakArray<AnimationBinaryChannel> channels)
+{
+	m_startTime = header.m_startTime;
+	m_duration = header.m_duration;
+	m_frameCount = header.m_frameCount;
 
-				// time
-				ANKI_CHECK(keyEl.getAttributeNumber("time", key.m_time));
-				m_startTime = min(m_startTime, key.m_time);
-				maxTime = max(maxTime, key.m_time);
+	if(m_duration <= 0.0 && m_frameCount > 1)
+	{
+		ANKI_RESOURCE_LOGE("Animation has more than one frame but no duration");
+		return Error::kUserData;
+	}
 
-				// value
-				ANKI_CHECK(keyEl.getNumbers(key.m_value));
+	m_sampleRate = (m_frameCount > 1) ? F64(m_frameCount - 1) / m_duration : 0.0;
 
-				// Check ident
-				if(key.m_value == Quat::getIdentity())
-				{
-					++identRotCount;
-				}
+	m_positionTrackChannels.resize(header.m_positionTrackCount, kMaxU32);
+	m_rotationTrackChannels.resize(header.m_rotationTrackCount, kMaxU32);
+	m_scaleTrackChannels.resize(header.m_scaleTrackCount, kMaxU32);
 
-				// Move to next
-				ANKI_CHECK(keyEl.getNextSiblingElement("key", keyEl));
-			} while(keyEl);
+	auto setTrackChannel = [](U32 track, U32 channelIdx, ResourceDynamicArray<U32>& trackChannels) -> Error {
+		if(track == kConstantAnimationTrack)
+		{
+			return Error::kNone;
 		}
 
-		// <scalingKeys>
-		ANKI_CHECK(chEl.getChildElementOptional("scaleKeys", keysEl));
-		if(keysEl)
+		if(track >= trackChannels.getSize() || trackChannels[track] != kMaxU32)
 		{
-			ANKI_CHECK(keysEl.getChildElement("key", keyEl));
+			ANKI_RESOURCE_LOGE("Incorrect animation track");
+			return Error::kUserData;
+		}
 
-			U32 count = 0;
-			ANKI_CHECK(keyEl.getSiblingElementsCount(count));
-			++count;
-			ch.m_scales.resize(count);
+		trackChannels[track] = channelIdx;
+		return Error::kNone;
+	};
 
-			count = 0;
-			do
-			{
-				AnimationKeyframe<F32>& key = ch.m_scales[count++];
+	m_channels.resize(channels.getSize());
+	for(U32 i = 0; i < channels.getSize(); ++i)
+	{
+		const AnimationBinaryChannel& in = channels[i];
+		AnimationChannel& out = m_channels[i];
 
-				// time
-				ANKI_CHECK(keyEl.getAttributeNumber("time", key.m_time));
-				m_startTime = std::min(m_startTime, key.m_time);
-				maxTime = std::max(maxTime, key.m_time);
+		if(in.m_name[kMaxAnimationChannelNameLength - 1] != '\0')
+		{
+			ANKI_RESOURCE_LOGE("Incorrect animation channel name");
+			return Error::kUserData;
+		}
 
-				// value
-				ANKI_CHECK(keyEl.getNumber(key.m_value));
+		out.m_name = &in.m_name[0];
 
-				// Check ident
-				if(isZero(key.m_value - 1.0f))
-				{
-					++identScaleCount;
-				}
+		ANKI_CHECK(setTrackChannel(in.m_positionTrack, i, m_positionTrackChannels));
+		ANKI_CHECK(setTrackChannel(in.m_rotationTrack, i, m_rotationTrackChannels));
+		ANKI_CHECK(setTrackChannel(in.m_scaleTrack, i, m_scaleTrackChannels));
+		out.m_positionTrack = in.m_positionTrack;
+		out.m_rotationTrack = in.m_rotationTrack;
+		out.m_scaleTrack = in.m_scaleTrack;
 
-				// Move to next
-				ANKI_CHECK(keyEl.getNextSiblingElement("key", keyEl));
-			} while(keyEl);
-		}
+		out.m_constantPosition = in.m_constantPosition;
+		out.m_constantRotation = Quat(in.m_constantRotation).normalize();
+		out.m_constantScale = in.m_constantScale;
+	}
 
-		// Remove identity vectors
-		if(identPosCount == ch.m_positions.getSize())
+	// Every track needs a channel or the interpolation will write out of bounds
+	for(const ResourceDynamicArray<U32>* trackChannels : {&m_positionTrackChannels, &m_rotationTrackChannels, &m_scaleTrackChannels})
+	{
+		for(U32 channelIdx : *trackChannels)
 		{
-			ch.m_positions.destroy();
+			if(channelIdx == kMaxU32)
+			{
+				ANKI_RESOURCE_LOGE("Animation track is not used by any channel");
+				return Error::kUserData;
+			}
 		}
+	}
 
-		if(identRotCount == ch.m_rotations.getSize())
-		{
-			ch.m_rotations.destroy();
-		}
+	return Error::kNone;
+}
 
-		if(identScaleCount == ch.m_scales.getSize())
-		{
-			ch.m_scales.destroy();
-		}
+Bool AnimationResource::computeFrame(Second time, U32& frame, U32& nextFrame, F32& factor) const
+{
+	if(time < m_startTime) [[unlikely]]
+	{
+		return false;
+	}
 
-		// Move to next channel
-		++channelCount;
-		ANKI_CHECK(chEl.getNextSiblingElement("channel", chEl));
-	} while(chEl);
+	// Audjust time
+	Second relativeTime = time - m_startTime;
+	if(relativeTime > m_duration)
+	{
+		relativeTime = (m_duration > 0.0) ? mod(relativeTime, m_duration) : 0.0;
+	}
 
-	m_duration = maxTime - m_startTime;
+	const F64 f = relativeTime * m_sampleRate;
+	frame = min(U32(f), m_frameCount - 1);
+	nextFrame = min(frame + 1, m_frameCount - 1);
+	factor = clamp(F32(f - F64(frame)), 0.0f, 1.0f);
 
-	return Error::kNone;
+	return true;
 }
 
 void AnimationResource::interpolate(U32 channelIndex, Second time, Vec3& pos, Quat& rot, F32& scale) const
 {
-	pos = Vec3(0.0f);
-	rot = Quat::getIdentity();
-	scale = 1.0f;
+	ANKI_ASSERT(channelIndex < m_channels.getSize());
 
-	if(time < m_startTime) [[unlikely]]
+	U32 frame, nextFrame;
+	F32 u;
+	if(!computeFrame(time, frame, nextFrame, u))
 	{
+		pos = Vec3(0.0f);
+		rot = Quat::getIdentity();
+		scale = 1.0f;
 		return;
 	}
 
-	// Audjust time
-	if(time > m_startTime + m_duration)
+	const AnimationChannel& channel = m_channels[channelIndex];
+
+	if(channel.m_positionTrack == kConstantAnimationTrack)
 	{
-		time = mod(time - m_startTime, m_duration) + m_startTime;
+		pos = channel.m_constantPosition;
+	}
+	else
+	{
+		const U32 trackCount = m_positionTrackChannels.getSize();
+		pos = m_positions[frame * trackCount + channel.m_positionTrack].lerp(m_positions[nextFrame * trackCount + channel.m_positionTrack], u);
 	}
 
-	ANKI_ASSERT(time >= m_startTime && time <= m_startTime + m_duration);
-	ANKI_ASSERT(channelIndex < m_channels.getSize());
+	if(channel.m_rotationTrack == kConstantAnimationTrack)
+	{
+		rot = channel.m_constantRotation;
+	}
+	else
+	{
+		// The rotations of a track are in the same hemisphere so a normalized lerp is enough. The scale of the snorm goes away with the normalization
+		const U32 trackCount = m_rotationTrackChannels.getSize();
+		const Vec4 a(m_rotations[frame * trackCount + channel.m_rotationTrack]);
+		const Vec4 b(m_rotations[nextFrame * trackCount + channel.m_rotationTrack]);
+		rot = Quat(a.lerp(b, u).normalize());
+	}
 
-	const AnimationChannel& channel = m_channels[channelIndex];
+	if(channel.m_scaleTrack == kConstantAnimationTrack)
+	{
+		scale = channel.m_constantScale;
+	}
+	else
+	{
+		const U32 trackCount = m_scaleTrackChannels.getSize();
+		scale = linearInterpolate(m_scales[frame * trackCount + channel.m_scaleTrack], m_scales[nextFrame * trackCount + channel.m_scaleTrack], u);
+	}
+}
+
+void AnimationResource::interpolateAll(Second time, WeakArray<AnimationChannelSample> samples) const
+{
+	ANKI_ASSERT(samples.getSize() == m_channels.getSize());
 
-	// Position
-	if(channel.m_positions.getSize() > 1)
+	U32 frame, nextFrame;
+	F32 u;
+	if(!computeFrame(time, frame, nextFrame, u))
 	{
-		for(U32 i = 0; i < channel.m_positions.getSize() - 1; ++i)
+		for(AnimationChannelSample& sample : samples)
 		{
-			const AnimationKeyframe<Vec3>& left = channel.m_positions[i];
-			const AnimationKeyframe<Vec3>& right = channel.m_positions[i + 1];
-			if(time >= left.m_time && time <= right.m_time)
-			{
-				const Second u = (time - left.m_time) / (right.m_time - left.m_time);
-				pos = linearInterpolate(left.m_value, right.m_value, F32(u));
-				break;
-			}
+			sample = {Vec3(0.0f), Quat::getIdentity(), 1.0f};
 		}
+		return;
 	}
 
-	// Rotation
-	if(channel.m_rotations.getSize() > 1)
+	// Start with the constants. The tracks will overwrite them
+	for(U32 i = 0; i < m_channels.getSize(); ++i)
 	{
-		for(U32 i = 0; i < channel.m_rotations.getSize() - 1; ++i)
-		{
-			const AnimationKeyframe<Quat>& left = channel.m_rotations[i];
-			const AnimationKeyframe<Quat>& right = channel.m_rotations[i + 1];
-			if(time >= left.m_time && time <= right.m_time)
-			{
-				const Second u = (time - left.m_time) / (right.m_time - left.m_time);
-				rot = left.m_value.slerp(right.m_value, F32(u));
-				break;
-			}
-		}
+		const AnimationChannel& channel = m_channels[i];
+		samples[i] = {channel.m_constantPosition, channel.m_constantRotation, channel.m_constantScale};
 	}
 
-	// Scale
-	if(channel.m_scales.getSize() > 1)
+	// The samples of a frame are contiguous so walk the two rows of every track type in one go
+	U32 trackCount = m_positionTrackChannels.getSize();
+	const Vec3* positionsA = m_positions.getBegin() + frame * trackCount;
+	const Vec3* positionsB = m_positions.getBegin() + nextFrame * trackCount;
+	for(U32 track = 0; track < trackCount; ++track)
 	{
-		for(U32 i = 0; i < channel.m_scales.getSize() - 1; ++i)
-		{
-			const AnimationKeyframe<F32>& left = channel.m_scales[i];
-			const AnimationKeyframe<F32>& right = channel.m_scales[i + 1];
-			if(time >= left.m_time && time <= right.m_time)
-			{
-				const Second u = (time - left.m_time) / (right.m_time - left.m_time);
-				scale = linearInterpolate(left.m_value, right.m_value, F32(u));
-				break;
-			}
-		}
+		samples[m_positionTrackChannels[track]].m_position = positionsA[track].lerp(positionsB[track], u);
+	}
+
+	trackCount = m_rotationTrackChannels.getSize();
+	const I16Vec4* rotationsA = m_rotations.getBegin() + frame * trackCount;
+	const I16Vec4* rotationsB = m_rotations.getBegin() + nextFrame * trackCount;
+	for(U32 track = 0; track < trackCount; ++track)
+	{
+		samples[m_rotationTrackChannels[track]].m_rotation = Quat(Vec4(rotationsA[track]).lerp(Vec4(rotationsB[track]), u).normalize());
+	}
+
+	trackCount = m_scaleTrackChannels.getSize();
+	const F32* scalesA = m_scales.getBegin() + frame * trackCount;
+	const F32* scalesB = m_scales.getBegin() + nextFrame * trackCount;
+	for(U32 track = 0; track < trackCount; ++track)
+	{
+		samples[m_scaleTrackChannels[track]].m_scale = linearInterpolate(scalesA[track], scalesB[track], u);
 	}
 }
 
@@ -6,14 +6,16 @@
 #pragma once
 
 #include <AnKi/Resource/ResourceObject.h>
+#include <AnKi/Resource/AnimationBinary.h>
 #include <AnKi/Math.h>
 #include <AnKi/Util/String.h>
 #include <AnKi/Util/WeakArray.h>
+#include <AnKi/Util/DynamicArray.h>
 
 namespace anki {
 
 // Forward
-class XmlElement;
+class ResourceFile;
 
 /// @addtogroup resource
 /// @{
@@ -22,9 +24,10 @@ class XmlElement;
 template<typename T>
 class AnimationKeyframe
 {
-	friend class AnimationResource;
-
 public:
+	Second m_time;
+	T m_value;
+
 	Second getTime() const
 	{
 		return m_time;
@@ -34,27 +37,39 @@ public:
 	{
 		return m_value;
 	}
-
-private:
-	Second m_time;
-	T m_value;
 };
 
 /// Animation channel
 class AnimationChannel
 {
+	friend class AnimationResource;
+
 public:
 	ResourceString m_name;
 
 	I32 m_boneIndex = -1; ///< For skeletal animations
 
-	ResourceDynamicArray<AnimationKeyframe<Vec3>> m_positions;
-	ResourceDynamicArray<AnimationKeyframe<Quat>> m_rotations;
-	ResourceDynamicArray<AnimationKeyframe<F32>> m_scales;
-	ResourceDynamicArray<AnimationKeyframe<F32>> m_cameraFovs;
+private:
+	U32 m_positionTrack = kConstantAnimationTrack;
+	U32 m_rotationTrack = kConstantAnimationTrack;
+	U32 m_scaleTrack = kConstantAnimationTrack;
+
+	Vec3 m_constantPosition = Vec3(0.0f);
+	Quat m_constantRotation = Quat::getIdentity();
+	F32 m_constantScale = 1.0f;
+};
+
+/// The interpolated transform of a channel.
+class AnimationChannelSample
+{
+public:
+	Vec3 m_position;
+	Quat m_rotation;
+	F32 m_scale;
 };
 
-/// Animation consists of keyframe data.
+/// Animation consists of uniformly sampled tracks. It can be loaded from the binary format that the importer writes or from the older text format
+/// that gets sampled at load time.
 class AnimationResource : public ResourceObject
 {
 public:
@@ -85,14 +100,55 @@ public:
 		return m_startTime;
 	}
 
-	/// Get the interpolated data
+	/// Get the number of samples of the tracks that are not constant.
+	U32 getFrameCount() const
+	{
+		return m_frameCount;
+	}
+
+	/// Get the interpolated data of a single channel. It's O(1).
 	void interpolate(U32 channelIndex, Second time, Vec3& position, Quat& rotation, F32& scale) const;
 
+	/// Get the interpolated data of all the channels at once. Prefer it over interpolate() when most of the channels are needed.
+	/// @param samples The output. Its size should be the same as the number of channels.
+	void interpolateAll(Second time, WeakArray<AnimationChannelSample> samples) const;
+
 private:
 	ResourceDynamicArray<AnimationChannel> m_channels;
-	Second m_duration;
-	Second m_startTime;
+
+	/// The samples of the tracks. Frame major, see AnimationBinary.h
+	ResourceDynamicArray<Vec3> m_positions;
+	ResourceDynamicArray<I16Vec4> m_rotations;
+	ResourceDynamicArray<F32> m_scales;
+
+	/// Track to channel index.
+	ResourceDynamicArray<U32> m_positionTrackChannels;
+	ResourceDynamicArray<U32> m_rotationTrackChannels;
+	ResourceDynamicArray<U32> m_scaleTrackChannels;
+
+	Second m_duration = 0.0;
+	Second m_startTime = 0.0;
+	F64 m_sampleRate = 0.0;
+	U32 m_frameCount = 0;
+
+	Error loadBinary(ResourceFile& file);
+
+	Error loadText(const ResourceFilename& filename);
+
+	Error init(const AnimationBinaryHeader& header, ConstWeakArray<AnimationBinaryChannel> channels);
+
+	/// Returns false if the time is before the start of the animation.
+	Bool computeFrame(Second time, U32& frame, U32& nextFrame, F32& factor) const;
 };
+
+/// Turn the keyframes of some channels to the uniformly sampled tracks of the binary format. It's used by the importer and by the loader of the
+/// text animations. TChannel has a m_name string and the m_positions, m_rotations and m_scales arrays of AnimationKeyframe.
+template<typename TChannel, typename TMemoryPool>
+Error sampleAnimationKeyframes(ConstWeakArray<TChannel> channels, AnimationBinaryHeader& header,
+							   DynamicArray<AnimationBinaryChannel, TMemoryPool>& outChannels, DynamicArray<Vec3, TMemoryPool>& positions,
+							   DynamicArray<I16Vec4, TMemoryPool>& rotations, DynamicArray<F32, TMemoryPool>& scales);
 /// @}
 
 } // end namespace anki
+
+#include <AnKi/Resource/AnimationResource.inl.h>
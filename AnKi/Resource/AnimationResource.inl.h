@@ -0,0 +1,237 @@
+// Copyright (C) 2009-present, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <AnKi/Resource/AnimationResource.h>
+
+namespace anki {
+
+namespace detail {
+
+// Sample the keyframes at uniform intervals. The keyframes are visited once because the sample times are increasing
+template<typename TKeyArray, typename T, typename TLerpFunc>
+void sampleKeyframes(const TKeyArray& keys, F64 startTime, F64 interval, WeakArray<T> out, TLerpFunc lerp)
+{
+	ANKI_ASSERT(keys.getSize() > 0);
+
+	U32 cursor = 0;
+	for(U32 i = 0; i < out.getSize(); ++i)
+	{
+		const F64 time = startTime + interval * F64(i);
+		while(cursor + 1 < keys.getSize() && keys[cursor + 1].m_time <= time)
+		{
+			++cursor;
+		}
+
+		if(cursor + 1 == keys.getSize() || time <= keys[cursor].m_time)
+		{
+			out[i] = keys[cursor].m_value;
+		}
+		else
+		{
+			const auto& left = keys[cursor];
+			const auto& right = keys[cursor + 1];
+			out[i] = lerp(left.m_value, right.m_value, F32((time - left.m_time) / (right.m_time - left.m_time)));
+		}
+	}
+}
+
+template<typename TKeyArray>
+void gatherKeyframeTimes(const TKeyArray& keys, F64& minTime, F64& maxTime, F64& minInterval)
+{
+	for(U32 i = 0; i < keys.getSize(); ++i)
+	{
+		minTime = min<F64>(minTime, keys[i].m_time);
+		maxTime = max<F64>(maxTime, keys[i].m_time);
+
+		if(i > 0 && keys[i].m_time > keys[i - 1].m_time)
+		{
+			minInterval = min<F64>(minInterval, keys[i].m_time - keys[i - 1].m_time);
+		}
+	}
+}
+
+} // end namespace detail
+
+template<typename TChannel, typename TMemoryPool>
+Error sampleAnimationKeyframes(ConstWeakArray<TChannel> channels, AnimationBinaryHeader& header,
+							   DynamicArray<AnimationBinaryChannel, TMemoryPool>& outChannels, DynamicArray<Vec3, TMemoryPool>& positions,
+							   DynamicArray<I16Vec4, TMemoryPool>& rotations, DynamicArray<F32, TMemoryPool>& scales)
+{
+	// Find the time range and the rate
+	F64 minTime = kMaxF64;
+	F64 maxTime = kMinF64;
+	F64 minInterval = kMaxF64;
+	for(const TChannel& channel : channels)
+	{
+		detail::gatherKeyframeTimes(channel.m_positions, minTime, maxTime, minInterval);
+		detail::gatherKeyframeTimes(channel.m_rotations, minTime, maxTime, minInterval);
+		detail::gatherKeyframeTimes(channel.m_scales, minTime, maxTime, minInterval);
+	}
+
+	if(minTime > maxTime)
+	{
+		minTime = maxTime = 0.0;
+	}
+
+	const F64 duration = maxTime - minTime;
+	U32 frameCount = 1;
+	F64 interval = 0.0;
+	if(duration > 0.0)
+	{
+		const F64 rate = clamp(1.0 / minInterval, kMinAnimationSampleRate, kMaxAnimationSampleRate);
+		frameCount = max(2u, U32(ceil(duration * rate - 0.001)) + 1);
+		interval = duration / F64(frameCount - 1);
+	}
+
+	// Sample the tracks. Store them track major at first
+	DynamicArray<Vec3, TMemoryPool> positionTracks;
+	DynamicArray<I16Vec4, TMemoryPool> rotationTracks;
+	DynamicArray<F32, TMemoryPool> scaleTracks;
+	DynamicArray<Vec3, TMemoryPool> positionSamples;
+	positionSamples.resize(frameCount);
+	DynamicArray<Quat, TMemoryPool> rotationSamples;
+	rotationSamples.resize(frameCount);
+	DynamicArray<F32, TMemoryPool> scaleSamples;
+	scaleSamples.resize(frameCount);
+
+	outChannels.resize(channels.getSize());
+	for(U32 i = 0; i < channels.getSize(); ++i)
+	{
+		const TChannel& in = channels[i];
+		AnimationBinaryChannel& out = outChannels[i];
+		zeroMemory(out);
+
+		if(in.m_name.getLength() >= kMaxAnimationChannelNameLength)
+		{
+			ANKI_RESOURCE_LOGE("Animation channel name is too long: %s", in.m_name.cstr());
+			return Error::kUserData;
+		}
+		memcpy(&out.m_name[0], in.m_name.cstr(), in.m_name.getLength() + 1);
+
+		// Positions
+		out.m_positionTrack = kConstantAnimationTrack;
+		out.m_constantPosition = Vec3(0.0f);
+		if(in.m_positions.getSize())
+		{
+			detail::sampleKeyframes(in.m_positions, minTime, interval, WeakArray<Vec3>(positionSamples), [](const Vec3& a, const Vec3& b, F32 u) {
+				return linearInterpolate(a, b, u);
+			});
+
+			Bool constant = true;
+			for(const Vec3& p : positionSamples)
+			{
+				constant = constant && (p - positionSamples[0]).abs() < kEpsilonf;
+			}
+
+			if(constant)
+			{
+				out.m_constantPosition = positionSamples[0];
+			}
+			else
+			{
+				out.m_positionTrack = positionTracks.getSize() / frameCount;
+				for(const Vec3& p : positionSamples)
+				{
+					positionTracks.emplaceBack(p);
+				}
+			}
+		}
+
+		// Rotations
+		out.m_rotationTrack = kConstantAnimationTrack;
+		out.m_constantRotation = Vec4(Quat::getIdentity());
+		if(in.m_rotations.getSize())
+		{
+			detail::sampleKeyframes(in.m_rotations, minTime, interval, WeakArray<Quat>(rotationSamples), [](const Quat& a, const Quat& b, F32 u) {
+				return a.slerp(b, u);
+			});
+
+			// Keep the rotations of the track in the same hemisphere. The runtime doesn't need to check before lerping them
+			for(U32 f = 1; f < frameCount; ++f)
+			{
+				if(Vec4(rotationSamples[f - 1]).dot(Vec4(rotationSamples[f])) < 0.0f)
+				{
+					rotationSamples[f] = Quat(-Vec4(rotationSamples[f]));
+				}
+			}
+
+			Bool constant = true;
+			for(const Quat& q : rotationSamples)
+			{
+				constant = constant && packAnimationRotation(q) == packAnimationRotation(rotationSamples[0]);
+			}
+
+			if(constant)
+			{
+				out.m_constantRotation = Vec4(rotationSamples[0]);
+			}
+			else
+			{
+				out.m_rotationTrack = rotationTracks.getSize() / frameCount;
+				for(const Quat& q : rotationSamples)
+				{
+					rotationTracks.emplaceBack(packAnimationRotation(q));
+				}
+			}
+		}
+
+		// Scales
+		out.m_scaleTrack = kConstantAnimationTrack;
+		out.m_constantScale = 1.0f;
+		if(in.m_scales.getSize())
+		{
+			detail::sampleKeyframes(in.m_scales, minTime, interval, WeakArray<F32>(scaleSamples), [](F32 a, F32 b, F32 u) {
+				return linearInterpolate(a, b, u);
+			});
+
+			Bool constant = true;
+			for(F32 s : scaleSamples)
+			{
+				constant = constant && absolute(s - scaleSamples[0]) < kEpsilonf;
+			}
+
+			if(constant)
+			{
+				out.m_constantScale = scaleSamples[0];
+			}
+			else
+			{
+				out.m_scaleTrack = scaleTracks.getSize() / frameCount;
+				for(F32 s : scaleSamples)
+				{
+					scaleTracks.emplaceBack(s);
+				}
+			}
+		}
+	}
+
+	// Transpose the tracks to frame major
+	auto transpose = [frameCount](const auto& tracks, auto& out) {
+		const U32 trackCount = tracks.getSize() / frameCount;
+		out.resize(tracks.getSize());
+		for(U32 track = 0; track < trackCount; ++track)
+		{
+			for(U32 frame = 0; frame < frameCount; ++frame)
+			{
+				out[frame * trackCount + track] = tracks[track * frameCount + frame];
+			}
+		}
+		return trackCount;
+	};
+
+	zeroMemory(header);
+	memcpy(&header.m_magic[0], kAnimationMagic, sizeof(header.m_magic));
+	header.m_channelCount = channels.getSize();
+	header.m_frameCount = frameCount;
+	header.m_positionTrackCount = transpose(positionTracks, positions);
+	header.m_rotationTrackCount = transpose(rotationTracks, rotations);
+	header.m_scaleTrackCount = transpose(scaleTracks, scales);
+	header.m_startTime = F32(minTime);
+	header.m_duration = F32(duration);
+
+	return Error::kNone;
+}
+
+} // end namespace anki
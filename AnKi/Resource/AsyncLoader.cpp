@@ -13,26 +13,67 @@ namespace anki {
 
 ANKI_SVAR(AsyncTasksInFlight, StatCategory::kMisc, "Async loader tasks", StatFlag::kNone)
 
-AsyncLoader::AsyncLoader()
-	: m_thread("AsyncLoad")
+void AsyncLoaderTaskStatusDeleter::operator()(AsyncLoaderTaskStatus* x)
 {
-	m_thread.start(this, threadCallback);
+	deleteInstance(ResourceMemoryPool::getSingleton(), x);
+}
+
+class AsyncLoader::WorkerThread
+{
+public:
+	Thread m_thread;
+	AsyncLoader* m_loader;
+	Stage m_stage;
+
+	WorkerThread(AsyncLoader* loader, Stage stage, CString threadName)
+		: m_thread(threadName.cstr())
+		, m_loader(loader)
+		, m_stage(stage)
+	{
+		m_thread.start(this, threadCallback);
+	}
+
+	static Error threadCallback(ThreadCallbackInfo& info)
+	{
+		WorkerThread& self = *static_cast<WorkerThread*>(info.m_userData);
+		return self.m_loader->threadWorker(self.m_stage);
+	}
+};
+
+AsyncLoader::AsyncLoader(U32 threadCount, U32 ioThreadCount)
+{
+	ANKI_ASSERT(threadCount > 0);
+
+	const Array<U32, U32(Stage::kCount)> threadCounts = {ioThreadCount, threadCount};
+	for(Stage stage : EnumIterable<Stage>())
+	{
+		StageQueues& queues = m_stages[stage];
+		queues.m_threads.resize(threadCounts[stage]);
+		for(U32 i = 0; i < threadCounts[stage]; ++i)
+		{
+			ResourceString threadName;
+			threadName.sprintf((stage == Stage::kIo) ? "AsyncLoadIo#%u" : "AsyncLoad#%u", i);
+			queues.m_threads[i] = newInstance<WorkerThread>(ResourceMemoryPool::getSingleton(), this, stage, threadName);
+		}
+	}
 }
 
 AsyncLoader::~AsyncLoader()
 {
 	stop();
 
-	for(auto& queue : m_taskQueues)
+	for(StageQueues& stage : m_stages)
 	{
-		if(!queue.isEmpty())
+		for(auto& queue : stage.m_taskQueues)
 		{
-			ANKI_RESOURCE_LOGW("Stoping loading thread while there is work to do");
-
-			while(!queue.isEmpty())
+			if(!queue.isEmpty())
 			{
-				AsyncLoaderTask* task = queue.popFront();
-				deleteInstance(ResourceMemoryPool::getSingleton(), task);
+				ANKI_RESOURCE_LOGW("Stoping loading thread while there is work to do");
+
+				while(!queue.isEmpty())
+				{
+					retireTask(queue.popFront(), AsyncLoaderTaskState::kCancelled);
+				}
 			}
 		}
 	}
@@ -40,112 +81,247 @@ AsyncLoader::~AsyncLoader()
 
 void AsyncLoader::stop()
 {
+	for(StageQueues& stage : m_stages)
+	{
+		LockGuard<Mutex> lock(stage.m_mtx);
+		stage.m_quit = true;
+		stage.m_condVar.notifyAll();
+	}
+
+	for(StageQueues& stage : m_stages)
+	{
+		for(WorkerThread* thread : stage.m_threads)
+		{
+			[[maybe_unused]] Error err = thread->m_thread.join();
+			deleteInstance(ResourceMemoryPool::getSingleton(), thread);
+		}
+
+		stage.m_threads.destroy();
+	}
+}
+
+AsyncLoaderTask* AsyncLoader::popTask(Stage stage, AsyncLoaderPriority& priority)
+{
+	StageQueues& queues = m_stages[stage];
+	const U32 threadCount = queues.m_threads.getSize();
+
+	// Everything that is not kHigh can't occupy all the threads. That way there is always a thread available for the important work. With a single
+	// thread there is nothing to reserve, the lower priorities would never run
+	U32 busyThreadCount = 0;
+	for(AsyncLoaderPriority p : EnumIterable<AsyncLoaderPriority>())
+	{
+		busyThreadCount += queues.m_busyThreadCounts[p];
+	}
+
+	for(AsyncLoaderPriority p : EnumIterable<AsyncLoaderPriority>())
 	{
-		LockGuard<Mutex> lock(m_mtx);
-		m_quit = true;
-		m_condVar.notifyOne();
+		const U32 maxThreadCount = (p == AsyncLoaderPriority::kHigh) ? threadCount : max(1u, threadCount - 1);
+		if(!queues.m_taskQueues[p].isEmpty() && busyThreadCount < maxThreadCount)
+		{
+			priority = p;
+			AsyncLoaderTask* task = queues.m_taskQueues[p].popFront();
+			task->m_status->m_state.store(U32(AsyncLoaderTaskState::kRunning));
+			return task;
+		}
+
+		busyThreadCount -= queues.m_busyThreadCounts[p];
 	}
 
-	[[maybe_unused]] Error err = m_thread.join();
+	return nullptr;
+}
+
+void AsyncLoader::pushTask(Stage stage, AsyncLoaderTask* task)
+{
+	StageQueues& queues = m_stages[stage];
+	AsyncLoaderTaskStatus& status = *task->m_status;
+
+	LockGuard<Mutex> lock(queues.m_mtx);
+	status.m_queuedPriority = AsyncLoaderPriority(status.m_priority.load());
+	status.m_stage.store(U32(stage));
+	status.m_state.store(U32(AsyncLoaderTaskState::kQueued));
+	queues.m_taskQueues[status.m_queuedPriority].pushBack(task);
+	queues.m_condVar.notifyOne();
 }
 
-Error AsyncLoader::threadCallback(ThreadCallbackInfo& info)
+void AsyncLoader::retireTask(AsyncLoaderTask* task, AsyncLoaderTaskState state)
 {
-	AsyncLoader& self = *reinterpret_cast<AsyncLoader*>(info.m_userData);
-	return self.threadWorker();
+	AsyncLoaderTaskStatus* status = task->m_status;
+	deleteInstance(ResourceMemoryPool::getSingleton(), task);
+
+	status->m_state.store(U32(state));
+	if(status->release() == 1)
+	{
+		AsyncLoaderTaskStatusDeleter()(status);
+	}
+
+	g_svarAsyncTasksInFlight.decrement(1u);
+	m_tasksInFlightCount.fetchSub(1);
 }
 
-Error AsyncLoader::threadWorker()
+Error AsyncLoader::threadWorker(Stage stage)
 {
-	Error err = Error::kNone;
+	StageQueues& queues = m_stages[stage];
 
-	while(!err)
+	while(true)
 	{
 		AsyncLoaderTask* task = nullptr;
 		AsyncLoaderPriority taskPriority = AsyncLoaderPriority::kCount;
-		Bool quit = false;
 
 		// Block until there is work to do
 		{
-			LockGuard<Mutex> lock(m_mtx);
-			while(m_taskQueues[AsyncLoaderPriority::kHigh].isEmpty() && m_taskQueues[AsyncLoaderPriority::kMedium].isEmpty()
-				  && m_taskQueues[AsyncLoaderPriority::kLow].isEmpty() && !m_quit)
+			LockGuard<Mutex> lock(queues.m_mtx);
+			while(!queues.m_quit && (task = popTask(stage, taskPriority)) == nullptr)
 			{
-				m_condVar.wait(m_mtx);
+				queues.m_condVar.wait(queues.m_mtx);
 			}
 
-			if(m_quit)
+			if(queues.m_quit)
 			{
-				quit = true;
-			}
-			else
-			{
-				for(AsyncLoaderPriority priority : EnumIterable<AsyncLoaderPriority>())
-				{
-					if(!m_taskQueues[priority].isEmpty())
-					{
-						task = m_taskQueues[priority].popFront();
-						taskPriority = priority;
-						break;
-					}
-				}
+				break;
 			}
+
+			++queues.m_busyThreadCounts[taskPriority];
 		}
 
-		if(quit)
+		// Exec the task
+		ANKI_ASSERT(task);
+		AsyncLoaderTaskContext ctx;
+		ctx.m_priority = taskPriority;
+		Error err = Error::kNone;
+		Bool cancelled = task->m_status->m_cancelRequested.load();
+
+		if(!cancelled && (stage == Stage::kIo || (task->hasIoStage() && m_stages[Stage::kIo].m_threads.getSize() == 0)))
 		{
-			break;
+			ANKI_TRACE_SCOPED_EVENT(RsrcAsyncIoTask);
+			err = task->io(ctx);
+			cancelled = task->m_status->m_cancelRequested.load();
+		}
+
+		if(!err && !cancelled && stage == Stage::kDecode)
+		{
+			ANKI_TRACE_SCOPED_EVENT(RsrcAsyncTask);
+			err = (*task)(ctx);
+		}
+
+		{
+			LockGuard<Mutex> lock(queues.m_mtx);
+			--queues.m_busyThreadCounts[taskPriority];
+		}
+
+		if(err)
+		{
+			ANKI_RESOURCE_LOGE("Async loader task failed");
+			retireTask(task, AsyncLoaderTaskState::kFailed);
+		}
+		else if(cancelled)
+		{
+			retireTask(task, AsyncLoaderTaskState::kCancelled);
+		}
+		else if(stage == Stage::kIo)
+		{
+			// Move to the next stage
+			pushTask(Stage::kDecode, task);
+		}
+		else if(ctx.m_resubmitTask)
+		{
+			// The task can change its priority but setTaskPriority() calls that happened while it was running win
+			U32 expectedPriority = U32(taskPriority);
+			task->m_status->m_priority.compareExchange(expectedPriority, U32(ctx.m_priority));
+			pushTask(Stage::kDecode, task);
 		}
 		else
 		{
-			// Exec the task
-			ANKI_ASSERT(task);
-			AsyncLoaderTaskContext ctx;
-			ctx.m_priority = taskPriority;
+			retireTask(task, AsyncLoaderTaskState::kCompleted);
+		}
+	}
 
-			{
-				// HighRezTimer::sleep(250.0_ms);
-				ANKI_TRACE_SCOPED_EVENT(RsrcAsyncTask);
-				err = (*task)(ctx);
-				g_svarAsyncTasksInFlight.decrement(1u);
-			}
+	return Error::kNone;
+}
 
-			if(!err)
-			{
-				m_tasksInFlightCount.fetchSub(1);
-			}
-			else
-			{
-				ANKI_RESOURCE_LOGE("Async loader task failed");
-			}
+AsyncLoaderTaskHandle AsyncLoader::submitTask(AsyncLoaderTask* task, AsyncLoaderPriority priority)
+{
+	ANKI_ASSERT(task && !task->m_status);
 
-			// Do other stuff
-			if(ctx.m_resubmitTask)
-			{
-				LockGuard<Mutex> lock(m_mtx);
-				m_taskQueues[ctx.m_priority].pushBack(task);
-			}
-			else
+	m_tasksInFlightCount.fetchAdd(1);
+	g_svarAsyncTasksInFlight.increment(1);
+
+	AsyncLoaderTaskHandle handle;
+	handle.m_status.reset(newInstance<AsyncLoaderTaskStatus>(ResourceMemoryPool::getSingleton()));
+	task->m_status = handle.m_status.get();
+	task->m_status->retain(); // The loader holds a reference until the task is retired
+	task->m_status->m_task = task;
+	task->m_status->m_priority.store(U32(priority));
+	task->m_status->m_cancellable = task->isCancellable();
+
+	const Stage stage = (task->hasIoStage() && m_stages[Stage::kIo].m_threads.getSize() > 0) ? Stage::kIo : Stage::kDecode;
+	pushTask(stage, task);
+
+	return handle;
+}
+
+void AsyncLoader::cancelTask(const AsyncLoaderTaskHandle& handle)
+{
+	ANKI_ASSERT(handle.isValid());
+	AsyncLoaderTaskStatus& status = *handle.m_status;
+
+	if(!status.m_cancellable)
+	{
+		ANKI_RESOURCE_LOGW("Can't cancel this task");
+		return;
+	}
+
+	// The workers check the flag before every stage so even if the task is not removed from the queue bellow it won't run
+	status.m_cancelRequested.store(1);
+
+	// Tasks move forward so search the stages in order
+	for(Stage stage : EnumIterable<Stage>())
+	{
+		AsyncLoaderTask* task = nullptr;
+		{
+			StageQueues& queues = m_stages[stage];
+			LockGuard<Mutex> lock(queues.m_mtx);
+			if(status.m_stage.load() == U32(stage) && status.m_state.load() == U32(AsyncLoaderTaskState::kQueued))
 			{
-				// Delete the task
-				deleteInstance(ResourceMemoryPool::getSingleton(), task);
+				task = status.m_task;
+				queues.m_taskQueues[status.m_queuedPriority].erase(task);
+				status.m_state.store(U32(AsyncLoaderTaskState::kRunning)); // Not in a queue any more
 			}
 		}
-	}
 
-	return err;
+		if(task)
+		{
+			retireTask(task, AsyncLoaderTaskState::kCancelled);
+			break;
+		}
+	}
 }
 
-void AsyncLoader::submitTask(AsyncLoaderTask* task, AsyncLoaderPriority priority)
+void AsyncLoader::setTaskPriority(const AsyncLoaderTaskHandle& handle, AsyncLoaderPriority priority)
 {
-	ANKI_ASSERT(task);
+	ANKI_ASSERT(handle.isValid());
+	AsyncLoaderTaskStatus& status = *handle.m_status;
 
-	m_tasksInFlightCount.fetchAdd(1);
-	g_svarAsyncTasksInFlight.increment(1);
+	// The next stage will use the new priority
+	status.m_priority.store(U32(priority));
 
-	LockGuard<Mutex> lock(m_mtx);
-	m_taskQueues[priority].pushBack(task);
-	m_condVar.notifyOne();
+	// If it's queued move it to the other queue
+	for(Stage stage : EnumIterable<Stage>())
+	{
+		StageQueues& queues = m_stages[stage];
+		LockGuard<Mutex> lock(queues.m_mtx);
+		if(status.m_stage.load() == U32(stage) && status.m_state.load() == U32(AsyncLoaderTaskState::kQueued))
+		{
+			if(status.m_queuedPriority != priority)
+			{
+				queues.m_taskQueues[status.m_queuedPriority].erase(status.m_task);
+				queues.m_taskQueues[priority].pushBack(status.m_task);
+				status.m_queuedPriority = priority;
+				queues.m_condVar.notifyOne();
+			}
+
+			break;
+		}
+	}
 }
 
 } // end namespace anki
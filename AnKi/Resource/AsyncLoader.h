@@ -8,11 +8,19 @@
 #include <AnKi/Resource/Common.h>
 #include <AnKi/Util/Thread.h>
 #include <AnKi/Util/List.h>
+#include <AnKi/Util/Ptr.h>
+#include <AnKi/Util/CVarSet.h>
 
 namespace anki {
 
 // Forward
 class AsyncLoader;
+class AsyncLoaderTask;
+
+ANKI_CVAR(NumericCVar<U32>, Rsrc, AsyncLoaderThreadCount, 2, 1, 64,
+		  "Number of threads that decode and upload resources. With 2 or more, one is kept for the high priority work")
+ANKI_CVAR(NumericCVar<U32>, Rsrc, AsyncLoaderIoThreadCount, 2, 0, 64,
+		  "Number of threads that do the I/O part of the async loading. If zero the I/O runs in the decode threads")
 
 /// @addtogroup resource
 /// @{
@@ -29,6 +37,81 @@ enum class AsyncLoaderPriority : U8
 };
 ANKI_ENUM_ALLOW_NUMERIC_OPERATIONS(AsyncLoaderPriority)
 
+/// @memberof AsyncLoader
+enum class AsyncLoaderTaskState : U8
+{
+	kQueued,
+	kRunning,
+	kCompleted,
+	kFailed,
+	kCancelled
+};
+
+/// The status of a submitted task. It outlives the task. Use AsyncLoaderTaskHandle to access it.
+/// @memberof AsyncLoader
+class AsyncLoaderTaskStatus
+{
+	friend class AsyncLoader;
+	friend class AsyncLoaderTaskHandle;
+
+public:
+	void retain() const
+	{
+		m_refcount.fetchAdd(1);
+	}
+
+	I32 release() const
+	{
+		return m_refcount.fetchSub(1, AtomicMemoryOrder::kAcqRel);
+	}
+
+private:
+	mutable Atomic<I32> m_refcount = {0};
+	Atomic<U32, AtomicMemoryOrder::kSeqCst> m_state = {U32(AsyncLoaderTaskState::kQueued)};
+	Atomic<U32> m_priority = {0}; ///< The requested priority.
+	Atomic<U32> m_cancelRequested = {0};
+	Atomic<U32> m_stage = {0}; ///< Written under the lock of the new stage and read under the locks of the others.
+	Bool m_cancellable = true;
+
+	// Protected by the lock of the stage the task is in
+	AsyncLoaderTask* m_task = nullptr;
+	AsyncLoaderPriority m_queuedPriority = AsyncLoaderPriority::kCount; ///< The queue the task is in.
+};
+
+/// @memberof AsyncLoader
+class AsyncLoaderTaskStatusDeleter
+{
+public:
+	void operator()(AsyncLoaderTaskStatus* x);
+};
+
+/// A handle to a submitted task. It can be used to cancel the task, change its priority or check if it's done.
+/// @memberof AsyncLoader
+class AsyncLoaderTaskHandle
+{
+	friend class AsyncLoader;
+
+public:
+	Bool isValid() const
+	{
+		return m_status.isCreated();
+	}
+
+	AsyncLoaderTaskState getState() const
+	{
+		return AsyncLoaderTaskState(m_status->m_state.load());
+	}
+
+	/// Completed, failed or cancelled.
+	Bool isDone() const
+	{
+		return getState() > AsyncLoaderTaskState::kRunning;
+	}
+
+private:
+	IntrusivePtr<AsyncLoaderTaskStatus, AsyncLoaderTaskStatusDeleter> m_status;
+};
+
 /// @memberof AsyncLoader
 class AsyncLoaderTaskContext
 {
@@ -37,7 +120,8 @@ public:
 	AsyncLoaderPriority m_priority = AsyncLoaderPriority::kCount;
 };
 
-/// Interface for tasks for the AsyncLoader.
+/// Interface for tasks for the AsyncLoader. A task runs in 2 stages. First the optional I/O stage (see hasIoStage()) runs in one of the I/O threads
+/// and then operator() (decoding, uploading etc) runs in one of the decode threads.
 /// @memberof AsyncLoader
 class AsyncLoaderTask : public IntrusiveListEnabled<AsyncLoaderTask>
 {
@@ -46,14 +130,41 @@ public:
 	{
 	}
 
+	/// If true then io() will be called before operator().
+	virtual Bool hasIoStage() const
+	{
+		return false;
+	}
+
+	/// The I/O stage. It should only do work that waits for the disk.
+	virtual Error io([[maybe_unused]] AsyncLoaderTaskContext& ctx)
+	{
+		return Error::kNone;
+	}
+
 	virtual Error operator()(AsyncLoaderTaskContext& ctx) = 0;
+
+	/// If false the task can't be cancelled. The tasks that finish something that others wait for (like the loading of a resource) shouldn't be
+	/// cancellable since they would never finish it.
+	virtual Bool isCancellable() const
+	{
+		return true;
+	}
+
+private:
+	friend class AsyncLoader;
+
+	AsyncLoaderTaskStatus* m_status = nullptr;
 };
 
-/// Asynchronous resource loader.
+/// Asynchronous resource loader. It has a pool of I/O threads and a pool of decode threads. Higher priority tasks are always picked first and the
+/// rest can't occupy all the threads of a pool so a kHigh task never waits behind a long queue of kMedium or kLow work.
+/// Note: A pool with a single thread can't reserve a thread. There a kHigh task waits for the stage of the lower priority task that is running
+/// and it's picked first at the next stage boundary.
 class AsyncLoader : public MakeSingleton<AsyncLoader>
 {
 public:
-	AsyncLoader();
+	AsyncLoader(U32 threadCount = g_cvarRsrcAsyncLoaderThreadCount, U32 ioThreadCount = g_cvarRsrcAsyncLoaderIoThreadCount);
 
 	~AsyncLoader();
 
@@ -65,7 +176,14 @@ public:
 	}
 
 	/// Submit a task.
-	void submitTask(AsyncLoaderTask* task, AsyncLoaderPriority priority);
+	AsyncLoaderTaskHandle submitTask(AsyncLoaderTask* task, AsyncLoaderPriority priority);
+
+	/// Cancel a task. If the task is still queued it's removed. If it's running it will be cancelled after its current stage. Check the state of
+	/// the handle to find out what happened. Has no effect on tasks that are not cancellable (see AsyncLoaderTask::isCancellable()).
+	void cancelTask(const AsyncLoaderTaskHandle& handle);
+
+	/// Move a task to another priority queue. Has no effect if the task is already running its last stage.
+	void setTaskPriority(const AsyncLoaderTaskHandle& handle, AsyncLoaderPriority priority);
 
 	/// Get the total number of completed tasks.
 	U32 getTasksInFlightCount() const
@@ -74,19 +192,43 @@ public:
 	}
 
 private:
-	Thread m_thread;
+	enum class Stage : U8
+	{
+		kIo,
+		kDecode,
+
+		kCount,
+		kFirst = 0
+	};
+	ANKI_ENUM_ALLOW_NUMERIC_OPERATIONS_FRIEND(Stage)
 
-	Mutex m_mtx;
-	ConditionVariable m_condVar;
-	Array<IntrusiveList<AsyncLoaderTask>, U32(AsyncLoaderPriority::kCount)> m_taskQueues;
-	Bool m_quit = false;
+	class WorkerThread;
+
+	/// The queues and the threads of a stage.
+	class StageQueues
+	{
+	public:
+		Mutex m_mtx;
+		ConditionVariable m_condVar;
+		Array<IntrusiveList<AsyncLoaderTask>, U32(AsyncLoaderPriority::kCount)> m_taskQueues;
+		Array<U32, U32(AsyncLoaderPriority::kCount)> m_busyThreadCounts = {}; ///< Number of threads that run a task of a priority.
+		ResourceDynamicArray<WorkerThread*> m_threads;
+		Bool m_quit = false;
+	};
+
+	Array<StageQueues, U32(Stage::kCount)> m_stages;
 
 	Atomic<U32> m_tasksInFlightCount = {0};
 
-	/// Thread callback
-	static Error threadCallback(ThreadCallbackInfo& info);
+	Error threadWorker(Stage stage);
+
+	/// Pop the task with the highest priority that is allowed to run. Needs to be called while the stage is locked.
+	AsyncLoaderTask* popTask(Stage stage, AsyncLoaderPriority& priority);
+
+	void pushTask(Stage stage, AsyncLoaderTask* task);
 
-	Error threadWorker();
+	/// Delete the task and update its status.
+	void retireTask(AsyncLoaderTask* task, AsyncLoaderTaskState state);
 
 	void stop();
 };
@@ -20,6 +20,8 @@ Error CpuMeshResource::load(const ResourceFilename& filename, [[maybe_unused]] B
 	m_isConvex = !!(loader.getHeader().m_flags & MeshBinaryFlag::kConvex);
 	m_maxLod = U8(loader.getHeader().m_lodCount - 1);
 
+	setCpuMemoryUsage(m_indicesMaxLod.getSizeInBytes() + m_positionsMaxLod.getSizeInBytes());
+
 	return Error::kNone;
 }
 
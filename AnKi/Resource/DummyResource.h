@@ -39,6 +39,7 @@ public:
 			void* tempMem = ResourceMemoryPool::getSingleton().allocate(128, 1);
 
 			ResourceMemoryPool::getSingleton().free(tempMem);
+			setCpuMemoryUsage(128);
 		}
 		else
 		{
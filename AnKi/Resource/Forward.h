@@ -12,6 +12,8 @@ namespace anki {
 template<typename T>
 class AnimationKeyframe;
 
+class AnimationChannelSample;
+
 class Bone;
 
 } // end namespace anki
@@ -15,6 +15,7 @@ Error GenericResource::load(const ResourceFilename& filename, [[maybe_unused]] B
 	const U32 size = U32(file->getSize());
 	m_data.resize(size);
 	ANKI_CHECK(file->read(&m_data[0], size));
+	setCpuMemoryUsage(size);
 
 	return Error::kNone;
 }
@@ -180,6 +180,12 @@ public:
 
 	virtual Error seek(PtrSize offset, FileSeekOrigin origin) = 0;
 
+	/// See ResourceFile::readMapped.
+	virtual const U8* readMapped([[maybe_unused]] PtrSize size)
+	{
+		return nullptr;
+	}
+
 	virtual PtrSize getSize() const
 	{
 		ANKI_ASSERT(!"Not Implemented");
@@ -202,6 +208,11 @@ public:
 		return m_rfile->seek(offset, origin);
 	}
 
+	const U8* readMapped(PtrSize size) final
+	{
+		return m_rfile->readMapped(size);
+	}
+
 	PtrSize getSize() const final
 	{
 		return m_rfile->getSize();
@@ -413,8 +424,16 @@ Error ImageLoader::loadAnkiImage(FileInterface& file, U32 maxImageSize, ImageBin
 						surf.m_width = mipWidth;
 						surf.m_height = mipHeight;
 
-						surf.m_data.resize(dataSize);
-						ANKI_CHECK(file.read(&surf.m_data[0], dataSize));
+						// Point to the file's memory if it's mapped. Saves a copy
+						if(const U8* mapped = file.readMapped(dataSize))
+						{
+							surf.m_mappedData = ConstWeakArray<U8, PtrSize>(mapped, dataSize);
+						}
+						else
+						{
+							surf.m_data.resize(dataSize);
+							ANKI_CHECK(file.read(&surf.m_data[0], dataSize));
+						}
 
 						mipCount = max(header.m_mipmapCount - mip, mipCount);
 					}
@@ -450,8 +469,16 @@ Error ImageLoader::loadAnkiImage(FileInterface& file, U32 maxImageSize, ImageBin
 				vol.m_height = mipHeight;
 				vol.m_depth = mipDepth;
 
-				vol.m_data.resize(dataSize);
-				ANKI_CHECK(file.read(&vol.m_data[0], dataSize));
+				// Point to the file's memory if it's mapped. Saves a copy
+				if(const U8* mapped = file.readMapped(dataSize))
+				{
+					vol.m_mappedData = ConstWeakArray<U8, PtrSize>(mapped, dataSize);
+				}
+				else
+				{
+					vol.m_data.resize(dataSize);
+					ANKI_CHECK(file.read(&vol.m_data[0], dataSize));
+				}
 
 				mipCount = max(header.m_mipmapCount - mip, mipCount);
 			}
@@ -524,6 +551,11 @@ Error ImageLoader::load(ResourceFilePtr rfile, const CString& filename, U32 maxI
 	{
 		ANKI_RESOURCE_LOGE("Failed to read image: %s", filename.cstr());
 	}
+	else if(file.m_rfile->readMapped(0))
+	{
+		// The surfaces might point to the file
+		m_mappedFile = std::move(file.m_rfile);
+	}
 
 	return err;
 }
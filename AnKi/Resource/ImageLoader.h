@@ -18,7 +18,14 @@ class ImageLoaderSurface
 public:
 	U32 m_width;
 	U32 m_height;
-	DynamicArray<U8, MemoryPoolPtrWrapper<BaseMemoryPool>, PtrSize> m_data;
+	DynamicArray<U8, MemoryPoolPtrWrapper<BaseMemoryPool>, PtrSize> m_data; ///< Empty if the data live in a memory mapped file.
+	ConstWeakArray<U8, PtrSize> m_mappedData; ///< Points to the memory mapped file. Valid as long as the ImageLoader is alive.
+
+	/// Get the data no matter where they live.
+	ConstWeakArray<U8, PtrSize> getData() const
+	{
+		return (m_mappedData.getSize()) ? m_mappedData : ConstWeakArray<U8, PtrSize>(m_data);
+	}
 
 	ImageLoaderSurface(MemoryPoolPtrWrapper<BaseMemoryPool> pool)
 		: m_data(pool)
@@ -34,7 +41,14 @@ public:
 	U32 m_width;
 	U32 m_height;
 	U32 m_depth;
-	DynamicArray<U8, MemoryPoolPtrWrapper<BaseMemoryPool>, PtrSize> m_data;
+	DynamicArray<U8, MemoryPoolPtrWrapper<BaseMemoryPool>, PtrSize> m_data; ///< Empty if the data live in a memory mapped file.
+	ConstWeakArray<U8, PtrSize> m_mappedData; ///< Points to the memory mapped file. Valid as long as the ImageLoader is alive.
+
+	/// Get the data no matter where they live.
+	ConstWeakArray<U8, PtrSize> getData() const
+	{
+		return (m_mappedData.getSize()) ? m_mappedData : ConstWeakArray<U8, PtrSize>(m_data);
+	}
 
 	ImageLoaderVolume(MemoryPoolPtrWrapper<BaseMemoryPool> pool)
 		: m_data(pool)
@@ -123,6 +137,15 @@ public:
 	/// Load a system image file.
 	Error load(const CString& filename, U32 maxImageSize = kMaxU32);
 
+	/// If the surfaces point to a memory mapped file bring that file to memory. See ResourceFile::prefetch.
+	void prefetch()
+	{
+		if(m_mappedFile)
+		{
+			m_mappedFile->prefetch();
+		}
+	}
+
 private:
 	class FileInterface;
 	class RsrcFile;
@@ -146,6 +169,8 @@ private:
 	ImageBinaryColorFormat m_colorFormat = ImageBinaryColorFormat::kNone;
 	ImageBinaryType m_imageType = ImageBinaryType::kNone;
 
+	ResourceFilePtr m_mappedFile; ///< Keep the file alive if some surfaces point to its memory.
+
 	void destroy();
 
 	static Error loadStb(Bool isFloat, FileInterface& fs, U32& width, U32& height,
@@ -7,6 +7,7 @@
 #include <AnKi/Resource/ImageLoader.h>
 #include <AnKi/Resource/ResourceManager.h>
 #include <AnKi/Resource/AsyncLoader.h>
+#include <AnKi/Resource/TextureStreamer.h>
 #include <AnKi/Util/CVarSet.h>
 #include <AnKi/Util/Filesystem.h>
 
@@ -25,11 +26,81 @@ class ImageResource::TexUploadTask : public AsyncLoaderTask
 public:
 	ImageResource::LoadingContext m_ctx;
 
+	Bool hasIoStage() const final
+	{
+		return true;
+	}
+
+	Error io([[maybe_unused]] AsyncLoaderTaskContext& ctx) final
+	{
+		m_ctx.m_loader.prefetch();
+		return Error::kNone;
+	}
+
 	Error operator()([[maybe_unused]] AsyncLoaderTaskContext& ctx) final
 	{
 		return m_ctx.m_image->loadAsync(m_ctx);
 	}
 
+	// The resource waits for it to become loaded
+	Bool isCancellable() const final
+	{
+		return false;
+	}
+
+	static BaseMemoryPool& getMemoryPool()
+	{
+		return ResourceMemoryPool::getSingleton();
+	}
+};
+
+// Loads a part of the mip chain of a streamable image and uploads it to a new texture. The TextureStreamer swaps the textures when it's done.
+class ImageResource::StreamTask : public AsyncLoaderTask
+{
+public:
+	ImageResourcePtr m_image;
+	ImageLoader m_loader{&ResourceMemoryPool::getSingleton()};
+	U32 m_firstMip = 0;
+
+	Bool hasIoStage() const final
+	{
+		return true;
+	}
+
+	Error io([[maybe_unused]] AsyncLoaderTaskContext& ctx) final
+	{
+		ImageResource& image = *m_image;
+
+		ResourceFilePtr file;
+		ANKI_CHECK(image.openFile(image.getFilename(), file));
+
+		// The file stores the mips from the finest to the coarsest so the mips we need are at the end of the file and they are read in one go
+		const U32 maxImageSize = max(image.m_streaming.m_fullSize.x, image.m_streaming.m_fullSize.y) >> m_firstMip;
+		ANKI_CHECK(m_loader.load(file, image.getFilename(), maxImageSize));
+		m_loader.prefetch();
+
+		if(m_loader.getMipmapCount() != image.m_streaming.m_fullMipCount - m_firstMip) [[unlikely]]
+		{
+			ANKI_RESOURCE_LOGE("The image changed after it was loaded: %s", image.getFilename().cstr());
+			return Error::kUserData;
+		}
+
+		return Error::kNone;
+	}
+
+	Error operator()([[maybe_unused]] AsyncLoaderTaskContext& ctx) final
+	{
+		ImageResource& image = *m_image;
+
+		TextureMemoryPoolAllocation alloc;
+		TexturePtr tex = image.newStreamingTexture(m_firstMip, alloc);
+		ANKI_CHECK(uploadMips(m_loader, *tex));
+
+		image.m_streaming.m_newTexAlloc = std::move(alloc);
+		image.m_streaming.m_newTex = std::move(tex);
+		return Error::kNone;
+	}
+
 	static BaseMemoryPool& getMemoryPool()
 	{
 		return ResourceMemoryPool::getSingleton();
@@ -38,6 +109,11 @@ public:
 
 ImageResource::~ImageResource()
 {
+	if(isStreamable() && TextureStreamer::isAllocated())
+	{
+		TextureStreamer::getSingleton().unregisterImage(*this);
+	}
+
 	m_tex.reset(nullptr);
 	TextureMemoryPool::getSingleton().deferredFree(m_texAlloc);
 }
@@ -68,7 +144,24 @@ Error ImageResource::load(const ResourceFilename& filename, Bool async)
 	ResourceFilePtr file;
 	ANKI_CHECK(openFile(filename, file));
 
-	ANKI_CHECK(loader.load(file, filename, g_cvarRsrcMaxImageSize));
+	// Peek the header of AnKi images to find out if the image can stream. If it can load only the tail of the mip chain
+	U32 maxImageSize = g_cvarRsrcMaxImageSize;
+	ImageBinaryHeader header = {};
+	if(async && g_cvarRsrcTextureStreaming && getFileExtension(filename) == "ankitex")
+	{
+		ANKI_CHECK(file->read(&header, sizeof(header)));
+		ANKI_CHECK(file->seek(0, FileSeekOrigin::kBeginning));
+
+		if(header.m_type == ImageBinaryType::k2D && header.m_mipmapCount > 1)
+		{
+			maxImageSize = min<U32>(maxImageSize, g_cvarRsrcTextureStreamingTailSize);
+
+			// The streaming copies the coarser mips out of it when it drops mips
+			init.m_usage |= TextureUsageBit::kCopySource;
+		}
+	}
+
+	ANKI_CHECK(loader.load(file, filename, maxImageSize));
 
 	m_avgColor = loader.getAverageColor();
 
@@ -245,9 +338,32 @@ Error ImageResource::load(const ResourceFilename& filename, Bool async)
 	// Create the texture
 	const PtrSize memReq = GrManager::getSingleton().getTextureMemoryRequirement(init);
 	m_texAlloc = TextureMemoryPool::getSingleton().allocate(memReq);
+	setGpuMemoryUsage(memReq);
 	init.m_memoryBuffer = m_texAlloc;
 	m_tex = GrManager::getSingleton().newTexture(init);
 
+	// Find the full mip chain and if some of it was left out register to the streamer
+	if(maxImageSize < g_cvarRsrcMaxImageSize)
+	{
+		U32 firstFileMip = 0;
+		while(firstFileMip + 1 < header.m_mipmapCount
+			  && max(header.m_width >> firstFileMip, header.m_height >> firstFileMip) > g_cvarRsrcMaxImageSize)
+		{
+			++firstFileMip;
+		}
+
+		m_streaming.m_fullSize = UVec2(header.m_width >> firstFileMip, header.m_height >> firstFileMip);
+		m_streaming.m_fullMipCount = U8(header.m_mipmapCount - firstFileMip);
+		m_streaming.m_tailFirstMip = U8(m_streaming.m_fullMipCount - init.m_mipmapCount);
+		m_streaming.m_residentFirstMip = m_streaming.m_tailFirstMip;
+		m_streaming.m_format = init.m_format;
+
+		if(isStreamable())
+		{
+			TextureStreamer::getSingleton().registerImage(*this);
+		}
+	}
+
 	// Upload the data
 	if(async)
 	{
@@ -265,8 +381,18 @@ Error ImageResource::load(const ResourceFilename& filename, Bool async)
 
 Error ImageResource::loadAsync(LoadingContext& ctx) const
 {
-	const U32 faceCount = textureTypeIsCube(m_tex->getTextureType()) ? 6 : 1;
-	const U32 copyCount = m_tex->getLayerCount() * faceCount * ctx.m_loader.getMipmapCount();
+	ANKI_CHECK(uploadMips(ctx.m_loader, *m_tex));
+
+	[[maybe_unused]] const U32 prevVal = m_pendingLoadedMips.fetchSub(m_tex->getMipmapCount());
+	ANKI_ASSERT(prevVal == m_tex->getMipmapCount());
+	return Error::kNone;
+}
+
+Error ImageResource::uploadMips(const ImageLoader& loader, Texture& tex)
+{
+	ANKI_ASSERT(loader.getMipmapCount() == tex.getMipmapCount());
+	const U32 faceCount = textureTypeIsCube(tex.getTextureType()) ? 6 : 1;
+	const U32 copyCount = tex.getLayerCount() * faceCount * loader.getMipmapCount();
 
 	for(U32 b = 0; b < copyCount; b += kMaxCopiesBeforeFlush)
 	{
@@ -283,9 +409,9 @@ Error ImageResource::loadAsync(LoadingContext& ctx) const
 		for(U32 i = begin; i < end; ++i)
 		{
 			U32 mip, layer, face;
-			unflatten3dArrayIndex(m_tex->getLayerCount(), faceCount, ctx.m_loader.getMipmapCount(), i, layer, face, mip);
+			unflatten3dArrayIndex(tex.getLayerCount(), faceCount, loader.getMipmapCount(), i, layer, face, mip);
 
-			barriers[barrierCount++] = {TextureView(m_tex.get(), TextureSubresourceDesc::surface(mip, face, layer)), TextureUsageBit::kNone,
+			barriers[barrierCount++] = {TextureView(&tex, TextureSubresourceDesc::surface(mip, face, layer)), TextureUsageBit::kNone,
 										TextureUsageBit::kCopyDestination};
 		}
 		cmdb->setPipelineBarrier({&barriers[0], barrierCount}, {}, {});
@@ -296,27 +422,27 @@ Error ImageResource::loadAsync(LoadingContext& ctx) const
 		for(U32 i = begin; i < end; ++i)
 		{
 			U32 mip, layer, face;
-			unflatten3dArrayIndex(m_tex->getLayerCount(), faceCount, ctx.m_loader.getMipmapCount(), i, layer, face, mip);
+			unflatten3dArrayIndex(tex.getLayerCount(), faceCount, loader.getMipmapCount(), i, layer, face, mip);
 
 			PtrSize surfOrVolSize;
 			const void* surfOrVolData;
 			PtrSize allocationSize;
 
-			if(m_tex->getTextureType() == TextureType::k3D)
+			if(tex.getTextureType() == TextureType::k3D)
 			{
-				const auto& vol = ctx.m_loader.getVolume(mip);
-				surfOrVolSize = vol.m_data.getSize();
-				surfOrVolData = &vol.m_data[0];
+				const auto& vol = loader.getVolume(mip);
+				surfOrVolSize = vol.getData().getSize();
+				surfOrVolData = &vol.getData()[0];
 
-				allocationSize = computeVolumeSize(m_tex->getWidth() >> mip, m_tex->getHeight() >> mip, m_tex->getDepth() >> mip, m_tex->getFormat());
+				allocationSize = computeVolumeSize(tex.getWidth() >> mip, tex.getHeight() >> mip, tex.getDepth() >> mip, tex.getFormat());
 			}
 			else
 			{
-				const auto& surf = ctx.m_loader.getSurface(mip, face, layer);
-				surfOrVolSize = surf.m_data.getSize();
-				surfOrVolData = &surf.m_data[0];
+				const auto& surf = loader.getSurface(mip, face, layer);
+				surfOrVolSize = surf.getData().getSize();
+				surfOrVolData = &surf.getData()[0];
 
-				allocationSize = computeSurfaceSize(m_tex->getWidth() >> mip, m_tex->getHeight() >> mip, m_tex->getFormat());
+				allocationSize = computeSurfaceSize(tex.getWidth() >> mip, tex.getHeight() >> mip, tex.getFormat());
 			}
 
 			ANKI_ASSERT(allocationSize >= surfOrVolSize);
@@ -329,7 +455,7 @@ Error ImageResource::loadAsync(LoadingContext& ctx) const
 
 			// Create temp tex view
 			const TextureSubresourceDesc subresource = TextureSubresourceDesc::surface(mip, face, layer);
-			cmdb->copyBufferToTexture(handle, TextureView(m_tex.get(), subresource));
+			cmdb->copyBufferToTexture(handle, TextureView(&tex, subresource));
 		}
 
 		// Set the barriers of the batch
@@ -337,10 +463,10 @@ Error ImageResource::loadAsync(LoadingContext& ctx) const
 		for(U32 i = begin; i < end; ++i)
 		{
 			U32 mip, layer, face;
-			unflatten3dArrayIndex(m_tex->getLayerCount(), faceCount, ctx.m_loader.getMipmapCount(), i, layer, face, mip);
+			unflatten3dArrayIndex(tex.getLayerCount(), faceCount, loader.getMipmapCount(), i, layer, face, mip);
 
-			barriers[barrierCount++] = {TextureView(m_tex.get(), TextureSubresourceDesc::surface(mip, face, layer)),
-										TextureUsageBit::kCopyDestination, TextureUsageBit::kAllSrv};
+			barriers[barrierCount++] = {TextureView(&tex, TextureSubresourceDesc::surface(mip, face, layer)), TextureUsageBit::kCopyDestination,
+										TextureUsageBit::kAllSrv};
 		}
 		cmdb->setPipelineBarrier({&barriers[0], barrierCount}, {}, {});
 
@@ -356,9 +482,78 @@ Error ImageResource::loadAsync(LoadingContext& ctx) const
 		cmdb.reset(nullptr);
 	}
 
-	[[maybe_unused]] const U32 prevVal = m_pendingLoadedMips.fetchSub(m_tex->getMipmapCount());
-	ANKI_ASSERT(prevVal == m_tex->getMipmapCount());
 	return Error::kNone;
 }
 
+TexturePtr ImageResource::newStreamingTexture(U32 firstMip, TextureMemoryPoolAllocation& alloc) const
+{
+	ANKI_ASSERT(isStreamable() && firstMip < m_streaming.m_fullMipCount);
+
+	const String filenameExt = anki::getFilename(getFilename());
+	TextureInitInfo init(filenameExt);
+	init.m_usage = TextureUsageBit::kAllSrv | TextureUsageBit::kCopySource | TextureUsageBit::kCopyDestination;
+	init.m_width = m_streaming.m_fullSize.x >> firstMip;
+	init.m_height = m_streaming.m_fullSize.y >> firstMip;
+	init.m_type = TextureType::k2D;
+	init.m_format = m_streaming.m_format;
+	init.m_mipmapCount = U8(m_streaming.m_fullMipCount - firstMip);
+
+	alloc = TextureMemoryPool::getSingleton().allocate(GrManager::getSingleton().getTextureMemoryRequirement(init));
+	init.m_memoryBuffer = alloc;
+	return GrManager::getSingleton().newTexture(init);
+}
+
+TexturePtr ImageResource::newCoarserTexture(U32 firstMip, TextureMemoryPoolAllocation& alloc) const
+{
+	ANKI_ASSERT(firstMip > m_streaming.m_residentFirstMip);
+	const U32 srcFirstMip = firstMip - m_streaming.m_residentFirstMip;
+
+	TexturePtr tex = newStreamingTexture(firstMip, alloc);
+	ANKI_ASSERT(tex->getMipmapCount() + srcFirstMip == m_tex->getMipmapCount());
+
+	CommandBufferInitInfo ci;
+	ci.m_flags = CommandBufferFlag::kGeneralWork | CommandBufferFlag::kSmallBatch;
+	CommandBufferPtr cmdb = GrManager::getSingleton().newCommandBuffer(ci);
+
+	Array<TextureBarrierInfo, 2> barriers;
+	barriers[0] = {TextureView(m_tex.get()), TextureUsageBit::kAllSrv, TextureUsageBit::kCopySource};
+	barriers[1] = {TextureView(tex.get()), TextureUsageBit::kNone, TextureUsageBit::kCopyDestination};
+	cmdb->setPipelineBarrier(barriers, {}, {});
+
+	for(U32 mip = 0; mip < tex->getMipmapCount(); ++mip)
+	{
+		cmdb->copyTextureToTexture(TextureView(m_tex.get(), TextureSubresourceDesc::surface(srcFirstMip + mip, 0, 0)),
+								   TextureView(tex.get(), TextureSubresourceDesc::surface(mip, 0, 0)));
+	}
+
+	barriers[0] = {TextureView(m_tex.get()), TextureUsageBit::kCopySource, TextureUsageBit::kAllSrv};
+	barriers[1] = {TextureView(tex.get()), TextureUsageBit::kCopyDestination, TextureUsageBit::kAllSrv};
+	cmdb->setPipelineBarrier(barriers, {}, {});
+
+	cmdb->endRecording();
+	GrManager::getSingleton().submit(cmdb.get());
+
+	return tex;
+}
+
+AsyncLoaderTaskHandle ImageResource::submitStreamTask(U32 firstMip)
+{
+	ANKI_ASSERT(getRefcount() > 0 && "Someone should hold a reference");
+
+	StreamTask* task = AsyncLoader::getSingleton().newTask<StreamTask>();
+	task->m_image.reset(this);
+	task->m_firstMip = firstMip;
+	return AsyncLoader::getSingleton().submitTask(task, AsyncLoaderPriority::kLow);
+}
+
+PtrSize ImageResource::computeStreamingMemory(U32 firstMip) const
+{
+	PtrSize size = 0;
+	for(U32 mip = firstMip; mip < m_streaming.m_fullMipCount; ++mip)
+	{
+		size += computeSurfaceSize(m_streaming.m_fullSize.x >> mip, m_streaming.m_fullSize.y >> mip, m_streaming.m_format);
+	}
+	return size;
+}
+
 } // end namespace anki
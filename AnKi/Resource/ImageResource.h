@@ -6,17 +6,28 @@
 #pragma once
 
 #include <AnKi/Resource/ResourceObject.h>
+#include <AnKi/Resource/AsyncLoader.h>
 #include <AnKi/Gr.h>
 #include <AnKi/GpuMemory/TextureMemoryPool.h>
 
 namespace anki {
 
+// Forward
+class ImageLoader;
+
 ANKI_CVAR(NumericCVar<U32>, Rsrc, MaxImageSize, 1024u * 1024u, 4u, kMaxU32, "Max image size to load")
+ANKI_CVAR(BoolCVar, Rsrc, TextureStreaming, true, "Load the tail mips of the 2D textures first and stream the finer mips in and out on demand")
+ANKI_CVAR(NumericCVar<U32>, Rsrc, TextureStreamingTailSize, 128u, 4u, kMaxU32, "The streamable textures initially load the mips up to that size")
 
 // Image resource class. It loads or creates an image and then loads it in the GPU. It supports compressed and uncompressed TGAs, PNGs, JPEG and
 // AnKi's image format.
+// 2D AnKi images that are loaded asynchronously are streamable. They load the tail of the mip chain and the TextureStreamer brings the finer mips
+// later. Every time the mips change the texture is replaced by a new one so don't cache the texture (or its bindless index) across frames without
+// checking getTextureVersion().
 class ImageResource : public ResourceObject
 {
+	friend class TextureStreamer;
+
 public:
 	ImageResource(CString fname, U32 uuid)
 		: ResourceObject(fname, uuid)
@@ -32,6 +43,18 @@ public:
 		return *m_tex;
 	}
 
+	// Incremented every time the texture streaming replaces the texture.
+	U32 getTextureVersion() const
+	{
+		return m_texVersion;
+	}
+
+	// The size of the finest mip. For streamable images it's not the size of the texture if the finer mips are not resident.
+	UVec2 getFullSize() const
+	{
+		return (isStreamable()) ? m_streaming.m_fullSize : UVec2(m_tex->getWidth(), m_tex->getHeight());
+	}
+
 	Vec4 getAverageColor() const
 	{
 		return m_avgColor;
@@ -42,20 +65,89 @@ public:
 		return m_pendingLoadedMips.load() == 0;
 	}
 
+	Bool isStreamable() const
+	{
+		return m_streaming.m_tailFirstMip > 0;
+	}
+
+	// By default streamable images stream in all their mips. The users that call requestResolution() every frame that they need the image should
+	// call that once so the image loads only what it's asked for. Thread-safe.
+	void enableDemandDrivenStreaming()
+	{
+		m_streaming.m_demandDriven.store(1);
+	}
+
+	// Ask for the mip that has at least that many texels in its largest dimension. The finest request of the frame wins. Thread-safe.
+	void requestResolution(F32 texels)
+	{
+		if(isStreamable())
+		{
+			const F32 fullSize = F32(max(m_streaming.m_fullSize.x, m_streaming.m_fullSize.y));
+			const U32 mip = (texels >= fullSize) ? 0 : U32(log2(fullSize / max(texels, 1.0f)));
+			m_streaming.m_requestedFirstMip.min(mip);
+		}
+	}
+
 private:
 	static constexpr U32 kMaxCopiesBeforeFlush = 4;
 
 	class TexUploadTask;
+	class StreamTask;
 	class LoadingContext;
 
+	// Everything needed to stream the mips. The mips are counted from the finest mip that the g_cvarRsrcMaxImageSize allows
+	class Streaming
+	{
+	public:
+		UVec2 m_fullSize = UVec2(0u);
+		Format m_format = Format::kNone;
+		U8 m_fullMipCount = 0;
+		U8 m_tailFirstMip = 0; // Zero if the image is not streamable
+		U8 m_residentFirstMip = 0; // The 1st mip of m_tex
+
+		Atomic<U32> m_requestedFirstMip = {kMaxU32}; // The finest request of this frame
+		Atomic<U32> m_demandDriven = {0};
+
+		// The TextureStreamer owns the rest
+		U32 m_streamerIndex = kMaxU32;
+		U8 m_wantedFirstMip = 0;
+		U8 m_inFlightFirstMip = 0;
+		Bool m_failed = false;
+		Timestamp m_wantedFrame = 0;
+		AsyncLoaderTaskHandle m_inFlight;
+
+		// The results of the StreamTask
+		TextureMemoryPoolAllocation m_newTexAlloc;
+		TexturePtr m_newTex;
+	};
+
 	TextureMemoryPoolAllocation m_texAlloc;
 	TexturePtr m_tex;
 
 	Vec4 m_avgColor = Vec4(0.0f);
 
+	Streaming m_streaming;
+	U32 m_texVersion = 0;
+
 	mutable Atomic<U32> m_pendingLoadedMips = {0};
 
 	Error loadAsync(LoadingContext& ctx) const;
+
+	// Upload all the mips of the loader to a texture with the same mip chain.
+	static Error uploadMips(const ImageLoader& loader, Texture& tex);
+
+	// Create a texture that holds the mips starting from firstMip. Used by the streaming.
+	TexturePtr newStreamingTexture(U32 firstMip, TextureMemoryPoolAllocation& alloc) const;
+
+	// Create a texture that holds the mips starting from firstMip and copy them on the GPU from the current texture. firstMip should be coarser than
+	// the first resident mip.
+	TexturePtr newCoarserTexture(U32 firstMip, TextureMemoryPoolAllocation& alloc) const;
+
+	// Start loading the mips starting from firstMip in the background. The task keeps a reference to the image.
+	AsyncLoaderTaskHandle submitStreamTask(U32 firstMip);
+
+	// The memory the streaming accounts for a texture that starts from firstMip.
+	PtrSize computeStreamingMemory(U32 firstMip) const;
 };
 
 } // end namespace anki
@@ -453,6 +453,9 @@ Error MaterialResource::parseInput(XmlElement inputEl, Bool async, BitSet<128>&
 		{
 			ANKI_CHECK(ResourceManager::getSingleton().loadResource(value, foundVar->m_image, async));
 
+			// The MaterialComponents ask for the resolution they need
+			foundVar->m_image->enableDemandDrivenStreaming();
+
 			foundVar->m_U32 = foundVar->m_image->getTexture().getOrCreateBindlessTextureIndex(TextureSubresourceDesc::all());
 		}
 		else
@@ -505,7 +508,7 @@ void MaterialResource::prefillLocalConstants()
 	}
 }
 
-const MaterialVariant& MaterialResource::getOrCreateVariant(const RenderingKey& key_) const
+RenderingKey MaterialResource::sanitizeRenderingKey(const RenderingKey& key_) const
 {
 	RenderingKey key = key_;
 
@@ -522,7 +525,7 @@ const MaterialVariant& MaterialResource::getOrCreateVariant(const RenderingKey&
 		key.setVelocity(false);
 	}
 
-	const Bool meshShadersSupported = GrManager::getSingleton().getDeviceCapabilities().m_meshShaders;
+	[[maybe_unused]] const Bool meshShadersSupported = GrManager::getSingleton().getDeviceCapabilities().m_meshShaders;
 	ANKI_ASSERT(!(key.getMeshletRendering() && (!meshShadersSupported && !g_cvarCoreMeshletRendering))
 				&& "Can't be asking for meshlet rendering if mesh shaders or SW meshlet rendering are not supported/enabled");
 	if(key.getMeshletRendering() && !(m_shaderTechniques & (ShaderTechniqueBit::kMeshSaders | ShaderTechniqueBit::kSwMeshletRendering)))
@@ -533,27 +536,12 @@ const MaterialVariant& MaterialResource::getOrCreateVariant(const RenderingKey&
 	ANKI_ASSERT(!key.getSkinned() || !!(m_presentBuildinMutatorMask & U32(1 << BuiltinMutatorId::kBones)));
 	ANKI_ASSERT(!key.getVelocity() || !!(m_presentBuildinMutatorMask & U32(1 << BuiltinMutatorId::kVelocity)));
 
-	MaterialVariant& variant = m_variantMatrix[key.getRenderingTechnique()][key.getSkinned()][key.getVelocity()][key.getMeshletRendering()];
-
-	// Check if it's initialized
-	{
-		RLockGuard lock(m_variantMatrixMtx);
-		if(variant.m_prog.isCreated()) [[likely]]
-		{
-			return variant;
-		}
-	}
-
-	// Not initialized, init it
-	WLockGuard lock(m_variantMatrixMtx);
-
-	// Check again
-	if(variant.m_prog.isCreated())
-	{
-		return variant;
-	}
+	return key;
+}
 
-	ShaderProgramResourceVariantInitInfo initInfo(m_prog);
+void MaterialResource::fillVariantInitInfo(const RenderingKey& key, ShaderProgramResourceVariantInitInfo& initInfo) const
+{
+	const Bool meshShadersSupported = GrManager::getSingleton().getDeviceCapabilities().m_meshShaders;
 
 	for(const PartialMutation& m : m_partialMutation)
 	{
@@ -620,10 +608,81 @@ const MaterialVariant& MaterialResource::getOrCreateVariant(const RenderingKey&
 	default:
 		ANKI_ASSERT(0);
 	}
+}
+
+const MaterialVariant& MaterialResource::getOrCreateVariant(const RenderingKey& key_) const
+{
+	const RenderingKey key = sanitizeRenderingKey(key_);
+	MaterialVariant& variant = m_variantMatrix[key.getRenderingTechnique()][key.getSkinned()][key.getVelocity()][key.getMeshletRendering()];
+
+	// Check if it's initialized
+	{
+		RLockGuard lock(m_variantMatrixMtx);
+		if(variant.m_prog.isCreated()) [[likely]]
+		{
+			return variant;
+		}
+	}
+
+	// Not initialized, init it
+	WLockGuard lock(m_variantMatrixMtx);
+
+	// Check again
+	if(variant.m_prog.isCreated())
+	{
+		return variant;
+	}
+
+	ShaderProgramResourceVariantInitInfo initInfo(m_prog);
+	fillVariantInitInfo(key, initInfo);
 
 	const ShaderProgramResourceVariant* progVariant = nullptr;
 	m_prog->getOrCreateVariant(initInfo, progVariant);
+	initVariant(key, progVariant, variant);
 
+	return variant;
+}
+
+Bool MaterialResource::tryGetOrCreateVariant(const RenderingKey& key_, const RenderingKey& fallbackKey, const MaterialVariant*& variant_) const
+{
+	const RenderingKey key = sanitizeRenderingKey(key_);
+	MaterialVariant& variant = m_variantMatrix[key.getRenderingTechnique()][key.getSkinned()][key.getVelocity()][key.getMeshletRendering()];
+
+	// Check if it's initialized
+	{
+		RLockGuard lock(m_variantMatrixMtx);
+		if(variant.m_prog.isCreated()) [[likely]]
+		{
+			variant_ = &variant;
+			return true;
+		}
+	}
+
+	// Ask the program without holding the lock, it's not going to block
+	ShaderProgramResourceVariantInitInfo initInfo(m_prog);
+	fillVariantInitInfo(key, initInfo);
+
+	const ShaderProgramResourceVariant* progVariant = nullptr;
+	if(m_prog->tryGetOrCreateVariant(initInfo, progVariant))
+	{
+		WLockGuard lock(m_variantMatrixMtx);
+
+		if(!variant.m_prog.isCreated())
+		{
+			initVariant(key, progVariant, variant);
+		}
+
+		variant_ = &variant;
+		return true;
+	}
+
+	// Not ready, use the fallback
+	variant_ = &getOrCreateVariant(fallbackKey);
+	return false;
+}
+
+void MaterialResource::initVariant(const RenderingKey& key, const ShaderProgramResourceVariant* progVariant, MaterialVariant& variant) const
+{
 	if(!progVariant)
 	{
 		ANKI_RESOURCE_LOGF("Fetched skipped mutation on program %s", getFilename().cstr());
@@ -635,8 +694,6 @@ const MaterialVariant& MaterialResource::getOrCreateVariant(const RenderingKey&
 	{
 		variant.m_rtShaderGroupHandleIndex = progVariant->getShaderGroupHandleIndex();
 	}
-
-	return variant;
 }
 
 Bool MaterialResource::isLoaded() const
@@ -216,6 +216,11 @@ public:
 	// Note: It's thread-safe.
 	const MaterialVariant& getOrCreateVariant(const RenderingKey& key) const;
 
+	// Non-blocking version of getOrCreateVariant(). If the variant of the key is ready it returns true. If it's not it starts creating it in the
+	// background, returns false and gives the variant of the fallbackKey instead. The fallback variant is created synchronously if needed so it
+	// should be one that most likely exists. Note: It's thread-safe.
+	Bool tryGetOrCreateVariant(const RenderingKey& key, const RenderingKey& fallbackKey, const MaterialVariant*& variant) const;
+
 	// Get a buffer with prefilled uniforms.
 	ConstWeakArray<U8> getPrefilledLocalConstants() const
 	{
@@ -224,6 +229,17 @@ public:
 
 	Bool isLoaded() const;
 
+	// The sum of the texture versions of the bindless textures. If it changes the bindless indices in the prefilled constants are stale.
+	U32 getTexturesVersion() const
+	{
+		U32 version = 0;
+		for(const MaterialVariable& var : m_vars)
+		{
+			version += (var.m_image) ? var.m_image->getTextureVersion() : 0;
+		}
+		return version;
+	}
+
 	const ShaderProgramResource& getShaderProgramResource() const
 	{
 		return *m_prog;
@@ -265,6 +281,10 @@ private:
 
 	mutable Atomic<U32> m_loaded = {0};
 
+	RenderingKey sanitizeRenderingKey(const RenderingKey& key) const;
+	void fillVariantInitInfo(const RenderingKey& key, ShaderProgramResourceVariantInitInfo& initInfo) const;
+	void initVariant(const RenderingKey& key, const ShaderProgramResourceVariant* progVariant, MaterialVariant& variant) const;
+
 	Error parseMutators(XmlElement mutatorsEl);
 	Error parseShaderProgram(XmlElement techniqueEl, Bool async);
 	Error parseInput(XmlElement inputEl, Bool async, BitSet<128>& varsSet);
@@ -41,6 +41,13 @@ public:
 
 	Error load(const ResourceFilename& filename);
 
+	/// Bring the file to memory. Does something only for memory mapped files. See ResourceFile::prefetch.
+	void prefetch()
+	{
+		ANKI_ASSERT(isLoaded());
+		m_file->prefetch();
+	}
+
 	Error storeIndexBuffer(U32 lod, void* ptr, PtrSize size);
 
 	Error storeVertexBuffer(U32 lod, U32 bufferIdx, void* ptr, PtrSize size);
@@ -39,11 +39,58 @@ public:
 	{
 	}
 
+	Bool hasIoStage() const final
+	{
+		return true;
+	}
+
+	Error io([[maybe_unused]] AsyncLoaderTaskContext& ctx) final
+	{
+		m_ctx.m_loader.prefetch();
+		return Error::kNone;
+	}
+
 	Error operator()([[maybe_unused]] AsyncLoaderTaskContext& ctx) final
 	{
 		return m_ctx.m_mesh->loadAsync(m_ctx.m_loader);
 	}
 
+	// The resource waits for it to become loaded
+	Bool isCancellable() const final
+	{
+		return false;
+	}
+
+	static BaseMemoryPool& getMemoryPool()
+	{
+		return ResourceMemoryPool::getSingleton();
+	}
+};
+
+/// Loads the occluder geometry of a mesh that is already loaded.
+class MeshResource::OccluderLoadTask : public AsyncLoaderTask
+{
+public:
+	MeshResourcePtr m_mesh;
+
+	OccluderLoadTask(MeshResource* mesh)
+		: m_mesh(mesh)
+	{
+	}
+
+	Error operator()([[maybe_unused]] AsyncLoaderTaskContext& ctx) final
+	{
+		const Error err = m_mesh->loadOccluderGeometry();
+		m_mesh->m_occluderState.store(U32((err) ? OccluderState::kFailed : OccluderState::kLoaded), AtomicMemoryOrder::kRelease);
+		return err;
+	}
+
+	// The mesh waits for it
+	Bool isCancellable() const final
+	{
+		return false;
+	}
+
 	static BaseMemoryPool& getMemoryPool()
 	{
 		return ResourceMemoryPool::getSingleton();
@@ -190,6 +237,34 @@ Error MeshResource::load(const ResourceFilename& filename, Bool async)
 		}
 	}
 
+	// Account the GPU memory
+	{
+		auto allocSize = [](const UnifiedGeometryBufferAllocation& alloc) -> PtrSize {
+			return (alloc) ? alloc.getAllocatedSize() : 0;
+		};
+
+		PtrSize gpuMemory = 0;
+		for(const Lod& lod : m_lods)
+		{
+			gpuMemory += allocSize(lod.m_indexBufferAllocationToken);
+			for(const UnifiedGeometryBufferAllocation& alloc : lod.m_vertexBuffersAllocationToken)
+			{
+				gpuMemory += allocSize(alloc);
+			}
+			gpuMemory += allocSize(lod.m_meshletIndices) + allocSize(lod.m_meshletBoundingVolumes) + allocSize(lod.m_meshletGeometryDescriptors);
+		}
+
+		for(const SubMesh& subMesh : m_subMeshes)
+		{
+			for(const UnifiedGeometryBufferAllocation& alloc : subMesh.m_blasAllocationTokens)
+			{
+				gpuMemory += allocSize(alloc);
+			}
+		}
+
+		setGpuMemoryUsage(gpuMemory);
+	}
+
 	// Submit the loading task
 	if(async)
 	{
@@ -205,7 +280,7 @@ Error MeshResource::load(const ResourceFilename& filename, Bool async)
 	return Error::kNone;
 }
 
-Error MeshResource::loadAsync(MeshBinaryLoader& loader) const
+Error MeshResource::loadAsync(MeshBinaryLoader& loader)
 {
 	GrManager& gr = GrManager::getSingleton();
 	TransferGpuAllocator& transferAlloc = TransferGpuAllocator::getSingleton();
@@ -458,11 +533,45 @@ Error MeshResource::loadAsync(MeshBinaryLoader& loader) const
 		transferAlloc.release(handles[i], fence);
 	}
 
+	makeGeometryRelocatable();
+
 	m_loadedLodCount.store(m_lods.getSize());
 
 	return Error::kNone;
 }
 
+void MeshResource::makeGeometryRelocatable()
+{
+	// Everything that is referenced by offset from the GPU scene can move. The rest stays put:
+	// - Meshlet descriptors bake the offsets of the vertex buffers and the meshlet indices
+	// - The BLASes live in the UGB memory
+	auto callback = [](void* userData) {
+		static_cast<MeshResource*>(userData)->m_geometryVersion.fetchAdd(1);
+	};
+
+	UnifiedGeometryBuffer& ugb = UnifiedGeometryBuffer::getSingleton();
+	for(Lod& lod : m_lods)
+	{
+		ugb.makeRelocatable(lod.m_indexBufferAllocationToken, callback, this);
+
+		if(lod.m_meshletCount == 0)
+		{
+			for(UnifiedGeometryBufferAllocation& alloc : lod.m_vertexBuffersAllocationToken)
+			{
+				if(alloc)
+				{
+					ugb.makeRelocatable(alloc, callback, this);
+				}
+			}
+		}
+		else
+		{
+			ugb.makeRelocatable(lod.m_meshletBoundingVolumes, callback, this);
+			ugb.makeRelocatable(lod.m_meshletGeometryDescriptors, callback, this);
+		}
+	}
+}
+
 Error MeshResource::getOrCreateCollisionShape(Bool wantStatic, U32 lod, PhysicsCollisionShapePtr& out) const
 {
 	lod = min<U32>(lod, getLodCount() - 1);
@@ -501,4 +610,40 @@ Error MeshResource::getOrCreateCollisionShape(Bool wantStatic, U32 lod, PhysicsC
 	return Error::kNone;
 }
 
+Bool MeshResource::getOccluderGeometry(ConstWeakArray<Vec3>& positions, ConstWeakArray<U32>& indices) const
+{
+	ANKI_ASSERT(isLoaded());
+
+	U32 state = m_occluderState.load(AtomicMemoryOrder::kAcquire);
+	if(state == U32(OccluderState::kNotRequested)
+	   && m_occluderState.compareExchange(state, U32(OccluderState::kLoading), AtomicMemoryOrder::kAcquire, AtomicMemoryOrder::kAcquire))
+	{
+		// Only the occluders pay for the CPU copy so load it on the 1st request
+		OccluderLoadTask* task = AsyncLoader::getSingleton().newTask<OccluderLoadTask>(const_cast<MeshResource*>(this));
+		AsyncLoader::getSingleton().submitTask(task, AsyncLoaderPriority::kMedium);
+		return false;
+	}
+
+	if(state != U32(OccluderState::kLoaded))
+	{
+		return false;
+	}
+
+	positions = m_occluderPositions;
+	indices = m_occluderIndices;
+	return true;
+}
+
+Error MeshResource::loadOccluderGeometry()
+{
+	MeshBinaryLoader loader(&ResourceMemoryPool::getSingleton());
+	ANKI_CHECK(loader.load(getFilename()));
+	ANKI_CHECK(loader.storeIndicesAndPosition(getLodCount() - 1, m_occluderIndices, m_occluderPositions));
+
+	ResourceManager::getSingleton().updateCpuMemoryUsage(
+		*this, getCpuMemoryUsage() + m_occluderIndices.getSizeInBytes() + m_occluderPositions.getSizeInBytes());
+
+	return Error::kNone;
+}
+
 } // end namespace anki
@@ -112,14 +112,33 @@ public:
 
 	Error getOrCreateCollisionShape(Bool wantStatic, U32 lod, PhysicsCollisionShapePtr& out) const;
 
+	/// Get the positions and indices of the coarsest LOD for CPU occlusion culling. The 1st call kicks an async task that loads them from the
+	/// file and it returns false until they are loaded. The arrays stay valid for the lifetime of the resource.
+	Bool getOccluderGeometry(ConstWeakArray<Vec3>& positions, ConstWeakArray<U32>& indices) const;
+
 	Bool isLoaded() const
 	{
 		return m_loadedLodCount.load() == m_lods.getSize();
 	}
 
+	/// It changes every time the UnifiedGeometryBuffer moves some of the geometry of the mesh. Offsets that were cached need to be re-fetched.
+	U32 getGeometryVersion() const
+	{
+		return m_geometryVersion.load();
+	}
+
 private:
 	class LoadTask;
 	class LoadContext;
+	class OccluderLoadTask;
+
+	enum class OccluderState : U32
+	{
+		kNotRequested,
+		kLoading,
+		kLoaded,
+		kFailed
+	};
 
 	class Lod
 	{
@@ -153,6 +172,8 @@ private:
 		Aabb m_aabb;
 	};
 
+	Atomic<U32> m_geometryVersion = {0}; // Keep it before the allocations. They might use it until they are destroyed
+
 	ResourceDynamicArray<SubMesh> m_subMeshes;
 	ResourceDynamicArray<Lod> m_lods;
 	Aabb m_aabb;
@@ -164,9 +185,17 @@ private:
 
 	mutable Atomic<U32> m_loadedLodCount = {0};
 
+	ResourceDynamicArray<Vec3> m_occluderPositions; // Written by the OccluderLoadTask before m_occluderState becomes kLoaded
+	ResourceDynamicArray<U32> m_occluderIndices;
+	mutable Atomic<U32> m_occluderState = {U32(OccluderState::kNotRequested)};
+
 	Bool m_isConvex = false;
 
-	Error loadAsync(MeshBinaryLoader& loader) const;
+	Error loadAsync(MeshBinaryLoader& loader);
+
+	Error loadOccluderGeometry();
+
+	void makeGeometryRelocatable();
 };
 /// @}
 
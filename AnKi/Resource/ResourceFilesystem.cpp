@@ -94,81 +94,296 @@ public:
 	}
 };
 
-/// ZIP file
-class ZipResourceFile final : public ResourceFile
+/// A loose file that is memory mapped. Reads are plain copies from the page cache.
+class MappedResourceFile final : public ResourceFile
+{
+public:
+	MemoryMappedFile m_file;
+	PtrSize m_pos = 0;
+
+	Error read(void* buff, PtrSize size) override
+	{
+		ANKI_TRACE_SCOPED_EVENT(RsrcFileRead);
+		const U8* data = readMapped(size);
+		if(!data)
+		{
+			ANKI_RESOURCE_LOGE("Reading past the end of the file");
+			return Error::kFileAccess;
+		}
+
+		memcpy(buff, data, size);
+		return Error::kNone;
+	}
+
+	Error readAllText(ResourceString& out) override
+	{
+		out = ResourceString('?', m_file.getSize());
+		memcpy(&out[0], m_file.getData(), m_file.getSize());
+		m_pos = m_file.getSize();
+		return Error::kNone;
+	}
+
+	Error readU32(U32& u) override
+	{
+		// Assume machine and file have same endianness
+		return read(&u, sizeof(u));
+	}
+
+	Error readF32(F32& f) override
+	{
+		// Assume machine and file have same endianness
+		return read(&f, sizeof(f));
+	}
+
+	Error seek(PtrSize offset, FileSeekOrigin origin) override
+	{
+		PtrSize newPos;
+		switch(origin)
+		{
+		case FileSeekOrigin::kBeginning:
+			newPos = offset;
+			break;
+		case FileSeekOrigin::kCurrent:
+			newPos = m_pos + offset;
+			break;
+		default:
+			ANKI_ASSERT(origin == FileSeekOrigin::kEnd);
+			newPos = m_file.getSize() + offset;
+		}
+
+		if(newPos > m_file.getSize())
+		{
+			ANKI_RESOURCE_LOGE("Seeking past the end of the file");
+			return Error::kFileAccess;
+		}
+
+		m_pos = newPos;
+		return Error::kNone;
+	}
+
+	PtrSize getSize() const override
+	{
+		return m_file.getSize();
+	}
+
+	const U8* readMapped(PtrSize size) override
+	{
+		if(m_pos + size > m_file.getSize())
+		{
+			return nullptr;
+		}
+
+		const U8* out = m_file.getData() + m_pos;
+		m_pos += size;
+		return out;
+	}
+
+	void prefetch() override
+	{
+		ANKI_TRACE_SCOPED_EVENT(RsrcFilePrefetch);
+
+		// Touch one byte per page
+		constexpr PtrSize kPageSize = 4_KB;
+		U8 sum = 0;
+		for(PtrSize offset = 0; offset < m_file.getSize(); offset += kPageSize)
+		{
+			sum += static_cast<const volatile U8*>(m_file.getData())[offset];
+		}
+		[[maybe_unused]] volatile U8 dontOptimize = sum;
+	}
+};
+
+/// An opened archive. Opening an archive parses the end of the central directory so the handles are kept around and re-used.
+class ZipArchiveHandle
 {
 public:
 	unzFile m_archive = nullptr;
-	PtrSize m_size = 0;
+	File m_file; ///< Used to read the stored (uncompressed) files directly.
 
-	~ZipResourceFile()
+	~ZipArchiveHandle()
 	{
 		if(m_archive)
 		{
-			// It's open
 			unzClose(m_archive);
-			m_archive = nullptr;
-			m_size = 0;
 		}
 	}
+};
 
-	Error open(const CString& archive, const CString& archivedFname)
+/// A pool of handles of the same archive. Every thread that opens a file gets its own handle so there is no need for locking while reading.
+class ZipArchiveHandlePool
+{
+public:
+	ResourceString m_archivePath;
+
+	ZipArchiveHandlePool(CString archivePath)
+		: m_archivePath(archivePath)
 	{
-		// Open archive
-		m_archive = unzOpen(&archive[0]);
-		if(m_archive == nullptr)
+	}
+
+	~ZipArchiveHandlePool()
+	{
+		for(ZipArchiveHandle* handle : m_freeHandles)
 		{
-			ANKI_RESOURCE_LOGE("Failed to open archive");
+			deleteInstance(ResourceMemoryPool::getSingleton(), handle);
+		}
+	}
+
+	void retain()
+	{
+		m_refcount.fetchAdd(1);
+	}
+
+	void release()
+	{
+		if(m_refcount.fetchSub(1) == 1)
+		{
+			deleteInstance(ResourceMemoryPool::getSingleton(), this);
+		}
+	}
+
+	Error acquireHandle(ZipArchiveHandle*& out)
+	{
+		{
+			LockGuard lock(m_mtx);
+			if(!m_freeHandles.isEmpty())
+			{
+				out = m_freeHandles.getBack();
+				m_freeHandles.popBack();
+				return Error::kNone;
+			}
+		}
+
+		ZipArchiveHandle* handle = newInstance<ZipArchiveHandle>(ResourceMemoryPool::getSingleton());
+		handle->m_archive = unzOpen(m_archivePath.cstr());
+		if(handle->m_archive == nullptr)
+		{
+			deleteInstance(ResourceMemoryPool::getSingleton(), handle);
+			ANKI_RESOURCE_LOGE("Failed to open archive: %s", m_archivePath.cstr());
 			return Error::kFileAccess;
 		}
 
-		// Locate archived
-		const int caseSensitive = 1;
-		if(unzLocateFile(m_archive, &archivedFname[0], caseSensitive) != UNZ_OK)
+		if(handle->m_file.open(m_archivePath, FileOpenFlag::kRead | FileOpenFlag::kBinary))
+		{
+			deleteInstance(ResourceMemoryPool::getSingleton(), handle);
+			return Error::kFileAccess;
+		}
+
+		out = handle;
+		return Error::kNone;
+	}
+
+	void releaseHandle(ZipArchiveHandle* handle)
+	{
+		LockGuard lock(m_mtx);
+		m_freeHandles.emplaceBack(handle);
+	}
+
+private:
+	ResourceDynamicArray<ZipArchiveHandle*> m_freeHandles;
+	Mutex m_mtx;
+	Atomic<I32> m_refcount = {1};
+};
+
+/// ZIP file
+class ZipResourceFile final : public ResourceFile
+{
+public:
+	~ZipResourceFile()
+	{
+		close();
+	}
+
+	Error open(ZipArchiveHandlePool& pool, const ResourceFilesystem::FileInfo& fileInfo)
+	{
+		ANKI_ASSERT(!m_handle);
+		pool.retain();
+		m_pool = &pool;
+		ANKI_CHECK(pool.acquireHandle(m_handle));
+
+		// Jump straight to the file using the index. No need to search the central directory
+		unz64_file_pos pos;
+		pos.pos_in_zip_directory = fileInfo.m_archivePosInCentralDir;
+		pos.num_of_file = fileInfo.m_archiveFileIndex;
+		if(unzGoToFilePos64(m_handle->m_archive, &pos) != UNZ_OK)
 		{
-			ANKI_RESOURCE_LOGE("Failed to locate file in archive");
+			ANKI_RESOURCE_LOGE("Failed to locate file in archive: %s", fileInfo.m_filename.cstr());
 			return Error::kFileAccess;
 		}
 
 		// Open file
-		if(unzOpenCurrentFile(m_archive) != UNZ_OK)
+		if(unzOpenCurrentFile(m_handle->m_archive) != UNZ_OK)
 		{
 			ANKI_RESOURCE_LOGE("unzOpenCurrentFile() failed");
 			return Error::kFileAccess;
 		}
+		m_currentFileOpen = true;
 
-		// Get size just in case
-		unz_file_info zinfo;
-		zinfo.uncompressed_size = 0;
-		unzGetCurrentFileInfo(m_archive, &zinfo, nullptr, 0, nullptr, 0, nullptr, 0);
-		m_size = zinfo.uncompressed_size;
+		m_size = fileInfo.m_archiveUncompressedSize;
 		ANKI_ASSERT(m_size != 0);
 
+		m_stored = fileInfo.m_archiveStored;
+		if(m_stored)
+		{
+			// The data of stored files are not compressed so they can be read directly from the archive
+			m_dataOffset = unzGetCurrentFileZStreamPos64(m_handle->m_archive);
+			unzCloseCurrentFile(m_handle->m_archive);
+			m_currentFileOpen = false;
+
+			ANKI_CHECK(m_handle->m_file.seek(m_dataOffset, FileSeekOrigin::kBeginning));
+		}
+
 		return Error::kNone;
 	}
 
 	void close()
 	{
-		if(m_archive)
+		if(m_handle)
 		{
-			unzClose(m_archive);
-			m_archive = nullptr;
-			m_size = 0;
+			if(m_currentFileOpen)
+			{
+				unzCloseCurrentFile(m_handle->m_archive);
+				m_currentFileOpen = false;
+			}
+
+			m_pool->releaseHandle(m_handle);
+			m_handle = nullptr;
+		}
+
+		if(m_pool)
+		{
+			m_pool->release();
+			m_pool = nullptr;
 		}
+
+		m_size = 0;
+		m_pos = 0;
 	}
 
 	Error read(void* buff, PtrSize size) override
 	{
 		ANKI_TRACE_SCOPED_EVENT(RsrcFileRead);
 
-		I64 readSize = unzReadCurrentFile(m_archive, buff, U32(size));
-
-		if(I64(size) != readSize)
+		if(m_pos + size > m_size)
 		{
-			ANKI_RESOURCE_LOGE("File read failed");
+			ANKI_RESOURCE_LOGE("Reading past the end of the file");
 			return Error::kFileAccess;
 		}
 
+		if(m_stored)
+		{
+			ANKI_CHECK(m_handle->m_file.read(buff, size));
+		}
+		else
+		{
+			const I64 readSize = unzReadCurrentFile(m_handle->m_archive, buff, U32(size));
+			if(I64(size) != readSize)
+			{
+				ANKI_RESOURCE_LOGE("File read failed");
+				return Error::kFileAccess;
+			}
+		}
+
+		m_pos += size;
 		return Error::kNone;
 	}
 
@@ -195,23 +410,52 @@ public:
 
 	Error seek(PtrSize offset, FileSeekOrigin origin) override
 	{
-		// Rewind if needed
-		if(origin == FileSeekOrigin::kBeginning)
+		PtrSize newPos;
+		switch(origin)
 		{
-			if(unzCloseCurrentFile(m_archive) || unzOpenCurrentFile(m_archive))
+		case FileSeekOrigin::kBeginning:
+			newPos = offset;
+			break;
+		case FileSeekOrigin::kCurrent:
+			newPos = m_pos + offset;
+			break;
+		default:
+			ANKI_ASSERT(origin == FileSeekOrigin::kEnd);
+			newPos = m_size + offset;
+		}
+
+		if(newPos > m_size)
+		{
+			ANKI_RESOURCE_LOGE("Seeking past the end of the file");
+			return Error::kFunctionFailed;
+		}
+
+		if(m_stored)
+		{
+			// Random access
+			ANKI_CHECK(m_handle->m_file.seek(m_dataOffset + newPos, FileSeekOrigin::kBeginning));
+			m_pos = newPos;
+			return Error::kNone;
+		}
+
+		// Compressed files can only move forward. Rewind if needed
+		if(newPos < m_pos)
+		{
+			if(unzCloseCurrentFile(m_handle->m_archive) || unzOpenCurrentFile(m_handle->m_archive))
 			{
 				ANKI_RESOURCE_LOGE("Rewind failed");
 				return Error::kFunctionFailed;
 			}
+
+			m_pos = 0;
 		}
 
 		// Move forward by reading dummy data
-		Array<char, 128> buff;
-		while(offset != 0)
+		Array<char, 4_KB> buff;
+		while(m_pos != newPos)
 		{
-			PtrSize toRead = min<PtrSize>(offset, sizeof(buff));
+			const PtrSize toRead = min<PtrSize>(newPos - m_pos, sizeof(buff));
 			ANKI_CHECK(read(&buff[0], toRead));
-			offset -= toRead;
 		}
 
 		return Error::kNone;
@@ -222,8 +466,25 @@ public:
 		ANKI_ASSERT(m_size > 0);
 		return m_size;
 	}
+
+private:
+	ZipArchiveHandlePool* m_pool = nullptr;
+	ZipArchiveHandle* m_handle = nullptr;
+	PtrSize m_size = 0;
+	PtrSize m_pos = 0;
+	PtrSize m_dataOffset = 0; ///< Where the data of a stored file start in the archive.
+	Bool m_stored = false;
+	Bool m_currentFileOpen = false;
 };
 
+ResourceFilesystem::DataPath::~DataPath()
+{
+	if(m_archiveHandles)
+	{
+		m_archiveHandles->release();
+	}
+}
+
 ResourceFilesystem::~ResourceFilesystem()
 {
 }
@@ -258,6 +519,7 @@ Error ResourceFilesystem::addNewPath(CString filepath_, const ResourceStringList
 
 	U32 fileCount = 0; // Count files manually because it's slower to get that number from the list
 	ResourceStringList filenameList;
+	ResourceDynamicArray<FileInfo> archiveFileInfos; // The rest of the info of the files inside an archive
 	constexpr CString archiveExtension(".ankizip");
 	constexpr CString allowedExtensions[] = {".ankiprog", ".ankiprogbin", ".ankitex", ".ankimtl", ".ankimesh", ".ankiskel", ".ankianim", ".ankiscene",
 											 ".ankipart", ".png",         ".jpg",     ".jpeg",    ".tga",      ".lua",      ".ttf"};
@@ -343,12 +605,28 @@ Error ResourceFilesystem::addNewPath(CString filepath_, const ResourceStringList
 			{
 				filenameList.pushBack(filename.getBegin());
 				++fileCount;
+
+				// Remember where the file is in the central directory so opening it later won't need to search
+				unz64_file_pos pos;
+				if(unzGetFilePos64(zfile, &pos) != UNZ_OK)
+				{
+					unzClose(zfile);
+					ANKI_RESOURCE_LOGE("unzGetFilePos64() failed");
+					return Error::kFileAccess;
+				}
+
+				FileInfo& fileInfo = *archiveFileInfos.emplaceBack();
+				fileInfo.m_archivePosInCentralDir = pos.pos_in_zip_directory;
+				fileInfo.m_archiveFileIndex = pos.num_of_file;
+				fileInfo.m_archiveUncompressedSize = info.uncompressed_size;
+				fileInfo.m_archiveStored = info.compression_method == 0;
 			}
 		} while(unzGoToNextFile(zfile) == UNZ_OK);
 
 		unzClose(zfile);
 
 		path.m_isArchive = true;
+		path.m_archiveHandles = newInstance<ZipArchiveHandlePool>(ResourceMemoryPool::getSingleton(), filepath);
 	}
 #if ANKI_OS_ANDROID
 	else if(filepath == ".apk assets")
@@ -402,12 +680,18 @@ Error ResourceFilesystem::addNewPath(CString filepath_, const ResourceStringList
 		U32 count = 0;
 		for(const ResourceString& str : filenameList)
 		{
+			if(path.m_isArchive)
+			{
+				path.m_files[count] = archiveFileInfos[count];
+			}
+
 			path.m_files[count].m_filename = str;
 			path.m_files[count].m_filenameHash = str.computeHash();
 			++count;
 		}
 
 		m_dataPaths.emplaceFront(std::move(path));
+		addFrontDataPathToIndex();
 
 		ANKI_RESOURCE_LOGI("Added new data path \"%s\" that contains %u files", &filepath[0], fileCount);
 	}
@@ -442,68 +726,97 @@ Error ResourceFilesystem::openFile(ResourceFilename filename, ResourceFilePtr& f
 	return err;
 }
 
+void ResourceFilesystem::addFrontDataPathToIndex()
+{
+	ANKI_TRACE_FUNCTION();
+
+	// The front data path has the highest priority so its files override the rest
+	const DataPath& path = m_dataPaths.getFront();
+	for(const FileInfo& file : path.m_files)
+	{
+		FileLocation location;
+		location.m_dataPath = &path;
+		location.m_file = &file;
+
+		auto it = m_fileIndex.find(file.m_filenameHash);
+		if(it != m_fileIndex.getEnd())
+		{
+			ANKI_ASSERT(it->m_file->m_filename == file.m_filename && "Hash collision");
+			*it = location;
+		}
+		else
+		{
+			m_fileIndex.emplace(file.m_filenameHash, location);
+		}
+	}
+
+	m_sortedFiles.resize(0);
+	for(const FileLocation& location : m_fileIndex)
+	{
+		m_sortedFiles.emplaceBack(location.m_file);
+	}
+
+	std::sort(m_sortedFiles.getBegin(), m_sortedFiles.getEnd(), [](const FileInfo* a, const FileInfo* b) {
+		return strcmp(a->m_filename.cstr(), b->m_filename.cstr()) < 0;
+	});
+}
+
 Error ResourceFilesystem::openFileInternal(const ResourceFilename& filename, ResourceFile*& rfile) const
 {
 	ANKI_RESOURCE_LOGV("Opening resource file: %s", filename.cstr());
 	rfile = nullptr;
 
-	const U64 filenameHash = filename.computeHash();
-
-	// Search for the fname in reverse order
-	for(const DataPath& p : m_dataPaths)
+	auto it = m_fileIndex.find(filename.computeHash());
+	if(it != m_fileIndex.getEnd())
 	{
-		for(const FileInfo& fsfile : p.m_files)
-		{
-			if(filenameHash != fsfile.m_filenameHash)
-			{
-				continue;
-			}
+		const DataPath& p = *it->m_dataPath;
+		const FileInfo& fsfile = *it->m_file;
+		ANKI_ASSERT(fsfile.m_filename == filename);
 
-			[[maybe_unused]] CString pfname = fsfile.m_filename;
-			ANKI_ASSERT(pfname == filename);
+		if(p.m_isArchive)
+		{
+			ZipResourceFile* file = newInstance<ZipResourceFile>(ResourceMemoryPool::getSingleton());
+			rfile = file;
 
-			// Found
-			if(p.m_isArchive)
+			ANKI_CHECK(file->open(*p.m_archiveHandles, fsfile));
+		}
+		else
+		{
+			ResourceString newFname;
+			if(!p.m_isSpecial)
 			{
-				ZipResourceFile* file = newInstance<ZipResourceFile>(ResourceMemoryPool::getSingleton());
-				rfile = file;
-
-				ANKI_CHECK(file->open(p.m_path.toCString(), filename));
+				newFname.sprintf("%s/%s", p.m_path.cstr(), filename.cstr());
 			}
 			else
 			{
-				ResourceString newFname;
-				if(!p.m_isSpecial)
-				{
-					newFname.sprintf("%s/%s", p.m_path.cstr(), filename.cstr());
-				}
-				else
-				{
-					newFname = filename;
-				}
-
-				CResourceFile* file = newInstance<CResourceFile>(ResourceMemoryPool::getSingleton());
-				rfile = file;
+				newFname = filename;
+			}
 
-				FileOpenFlag openFlags = FileOpenFlag::kRead;
-				if(p.m_isSpecial)
+			// Try to map the file first. Empty files can't be mapped so fallback to regular reads
+			if(!p.m_isSpecial && g_cvarRsrcMemoryMapFiles)
+			{
+				MemoryMappedFile mapped;
+				if(mapped.open(newFname) == Error::kNone && mapped.isOpen())
 				{
-					openFlags |= FileOpenFlag::kSpecial;
+					MappedResourceFile* file = newInstance<MappedResourceFile>(ResourceMemoryPool::getSingleton());
+					file->m_file = std::move(mapped);
+					rfile = file;
+					return Error::kNone;
 				}
+			}
 
-				ANKI_CHECK(file->m_file.open(newFname, openFlags));
+			CResourceFile* file = newInstance<CResourceFile>(ResourceMemoryPool::getSingleton());
+			rfile = file;
 
-#if 0
-				printf("Opening asset %s, update time %llu\n", newFname.cstr(), fsfile.m_fileUpdateTime);
-#endif
+			FileOpenFlag openFlags = FileOpenFlag::kRead;
+			if(p.m_isSpecial)
+			{
+				openFlags |= FileOpenFlag::kSpecial;
 			}
-		}
 
-		if(rfile)
-		{
-			break;
+			ANKI_CHECK(file->m_file.open(newFname, openFlags));
 		}
-	} // end for all paths
+	}
 
 #if !ANKI_OS_ANDROID
 
@@ -533,29 +846,41 @@ ResourceString ResourceFilesystem::getFileFullPath(ResourceFilename filename) co
 	ResourceString out;
 	const U64 filenameHash = filename.computeHash();
 	Bool found = false;
-	for(const DataPath& p : m_dataPaths)
+
+	// Fast path, the file with the highest priority is a filesystem file
+	auto it = m_fileIndex.find(filenameHash);
+	if(it != m_fileIndex.getEnd() && !it->m_dataPath->m_isArchive && !it->m_dataPath->m_isSpecial)
+	{
+		out.sprintf("%s/%s", it->m_dataPath->m_path.cstr(), it->m_file->m_filename.cstr());
+		found = true;
+	}
+
+	// Slow path, the file with the highest priority is in an archive. Search the filesystem files of lower priority data paths
+	if(!found && it != m_fileIndex.getEnd())
 	{
-		for(const FileInfo& fsfile : p.m_files)
+		for(const DataPath& p : m_dataPaths)
 		{
-			if(filenameHash != fsfile.m_filenameHash)
+			if(p.m_isArchive || p.m_isSpecial)
 			{
 				continue;
 			}
 
-			ANKI_ASSERT(fsfile.m_filename == filename);
+			for(const FileInfo& fsfile : p.m_files)
+			{
+				if(filenameHash == fsfile.m_filenameHash)
+				{
+					ANKI_ASSERT(fsfile.m_filename == filename);
+					out.sprintf("%s/%s", p.m_path.cstr(), fsfile.m_filename.cstr());
+					found = true;
+					break;
+				}
+			}
 
-			if(!p.m_isArchive && !p.m_isSpecial)
+			if(found)
 			{
-				out.sprintf("%s/%s", p.m_path.cstr(), fsfile.m_filename.cstr());
-				found = true;
 				break;
 			}
 		}
-
-		if(found)
-		{
-			break;
-		}
 	}
 
 #if ANKI_WITH_EDITOR
@@ -587,6 +912,8 @@ U64 ResourceFilesystem::getFileUpdateTime(ResourceFilename filename) const
 Error ResourceFilesystem::refreshAll()
 {
 	m_dataPaths.destroy();
+	m_fileIndex.destroy();
+	m_sortedFiles.destroy();
 
 	ResourceStringList paths;
 	paths.splitString(g_cvarRsrcDataPaths, ':');
@@ -10,14 +10,19 @@
 #include <AnKi/Util/StringList.h>
 #include <AnKi/Util/File.h>
 #include <AnKi/Util/Ptr.h>
+#include <AnKi/Util/HashMap.h>
 #include <AnKi/Util/CVarSet.h>
 
 namespace anki {
 
+// Forward
+class ZipArchiveHandlePool;
+
 ANKI_CVAR(StringCVar, Rsrc, DataPaths, ".",
 		  "The engine loads assets only in from these paths. Separate them with : (it's smart enough to identify drive letters in Windows). After a "
 		  "path you can add an optional | and what follows it is a number of words to include or exclude paths. eg. "
 		  "my_path|include_this,include_that,!exclude_this")
+ANKI_CVAR(BoolCVar, Rsrc, MemoryMapFiles, true, "Memory map the files that are not part of archives instead of reading them with syscalls")
 
 // Resource filesystem file. An interface that abstracts the resource file.
 class ResourceFile
@@ -53,6 +58,18 @@ public:
 	// Get the size of the file.
 	virtual PtrSize getSize() const = 0;
 
+	// Memory mapped files can return a pointer to the next bytes of the file instead of copying them with read(). It moves the position indicator
+	// forward like read() does. The memory is valid for as long as the file is alive. Returns nullptr if the file is not memory mapped.
+	virtual const U8* readMapped([[maybe_unused]] PtrSize size)
+	{
+		return nullptr;
+	}
+
+	// Bring the contents of a memory mapped file to memory so that later reads don't block on page faults. Does nothing for other files.
+	virtual void prefetch()
+	{
+	}
+
 	void retain() const
 	{
 		m_refcount.fetchAdd(1);
@@ -128,6 +145,35 @@ public:
 		return cont;
 	}
 
+	// Iterate the filenames that start with a prefix. Every filename is visited once even if it's present in many data paths. It doesn't
+	// traverse all the files.
+	template<typename TFunc>
+	FunctorContinue iterateAllFilenames(CString prefix, TFunc func) const
+	{
+		const PtrSize prefixLength = prefix.getLength();
+		auto it = std::lower_bound(m_sortedFiles.getBegin(), m_sortedFiles.getEnd(), prefix, [](const FileInfo* file, CString prefix) {
+			return strcmp(file->m_filename.cstr(), prefix.cstr()) < 0;
+		});
+
+		FunctorContinue cont = FunctorContinue::kContinue;
+		for(; it != m_sortedFiles.getEnd(); ++it)
+		{
+			const FileInfo& file = **it;
+			if(strncmp(file.m_filename.cstr(), prefix.cstr(), prefixLength) != 0)
+			{
+				break;
+			}
+
+			cont = func(file.m_filename.toCString());
+			if(cont == FunctorContinue::kStop)
+			{
+				break;
+			}
+		}
+
+		return cont;
+	}
+
 	// Iterate paths in the DataPaths CVar
 	template<typename TFunc>
 	FunctorContinue iterateAllDataPaths(TFunc func) const
@@ -186,6 +232,12 @@ private:
 	public:
 		ResourceString m_filename;
 		U64 m_filenameHash = 0;
+
+		// The location of the file in the archive's central directory. Only for archives
+		U64 m_archivePosInCentralDir = 0;
+		U64 m_archiveFileIndex = 0;
+		U64 m_archiveUncompressedSize = 0;
+		Bool m_archiveStored = false; // The file is not compressed
 	};
 
 	class DataPath
@@ -193,6 +245,7 @@ private:
 	public:
 		ResourceDynamicArray<FileInfo> m_files; // Files inside the directory.
 		ResourceString m_path; // A directory or an archive.
+		ZipArchiveHandlePool* m_archiveHandles = nullptr; // Opened archive handles that are shared between the files of this path
 		Bool m_isArchive = false;
 		Bool m_isSpecial = false;
 
@@ -205,24 +258,50 @@ private:
 			*this = std::move(b);
 		}
 
+		~DataPath();
+
 		DataPath& operator=(const DataPath&) = delete; // Non-copyable
 
 		DataPath& operator=(DataPath&& b)
 		{
 			m_files = std::move(b.m_files);
 			m_path = std::move(b.m_path);
+			std::swap(m_archiveHandles, b.m_archiveHandles);
 			m_isArchive = b.m_isArchive;
 			m_isSpecial = b.m_isSpecial;
 			return *this;
 		}
 	};
 
+	class FileLocation
+	{
+	public:
+		const DataPath* m_dataPath = nullptr;
+		const FileInfo* m_file = nullptr;
+	};
+
+	// The keys are already hashes
+	class FilenameHashHasher
+	{
+	public:
+		U64 operator()(U64 filenameHash) const
+		{
+			return filenameHash;
+		}
+	};
+
 	ResourceList<DataPath> m_dataPaths;
 
+	ResourceHashMap<U64, FileLocation, FilenameHashHasher> m_fileIndex; // Filename hash to the file in the data path with the highest priority
+	ResourceDynamicArray<const FileInfo*> m_sortedFiles; // The files of m_fileIndex sorted by filename. For the prefix queries
+
 	// Add a filesystem path or an archive. The path is read-only.
 	Error addNewPath(CString path, const ResourceStringList& includeStrings, const ResourceStringList& excludedStrings);
 
 	Error openFileInternal(const ResourceFilename& filename, ResourceFile*& rfile) const;
+
+	// Add the files of the data path with the highest priority (the front) to the index
+	void addFrontDataPathToIndex();
 };
 
 } // end namespace anki
@@ -10,6 +10,9 @@
 #include <AnKi/Resource/AccelerationStructureScratchAllocator.h>
 #include <AnKi/Util/Logger.h>
 #include <AnKi/Util/CVarSet.h>
+#include <AnKi/Util/HighRezTimer.h>
+#include <AnKi/Util/Tracer.h>
+#include <AnKi/Core/StatsSet.h>
 
 #include <AnKi/Resource/MaterialResource.h>
 #include <AnKi/Resource/MeshResource.h>
@@ -18,6 +21,7 @@
 #include <AnKi/Resource/DummyResource.h>
 #include <AnKi/Resource/ParticleEmitterResource2.h>
 #include <AnKi/Resource/ImageResource.h>
+#include <AnKi/Resource/TextureStreamer.h>
 #include <AnKi/Resource/GenericResource.h>
 #include <AnKi/Resource/ImageAtlasResource.h>
 #include <AnKi/Resource/ShaderProgramResource.h>
@@ -25,6 +29,42 @@
 
 namespace anki {
 
+template<typename T>
+static StatCounter& getLoadWaitTimeStatCounter();
+
+#define ANKI_INSTANTIATE_RESOURCE(className) \
+	ANKI_SVAR(className##LoadWaitTime, StatCategory::kTime, #className " load wait", StatFlag::kMilisecond | StatFlag::kZeroEveryFrame) \
+	template<> \
+	StatCounter& getLoadWaitTimeStatCounter<className>() \
+	{ \
+		return g_svar##className##LoadWaitTime; \
+	}
+#include <AnKi/Resource/Resources.def.h>
+
+template<typename T>
+static StatCounter& getCpuMemoryStatCounter();
+template<typename T>
+static StatCounter& getGpuMemoryStatCounter();
+
+#define ANKI_INSTANTIATE_RESOURCE(className) \
+	ANKI_SVAR(className##CpuMemory, StatCategory::kCpuMem, #className, StatFlag::kBytes) \
+	ANKI_SVAR(className##GpuMemory, StatCategory::kGpuMem, #className, StatFlag::kBytes) \
+	template<> \
+	StatCounter& getCpuMemoryStatCounter<className>() \
+	{ \
+		return g_svar##className##CpuMemory; \
+	} \
+	template<> \
+	StatCounter& getGpuMemoryStatCounter<className>() \
+	{ \
+		return g_svar##className##GpuMemory; \
+	}
+#include <AnKi/Resource/Resources.def.h>
+
+ANKI_SVAR(UnreferencedResources, StatCategory::kMisc, "Unreferenced rsrcs", StatFlag::kNone)
+ANKI_SVAR(RevivedResources, StatCategory::kMisc, "Revived rsrcs", StatFlag::kZeroEveryFrame)
+ANKI_SVAR(EvictedResources, StatCategory::kMisc, "Evicted rsrcs", StatFlag::kZeroEveryFrame)
+
 ResourceManager::ResourceManager()
 {
 }
@@ -34,6 +74,11 @@ ResourceManager::~ResourceManager()
 	ANKI_RESOURCE_LOGI("Destroying resource manager");
 
 	AsyncLoader::freeSingleton();
+
+	// Some resources reference others so evicting them might put more in the LRU
+	evictUnreferencedResourcesInternal(true);
+	ANKI_ASSERT(m_lruHead == nullptr);
+
 	ShaderProgramResourceSystem::freeSingleton();
 	TransferGpuAllocator::freeSingleton();
 	ResourceFilesystem::freeSingleton();
@@ -44,6 +89,7 @@ ResourceManager::~ResourceManager()
 #include <AnKi/Resource/Resources.def.h>
 
 	AccelerationStructureScratchAllocator::freeSingleton();
+	TextureStreamer::freeSingleton();
 
 	ResourceMemoryPool::freeSingleton();
 }
@@ -63,6 +109,8 @@ Error ResourceManager::init(AllocAlignedCallback allocCallback, void* allocCallb
 	TransferGpuAllocator::allocateSingleton();
 	ANKI_CHECK(TransferGpuAllocator::getSingleton().init(g_cvarRsrcTransferScratchMemorySize));
 
+	TextureStreamer::allocateSingleton();
+
 	// Init the programs
 	ShaderProgramResourceSystem::allocateSingleton();
 	ANKI_CHECK(ShaderProgramResourceSystem::getSingleton().init());
@@ -116,58 +164,115 @@ Error ResourceManager::loadResource(CString filename, ResourcePtr<T>& out, Bool
 
 	ANKI_ASSERT(entry);
 
-	// Try to load the resource
+	// Find out if the resource needs to be loaded. If another thread is loading it wait for it
 	Error err = Error::kNone;
 	T* rsrc = nullptr;
 	{
 		LockGuard lock(entry->m_mtx);
 
-		if(entry->m_resources.getSize() == 0
-#if ANKI_WITH_EDITOR
-		   || entry->m_resources.getBack()->isObsolete()
-#endif
-		)
+		if(entry->m_loading)
 		{
-			// Resource hasn't been loaded or it needs update, load it
-
-			rsrc = newInstance<T>(ResourceMemoryPool::getSingleton(), filename, m_uuid.fetchAdd(1));
-
-			// Increment the refcount in that case where async jobs increment it and decrement it in the scope of a load()
-			rsrc->retain();
+			ANKI_TRACE_SCOPED_EVENT(RsrcLoadWait);
+			const Second startTime = HighRezTimer::getCurrentTime();
 
-			err = rsrc->load(filename, async);
+			while(entry->m_loading)
+			{
+				entry->m_loadDoneCond.wait(entry->m_mtx);
+			}
 
-			// Decrement because of the increment happened a few lines above
-			rsrc->release();
+			getLoadWaitTimeStatCounter<T>().increment((HighRezTimer::getCurrentTime() - startTime) * 1000.0);
 
-			if(err)
+			if(entry->m_lastLoadError)
 			{
-				ANKI_RESOURCE_LOGE("Failed to load resource: %s", filename.cstr());
-				deleteInstance(ResourceMemoryPool::getSingleton(), rsrc);
-				rsrc = nullptr;
+				// Don't try again, the load we waited for failed
+				return entry->m_lastLoadError;
 			}
-			else
-			{
-				entry->m_resources.emplaceBack(rsrc);
+		}
 
+		if(entry->m_resources.getSize() == 0
 #if ANKI_WITH_EDITOR
-				if(m_trackFileUpdateTimes)
-				{
-					entry->m_fileUpdateTime = ResourceFilesystem::getSingleton().getFileUpdateTime(filename);
-				}
+		   || entry->m_resources.getBack()->isObsolete()
 #endif
-			}
+		)
+		{
+			// Resource hasn't been loaded or it needs update, this thread will load it
+			entry->m_loading = true;
 		}
 		else
 		{
 			rsrc = entry->m_resources.getBack();
+
+			if(rsrc->getRefcount() == 0)
+			{
+				// Nobody references it, it might be in the LRU
+				LockGuard lruLock(m_lruMtx);
+				if(rsrc->m_inLru)
+				{
+					lruRemove(*rsrc);
+					g_svarRevivedResources.increment(1);
+				}
+			}
+
+			out.reset(rsrc);
+			return Error::kNone;
 		}
+	}
+
+	// Load it without holding the lock
+	rsrc = newInstance<T>(ResourceMemoryPool::getSingleton(), filename, m_uuid.fetchAdd(1));
+	rsrc->m_evictCallback = evictResource<T>;
+
+	// Increment the refcount in that case where async jobs increment it and decrement it in the scope of a load()
+	rsrc->retain();
+
+	err = rsrc->load(filename, async);
+
+	if(err)
+	{
+		// Decrement because of the increment happened a few lines above
+		rsrc->release();
+
+		ANKI_RESOURCE_LOGE("Failed to load resource: %s", filename.cstr());
+		deleteInstance(ResourceMemoryPool::getSingleton(), rsrc);
+		rsrc = nullptr;
+	}
+
+	{
+		LockGuard lock(entry->m_mtx);
 
 		if(!err)
 		{
-			ANKI_ASSERT(rsrc);
+			entry->m_resources.emplaceBack(rsrc);
+
+			m_cpuMemoryUsage.fetchAdd(rsrc->getCpuMemoryUsage());
+			m_gpuMemoryUsage.fetchAdd(rsrc->getGpuMemoryUsage());
+			getCpuMemoryStatCounter<T>().increment(rsrc->getCpuMemoryUsage());
+			getGpuMemoryStatCounter<T>().increment(rsrc->getGpuMemoryUsage());
+
+#if ANKI_WITH_EDITOR
+			if(m_trackFileUpdateTimes)
+			{
+				entry->m_fileUpdateTime = ResourceFilesystem::getSingleton().getFileUpdateTime(filename);
+			}
+#endif
+
 			out.reset(rsrc);
+
+			// Decrement because of the increment happened before the load. Do it after the reset so the async jobs of the load can't drop the
+			// refcount to zero
+			rsrc->release();
 		}
+
+		entry->m_lastLoadError = err;
+		entry->m_loading = false;
+	}
+
+	entry->m_loadDoneCond.notifyAll();
+
+	if(!err)
+	{
+		// The new resource might have exceeded the budget
+		evictUnreferencedResourcesInternal(false);
 	}
 
 	return err;
@@ -177,7 +282,6 @@ template<typename T>
 void ResourceManager::freeResource(T* ptr)
 {
 	ANKI_ASSERT(ptr);
-	ANKI_ASSERT(ptr->m_refcount.load() == 0);
 
 	TypeData<T>& type = static_cast<TypeData<T>&>(m_allTypes);
 
@@ -192,24 +296,252 @@ void ResourceManager::freeResource(T* ptr)
 	{
 		LockGuard lock(entry->m_mtx);
 
+		if(ptr->getRefcount() > 0)
+		{
+			// Someone loaded it again in the meantime
+			return;
+		}
+
+		const Bool newestVersion = entry->m_resources.getBack() == ptr
+#if ANKI_WITH_EDITOR
+								   && !ptr->isObsolete()
+#endif
+			;
+
+		if(newestVersion && g_cvarRsrcCpuMemoryBudget > 0 && g_cvarRsrcGpuMemoryBudget > 0)
+		{
+			// Keep it around in case someone asks for it again. If it's being evicted the evicting thread decides
+			LockGuard lruLock(m_lruMtx);
+			if(!ptr->m_inLru && !ptr->m_evicting)
+			{
+				lruPushBack(*ptr);
+			}
+			ptr = nullptr;
+		}
+		else
+		{
+			{
+				LockGuard lruLock(m_lruMtx);
+				if(ptr->m_evicting)
+				{
+					// The evicting thread will delete it
+					return;
+				}
+			}
+
+			auto it = entry->m_resources.getBegin();
+			for(; it != entry->m_resources.getEnd(); ++it)
+			{
+				if(*it == ptr)
+				{
+					break;
+				}
+			}
+			ANKI_ASSERT(it != entry->m_resources.getEnd());
+			entry->m_resources.erase(it);
+		}
+	}
+
+	if(ptr)
+	{
+		// Delete it outside the lock because it might free other resources
+		deleteResource(ptr);
+	}
+	else
+	{
+		evictUnreferencedResourcesInternal(false);
+	}
+}
+
+template<typename T>
+void ResourceManager::updateMemoryUsage(T& rsrc, PtrSize size, Bool gpu)
+{
+	TypeData<T>& type = static_cast<TypeData<T>&>(m_allTypes);
+
+	typename TypeData<T>::Entry* entry = nullptr;
+	{
+		RLockGuard lock(type.m_mtx);
+		auto it = type.m_map.find(rsrc.m_fname);
+		ANKI_ASSERT(it != type.m_map.getEnd());
+		entry = &type.m_entries[*it];
+	}
+
+	LockGuard lock(entry->m_mtx);
+
+	Bool accounted = false;
+	for(T* r : entry->m_resources)
+	{
+		if(r == &rsrc)
+		{
+			accounted = true;
+			break;
+		}
+	}
+
+	Atomic<PtrSize>& totalUsage = (gpu) ? m_gpuMemoryUsage : m_cpuMemoryUsage;
+	PtrSize& rsrcUsage = (gpu) ? rsrc.m_gpuMemoryUsage : rsrc.m_cpuMemoryUsage;
+
+	if(accounted)
+	{
+		StatCounter& statCounter = (gpu) ? getGpuMemoryStatCounter<T>() : getCpuMemoryStatCounter<T>();
+
+		totalUsage.fetchSub(rsrcUsage);
+		totalUsage.fetchAdd(size);
+		statCounter.decrement(rsrcUsage);
+		statCounter.increment(size);
+		rsrcUsage = size;
+	}
+	else if(rsrc.getRefcount() > 0)
+	{
+		// Still in loadResource(). It will account for it
+		rsrcUsage = size;
+	}
+	else
+	{
+		// On its way to deleteResource(). It will subtract what was accounted for
+	}
+}
+
+template<typename T>
+void ResourceManager::deleteResource(T* rsrc)
+{
+	ANKI_ASSERT(rsrc->getRefcount() == 0 && !rsrc->m_inLru);
+
+	m_cpuMemoryUsage.fetchSub(rsrc->getCpuMemoryUsage());
+	m_gpuMemoryUsage.fetchSub(rsrc->getGpuMemoryUsage());
+	getCpuMemoryStatCounter<T>().decrement(rsrc->getCpuMemoryUsage());
+	getGpuMemoryStatCounter<T>().decrement(rsrc->getGpuMemoryUsage());
+
+	deleteInstance(ResourceMemoryPool::getSingleton(), rsrc);
+}
+
+template<typename T>
+void ResourceManager::evictResource(ResourceObject& rsrc_)
+{
+	ResourceManager& self = ResourceManager::getSingleton();
+	T* rsrc = static_cast<T*>(&rsrc_);
+	TypeData<T>& type = static_cast<TypeData<T>&>(self.m_allTypes);
+
+	typename TypeData<T>::Entry* entry = nullptr;
+	{
+		RLockGuard lock(type.m_mtx);
+		auto it = type.m_map.find(rsrc->m_fname);
+		ANKI_ASSERT(it != type.m_map.getEnd());
+		entry = &type.m_entries[*it];
+	}
+
+	{
+		LockGuard lock(entry->m_mtx);
+
+		// Nobody else can put it back in the LRU or delete it while it's marked as evicting
+		{
+			LockGuard lruLock(self.m_lruMtx);
+			ANKI_ASSERT(rsrc->m_evicting && !rsrc->m_inLru);
+			rsrc->m_evicting = false;
+		}
+
+		if(rsrc->getRefcount() > 0)
+		{
+			// Revived before the lock was taken. The freeResource() that will follow will put it back in the LRU
+			return;
+		}
+
 		auto it = entry->m_resources.getBegin();
 		for(; it != entry->m_resources.getEnd(); ++it)
 		{
-			if(*it == ptr)
+			if(*it == rsrc)
 			{
 				break;
 			}
 		}
 		ANKI_ASSERT(it != entry->m_resources.getEnd());
-		deleteInstance(ResourceMemoryPool::getSingleton(), *it);
 		entry->m_resources.erase(it);
 	}
+
+	g_svarEvictedResources.increment(1);
+	self.deleteResource(rsrc);
+}
+
+void ResourceManager::evictUnreferencedResourcesInternal(Bool all)
+{
+	while(true)
+	{
+		if(!all && m_cpuMemoryUsage.load() <= g_cvarRsrcCpuMemoryBudget && m_gpuMemoryUsage.load() <= g_cvarRsrcGpuMemoryBudget)
+		{
+			break;
+		}
+
+		// Evict the oldest
+		ResourceObject* rsrc;
+		{
+			LockGuard lock(m_lruMtx);
+			rsrc = m_lruHead;
+			if(!rsrc)
+			{
+				break;
+			}
+
+			lruRemove(*rsrc);
+			rsrc->m_evicting = true; // This thread owns it now
+		}
+
+		rsrc->m_evictCallback(*rsrc);
+	}
+}
+
+void ResourceManager::lruPushBack(ResourceObject& rsrc)
+{
+	ANKI_ASSERT(!rsrc.m_inLru);
+	rsrc.m_inLru = true;
+	rsrc.m_lruPrev = m_lruTail;
+	rsrc.m_lruNext = nullptr;
+
+	if(m_lruTail)
+	{
+		m_lruTail->m_lruNext = &rsrc;
+	}
+	else
+	{
+		m_lruHead = &rsrc;
+	}
+	m_lruTail = &rsrc;
+
+	g_svarUnreferencedResources.increment(1);
+}
+
+void ResourceManager::lruRemove(ResourceObject& rsrc)
+{
+	ANKI_ASSERT(rsrc.m_inLru);
+	rsrc.m_inLru = false;
+
+	if(rsrc.m_lruPrev)
+	{
+		rsrc.m_lruPrev->m_lruNext = rsrc.m_lruNext;
+	}
+	else
+	{
+		m_lruHead = rsrc.m_lruNext;
+	}
+
+	if(rsrc.m_lruNext)
+	{
+		rsrc.m_lruNext->m_lruPrev = rsrc.m_lruPrev;
+	}
+	else
+	{
+		m_lruTail = rsrc.m_lruPrev;
+	}
+
+	rsrc.m_lruPrev = rsrc.m_lruNext = nullptr;
+
+	g_svarUnreferencedResources.decrement(1);
 }
 
 // Instansiate
 #define ANKI_INSTANTIATE_RESOURCE(className) \
 	template Error ResourceManager::loadResource<className>(CString filename, ResourcePtr<className> & out, Bool async); \
-	template void ResourceManager::freeResource<className>(className * ptr);
+	template void ResourceManager::freeResource<className>(className * ptr); \
+	template void ResourceManager::updateMemoryUsage<className>(className & rsrc, PtrSize size, Bool gpu);
 #include <AnKi/Resource/Resources.def.h>
 
 #if ANKI_WITH_EDITOR
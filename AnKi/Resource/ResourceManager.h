@@ -24,8 +24,13 @@ class ResourceManagerModel;
 class ShaderCompilerCache;
 class ShaderProgramResourceSystem;
 class AccelerationStructureScratchAllocator;
+class ResourceObject;
 
 ANKI_CVAR(NumericCVar<PtrSize>, Rsrc, TransferScratchMemorySize, 256_MB, 1_MB, 4_GB, "Memory that is used fot texture and buffer uploads")
+ANKI_CVAR(NumericCVar<PtrSize>, Rsrc, CpuMemoryBudget, 512_MB, 0, 64_GB,
+		  "The resources that are not referenced stay in memory until the CPU memory of all resources exceeds that. 0 to delete them immediately")
+ANKI_CVAR(NumericCVar<PtrSize>, Rsrc, GpuMemoryBudget, 2_GB, 0, 64_GB,
+		  "The resources that are not referenced stay in memory until the GPU memory of all resources exceeds that. 0 to delete them immediately")
 #if ANKI_WITH_EDITOR
 ANKI_CVAR(BoolCVar, Rsrc, TrackFileUpdates, false, "If true the resource manager is able to track file update times")
 #endif
@@ -54,12 +59,46 @@ public:
 	void refreshFileUpdateTimes();
 #endif
 
+	// Delete the resources that are not referenced by anyone. Thread-safe.
+	void evictUnreferencedResources()
+	{
+		evictUnreferencedResourcesInternal(true);
+	}
+
+	// The memory of all the resources, including the unreferenced ones that are kept around.
+	PtrSize getCpuMemoryUsage() const
+	{
+		return m_cpuMemoryUsage.load();
+	}
+
+	PtrSize getGpuMemoryUsage() const
+	{
+		return m_gpuMemoryUsage.load();
+	}
+
 	// Internals:
 
+	// It doesn't delete the resource immediately. It keeps it around in case someone asks for it again until the memory budget is exceeded.
 	// Note: Thread-safe against itself, loadResource() and refreshFileUpdateTimes()
 	template<typename T>
 	ANKI_INTERNAL void freeResource(T* ptr);
 
+	// Change the CPU memory of a resource after it's loaded. Used by resources that load some of their data on demand.
+	// Note: Thread-safe against itself, loadResource() and freeResource()
+	template<typename T>
+	ANKI_INTERNAL void updateCpuMemoryUsage(T& rsrc, PtrSize size)
+	{
+		updateMemoryUsage(rsrc, size, false);
+	}
+
+	// Change the GPU memory of a resource after it's loaded. Used by resources that replace their GPU objects over their lifetime.
+	// Note: Thread-safe against itself, loadResource() and freeResource()
+	template<typename T>
+	ANKI_INTERNAL void updateGpuMemoryUsage(T& rsrc, PtrSize size)
+	{
+		updateMemoryUsage(rsrc, size, true);
+	}
+
 private:
 	template<typename Type>
 	class TypeData
@@ -69,7 +108,10 @@ private:
 		{
 		public:
 			DynamicArray<Type*> m_resources; // Hosts multiple versions of a resource. The last element is the newest
-			SpinLock m_mtx;
+			Mutex m_mtx; // Not held while loading
+			ConditionVariable m_loadDoneCond; // Signaled when a load finishes
+			Error m_lastLoadError = Error::kNone;
+			Bool m_loading = false; // A thread is loading a new version. The rest wait for it instead of loading it again
 #if ANKI_WITH_EDITOR
 			U64 m_fileUpdateTime = 0;
 #endif
@@ -101,6 +143,14 @@ public \
 
 	Atomic<U32> m_uuid = {1};
 
+	Atomic<PtrSize> m_cpuMemoryUsage = {0};
+	Atomic<PtrSize> m_gpuMemoryUsage = {0};
+
+	// The LRU of the resources that are not referenced. The head is the oldest
+	Mutex m_lruMtx;
+	ResourceObject* m_lruHead = nullptr;
+	ResourceObject* m_lruTail = nullptr;
+
 #if ANKI_WITH_EDITOR
 	Bool m_trackFileUpdateTimes = false;
 #endif
@@ -113,6 +163,20 @@ public \
 	template<typename T>
 	void refreshFileUpdateTimesInternal();
 #endif
+
+	template<typename T>
+	void deleteResource(T* rsrc);
+
+	template<typename T>
+	static void evictResource(ResourceObject& rsrc);
+
+	template<typename T>
+	void updateMemoryUsage(T& rsrc, PtrSize size, Bool gpu);
+
+	void evictUnreferencedResourcesInternal(Bool all);
+
+	void lruPushBack(ResourceObject& rsrc);
+	void lruRemove(ResourceObject& rsrc);
 };
 
 } // end namespace anki
@@ -40,6 +40,21 @@ public:
 		return m_refcount.fetchSub(1);
 	}
 
+	// Retain only if someone else holds a reference. An unreferenced resource might be on its way to deletion so it can't be retained.
+	Bool tryRetain() const
+	{
+		I32 refcount = m_refcount.load();
+		while(refcount > 0)
+		{
+			if(m_refcount.compareExchange(refcount, refcount + 1))
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
 	CString getFilename() const
 	{
 		ANKI_ASSERT(!m_fname.isEmpty());
@@ -66,7 +81,30 @@ public:
 	}
 #endif
 
+	// The CPU memory the resource holds. It counts towards the memory budget of the ResourceManager.
+	PtrSize getCpuMemoryUsage() const
+	{
+		return m_cpuMemoryUsage;
+	}
+
+	// The GPU memory the resource holds. It counts towards the memory budget of the ResourceManager.
+	PtrSize getGpuMemoryUsage() const
+	{
+		return m_gpuMemoryUsage;
+	}
+
 protected:
+	// The loaders call these in load() to inform about the memory they hold.
+	void setCpuMemoryUsage(PtrSize size)
+	{
+		m_cpuMemoryUsage = size;
+	}
+
+	void setGpuMemoryUsage(PtrSize size)
+	{
+		m_gpuMemoryUsage = size;
+	}
+
 	Error openFile(const ResourceFilename& filename, ResourceFilePtr& file);
 
 	Error openFileReadAllText(const ResourceFilename& filename, ResourceString& file);
@@ -80,6 +118,16 @@ private:
 #endif
 	U32 m_uuid = 0;
 	ResourceString m_fname; // Unique resource name
+
+	PtrSize m_cpuMemoryUsage = 0;
+	PtrSize m_gpuMemoryUsage = 0;
+
+	// The LRU of the unreferenced resources that the ResourceManager keeps around
+	ResourceObject* m_lruPrev = nullptr;
+	ResourceObject* m_lruNext = nullptr;
+	void (*m_evictCallback)(ResourceObject& rsrc) = nullptr;
+	Bool m_inLru = false;
+	Bool m_evicting = false; // Popped from the LRU by a thread that will call m_evictCallback. Only that thread can delete it. Protected by m_lruMtx
 };
 
 } // end namespace anki
@@ -11,9 +11,16 @@
 #include <AnKi/Util/Filesystem.h>
 #include <AnKi/Util/Functions.h>
 #include <AnKi/Util/CVarSet.h>
+#include <AnKi/Util/Tracer.h>
+#include <AnKi/Core/Common.h>
+#include <AnKi/Core/StatsSet.h>
 
 namespace anki {
 
+ANKI_SVAR(ShaderVariantsPending, StatCategory::kMisc, "Shader variants in flight", StatFlag::kNone)
+ANKI_SVAR(ShaderVariantsCreatedAsync, StatCategory::kMisc, "Shader variants created async", StatFlag::kNone)
+ANKI_SVAR(ShaderVariantMaxPendingFrames, StatCategory::kMisc, "Max frames a variant was pending", StatFlag::kNone)
+
 ShaderProgramResourceVariant::ShaderProgramResourceVariant()
 {
 }
@@ -24,10 +31,22 @@ ShaderProgramResourceVariant::~ShaderProgramResourceVariant()
 
 ShaderProgramResource::~ShaderProgramResource()
 {
+	// The background jobs reference this
+	{
+		LockGuard lock(m_pendingVariantJobsMtx);
+		while(m_pendingVariantJobCount > 0)
+		{
+			m_pendingVariantJobsCvar.wait(m_pendingVariantJobsMtx);
+		}
+	}
+
 	for(auto it : m_variants)
 	{
-		ShaderProgramResourceVariant* variant = &(*it);
-		deleteInstance(ResourceMemoryPool::getSingleton(), variant);
+		ShaderProgramResourceVariant* variant = it;
+		if(variant)
+		{
+			deleteInstance(ResourceMemoryPool::getSingleton(), variant);
+		}
 	}
 
 	ResourceMemoryPool::getSingleton().free(m_binary);
@@ -39,14 +58,13 @@ Error ShaderProgramResource::load(const ResourceFilename& filename, [[maybe_unus
 	ResourceFilePtr file;
 	ANKI_CHECK(openFile(filename, file));
 	ANKI_CHECK(deserializeShaderBinaryFromAnyFile(*file, m_binary, ResourceMemoryPool::getSingleton()));
+	setCpuMemoryUsage(file->getSize()); // Roughly
 
 	return Error::kNone;
 }
 
-void ShaderProgramResource::getOrCreateVariant(const ShaderProgramResourceVariantInitInfo& info_, const ShaderProgramResourceVariant*& variant) const
+U64 ShaderProgramResource::fillDefaultsAndComputeHash(ShaderProgramResourceVariantInitInfo& info) const
 {
-	ShaderProgramResourceVariantInitInfo info = info_;
-
 	// Sanity checks
 	ANKI_ASSERT(info.m_setMutators.getSetBitCount() == m_binary->m_mutators.getSize());
 
@@ -94,6 +112,14 @@ void ShaderProgramResource::getOrCreateVariant(const ShaderProgramResourceVarian
 		hash = appendHash(info.m_mutation.getBegin(), m_binary->m_mutators.getSize() * sizeof(info.m_mutation[0]), hash);
 	}
 
+	return hash;
+}
+
+void ShaderProgramResource::getOrCreateVariant(const ShaderProgramResourceVariantInitInfo& info_, const ShaderProgramResourceVariant*& variant) const
+{
+	ShaderProgramResourceVariantInitInfo info = info_;
+	const U64 hash = fillDefaultsAndComputeHash(info);
+
 	// Check if the variant is in the cache
 	{
 		RLockGuard lock(m_mtx);
@@ -103,7 +129,7 @@ void ShaderProgramResource::getOrCreateVariant(const ShaderProgramResourceVarian
 		{
 			// Done
 			variant = *it;
-			if(!!(info.m_shaderTypes & ShaderTypeBit::kAllGraphics))
+			if(variant && !!(info.m_shaderTypes & ShaderTypeBit::kAllGraphics))
 			{
 				ANKI_ASSERT(variant->m_prog->getShaderTypes() == info.m_shaderTypes);
 			}
@@ -136,6 +162,116 @@ void ShaderProgramResource::getOrCreateVariant(const ShaderProgramResourceVarian
 	}
 }
 
+Bool ShaderProgramResource::tryGetOrCreateVariant(const ShaderProgramResourceVariantInitInfo& info_,
+												  const ShaderProgramResourceVariant*& variant) const
+{
+	ShaderProgramResourceVariantInitInfo info = info_;
+	const U64 hash = fillDefaultsAndComputeHash(info);
+	variant = nullptr;
+
+	// Check if the variant is in the cache
+	{
+		RLockGuard lock(m_mtx);
+
+		auto it = m_variants.find(hash);
+		if(it != m_variants.getEnd()) [[likely]]
+		{
+			variant = *it;
+			return true;
+		}
+
+		if(m_pendingVariants.find(hash) != m_pendingVariants.getEnd())
+		{
+			return false;
+		}
+	}
+
+	WLockGuard lock(m_mtx);
+
+	// Check again
+	auto it = m_variants.find(hash);
+	if(it != m_variants.getEnd())
+	{
+		variant = *it;
+		return true;
+	}
+
+	if(m_pendingVariants.find(hash) != m_pendingVariants.getEnd())
+	{
+		return false;
+	}
+
+	if(!CoreBackgroundThreadJobManager::isAllocated())
+	{
+		// No threads to do the work, create it now
+		ShaderProgramResourceVariant* v = createNewVariant(info);
+		if(v)
+		{
+			m_variants.emplace(hash, v);
+		}
+		variant = v;
+		return true;
+	}
+
+	m_pendingVariants.emplace(hash, GlobalFrameIndex::getSingleton().m_value);
+	{
+		LockGuard lock(m_pendingVariantJobsMtx);
+		++m_pendingVariantJobCount;
+	}
+	g_svarShaderVariantsPending.increment(1);
+
+	info.m_ptr.reset(nullptr); // Don't hold a reference to this, the destructor waits for the job
+	CoreBackgroundThreadJobManager::getSingleton().dispatchTask([this, info, hash]([[maybe_unused]] U32 tid) {
+		ANKI_TRACE_SCOPED_EVENT(RsrcShaderVariantAsync);
+
+		ShaderProgramResourceVariant* v = createNewVariant(info);
+
+		{
+			WLockGuard lock(m_mtx);
+
+			auto it = m_pendingVariants.find(hash);
+			ANKI_ASSERT(it != m_pendingVariants.getEnd());
+			const Timestamp requestFrame = *it;
+			m_pendingVariants.erase(it);
+
+			const U32 pendingFrameCount = U32(GlobalFrameIndex::getSingleton().m_value - requestFrame);
+			g_svarShaderVariantMaxPendingFrames.max(pendingFrameCount);
+
+			if(m_variants.find(hash) != m_variants.getEnd())
+			{
+				// Someone called getOrCreateVariant() in the meantime and created it
+				if(v)
+				{
+					deleteInstance(ResourceMemoryPool::getSingleton(), v);
+				}
+			}
+			else
+			{
+				if(v)
+				{
+					v->m_pendingFrameCount = pendingFrameCount;
+				}
+
+				// Store skipped mutations as well so they are not created again
+				m_variants.emplace(hash, v);
+			}
+		}
+
+		g_svarShaderVariantsPending.decrement(1);
+		g_svarShaderVariantsCreatedAsync.increment(1);
+
+		// Notify while holding the lock because the destructor might be waiting and it will delete the cvar as soon as it can
+		LockGuard lock(m_pendingVariantJobsMtx);
+		--m_pendingVariantJobCount;
+		if(m_pendingVariantJobCount == 0)
+		{
+			m_pendingVariantJobsCvar.notifyAll();
+		}
+	});
+
+	return false;
+}
+
 U32 ShaderProgramResource::findTechnique(CString name) const
 {
 	U32 techniqueIdx = kMaxU32;
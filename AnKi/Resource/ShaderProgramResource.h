@@ -50,10 +50,17 @@ public:
 		return m_shaderGroupHandlesBuff;
 	}
 
+	// How many frames the variant took to be created in the background. It's zero if it was created synchronously.
+	U32 getPendingFrameCount() const
+	{
+		return m_pendingFrameCount;
+	}
+
 private:
 	ShaderProgramPtr m_prog;
 	U32 m_shaderGroupHandleIndex = kMaxU32; // Cache the index of the handle here.
 	BufferView m_shaderGroupHandlesBuff;
+	U32 m_pendingFrameCount = 0;
 };
 
 class ShaderProgramResourceVariantInitInfo
@@ -140,14 +147,26 @@ public:
 	// It's thread-safe.
 	void getOrCreateVariant(const ShaderProgramResourceVariantInitInfo& info, const ShaderProgramResourceVariant*& variant) const;
 
+	// Non-blocking version of getOrCreateVariant(). If the variant doesn't exist it starts creating it in the CoreBackgroundThreadJobManager (that
+	// the frame doesn't wait for) and returns false. When it's ready it returns true and the variant (which is nullptr if the mutation is skipped).
+	// It's thread-safe.
+	Bool tryGetOrCreateVariant(const ShaderProgramResourceVariantInitInfo& info, const ShaderProgramResourceVariant*& variant) const;
+
 private:
 	ShaderBinary* m_binary = nullptr;
 
 	mutable ResourceHashMap<U64, ShaderProgramResourceVariant*> m_variants;
+	mutable ResourceHashMap<U64, Timestamp> m_pendingVariants; // Variants created in the background and the frame they were requested.
 	mutable RWMutex m_mtx;
 
+	mutable U32 m_pendingVariantJobCount = 0;
+	mutable Mutex m_pendingVariantJobsMtx;
+	mutable ConditionVariable m_pendingVariantJobsCvar; // Signaled when m_pendingVariantJobCount reaches zero.
+
 	ShaderProgramResourceVariant* createNewVariant(const ShaderProgramResourceVariantInitInfo& info) const;
 
+	U64 fillDefaultsAndComputeHash(ShaderProgramResourceVariantInitInfo& info) const;
+
 	U32 findTechnique(CString name) const;
 };
 
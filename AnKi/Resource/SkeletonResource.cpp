@@ -111,6 +111,30 @@ Error SkeletonResource::load(const ResourceFilename& filename, [[maybe_unused]]
 		++it;
 	}
 
+	// Sort the bones so that the parents come before their children
+	if(m_rootBoneIdx == kMaxU32)
+	{
+		ANKI_RESOURCE_LOGE("Skeleton doesn't have a root bone");
+		return Error::kUserData;
+	}
+
+	m_boneEvaluationOrder.resize(m_bones.getSize());
+	U32 orderedCount = 0;
+	m_boneEvaluationOrder[orderedCount++] = m_rootBoneIdx;
+	for(U32 i = 0; i < orderedCount; ++i)
+	{
+		for(const Bone* child : m_bones[m_boneEvaluationOrder[i]].getChildren())
+		{
+			m_boneEvaluationOrder[orderedCount++] = child->m_idx;
+		}
+	}
+
+	if(orderedCount != m_bones.getSize())
+	{
+		ANKI_RESOURCE_LOGE("Some bones are not connected to the root bone");
+		return Error::kUserData;
+	}
+
 	return Error::kNone;
 }
 
@@ -123,8 +123,16 @@ public:
 		return m_bones[m_rootBoneIdx];
 	}
 
+	/// The indices of all the bones sorted so that the parents come before their children. Walking the hierarchy in this order needs no
+	/// recursion.
+	ConstWeakArray<U32> getBoneEvaluationOrder() const
+	{
+		return m_boneEvaluationOrder;
+	}
+
 private:
 	ResourceDynamicArray<Bone> m_bones;
+	ResourceDynamicArray<U32> m_boneEvaluationOrder;
 	U32 m_rootBoneIdx = kMaxU32;
 };
 /// @}
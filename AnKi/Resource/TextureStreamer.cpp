@@ -0,0 +1,278 @@
+// Copyright (C) 2009-present, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <AnKi/Resource/TextureStreamer.h>
+#include <AnKi/Resource/ImageResource.h>
+#include <AnKi/Resource/ResourceManager.h>
+#include <AnKi/Core/StatsSet.h>
+#include <AnKi/Util/Tracer.h>
+#include <algorithm>
+
+namespace anki {
+
+ANKI_SVAR(TextureStreamingMemory, StatCategory::kGpuMem, "Streamable textures", StatFlag::kBytes | StatFlag::kMainThreadUpdates)
+ANKI_SVAR(TextureStreamingInFlight, StatCategory::kMisc, "Textures streaming", StatFlag::kMainThreadUpdates)
+ANKI_SVAR(TextureStreamingReplaced, StatCategory::kMisc, "Textures replaced", StatFlag::kMainThreadUpdates | StatFlag::kZeroEveryFrame)
+
+TextureStreamer::~TextureStreamer()
+{
+	ANKI_ASSERT(m_images.getSize() == 0 && "Some images are still alive");
+	ANKI_ASSERT(m_inFlightCount == 0);
+}
+
+PtrSize TextureStreamer::computeReservedMemory(const ImageResource& image)
+{
+	const ImageResource::Streaming& s = image.m_streaming;
+	const U32 firstMip = (s.m_inFlight.isValid()) ? min(s.m_residentFirstMip, s.m_inFlightFirstMip) : s.m_residentFirstMip;
+	return image.computeStreamingMemory(firstMip);
+}
+
+void TextureStreamer::registerImage(ImageResource& image)
+{
+	ImageResource::Streaming& s = image.m_streaming;
+	ANKI_ASSERT(image.isStreamable());
+
+	LockGuard lock(m_mtx);
+
+	ANKI_ASSERT(s.m_streamerIndex == kMaxU32);
+	s.m_streamerIndex = m_images.getSize();
+	s.m_wantedFirstMip = s.m_tailFirstMip;
+	s.m_wantedFrame = GlobalFrameIndex::getSingleton().m_value;
+	m_images.emplaceBack(&image);
+
+	m_memoryUsage += computeReservedMemory(image);
+}
+
+void TextureStreamer::unregisterImage(ImageResource& image)
+{
+	ImageResource::Streaming& s = image.m_streaming;
+
+	LockGuard lock(m_mtx);
+
+	const U32 idx = s.m_streamerIndex;
+	ANKI_ASSERT(idx < m_images.getSize() && m_images[idx] == &image);
+
+	// The requests hold a reference to the image so if there is one it has finished
+	m_memoryUsage -= computeReservedMemory(image);
+	if(s.m_inFlight.isValid())
+	{
+		--m_inFlightCount;
+		s.m_inFlight = AsyncLoaderTaskHandle();
+	}
+
+	m_images[idx] = m_images.getBack();
+	m_images[idx]->m_streaming.m_streamerIndex = idx;
+	m_images.popBack();
+	s.m_streamerIndex = kMaxU32;
+}
+
+void TextureStreamer::update()
+{
+	ANKI_TRACE_SCOPED_EVENT(RsrcTextureStreaming);
+
+	const Timestamp frame = GlobalFrameIndex::getSingleton().m_value;
+
+	// Let go of the textures that were replaced a few frames ago. They are in the order they were retired
+	U32 expiredCount = 0;
+	while(expiredCount < m_retired.getSize() && frame - m_retired[expiredCount].m_frame >= kRetiredTextureFrameCount)
+	{
+		RetiredTexture& retired = m_retired[expiredCount++];
+		retired.m_tex.reset(nullptr);
+		TextureMemoryPool::getSingleton().deferredFree(retired.m_alloc);
+	}
+
+	if(expiredCount)
+	{
+		m_retired.erase(m_retired.getBegin(), m_retired.getBegin() + expiredCount);
+	}
+
+	{
+		LockGuard lock(m_mtx);
+		updateInternal(frame);
+	}
+
+	// Drop the references that were needed to kick the requests. Outside the lock because it might delete images
+	m_kickedImages.resize(0);
+
+	g_svarTextureStreamingMemory.set(m_memoryUsage);
+	g_svarTextureStreamingInFlight.set(m_inFlightCount);
+}
+
+void TextureStreamer::updateInternal(Timestamp frame)
+{
+	const PtrSize budget = g_cvarRsrcTextureStreamingBudget;
+
+	// Gather what every image wants and finish the requests that are done
+	const Bool overBudget = m_memoryUsage > budget;
+	Bool replacedTextures = false;
+	m_requests.resize(0);
+	for(ImageResource* image : m_images)
+	{
+		ImageResource::Streaming& s = image->m_streaming;
+
+		// Finer mips apply right away. Coarser only after a while so the mips don't come and go when the camera moves around
+		const U32 requestedMip = s.m_requestedFirstMip.exchange(kMaxU32);
+		const U32 mip = (s.m_demandDriven.load()) ? min<U32>(requestedMip, s.m_tailFirstMip) : 0;
+		if(mip <= s.m_wantedFirstMip || frame - s.m_wantedFrame > g_cvarRsrcTextureStreamingStreamOutDelay)
+		{
+			s.m_wantedFirstMip = U8(mip);
+			s.m_wantedFrame = frame;
+		}
+
+		U32 wantedMip = s.m_wantedFirstMip;
+		if(overBudget && s.m_demandDriven.load() && requestedMip == kMaxU32)
+		{
+			// No one asked for it this frame, make some room for the rest
+			wantedMip = min<U32>(s.m_residentFirstMip + 1, s.m_tailFirstMip);
+			s.m_wantedFirstMip = U8(max<U32>(wantedMip, s.m_wantedFirstMip));
+		}
+
+		if(s.m_inFlight.isValid())
+		{
+			if(!s.m_inFlight.isDone())
+			{
+				continue;
+			}
+
+			replacedTextures = finishRequest(*image, frame) || replacedTextures;
+		}
+
+		if(!s.m_failed && image->isLoaded() && wantedMip != s.m_residentFirstMip)
+		{
+			// The ones that free memory come first and then the ones that miss the most mips
+			const U32 priority = (wantedMip > s.m_residentFirstMip) ? kMaxU32 : s.m_residentFirstMip - wantedMip;
+			m_requests.emplaceBack(Request{image, wantedMip, priority});
+		}
+	}
+
+	std::sort(m_requests.getBegin(), m_requests.getEnd(), [](const Request& a, const Request& b) {
+		return a.m_priority > b.m_priority;
+	});
+
+	// Kick as many requests as the budget allows
+	for(const Request& req : m_requests)
+	{
+		ImageResource& image = *req.m_image;
+		const U32 residentMip = image.m_streaming.m_residentFirstMip;
+		U32 firstMip = req.m_firstMip;
+
+		if(firstMip > residentMip)
+		{
+			// The mips are already on the GPU so it doesn't count as in flight
+			streamOut(image, firstMip, frame);
+			replacedTextures = true;
+			continue;
+		}
+
+		if(m_inFlightCount >= g_cvarRsrcTextureStreamingMaxInFlight)
+		{
+			break;
+		}
+
+		// Stream in as many mips as they fit
+		const PtrSize residentMemory = image.computeStreamingMemory(residentMip);
+		while(firstMip < residentMip && m_memoryUsage + image.computeStreamingMemory(firstMip) - residentMemory > budget)
+		{
+			++firstMip;
+		}
+
+		if(firstMip == residentMip)
+		{
+			continue;
+		}
+
+		kickRequest(image, firstMip);
+	}
+
+	if(replacedTextures)
+	{
+		++m_epoch;
+	}
+}
+
+Bool TextureStreamer::kickRequest(ImageResource& image, U32 firstMip)
+{
+	ImageResource::Streaming& s = image.m_streaming;
+	ANKI_ASSERT(!s.m_inFlight.isValid() && firstMip < s.m_residentFirstMip);
+
+	// Hold a reference until the task takes its own. If no one else has one the image might be getting deleted
+	if(!image.tryRetain())
+	{
+		return false;
+	}
+
+	m_kickedImages.emplaceBack(&image);
+	image.release();
+
+	m_memoryUsage -= computeReservedMemory(image);
+	s.m_inFlightFirstMip = U8(firstMip);
+	s.m_inFlight = image.submitStreamTask(firstMip);
+	m_memoryUsage += computeReservedMemory(image);
+	++m_inFlightCount;
+
+	return true;
+}
+
+Bool TextureStreamer::finishRequest(ImageResource& image, Timestamp frame)
+{
+	ImageResource::Streaming& s = image.m_streaming;
+	ANKI_ASSERT(s.m_inFlight.isDone());
+
+	const Bool success = s.m_inFlight.getState() == AsyncLoaderTaskState::kCompleted && s.m_newTex.isCreated();
+
+	m_memoryUsage -= computeReservedMemory(image);
+	s.m_inFlight = AsyncLoaderTaskHandle();
+	--m_inFlightCount;
+
+	if(!success) [[unlikely]]
+	{
+		ANKI_RESOURCE_LOGW("Texture streaming failed. The image will stay as it is: %s", image.getFilename().cstr());
+		s.m_newTex.reset(nullptr);
+		TextureMemoryPool::getSingleton().deferredFree(s.m_newTexAlloc);
+		s.m_failed = true;
+		m_memoryUsage += computeReservedMemory(image);
+		return false;
+	}
+
+	replaceTexture(image, std::move(s.m_newTex), s.m_newTexAlloc, s.m_inFlightFirstMip, frame);
+	m_memoryUsage += computeReservedMemory(image);
+
+	return true;
+}
+
+void TextureStreamer::streamOut(ImageResource& image, U32 firstMip, Timestamp frame)
+{
+	[[maybe_unused]] ImageResource::Streaming& s = image.m_streaming;
+	ANKI_ASSERT(!s.m_inFlight.isValid() && firstMip > s.m_residentFirstMip);
+
+	TextureMemoryPoolAllocation alloc;
+	TexturePtr tex = image.newCoarserTexture(firstMip, alloc);
+
+	m_memoryUsage -= computeReservedMemory(image);
+	replaceTexture(image, std::move(tex), alloc, firstMip, frame);
+	m_memoryUsage += computeReservedMemory(image);
+}
+
+void TextureStreamer::replaceTexture(ImageResource& image, TexturePtr tex, TextureMemoryPoolAllocation& alloc, U32 firstMip, Timestamp frame)
+{
+	// Keep the old texture for a little while
+	RetiredTexture& retired = *m_retired.emplaceBack();
+	retired.m_alloc = std::move(image.m_texAlloc);
+	retired.m_tex = std::move(image.m_tex);
+	retired.m_frame = frame;
+
+	const PtrSize gpuMemory = alloc.getSize();
+	image.m_texAlloc = std::move(alloc);
+	image.m_tex = std::move(tex);
+	image.m_streaming.m_residentFirstMip = U8(firstMip);
+	++image.m_texVersion;
+
+	// The image might be in the LRU or on its way to be deleted. The ResourceManager knows what to do
+	ResourceManager::getSingleton().updateGpuMemoryUsage(image, gpuMemory);
+
+	g_svarTextureStreamingReplaced.increment(1);
+}
+
+} // end namespace anki
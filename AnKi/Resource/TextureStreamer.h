@@ -0,0 +1,111 @@
+// Copyright (C) 2009-present, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#pragma once
+
+#include <AnKi/Resource/Common.h>
+#include <AnKi/GpuMemory/TextureMemoryPool.h>
+#include <AnKi/Util/Thread.h>
+#include <AnKi/Util/CVarSet.h>
+
+namespace anki {
+
+// Forward
+class ImageResource;
+
+ANKI_CVAR(NumericCVar<PtrSize>, Rsrc, TextureStreamingBudget, 768_MB, 16_MB, 64_GB,
+		  "The GPU memory the streamable textures can use. The tail mips don't respect it")
+ANKI_CVAR(NumericCVar<U32>, Rsrc, TextureStreamingMaxInFlight, 8, 1, 1024, "Max number of textures that stream at the same time")
+ANKI_CVAR(NumericCVar<U32>, Rsrc, TextureStreamingStreamOutDelay, 120, 1, kMaxU32,
+		  "Number of frames a texture keeps its finer mips after they stopped being requested")
+
+// Streams the mips of the streamable ImageResources in and out. The images get their requests for resolution during the frame and once per frame
+// the streamer compares what's requested with what's resident and it kicks AsyncLoader tasks that load a new mip chain into a new texture. When a
+// task is done the new texture replaces the old one. Dropping mips doesn't go to the disk, the coarser mips are copied on the GPU to a new texture.
+// The textures that need the most mips come first and the finer mips stream in as long as the memory budget allows.
+class TextureStreamer : public MakeSingleton<TextureStreamer>
+{
+	template<typename>
+	friend class MakeSingleton;
+	friend class ImageResource;
+
+public:
+	// Swap the textures of the finished requests and kick new requests. Call it once per frame before the users of the textures run since they
+	// need to see the new textures.
+	// Note: Not thread-safe.
+	void update();
+
+	// Incremented every time a texture is replaced. The users that cache the bindless indices check it to know if they need to refresh them.
+	U32 getEpoch() const
+	{
+		return m_epoch;
+	}
+
+	// The memory of the textures of the streamable images. It includes the requests that are in flight and stream mips in.
+	PtrSize getMemoryUsage() const
+	{
+		return m_memoryUsage;
+	}
+
+private:
+	// The number of frames the replaced textures are kept around in case someone holds a raw pointer to them
+	static constexpr U32 kRetiredTextureFrameCount = 2;
+
+	class Request
+	{
+	public:
+		ImageResource* m_image;
+		U32 m_firstMip;
+		U32 m_priority;
+	};
+
+	class RetiredTexture
+	{
+	public:
+		TextureMemoryPoolAllocation m_alloc;
+		TexturePtr m_tex; // Released before the memory
+		Timestamp m_frame;
+	};
+
+	ResourceDynamicArray<ImageResource*> m_images;
+	Mutex m_mtx; // Protects the images
+
+	ResourceDynamicArray<Request> m_requests; // Re-used every frame
+	ResourceDynamicArray<ImageResourcePtr> m_kickedImages; // Re-used every frame
+	ResourceDynamicArray<RetiredTexture> m_retired;
+
+	PtrSize m_memoryUsage = 0;
+	U32 m_inFlightCount = 0;
+	U32 m_epoch = 0;
+
+	TextureStreamer() = default;
+
+	~TextureStreamer();
+
+	// Called by the ImageResource when it's loaded. Thread-safe.
+	void registerImage(ImageResource& image);
+
+	// Called by the ImageResource when it's deleted. Thread-safe.
+	void unregisterImage(ImageResource& image);
+
+	void updateInternal(Timestamp frame);
+
+	// Returns true if the texture was replaced.
+	Bool finishRequest(ImageResource& image, Timestamp frame);
+
+	// Start streaming finer mips in. Returns false if the image can't stream right now.
+	Bool kickRequest(ImageResource& image, U32 firstMip);
+
+	// Drop the finer mips of an image right away.
+	void streamOut(ImageResource& image, U32 firstMip, Timestamp frame);
+
+	// Retire the texture of the image and give it the new one. It also updates the GPU memory the ResourceManager accounts for the image.
+	void replaceTexture(ImageResource& image, TexturePtr tex, TextureMemoryPoolAllocation& alloc, U32 firstMip, Timestamp frame);
+
+	// What the memory accounts for. If mips stream in the memory of the new texture is reserved from the start.
+	static PtrSize computeReservedMemory(const ImageResource& image);
+};
+
+} // end namespace anki
@@ -0,0 +1,144 @@
+// Copyright (C) 2009-present, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <AnKi/Scene/AnimationPoseCache.h>
+#include <AnKi/Resource/SkeletonResource.h>
+#include <AnKi/Resource/AnimationResource.h>
+#include <AnKi/Core/StatsSet.h>
+#include <AnKi/Util/Tracer.h>
+#include <AnKi/Util/Hash.h>
+
+namespace anki {
+
+ANKI_SVAR(AnimationPosesEvaluated, StatCategory::kScene, "Animation poses evaluated", StatFlag::kZeroEveryFrame)
+ANKI_SVAR(AnimationPosesShared, StatCategory::kScene, "Animation poses shared", StatFlag::kZeroEveryFrame)
+
+void computeSkeletonPose(const SkeletonResource& skeleton, ConstWeakArray<AnimationChannelSample> boneLocalTransforms,
+						 const BitSet<128>& bonesAnimated, WeakArray<Mat3x4> boneTransforms, Vec3& minExtend, Vec3& maxExtend)
+{
+	ConstWeakArray<Bone> bones = skeleton.getBones();
+	ANKI_ASSERT(boneTransforms.getSize() == bones.getSize() && boneLocalTransforms.getSize() == bones.getSize());
+
+	Vec4 minv(kMaxF32, kMaxF32, kMaxF32, 0.0f);
+	Vec4 maxv(kMinF32, kMinF32, kMinF32, 0.0f);
+
+	// Compute the model space transforms. The parents are visited first so their transforms are ready
+	for(U32 boneIdx : skeleton.getBoneEvaluationOrder())
+	{
+		const Bone& bone = bones[boneIdx];
+
+		Mat3x4 local;
+		if(bonesAnimated.get(boneIdx))
+		{
+			const AnimationChannelSample& t = boneLocalTransforms[boneIdx];
+			local = Mat3x4(t.m_position, Mat3(t.m_rotation), Vec3(t.m_scale));
+		}
+		else
+		{
+			local = bone.getTransform();
+		}
+
+		const Mat3x4 modelSpace = (bone.getParent()) ? boneTransforms[bone.getParent()->getIndex()].combineTransformations(local) : local;
+		boneTransforms[boneIdx] = modelSpace;
+
+		const Vec4 bonePos = modelSpace.getTranslationPart().xyz0;
+		minv = minv.min(bonePos);
+		maxv = maxv.max(bonePos);
+	}
+
+	// Now that nothing reads them apply the vertex transforms
+	for(U32 boneIdx = 0; boneIdx < bones.getSize(); ++boneIdx)
+	{
+		boneTransforms[boneIdx] = boneTransforms[boneIdx].combineTransformations(bones[boneIdx].getVertexTransform());
+	}
+
+	minExtend = minv.xyz;
+	maxExtend = maxv.xyz;
+}
+
+const AnimationPoseCache::Pose& AnimationPoseCache::getPose(const SkeletonResource& skeleton, const AnimationResource& anim,
+															 ConstWeakArray<U32> channelBones, Second time)
+{
+	class Key
+	{
+	public:
+		Second m_time;
+		U32 m_skeletonUuid;
+		U32 m_animationUuid;
+	} key = {time, skeleton.getUuid(), anim.getUuid()};
+	const U64 hash = computeHash(&key, sizeof(key));
+
+	auto matches = [&](const Entry& entry) {
+		return entry.m_skeletonUuid == key.m_skeletonUuid && entry.m_animationUuid == key.m_animationUuid && entry.m_time == key.m_time;
+	};
+
+	{
+		LockGuard lock(m_mtx);
+		auto it = m_map.find(hash);
+		if(it != m_map.getEnd() && matches(**it))
+		{
+			g_svarAnimationPosesShared.increment(1);
+			return (*it)->m_pose;
+		}
+	}
+
+	// Evaluate it without holding the lock. Some other thread might evaluate the same pose in the meantime but that's rare
+	Entry* entry = evaluate(skeleton, anim, channelBones, time);
+	g_svarAnimationPosesEvaluated.increment(1);
+
+	LockGuard lock(m_mtx);
+	auto it = m_map.find(hash);
+	if(it == m_map.getEnd())
+	{
+		m_map.emplace(hash, entry);
+	}
+	else if(matches(**it))
+	{
+		// Lost the race. Share the other pose so all skins see the same thing
+		entry = *it;
+	}
+
+	return entry->m_pose;
+}
+
+AnimationPoseCache::Entry* AnimationPoseCache::evaluate(const SkeletonResource& skeleton, const AnimationResource& anim,
+														ConstWeakArray<U32> channelBones, Second time)
+{
+	ANKI_TRACE_SCOPED_EVENT(SceneAnimationPoseEvaluate);
+
+	const U32 boneCount = skeleton.getBones().getSize();
+	const U32 channelCount = anim.getChannels().getSize();
+	ANKI_ASSERT(channelBones.getSize() == channelCount);
+
+	// Sample the animation and move the samples to their bones
+	AnimationChannelSample* samples = newArray<AnimationChannelSample>(*m_pool, channelCount);
+	anim.interpolateAll(time, WeakArray<AnimationChannelSample>(samples, channelCount));
+
+	AnimationChannelSample* boneLocalTransforms = newArray<AnimationChannelSample>(*m_pool, boneCount);
+	BitSet<128> bonesAnimated(false);
+	for(U32 i = 0; i < channelCount; ++i)
+	{
+		const U32 boneIdx = channelBones[i];
+		if(boneIdx != kMaxU32)
+		{
+			boneLocalTransforms[boneIdx] = samples[i];
+			bonesAnimated.set(boneIdx);
+		}
+	}
+
+	Entry* entry = newInstance<Entry>(*m_pool);
+	entry->m_skeletonUuid = skeleton.getUuid();
+	entry->m_animationUuid = anim.getUuid();
+	entry->m_time = time;
+
+	Mat3x4* boneTransforms = newArray<Mat3x4>(*m_pool, boneCount);
+	computeSkeletonPose(skeleton, ConstWeakArray<AnimationChannelSample>(boneLocalTransforms, boneCount), bonesAnimated,
+						WeakArray<Mat3x4>(boneTransforms, boneCount), entry->m_pose.m_minExtend, entry->m_pose.m_maxExtend);
+	entry->m_pose.m_boneTransforms = ConstWeakArray<Mat3x4>(boneTransforms, boneCount);
+
+	return entry;
+}
+
+} // end namespace anki
@@ -0,0 +1,76 @@
+// Copyright (C) 2009-present, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#pragma once
+
+#include <AnKi/Scene/Common.h>
+#include <AnKi/Resource/Forward.h>
+#include <AnKi/Math.h>
+#include <AnKi/Util/HashMap.h>
+#include <AnKi/Util/BitSet.h>
+#include <AnKi/Util/Thread.h>
+#include <AnKi/Util/WeakArray.h>
+#include <AnKi/Util/CVarSet.h>
+
+namespace anki {
+
+ANKI_CVAR(BoolCVar, Scene, AnimationPoseCache, true, "Skins that play the same animation at the same time share the pose")
+
+// Compute the final bone transforms of a skeleton. The hierarchy is walked in SkeletonResource::getBoneEvaluationOrder() so there is no
+// recursion. The bones that are not in bonesAnimated use their bind transform. It also returns the extend of the bone positions.
+void computeSkeletonPose(const SkeletonResource& skeleton, ConstWeakArray<AnimationChannelSample> boneLocalTransforms,
+						 const BitSet<128>& bonesAnimated, WeakArray<Mat3x4> boneTransforms, Vec3& minExtend, Vec3& maxExtend);
+
+// Holds the poses of skeletons that play a single animation. Skins that play the same clip at the same time (think crowds) evaluate it once.
+// The poses live for a frame.
+class AnimationPoseCache
+{
+public:
+	class Pose
+	{
+	public:
+		ConstWeakArray<Mat3x4> m_boneTransforms;
+		Vec3 m_minExtend;
+		Vec3 m_maxExtend;
+	};
+
+	AnimationPoseCache(StackMemoryPool* pool)
+		: m_pool(pool)
+		, m_map(pool)
+	{
+		ANKI_ASSERT(pool);
+	}
+
+	AnimationPoseCache(const AnimationPoseCache&) = delete; // Non-copyable
+
+	AnimationPoseCache& operator=(const AnimationPoseCache&) = delete; // Non-copyable
+
+	// Forget all the poses. Call it before the memory pool is reset.
+	void reset()
+	{
+		m_map.destroy();
+	}
+
+	// Get the pose of a skeleton that plays a single animation. channelBones maps the animation channels to bones. Thread-safe.
+	const Pose& getPose(const SkeletonResource& skeleton, const AnimationResource& anim, ConstWeakArray<U32> channelBones, Second time);
+
+private:
+	class Entry
+	{
+	public:
+		Pose m_pose;
+		U32 m_skeletonUuid;
+		U32 m_animationUuid;
+		Second m_time;
+	};
+
+	StackMemoryPool* m_pool;
+	Mutex m_mtx;
+	HashMap<U64, Entry*, DefaultHasher<U64>, MemoryPoolPtrWrapper<StackMemoryPool>> m_map;
+
+	Entry* evaluate(const SkeletonResource& skeleton, const AnimationResource& anim, ConstWeakArray<U32> channelBones, Second time);
+};
+
+} // end namespace anki
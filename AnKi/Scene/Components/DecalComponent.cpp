@@ -33,9 +33,10 @@ void DecalComponent::setImage(LayerType type, CString fname)
 		if(!l.m_image || rsrc->getUuid() != l.m_image->getUuid())
 		{
 			m_dirty = true;
+			markSceneNodeForUpdate();
 
 			l.m_image = std::move(rsrc);
-			l.m_bindlessTextureIndex = l.m_image->getTexture().getOrCreateBindlessTextureIndex(TextureSubresourceDesc::all());
+			refreshBindlessTextureIndex(l);
 		}
 	}
 }
@@ -50,12 +51,41 @@ void DecalComponent::setBlendFactor(LayerType type, F32 blendFactor)
 		{
 			l.m_blendFactor = blendFactor;
 			m_dirty = true;
+			markSceneNodeForUpdate();
+		}
+	}
+}
+
+void DecalComponent::refreshBindlessTextureIndex(Layer& layer)
+{
+	layer.m_bindlessTextureIndex = layer.m_image->getTexture().getOrCreateBindlessTextureIndex(TextureSubresourceDesc::all());
+	layer.m_textureVersion = layer.m_image->getTextureVersion();
+}
+
+void DecalComponent::wakeIfTexturesStreamed()
+{
+	for(const Layer& l : m_layers)
+	{
+		if(l.m_image && l.m_textureVersion != l.m_image->getTextureVersion())
+		{
+			markSceneNodeForUpdate();
+			break;
 		}
 	}
 }
 
 void DecalComponent::update(SceneComponentUpdateInfo& info, Bool& updated)
 {
+	// The streaming might have replaced some textures
+	for(Layer& l : m_layers)
+	{
+		if(l.m_image && l.m_textureVersion != l.m_image->getTextureVersion()) [[unlikely]]
+		{
+			refreshBindlessTextureIndex(l);
+			m_dirty = true;
+		}
+	}
+
 	updated = m_dirty || info.m_node->movedThisFrame();
 
 	if(!updated) [[likely]]
@@ -105,13 +135,12 @@ Error DecalComponent::serialize(SceneSerializer& serializer)
 
 	if(!serializer.isInWriteMode() && diffuse.m_image)
 	{
-		diffuse.m_bindlessTextureIndex = diffuse.m_image->getTexture().getOrCreateBindlessTextureIndex(TextureSubresourceDesc::all());
+		refreshBindlessTextureIndex(diffuse);
 	}
 
 	if(!serializer.isInWriteMode() && roughnessMetalness.m_image)
 	{
-		roughnessMetalness.m_bindlessTextureIndex =
-			roughnessMetalness.m_image->getTexture().getOrCreateBindlessTextureIndex(TextureSubresourceDesc::all());
+		refreshBindlessTextureIndex(roughnessMetalness);
 	}
 
 	return Error::kNone;
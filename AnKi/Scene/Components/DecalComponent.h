@@ -82,6 +82,9 @@ public:
 		return m_layers[LayerType::kRoughnessMetalness].m_blendFactor;
 	}
 
+	// Mark the node for update if the streaming replaced the texture of some layer.
+	ANKI_INTERNAL void wakeIfTexturesStreamed();
+
 private:
 	enum class LayerType : U8
 	{
@@ -96,6 +99,7 @@ private:
 		ImageResourcePtr m_image;
 		F32 m_blendFactor = 1.0f;
 		U32 m_bindlessTextureIndex = kMaxU32;
+		U32 m_textureVersion = 0; // The ImageResource::getTextureVersion() of the bindless index
 	};
 
 	ImageResourcePtr m_defaultDecalImage; // Keep that loaded to avoid loading it all the time when a new decal is constructed
@@ -110,8 +114,15 @@ private:
 
 	void setBlendFactor(LayerType type, F32 blendFactor);
 
+	static void refreshBindlessTextureIndex(Layer& layer);
+
 	void update(SceneComponentUpdateInfo& info, Bool& updated) override;
 
+	Bool canSleep() const override
+	{
+		return !m_dirty;
+	}
+
 	Error serialize(SceneSerializer& serializer) override;
 };
 
@@ -37,6 +37,7 @@ public:
 		{
 			m_type = type;
 			m_dirty = true;
+			markSceneNodeForUpdate();
 		}
 	}
 
@@ -50,6 +51,7 @@ public:
 		if(ANKI_EXPECT(density >= 0.0f) && m_density != density)
 		{
 			m_dirty = true;
+			markSceneNodeForUpdate();
 			m_density = density;
 		}
 	}
@@ -70,6 +72,11 @@ private:
 
 	void update(SceneComponentUpdateInfo& info, Bool& updated) override;
 
+	Bool canSleep() const override
+	{
+		return !m_dirty;
+	}
+
 	Error serialize(SceneSerializer& serializer) override;
 };
 
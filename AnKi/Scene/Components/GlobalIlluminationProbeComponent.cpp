@@ -152,6 +152,13 @@ void GlobalIlluminationProbeComponent::update(SceneComponentUpdateInfo& info, Bo
 		gpuProbe.m_cpuFeedback = cpuFeedback;
 		gpuProbe.m_sceneNodeUuid = info.m_node->getUuid();
 		m_gpuSceneProbe.uploadToGpuScene(gpuProbe);
+
+		// Update the spatial index
+		if(!m_spatialIndex.isValid())
+		{
+			m_spatialIndex.allocate(*this);
+		}
+		m_spatialIndex.update(aabb);
 	}
 
 	m_dirty = false;
@@ -8,6 +8,7 @@
 #include <AnKi/Scene/Components/SceneComponent.h>
 #include <AnKi/Scene/Frustum.h>
 #include <AnKi/Scene/GpuSceneArray.h>
+#include <AnKi/Scene/SpatialIndex.h>
 #include <AnKi/Collision/Aabb.h>
 
 namespace anki {
@@ -119,6 +120,7 @@ private:
 	U32 m_volTexBindlessIdx = 0;
 
 	GpuSceneArrays::GlobalIlluminationProbe::Allocation m_gpuSceneProbe;
+	SpatialIndexHandle m_spatialIndex;
 
 	ShaderProgramResourcePtr m_clearTextureProg;
 
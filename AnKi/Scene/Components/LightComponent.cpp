@@ -144,6 +144,14 @@ void LightComponent::update(SceneComponentUpdateInfo& info, Bool& updated)
 			m_gpuSceneLight.allocate();
 		}
 		m_gpuSceneLight.uploadToGpuScene(gpuLight);
+
+		// Update the spatial index
+		if(!m_spatialIndex.isValid())
+		{
+			m_spatialIndex.allocate(*this);
+		}
+		const Vec3 origin = m_worldTransform.getOrigin().xyz;
+		m_spatialIndex.update(Aabb(origin - m_point.m_radius, origin + m_point.m_radius));
 	}
 	else if(updated && m_type == LightComponentType::kSpot)
 	{
@@ -212,10 +220,27 @@ void LightComponent::update(SceneComponentUpdateInfo& info, Bool& updated)
 			m_gpuSceneLight.allocate();
 		}
 		m_gpuSceneLight.uploadToGpuScene(gpuLight);
+
+		// Update the spatial index. The bounds are the ones of the apex and the far corners of the frustum
+		Vec3 aabbMin = m_worldTransform.getOrigin().xyz;
+		Vec3 aabbMax = aabbMin;
+		for(const Vec3& point : points)
+		{
+			aabbMin = aabbMin.min(point);
+			aabbMax = aabbMax.max(point);
+		}
+
+		if(!m_spatialIndex.isValid())
+		{
+			m_spatialIndex.allocate(*this);
+		}
+		m_spatialIndex.update(Aabb(aabbMin, aabbMax));
 	}
 	else if(m_type == LightComponentType::kDirectional)
 	{
+		// Directional lights affect everything so they are not part of the spatial index
 		m_gpuSceneLight.free();
+		m_spatialIndex.free();
 
 		if(updated && (m_dir.m_month >= 0 && m_dir.m_day >= 0 && m_dir.m_hour >= 0.0f))
 		{
@@ -7,6 +7,7 @@
 
 #include <AnKi/Scene/Components/SceneComponent.h>
 #include <AnKi/Scene/GpuSceneArray.h>
+#include <AnKi/Scene/SpatialIndex.h>
 #include <AnKi/Math.h>
 #include <AnKi/Collision/Common.h>
 
@@ -211,6 +212,8 @@ private:
 	GpuSceneArrays::Light::Allocation m_gpuSceneLight;
 	GpuSceneArrays::LightVisibleRenderablesHash::Allocation m_hash;
 
+	SpatialIndexHandle m_spatialIndex;
+
 	Array<Vec4, 6> m_shadowAtlasUvViewports;
 
 	LightComponentType m_type;
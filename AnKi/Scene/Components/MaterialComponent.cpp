@@ -37,6 +37,7 @@ MaterialComponent& MaterialComponent::setMaterialFilename(CString fname)
 	else
 	{
 		m_anyDirty = !m_resource || (m_resource->getUuid() != newRsrc->getUuid());
+		markSceneNodeForUpdate();
 		m_resource = std::move(newRsrc);
 	}
 
@@ -61,6 +62,7 @@ MaterialComponent& MaterialComponent::setSubmeshIndex(U32 submeshIdx)
 	{
 		m_submeshIdx = submeshIdx;
 		m_anyDirty = true;
+		markSceneNodeForUpdate();
 	}
 
 	return *this;
@@ -112,6 +114,36 @@ Bool MaterialComponent::isValid() const
 	return valid;
 }
 
+void MaterialComponent::wakeIfTexturesStreamed()
+{
+	if(isValid() && m_texturesVersion != m_resource->getTexturesVersion())
+	{
+		markSceneNodeForUpdate();
+	}
+}
+
+void MaterialComponent::requestTextureResolution(const Vec3& cameraOrigin, F32 pixelsPerUnit, F32 cameraNear) const
+{
+	if(!isValid())
+	{
+		return;
+	}
+
+	// Assume the textures span the bounding volume once. Not accurate for tiling textures but the coarser mips are also the cheaper ones
+	const Aabb aabb = computeAabb(getSceneNode());
+	const Vec3 closestPoint = cameraOrigin.clamp(aabb.getMin().xyz, aabb.getMax().xyz);
+	const F32 distance = max((closestPoint - cameraOrigin).length(), cameraNear);
+	const F32 pixels = (aabb.getMax().xyz - aabb.getMin().xyz).length() / distance * pixelsPerUnit;
+
+	for(const MaterialVariable& mtlVar : m_resource->getVariables())
+	{
+		if(mtlVar.tryGetImageResource())
+		{
+			mtlVar.tryGetImageResource()->requestResolution(pixels);
+		}
+	}
+}
+
 Aabb MaterialComponent::computeAabb(const SceneNode& node) const
 {
 	const Bool prioritizeEmitter = m_emitterComponent != nullptr;
@@ -145,6 +177,7 @@ void MaterialComponent::update(SceneComponentUpdateInfo& info, Bool& updated)
 		m_gpuSceneRenderableAabbDepth.free();
 		m_gpuSceneRenderableAabbForward.free();
 		m_gpuSceneRenderableAabbRt.free();
+		m_spatialIndex.free();
 
 		for(RenderingTechnique t : EnumIterable<RenderingTechnique>())
 		{
@@ -181,11 +214,18 @@ void MaterialComponent::update(SceneComponentUpdateInfo& info, Bool& updated)
 	}
 #endif
 
-	Bool dirty = m_anyDirty || moved != movedLastFrame;
+	Bool dirty = m_anyDirty || m_variantsPending || moved != movedLastFrame;
 
 	const Bool prioritizeEmitter = !!m_emitterComponent;
 	const MaterialResource& mtl = *m_resource;
 
+	// The streaming replaced some textures, patch their bindless indices
+	if(!dirty && m_texturesVersion != mtl.getTexturesVersion()) [[unlikely]]
+	{
+		updated = true;
+		uploadConstants();
+	}
+
 	if(m_skinComponent)
 	{
 		dirty = dirty || m_skinComponent->gpuSceneReallocationsThisFrame();
@@ -210,10 +250,12 @@ void MaterialComponent::update(SceneComponentUpdateInfo& info, Bool& updated)
 			info.updateSceneBounds(aabbWorld.getMin().xyz, aabbWorld.getMax().xyz);
 		}
 
-		// Update the GPU scene AABBs
+		// Update the GPU scene AABBs and the spatial index
 		if(prioritizeEmitter || m_skinComponent || moved)
 		{
 			const Aabb aabbWorld = computeAabb(*info.m_node);
+			m_spatialIndex.update(aabbWorld);
+
 			for(RenderingTechnique t : EnumBitsIterable<RenderingTechnique, RenderingTechniqueBit>(mtl.getRenderingTechniques()))
 			{
 				const GpuSceneRenderableBoundingVolume gpuVolume = initGpuSceneRenderableBoundingVolume(
@@ -246,6 +288,7 @@ void MaterialComponent::update(SceneComponentUpdateInfo& info, Bool& updated)
 
 	updated = true;
 	m_anyDirty = false;
+	m_variantsPending = false;
 
 	// Sanitize
 	m_submeshIdx = min(m_submeshIdx, (m_meshComponent) ? (m_meshComponent->getMeshResource().getSubMeshCount() - 1) : 0);
@@ -300,17 +343,7 @@ void MaterialComponent::update(SceneComponentUpdateInfo& info, Bool& updated)
 	}
 
 	// Update the constants
-	{
-		ConstWeakArray<U8> preallocatedConsts = mtl.getPrefilledLocalConstants();
-
-		if(!m_gpuSceneConstants || m_gpuSceneConstants.getSize() != preallocatedConsts.getSizeInBytes())
-		{
-			GpuSceneBuffer::getSingleton().deferredFree(m_gpuSceneConstants);
-			m_gpuSceneConstants = GpuSceneBuffer::getSingleton().allocate(preallocatedConsts.getSizeInBytes(), 4);
-		}
-
-		GpuSceneMicroPatcher::getSingleton().newCopy(m_gpuSceneConstants.getOffset(), m_gpuSceneConstants.getSize(), preallocatedConsts.getBegin());
-	}
+	uploadConstants();
 
 	// Update renderable
 	{
@@ -363,11 +396,25 @@ void MaterialComponent::update(SceneComponentUpdateInfo& info, Bool& updated)
 		key.setMeshletRendering(!prioritizeEmitter
 								&& (GrManager::getSingleton().getDeviceCapabilities().m_meshShaders || g_cvarCoreMeshletRendering));
 
-		const MaterialVariant& mvariant = mtl.getOrCreateVariant(key);
+		const MaterialVariant* mvariant;
+		if(key.getVelocity())
+		{
+			// The velocity variant appears when the node starts moving. Don't stall the update, draw without velocity until it's ready
+			RenderingKey fallbackKey = key;
+			fallbackKey.setVelocity(false);
+			if(!mtl.tryGetOrCreateVariant(key, fallbackKey, mvariant))
+			{
+				m_variantsPending = true;
+			}
+		}
+		else
+		{
+			mvariant = &mtl.getOrCreateVariant(key);
+		}
 
 		RenderStateInfo state;
 		state.m_primitiveTopology = PrimitiveTopology::kTriangles;
-		state.m_program = mvariant.getShaderProgram();
+		state.m_program = mvariant->getShaderProgram();
 
 		Bool wantsMesletCount = false;
 		U32 meshletCount = 0;
@@ -382,10 +429,16 @@ void MaterialComponent::update(SceneComponentUpdateInfo& info, Bool& updated)
 		m_renderStateBucketIndices[t] = RenderStateBucketContainer::getSingleton().addUser(state, t, (wantsMesletCount) ? meshletCount : 0);
 	}
 
-	// Upload the AABBs to the GPU scene
+	// Upload the AABBs to the GPU scene and the spatial index
 	{
 		const Aabb aabbWorld = computeAabb(*info.m_node);
 
+		if(!m_spatialIndex.isValid())
+		{
+			m_spatialIndex.allocate(*this);
+		}
+		m_spatialIndex.update(aabbWorld);
+
 		// Raster
 		for(RenderingTechnique t : EnumBitsIterable<RenderingTechnique, RenderingTechniqueBit>(RenderingTechniqueBit::kAllRaster))
 		{
@@ -462,6 +515,32 @@ void MaterialComponent::update(SceneComponentUpdateInfo& info, Bool& updated)
 	}
 }
 
+void MaterialComponent::uploadConstants()
+{
+	const MaterialResource& mtl = *m_resource;
+	ConstWeakArray<U8> preallocatedConsts = mtl.getPrefilledLocalConstants();
+
+	if(!m_gpuSceneConstants || m_gpuSceneConstants.getSize() != preallocatedConsts.getSizeInBytes())
+	{
+		GpuSceneBuffer::getSingleton().deferredFree(m_gpuSceneConstants);
+		m_gpuSceneConstants = GpuSceneBuffer::getSingleton().allocate(preallocatedConsts.getSizeInBytes(), 4);
+	}
+
+	GpuSceneMicroPatcher::getSingleton().newCopy(m_gpuSceneConstants.getOffset(), m_gpuSceneConstants.getSize(), preallocatedConsts.getBegin());
+
+	// The bindless indices of the prefilled constants are the ones of the textures at load time. Streaming might have replaced the textures since
+	m_texturesVersion = mtl.getTexturesVersion();
+	for(const MaterialVariable& mtlVar : mtl.getVariables())
+	{
+		if(mtlVar.getDataType() == ShaderVariableDataType::kU32 && mtlVar.tryGetImageResource()
+		   && mtlVar.tryGetImageResource()->getTextureVersion() > 0)
+		{
+			const U32 bindlessIdx = mtlVar.tryGetImageResource()->getTexture().getOrCreateBindlessTextureIndex(TextureSubresourceDesc::all());
+			GpuSceneMicroPatcher::getSingleton().newCopy(m_gpuSceneConstants.getOffset() + mtlVar.getOffsetInLocalConstants(), bindlessIdx);
+		}
+	}
+}
+
 Error MaterialComponent::serialize(SceneSerializer& serializer)
 {
 	ANKI_SERIALIZE(m_resource, 1);
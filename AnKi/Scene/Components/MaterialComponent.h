@@ -8,6 +8,7 @@
 #include <AnKi/Scene/Components/SceneComponent.h>
 #include <AnKi/Scene/GpuSceneArray.h>
 #include <AnKi/Scene/RenderStateBucket.h>
+#include <AnKi/Scene/SpatialIndex.h>
 #include <AnKi/Resource/Forward.h>
 
 namespace anki {
@@ -43,6 +44,13 @@ public:
 
 	Bool isValid() const;
 
+	// Mark the node for update if some texture of the material got replaced by the streaming.
+	ANKI_INTERNAL void wakeIfTexturesStreamed();
+
+	// Ask the streamable textures of the material for the resolution the component covers on the screen. pixelsPerUnit is the number of pixels
+	// a unit covers at distance 1 from the camera.
+	ANKI_INTERNAL void requestTextureResolution(const Vec3& cameraOrigin, F32 pixelsPerUnit, F32 cameraNear) const;
+
 private:
 	GpuSceneArrays::Renderable::Allocation m_gpuSceneRenderable;
 	GpuSceneArrays::RenderableBoundingVolumeGBuffer::Allocation m_gpuSceneRenderableAabbGBuffer;
@@ -51,6 +59,8 @@ private:
 	GpuSceneArrays::RenderableBoundingVolumeRt::Allocation m_gpuSceneRenderableAabbRt;
 	GpuSceneBufferAllocation m_gpuSceneConstants;
 
+	SpatialIndexHandle m_spatialIndex;
+
 	Array<RenderStateBucketIndex, U32(RenderingTechnique::kCount)> m_renderStateBucketIndices;
 
 	MaterialResourcePtr m_resource;
@@ -60,19 +70,29 @@ private:
 	ParticleEmitter2Component* m_emitterComponent = nullptr;
 
 	U32 m_submeshIdx = 0;
+	U32 m_texturesVersion = 0; // The MaterialResource::getTexturesVersion() of the constants in the GPU scene
 
 	Bool m_anyDirty : 1 = true; // A compound flag because it's too difficult to track everything
 	Bool m_movedLastFrame : 1 = true;
+	Bool m_variantsPending : 1 = false; // Some variant is created in the background and a fallback is used
 
 	static inline Atomic<U32> m_renderableUuid = {1};
 
 	void update(SceneComponentUpdateInfo& info, Bool& updated) override;
 
+	Bool canSleep() const override
+	{
+		// Keep polling while the resources are loading
+		return !m_anyDirty && !m_variantsPending && isValid();
+	}
+
 	Error serialize(SceneSerializer& serializer) override;
 
 	void onOtherComponentRemovedOrAdded(SceneComponent* other, Bool added) override;
 
 	Aabb computeAabb(const SceneNode& node) const;
+
+	void uploadConstants();
 };
 
 } // end namespace anki
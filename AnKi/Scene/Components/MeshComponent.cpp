@@ -31,6 +31,7 @@ MeshComponent& MeshComponent::setMeshFilename(CString fname)
 	{
 		m_resource = newRsrc;
 		m_resourceDirty = true;
+		markSceneNodeForUpdate();
 	}
 
 	return *this;
@@ -46,6 +47,14 @@ Bool MeshComponent::isValid() const
 	return !!m_resource && m_resource->isLoaded();
 }
 
+void MeshComponent::wakeIfGeometryRelocated()
+{
+	if(isValid() && m_geometryVersion != m_resource->getGeometryVersion())
+	{
+		markSceneNodeForUpdate();
+	}
+}
+
 void MeshComponent::update([[maybe_unused]] SceneComponentUpdateInfo& info, Bool& updated)
 {
 	if(!isValid()) [[unlikely]]
@@ -58,6 +67,11 @@ void MeshComponent::update([[maybe_unused]] SceneComponentUpdateInfo& info, Bool
 	}
 
 	m_gpuSceneMeshLodsReallocatedThisFrame = false;
+	if(m_geometryVersion != m_resource->getGeometryVersion()) [[unlikely]]
+	{
+		m_resourceDirty = true;
+	}
+
 	if(!m_resourceDirty) [[likely]]
 	{
 		return;
@@ -67,6 +81,7 @@ void MeshComponent::update([[maybe_unused]] SceneComponentUpdateInfo& info, Bool
 	m_resourceDirty = false;
 
 	const MeshResource& mesh = *m_resource;
+	m_geometryVersion = mesh.getGeometryVersion();
 	const U32 submeshCount = mesh.getSubMeshCount();
 
 	if(m_gpuSceneMeshLods.getSize() != submeshCount)
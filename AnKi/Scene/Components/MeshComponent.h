@@ -38,6 +38,20 @@ public:
 		return *m_resource;
 	}
 
+	// Mark the mesh as an occluder for the CPU occlusion culling. Prefer big and simple meshes like walls and terrain. The coarsest LOD is the
+	// one that will be rasterized so it shouldn't extend beyond the mesh. Its geometry is loaded to the CPU the 1st time it's rasterized. It's not
+	// serialized.
+	MeshComponent& setOccluder(Bool occluder)
+	{
+		m_occluder = occluder;
+		return *this;
+	}
+
+	Bool isOccluder() const
+	{
+		return m_occluder;
+	}
+
 	ANKI_INTERNAL U32 getGpuSceneMeshLodsIndex(U32 submeshIdx) const
 	{
 		ANKI_ASSERT(isValid());
@@ -50,16 +64,27 @@ public:
 		return m_gpuSceneMeshLodsReallocatedThisFrame;
 	}
 
+	// The UnifiedGeometryBuffer might move the geometry around. Wake the node if that happened so it can re-upload the offsets.
+	ANKI_INTERNAL void wakeIfGeometryRelocated();
+
 private:
 	MeshResourcePtr m_resource;
 
 	SceneDynamicArray<GpuSceneArrays::MeshLod::Allocation> m_gpuSceneMeshLods;
 
+	U32 m_geometryVersion = 0; // The MeshResource's geometry version of the last upload
 	Bool m_resourceDirty = true;
 	Bool m_gpuSceneMeshLodsReallocatedThisFrame = false;
+	Bool m_occluder = false;
 
 	void update(SceneComponentUpdateInfo& info, Bool& updated) override;
 
+	Bool canSleep() const override
+	{
+		// Keep polling while the resource is loading
+		return !m_resourceDirty && isValid();
+	}
+
 	Error serialize(SceneSerializer& serializer) override;
 };
 
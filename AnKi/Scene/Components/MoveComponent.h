@@ -38,6 +38,11 @@ private:
 	Bool m_movedLastFrame = true;
 
 	void update(SceneComponentUpdateInfo& info, Bool& updated) override;
+
+	Bool canSleep() const override
+	{
+		return true; // The node wakes up when its transform changes
+	}
 };
 
 } // end namespace anki
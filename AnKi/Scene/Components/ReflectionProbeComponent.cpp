@@ -66,6 +66,13 @@ void ReflectionProbeComponent::update(SceneComponentUpdateInfo& info, Bool& upda
 		gpuProbe.m_cpuFeedback = m_reflectionNeedsRefresh;
 		gpuProbe.m_sceneNodeUuid = info.m_node->getUuid();
 		m_gpuSceneProbe.uploadToGpuScene(gpuProbe);
+
+		// Update the spatial index
+		if(!m_spatialIndex.isValid())
+		{
+			m_spatialIndex.allocate(*this);
+		}
+		m_spatialIndex.update(aabbWorld);
 	}
 }
 
@@ -8,6 +8,7 @@
 #include <AnKi/Scene/Components/SceneComponent.h>
 #include <AnKi/Scene/Frustum.h>
 #include <AnKi/Scene/GpuSceneArray.h>
+#include <AnKi/Scene/SpatialIndex.h>
 #include <AnKi/Collision/Aabb.h>
 
 namespace anki {
@@ -66,6 +67,7 @@ private:
 	Vec3 m_halfSize = Vec3(1.0f);
 
 	GpuSceneArrays::ReflectionProbe::Allocation m_gpuSceneProbe;
+	SpatialIndexHandle m_spatialIndex;
 
 	TexturePtr m_reflectionTex;
 	U32 m_reflectionTexBindlessIndex = kMaxU32;
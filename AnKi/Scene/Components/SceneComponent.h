@@ -149,7 +149,8 @@ class SceneComponent
 {
 public:
 	SceneComponent(SceneComponentType type, const SceneComponentInitInfo& init)
-		: m_type(U8(type))
+		: m_node(init.m_node)
+		, m_type(U8(type))
 		, m_sceneUuid(init.m_sceneUuid)
 		, m_componentUuid(init.m_componentUuid)
 	{
@@ -196,12 +197,29 @@ public:
 		ANKI_ASSERT(m_arrayIdx == idx);
 	}
 
+	ANKI_INTERNAL SceneNode& getSceneNode()
+	{
+		return *m_node;
+	}
+
+	ANKI_INTERNAL const SceneNode& getSceneNode() const
+	{
+		return *m_node;
+	}
+
 	ANKI_INTERNAL virtual void onDestroy([[maybe_unused]] SceneNode& node)
 	{
 	}
 
 	ANKI_INTERNAL virtual void update(SceneComponentUpdateInfo& info, Bool& updated) = 0;
 
+	// Return true if the component has nothing to do until the node moves or one of the component's setters gets called. If all components
+	// of a node can sleep then the scenegraph may skip the node's update.
+	ANKI_INTERNAL virtual Bool canSleep() const
+	{
+		return false;
+	}
+
 	ANKI_INTERNAL virtual void onOtherComponentRemovedOrAdded([[maybe_unused]] SceneComponent* other, [[maybe_unused]] Bool added)
 	{
 	}
@@ -246,6 +264,9 @@ public:
 	}
 
 protected:
+	// Components that can sleep should call this when some state changes that requires an update.
+	void markSceneNodeForUpdate();
+
 	// A convenience function for components to keep tabs on other components of a SceneNode
 	template<typename TComponent>
 	static void bookkeepComponent(SceneDynamicArray<TComponent*>& arr, SceneComponent* other, Bool added, Bool& firstDirty)
@@ -300,6 +321,8 @@ protected:
 private:
 	static constexpr U32 kArrayIdxBits = 23u;
 
+	SceneNode* m_node = nullptr;
+
 	Timestamp m_timestamp = 1; // Indicates when an update happened
 
 	U32 m_serialize : 1 = false;
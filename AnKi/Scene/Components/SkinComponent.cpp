@@ -50,6 +50,7 @@ void SkinComponent::playAnimation(U32 trackIdx, AnimationResourcePtr anim, const
 	Track& track = m_tracks[trackIdx];
 
 	track.m_anim = anim;
+	track.m_channelBones.destroy();
 	track.m_absoluteStartTime = m_absoluteTime + info.m_startTime;
 	track.m_relativeTimePassed = 0.0;
 	if(info.m_repeatTimes > 0.0)
@@ -90,7 +91,6 @@ void SkinComponent::update(SceneComponentUpdateInfo& info, Bool& updated)
 	const Bool updatedLastFrame = m_updatedLastFrame;
 	const Bool resourceDirty = m_resourceDirty;
 	m_resourceDirty = false;
-	Bool animationRun = false;
 
 	if(resourceDirty) [[unlikely]]
 	{
@@ -98,7 +98,7 @@ void SkinComponent::update(SceneComponentUpdateInfo& info, Bool& updated)
 		const U32 boneCount = m_resource->getBones().getSize();
 		m_boneTrfs[0].resize(boneCount, Mat3x4::getIdentity());
 		m_boneTrfs[1].resize(boneCount, Mat3x4::getIdentity());
-		m_animationTrfs.resize(boneCount, Trf{Vec3(0.0f), Quat::getIdentity(), 1.0f});
+		m_animationTrfs.resize(boneCount, AnimationChannelSample{Vec3(0.0f), Quat::getIdentity(), 1.0f});
 
 		m_gpuSceneBoneTransforms = GpuSceneBuffer::getSingleton().allocate(sizeof(Mat4) * boneCount * 2, 4);
 
@@ -107,11 +107,10 @@ void SkinComponent::update(SceneComponentUpdateInfo& info, Bool& updated)
 
 	const Second dt = info.m_dt;
 
-	Vec4 minExtend(kMaxF32, kMaxF32, kMaxF32, 0.0f);
-	Vec4 maxExtend(kMinF32, kMinF32, kMinF32, 0.0f);
-
-	BitSet<128> bonesAnimated(false);
-
+	// Find the tracks that play this frame and advance their time
+	Array<Track*, kMaxAnimationTracks> activeTracks;
+	Array<Second, kMaxAnimationTracks> animTimes;
+	U32 activeTrackCount = 0;
 	for(Track& track : m_tracks)
 	{
 		if(!track.m_anim.isCreated())
@@ -125,37 +124,68 @@ void SkinComponent::update(SceneComponentUpdateInfo& info, Bool& updated)
 			continue;
 		}
 
-		const Second clipDuration = track.m_anim->getDuration();
-		const Second animationDuration = track.m_repeatTimes * clipDuration;
-
+		const Second animationDuration = track.m_repeatTimes * track.m_anim->getDuration();
 		if(track.m_repeatTimes > 0.0 && track.m_relativeTimePassed > animationDuration)
 		{
 			// Animation finished
 			continue;
 		}
 
-		animationRun = true;
-
-		const Second animTime = track.m_relativeTimePassed;
+		animTimes[activeTrackCount] = track.m_relativeTimePassed;
+		activeTracks[activeTrackCount++] = &track;
 		track.m_relativeTimePassed += dt * Second(track.m_animationSpeedScale);
 
-		// Iterate the animation channels and interpolate
-		for(U32 i = 0; i < track.m_anim->getChannels().getSize(); ++i)
+		// Map the channels to bones once. Unknown bones are reported once as well
+		const U32 channelCount = track.m_anim->getChannels().getSize();
+		if(resourceDirty || track.m_channelBones.getSize() != channelCount)
+		{
+			track.m_channelBones.resize(channelCount);
+			for(U32 i = 0; i < channelCount; ++i)
+			{
+				const AnimationChannel& channel = track.m_anim->getChannels()[i];
+				const Bone* bone = m_resource->tryFindBone(channel.m_name.toCString());
+				if(!bone)
+				{
+					ANKI_SCENE_LOGW("Animation is referencing unknown bone \"%s\"", &channel.m_name[0]);
+				}
+
+				track.m_channelBones[i] = (bone) ? bone->getIndex() : kMaxU32;
+			}
+		}
+	}
+
+	const Bool animationRun = activeTrackCount > 0;
+
+	// A single track without blending is the common case (crowds). Skins that play the same clip at the same time share the pose
+	const AnimationPoseCache::Pose* sharedPose = nullptr;
+	if(activeTrackCount == 1 && g_cvarSceneAnimationPoseCache)
+	{
+		const Track& track = *activeTracks[0];
+		sharedPose = &SceneGraph::getSingleton().getAnimationPoseCache().getPose(*m_resource, *track.m_anim, track.m_channelBones, animTimes[0]);
+	}
+
+	BitSet<128> bonesAnimated(false);
+	for(U32 t = 0; t < activeTrackCount && !sharedPose; ++t)
+	{
+		const Track& track = *activeTracks[t];
+		const Second animTime = animTimes[t];
+		const Second animationDuration = track.m_repeatTimes * track.m_anim->getDuration();
+		const U32 channelCount = track.m_channelBones.getSize();
+
+		// Interpolate all the channels at once
+		DynamicArray<AnimationChannelSample, MemoryPoolPtrWrapper<StackMemoryPool>> samples(info.m_framePool);
+		samples.resize(channelCount);
+		track.m_anim->interpolateAll(animTime, WeakArray<AnimationChannelSample>(samples.getBegin(), channelCount));
+
+		for(U32 i = 0; i < channelCount; ++i)
 		{
-			const AnimationChannel& channel = track.m_anim->getChannels()[i];
-			const Bone* bone = m_resource->tryFindBone(channel.m_name.toCString());
-			if(!bone)
+			const U32 boneIdx = track.m_channelBones[i];
+			if(boneIdx == kMaxU32)
 			{
-				ANKI_SCENE_LOGW("Animation is referencing unknown bone \"%s\"", &channel.m_name[0]);
 				continue;
 			}
-			const U32 boneIdx = bone->getIndex();
 
-			// Interpolate
-			Vec3 position;
-			Quat rotation;
-			F32 scale;
-			track.m_anim->interpolate(i, animTime, position, rotation, scale);
+			AnimationChannelSample sample = samples[i];
 
 			// Blend with previous track
 			if(bonesAnimated.get(boneIdx) && (track.m_blendInTime > 0.0 || track.m_blendOutTime > 0.0))
@@ -184,17 +214,17 @@ void SkinComponent::update(SceneComponentUpdateInfo& info, Bool& updated)
 
 				if(factor < 1.0f)
 				{
-					const Trf& prevTrf = m_animationTrfs[boneIdx];
+					const AnimationChannelSample& prev = m_animationTrfs[boneIdx];
 
-					position = linearInterpolate(prevTrf.m_translation, position, factor);
-					rotation = prevTrf.m_rotation.slerp(rotation, factor);
-					scale = linearInterpolate(prevTrf.m_scale, scale, factor);
+					sample.m_position = linearInterpolate(prev.m_position, sample.m_position, factor);
+					sample.m_rotation = prev.m_rotation.slerp(sample.m_rotation, factor);
+					sample.m_scale = linearInterpolate(prev.m_scale, sample.m_scale, factor);
 				}
 			}
 
 			// Store
 			bonesAnimated.set(boneIdx);
-			m_animationTrfs[boneIdx] = {position, rotation, scale};
+			m_animationTrfs[boneIdx] = sample;
 		}
 	}
 
@@ -203,10 +233,21 @@ void SkinComponent::update(SceneComponentUpdateInfo& info, Bool& updated)
 		m_prevBoneTrfs = m_crntBoneTrfs;
 		m_crntBoneTrfs = m_crntBoneTrfs ^ 1;
 
-		// Walk the bone hierarchy to add additional transforms
-		visitBones(m_resource->getRootBone(), Mat3x4::getIdentity(), bonesAnimated, minExtend, maxExtend);
+		Vec3 minExtend;
+		Vec3 maxExtend;
+		if(sharedPose)
+		{
+			memcpy(m_boneTrfs[m_crntBoneTrfs].getBegin(), sharedPose->m_boneTransforms.getBegin(), sharedPose->m_boneTransforms.getSizeInBytes());
+			minExtend = sharedPose->m_minExtend;
+			maxExtend = sharedPose->m_maxExtend;
+		}
+		else
+		{
+			computeSkeletonPose(*m_resource, WeakArray<AnimationChannelSample>(m_animationTrfs), bonesAnimated,
+								WeakArray<Mat3x4>(m_boneTrfs[m_crntBoneTrfs]), minExtend, maxExtend);
+		}
 
-		const Vec4 e(kEpsilonf, kEpsilonf, kEpsilonf, 0.0f);
+		const Vec3 e(kEpsilonf);
 		m_boneBoundingVolume.setMin(minExtend - e);
 		m_boneBoundingVolume.setMax(maxExtend + e);
 
@@ -231,33 +272,6 @@ void SkinComponent::update(SceneComponentUpdateInfo& info, Bool& updated)
 	m_updatedLastFrame = resourceDirty || animationRun;
 }
 
-void SkinComponent::visitBones(const Bone& bone, const Mat3x4& parentTrf, const BitSet<128>& bonesAnimated, Vec4& minExtend, Vec4& maxExtend)
-{
-	Mat3x4 outMat;
-
-	if(bonesAnimated.get(bone.getIndex()))
-	{
-		const Trf& t = m_animationTrfs[bone.getIndex()];
-		outMat = parentTrf.combineTransformations(Mat3x4(t.m_translation.xyz, Mat3(t.m_rotation), Vec3(t.m_scale)));
-	}
-	else
-	{
-		outMat = parentTrf.combineTransformations(bone.getTransform());
-	}
-
-	m_boneTrfs[m_crntBoneTrfs][bone.getIndex()] = outMat.combineTransformations(bone.getVertexTransform());
-
-	// Update volume
-	const Vec3 bonePos = outMat * Vec4(0.0f, 0.0f, 0.0f, 1.0f);
-	minExtend = minExtend.min(bonePos.xyz0);
-	maxExtend = maxExtend.max(bonePos.xyz0);
-
-	for(const Bone* child : bone.getChildren())
-	{
-		visitBones(*child, outMat, bonesAnimated, minExtend, maxExtend);
-	}
-}
-
 Error SkinComponent::serialize(SceneSerializer& serializer)
 {
 	ANKI_SERIALIZE(m_resource, 1);
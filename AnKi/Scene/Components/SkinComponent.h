@@ -110,19 +110,12 @@ private:
 		Second m_blendOutTime = 0.0f;
 		F32 m_repeatTimes = 1.0f;
 		F32 m_animationSpeedScale = 1.0f;
-	};
-
-	class Trf
-	{
-	public:
-		Vec3 m_translation;
-		Quat m_rotation;
-		F32 m_scale;
+		SceneDynamicArray<U32> m_channelBones; // Channel index to bone index. kMaxU32 if the bone is missing
 	};
 
 	SkeletonResourcePtr m_resource;
 	Array<SceneDynamicArray<Mat3x4>, 2> m_boneTrfs;
-	SceneDynamicArray<Trf> m_animationTrfs;
+	SceneDynamicArray<AnimationChannelSample> m_animationTrfs; // Bone space transforms of the animated bones
 	Aabb m_boneBoundingVolume = Aabb(Vec3(-1.0f), Vec3(1.0f));
 	Array<Track, kMaxAnimationTracks> m_tracks;
 	Second m_absoluteTime = 0.0;
@@ -138,8 +131,6 @@ private:
 	void update(SceneComponentUpdateInfo& info, Bool& updated) override;
 
 	Error serialize(SceneSerializer& serializer) override;
-
-	void visitBones(const Bone& bone, const Mat3x4& parentTrf, const BitSet<128, U8>& bonesAnimated, Vec4& minExtend, Vec4& maxExtend);
 };
 
 } // end namespace anki
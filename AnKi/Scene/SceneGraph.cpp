@@ -7,12 +7,17 @@
 #include <AnKi/Scene/RenderStateBucket.h>
 #include <AnKi/Physics/PhysicsWorld.h>
 #include <AnKi/Resource/ResourceManager.h>
+#include <AnKi/Resource/MeshResource.h>
 #include <AnKi/Util/CVarSet.h>
 #include <AnKi/Core/StatsSet.h>
 #include <AnKi/Util/Tracer.h>
 #include <AnKi/Util/HighRezTimer.h>
 #include <AnKi/Util/Filesystem.h>
+#include <AnKi/Util/TaskGraph.h>
 #include <AnKi/Core/App.h>
+#include <AnKi/GpuMemory/UnifiedGeometryBuffer.h>
+#include <AnKi/Resource/TextureStreamer.h>
+#include <AnKi/Window/NativeWindow.h>
 #include <AnKi/Resource/ScriptResource.h>
 #include <AnKi/Script/ScriptManager.h>
 #include <AnKi/Scene/StatsUiNode.h>
@@ -44,6 +49,7 @@ namespace anki {
 ANKI_SVAR(SceneUpdateTime, StatCategory::kTime, "All scene update", StatFlag::kMilisecond | StatFlag::kShowAverage | StatFlag::kMainThreadUpdates)
 ANKI_SVAR(SceneComponentsUpdated, StatCategory::kScene, "Scene components updated per frame", StatFlag::kZeroEveryFrame)
 ANKI_SVAR(SceneNodesUpdated, StatCategory::kScene, "Scene nodes updated per frame", StatFlag::kZeroEveryFrame)
+ANKI_SVAR(SceneNodesSkipped, StatCategory::kScene, "Sleeping scene nodes or sub-trees skipped per frame", StatFlag::kZeroEveryFrame)
 
 class SceneGraph::UpdateSceneNodesCtx
 {
@@ -68,15 +74,13 @@ public:
 		}
 	};
 
-	Atomic<U32> m_crntNodeIndex = {0};
-	U32 m_lastNodeIndex = 0;
-
 	Second m_prevUpdateTime = 0.0;
 	Second m_crntTime = 0.0;
 
 	DynamicArray<PerThread, MemoryPoolPtrWrapper<StackMemoryPool>> m_perThread;
 
 	Bool m_forceUpdateSceneBounds = false;
+	Bool m_skipSleepingNodes = false;
 
 	UpdateSceneNodesCtx(U32 threadCount)
 		: m_perThread(&SceneGraph::getSingleton().m_framePool)
@@ -85,12 +89,40 @@ public:
 	}
 };
 
+// The state of a scene that is loaded in slices.
+class SceneGraph::SceneLoader
+{
+public:
+	ResourceFilePtr m_file;
+	SceneSerializer* m_serializer = nullptr;
+	Scene* m_scene = nullptr;
+	SceneNode::SerializeCommonArgs m_serializationArgs;
+
+	U32 m_nodeCount = 0;
+	U32 m_loadedNodeCount = 0;
+
+	SceneComponentType m_componentType = SceneComponentType::kFirst;
+	U32 m_componentCount = kMaxU32; // Of the current type. kMaxU32 if it's not read yet
+	U32 m_loadedComponentCount = 0; // Of the current type
+
+	~SceneLoader()
+	{
+		deleteInstance(SceneMemoryPool::getSingleton(), m_serializer);
+	}
+};
+
 SceneGraph::SceneGraph()
 {
 }
 
 SceneGraph::~SceneGraph()
 {
+	for(SceneLoader* loader : m_sceneLoaders)
+	{
+		deleteInstance(SceneMemoryPool::getSingleton(), loader);
+	}
+	m_sceneLoaders.destroy();
+
 	for(SceneNode* node : m_deferredOps.m_nodesForRegistration)
 	{
 		deleteInstance(SceneMemoryPool::getSingleton(), node);
@@ -193,11 +225,43 @@ void SceneGraph::update(Second prevUpdateTime, Second crntTime)
 	const Second startUpdateTime = HighRezTimer::getCurrentTime();
 
 	// Reset the framepool
+	m_animationPoseCache.reset();
 	m_framePool.reset();
 
+	// Create some of the nodes of the scenes that load incrementally. Do it before the deferred ops so the nodes are registered right away
+	streamScenes();
+
 	// Deferred ops at the beginning
 	doDeferredOperations();
 
+	// The UGB moved some geometry at the end of the previous frame. Wake the sleeping meshes that need to re-upload their offsets
+	const U32 relocationEpoch = UnifiedGeometryBuffer::getSingleton().getRelocationEpoch();
+	if(relocationEpoch != m_unifiedGeometryBufferRelocationEpoch) [[unlikely]]
+	{
+		m_unifiedGeometryBufferRelocationEpoch = relocationEpoch;
+		for(MeshComponent& comp : m_componentArrays.getMeshs())
+		{
+			comp.wakeIfGeometryRelocated();
+		}
+	}
+
+	// Same for the textures that the streaming replaced. The streamer swaps them here so the nodes see the new textures right away
+	TextureStreamer::getSingleton().update();
+	const U32 textureStreamingEpoch = TextureStreamer::getSingleton().getEpoch();
+	if(textureStreamingEpoch != m_textureStreamingEpoch) [[unlikely]]
+	{
+		m_textureStreamingEpoch = textureStreamingEpoch;
+		for(MaterialComponent& comp : m_componentArrays.getMaterials())
+		{
+			comp.wakeIfTexturesStreamed();
+		}
+
+		for(DecalComponent& comp : m_componentArrays.getDecals())
+		{
+			comp.wakeIfTexturesStreamed();
+		}
+	}
+
 	// Update physics
 	if(!m_paused) [[likely]]
 	{
@@ -208,36 +272,51 @@ void SceneGraph::update(Second prevUpdateTime, Second crntTime)
 	m_inUpdate = true;
 #endif
 
-	// Update events
-	{
-		ANKI_TRACE_SCOPED_EVENT(EventsUpdate);
-		m_events.updateAllEvents(prevUpdateTime, crntTime);
-	}
-
-	// Update scene nodes
+	// Update events and scene nodes as a graph of tasks so the node updates start the moment the events are done
 	UpdateSceneNodesCtx updateCtx(CoreThreadJobManager::getSingleton().getThreadCount());
 	{
-		// Before the update wake some threads with dummy work
-		for(U32 i = 0; i < 2; i++)
-		{
-			CoreThreadJobManager::getSingleton().dispatchTask([]([[maybe_unused]] U32 tid) {});
-		}
-
 		ANKI_TRACE_SCOPED_EVENT(SceneNodesUpdate);
-		updateCtx.m_crntNodeIndex.setNonAtomically((m_updatableNodes.isEmpty()) ? 0 : m_updatableNodes.getFront().getArrayIndex());
-		updateCtx.m_lastNodeIndex = (m_updatableNodes.isEmpty()) ? 0 : m_updatableNodes.getBack().getArrayIndex();
 		updateCtx.m_prevUpdateTime = prevUpdateTime;
 		updateCtx.m_crntTime = crntTime;
 		updateCtx.m_forceUpdateSceneBounds = (m_frame % kForceSetSceneBoundsFrameCount) == 0;
 
-		for(U32 i = 0; i < CoreThreadJobManager::getSingleton().getThreadCount(); i++)
-		{
-			CoreThreadJobManager::getSingleton().dispatchTask([this, &updateCtx](U32 tid) {
-				updateNodes(tid, updateCtx);
+		// Sleeping nodes don't contribute to the scene bounds so update everything when the bounds are re-computed
+		updateCtx.m_skipSleepingNodes = g_cvarSceneSkipSleepingNodes && !updateCtx.m_forceUpdateSceneBounds;
+#if ANKI_WITH_EDITOR
+		updateCtx.m_skipSleepingNodes = updateCtx.m_skipSleepingNodes && !m_checkForResourceUpdates;
+#endif
+
+		const U32 firstNodeIndex = (m_updatableNodes.isEmpty()) ? 0 : m_updatableNodes.getFront().getArrayIndex();
+		const U32 endNodeIndex = (m_updatableNodes.isEmpty()) ? 0 : m_updatableNodes.getBack().getArrayIndex() + 1;
+
+		TaskGraph graph(CoreThreadJobManager::getSingleton(), &m_framePool);
+
+		const TaskGraphTask eventsTask = graph.newTask([this, prevUpdateTime, crntTime]([[maybe_unused]] U32 tid) {
+			ANKI_TRACE_SCOPED_EVENT(EventsUpdate);
+			m_events.updateAllEvents(prevUpdateTime, crntTime);
+		});
+
+		// Propagate the transforms that changed since last frame with a linear pass over the transform store
+		const TaskGraphTask transformsTask = graph.newContinuation(eventsTask, [this]([[maybe_unused]] U32 tid) {
+			ANKI_TRACE_SCOPED_EVENT(SceneTransformsUpdate);
+			m_transformStore.updateWorldTransforms([](SceneTransformHandle& handle) {
+				SceneNode& node = *static_cast<SceneNode*>(handle.getUserData());
+				node.markForUpdate();
+				node.markChildrenTransformDirty();
 			});
-		}
+		});
 
-		CoreThreadJobManager::getSingleton().waitForAllTasksToFinish();
+		// Process a cacheline worth of root nodes per job
+		constexpr U32 kNodeBatchSize = ANKI_CACHE_LINE_SIZE / sizeof(void*);
+		graph.newParallelFor(
+			firstNodeIndex, endNodeIndex, kNodeBatchSize,
+			[this, &updateCtx](U32 tid, U32 begin, U32 end) {
+				updateNodes(tid, begin, end, updateCtx);
+			},
+			{transformsTask});
+
+		graph.submit();
+		graph.wait();
 	}
 
 #if ANKI_ASSERTIONS_ENABLED
@@ -365,15 +444,241 @@ void SceneGraph::update(Second prevUpdateTime, Second crntTime)
 		}
 	}
 
-	// Misc
-#define ANKI_CAT_TYPE(arrayName, gpuSceneType, id, cvarName) GpuSceneArrays::arrayName::getSingleton().flush();
+	// Apply the new bounds to the spatial index. Needs to happen after the nodes are deleted since that removes objects from the index
+	m_spatialIndex.flush();
+
+	// Now that the nodes are done and the camera is final rasterize the occluders
+	rasterizeOccluders();
+
+	requestTextureResolutions();
+
+	// Flush the GPU scene arrays. Needs to happen after the nodes are deleted since that frees GPU scene allocations
+	{
+		ANKI_TRACE_SCOPED_EVENT(SceneGpuSceneFlush);
+		TaskGraph graph(CoreThreadJobManager::getSingleton(), &m_framePool);
+
+#define ANKI_CAT_TYPE(arrayName, gpuSceneType, id, cvarName) \
+	graph.newTask([]([[maybe_unused]] U32 tid) { \
+		GpuSceneArrays::arrayName::getSingleton().flush(); \
+	});
 #include <AnKi/Scene/GpuSceneArrays.def.h>
 
+		graph.submit();
+		graph.wait();
+	}
+
 	g_svarSceneUpdateTime.set((HighRezTimer::getCurrentTime() - startUpdateTime) * 1000.0);
 	++m_frame;
 }
 
+// All the components that live in the spatial index
+constexpr SceneComponentTypeMask kSpatialIndexComponents = SceneComponentTypeMask::kMaterial | SceneComponentTypeMask::kLight
+														   | SceneComponentTypeMask::kReflectionProbe
+														   | SceneComponentTypeMask::kGlobalIlluminationProbe;
+
+WeakArray<SceneNode*> SceneGraph::findSceneNodesInSphere(Vec3 center, F32 radius) const
+{
+	DynamicArray<SceneNode*, MemoryPoolPtrWrapper<StackMemoryPool>> nodes(&m_framePool);
+	m_spatialIndex.visitSphere(Sphere(center, radius), kSpatialIndexComponents, [&](SceneComponent* comp) {
+		SceneNode* node = &comp->getSceneNode();
+
+		// A node might have more than one component in the index
+		if(std::find(nodes.getBegin(), nodes.getEnd(), node) == nodes.getEnd())
+		{
+			nodes.emplaceBack(node);
+		}
+	});
+
+	WeakArray<SceneNode*> out;
+	nodes.moveAndReset(out);
+	return out;
+}
+
+WeakArray<SceneNode*> SceneGraph::findSceneNodesAlongRay(Vec3 origin, Vec3 direction, F32 maxDistance) const
+{
+	class Hit
+	{
+	public:
+		SceneNode* m_node;
+		F32 m_distance;
+	};
+
+	DynamicArray<Hit, MemoryPoolPtrWrapper<StackMemoryPool>> hits(&m_framePool);
+	const Ray ray(origin, direction.normalize());
+	m_spatialIndex.visitRay(ray, maxDistance, kSpatialIndexComponents, [&](SceneComponent* comp, F32 distance) {
+		SceneNode* node = &comp->getSceneNode();
+
+		// A node might have more than one component in the index. Keep the closest hit
+		for(Hit& hit : hits)
+		{
+			if(hit.m_node == node)
+			{
+				hit.m_distance = min(hit.m_distance, distance);
+				return;
+			}
+		}
+
+		hits.emplaceBack(Hit{node, distance});
+	});
+
+	std::sort(hits.getBegin(), hits.getEnd(), [](const Hit& a, const Hit& b) {
+		return a.m_distance < b.m_distance;
+	});
+
+	DynamicArray<SceneNode*, MemoryPoolPtrWrapper<StackMemoryPool>> nodes(&m_framePool);
+	nodes.resize(hits.getSize());
+	for(U32 i = 0; i < hits.getSize(); ++i)
+	{
+		nodes[i] = hits[i].m_node;
+	}
+
+	WeakArray<SceneNode*> out;
+	nodes.moveAndReset(out);
+	return out;
+}
+
+void SceneGraph::requestTextureResolutions()
+{
+	if(!g_cvarRsrcTextureStreaming)
+	{
+		return;
+	}
+
+	ANKI_TRACE_SCOPED_EVENT(SceneTextureStreamingRequests);
+
+	// The materials in the view of the main camera ask for the resolution they cover on the screen. The rest of the demand driven textures keep
+	// only their tail mips
+	const Frustum& frustum = m_mainCamNode->getFirstComponentOfType<CameraComponent>().getFrustum();
+	const Vec3 cameraOrigin = frustum.getWorldTransform().getOrigin().xyz;
+	const F32 pixelsPerUnit = F32(g_cvarWindowHeight) / (2.0f * tan(frustum.getFovY() / 2.0f)); // At distance 1
+
+	m_spatialIndex.visitFrustum(frustum.getViewProjectionMatrix(), SceneComponentTypeMask::kMaterial, [&](SceneComponent* comp) {
+		static_cast<MaterialComponent*>(comp)->requestTextureResolution(cameraOrigin, pixelsPerUnit, frustum.getNear());
+	});
+}
+
+void SceneGraph::rasterizeOccluders()
+{
+	m_occlusionRasterizerValid = false;
+	if(!g_cvarSceneSoftwareOcclusionCulling)
+	{
+		return;
+	}
+
+	ANKI_TRACE_SCOPED_EVENT(SceneRasterizeOccluders);
+
+	class Occluder
+	{
+	public:
+		ConstWeakArray<Vec3> m_positions;
+		ConstWeakArray<U32> m_indices;
+		Mat3x4 m_worldTransform;
+	};
+
+	DynamicArray<Occluder, MemoryPoolPtrWrapper<StackMemoryPool>> occluders(&m_framePool);
+	for(MeshComponent& comp : m_componentArrays.getMeshs())
+	{
+		if(!comp.isOccluder() || !comp.isValid())
+		{
+			continue;
+		}
+
+		Occluder occluder;
+		if(!comp.getMeshResource().getOccluderGeometry(occluder.m_positions, occluder.m_indices))
+		{
+			// Still loading
+			continue;
+		}
+
+		occluder.m_worldTransform = Mat3x4(comp.getSceneNode().getWorldTransform());
+		occluders.emplaceBack(occluder);
+	}
+
+	if(occluders.getSize() == 0)
+	{
+		// Nothing to occlude with, let the renderer use its own depth
+		return;
+	}
+
+	const CameraComponent& cam = m_mainCamNode->getFirstComponentOfType<CameraComponent>();
+	m_occlusionRasterizer.prepare(cam.getFrustum().getViewProjectionMatrix(), kOcclusionDepthSize.x, kOcclusionDepthSize.y);
+
+	TaskGraph graph(CoreThreadJobManager::getSingleton(), &m_framePool);
+
+	const TaskGraphTask drawTask =
+		graph.newParallelFor(0, occluders.getSize(), 4, [this, &occluders]([[maybe_unused]] U32 tid, U32 begin, U32 end) {
+			for(U32 i = begin; i < end; ++i)
+			{
+				const Occluder& occluder = occluders[i];
+				m_occlusionRasterizer.draw(occluder.m_positions, occluder.m_indices, occluder.m_worldTransform, true);
+			}
+		});
+
+	const TaskGraphTask tilesTask = graph.newParallelFor(
+		0, m_occlusionRasterizer.getTileCount(), 1,
+		[this]([[maybe_unused]] U32 tid, U32 begin, U32 end) {
+			for(U32 tile = begin; tile < end; ++tile)
+			{
+				m_occlusionRasterizer.rasterizeTile(tile);
+			}
+		},
+		{drawTask});
+
+	graph.newContinuation(tilesTask, [this]([[maybe_unused]] U32 tid) {
+		m_occlusionRasterizer.buildHierarchicalDepth();
+	});
+
+	graph.submit();
+	graph.wait();
+
+	m_occlusionRasterizerValid = true;
+}
+
 void SceneGraph::updateNode(U32 tid, SceneNode& node, UpdateSceneNodesCtx& ctx)
+{
+	if(ctx.m_skipSleepingNodes && node.m_subtreeUpdateRequestFrame.load() < m_frame)
+	{
+		// Nothing in this sub-tree asked for an update
+		g_svarSceneNodesSkipped.increment(1);
+		return;
+	}
+
+	if(!ctx.m_skipSleepingNodes || node.m_updateRequestFrame.load() >= m_frame)
+	{
+		updateSingleNode(tid, node, ctx);
+	}
+	else
+	{
+		g_svarSceneNodesSkipped.increment(1);
+	}
+
+	// Update children
+	const U32 childCount = node.m_children.getSize();
+	U32 inlineChildCount = childCount;
+	if(childCount > kChildNodeBatchSize)
+	{
+		// Too many children, update them in parallel. SceneGraph::update() waits for all the jobs so no need to wait here
+		inlineChildCount = kChildNodeBatchSize;
+		for(U32 begin = kChildNodeBatchSize; begin < childCount; begin += kChildNodeBatchSize)
+		{
+			const U32 end = min(childCount, begin + kChildNodeBatchSize);
+			CoreThreadJobManager::getSingleton().dispatchTask([this, &node, &ctx, begin, end](U32 tid) {
+				ANKI_TRACE_SCOPED_EVENT(SceneNodeUpdate);
+				for(U32 i = begin; i < end; ++i)
+				{
+					updateNode(tid, *node.m_children[i], ctx);
+				}
+			});
+		}
+	}
+
+	for(U32 i = 0; i < inlineChildCount; ++i)
+	{
+		updateNode(tid, *node.m_children[i], ctx);
+	}
+}
+
+void SceneGraph::updateSingleNode(U32 tid, SceneNode& node, UpdateSceneNodesCtx& ctx)
 {
 	ANKI_TRACE_FUNCTION();
 	ANKI_TRACE_INC_COUNTER(SceneNodeUpdated, 1);
@@ -390,10 +695,12 @@ void SceneGraph::updateNode(U32 tid, SceneNode& node, UpdateSceneNodesCtx& ctx)
 												 m_paused);
 	componentUpdateInfo.m_framePool = &m_framePool;
 	U32 sceneComponentUpdatedCount = 0;
+	Bool canSleep = node.m_canSleep;
 	node.iterateComponents([&](SceneComponent& comp) {
 		componentUpdateInfo.m_node = &node;
 		Bool updated = false;
 		comp.update(componentUpdateInfo, updated);
+		canSleep = canSleep && comp.canSleep();
 
 		if(updated)
 		{
@@ -463,54 +770,36 @@ void SceneGraph::updateNode(U32 tid, SceneNode& node, UpdateSceneNodesCtx& ctx)
 		}
 	}
 
-	// Update children
-	node.visitChildrenMaxDepth(0, [&](SceneNode& child) {
-		updateNode(tid, child, ctx);
-		return FunctorContinue::kContinue;
-	});
+	// Keep the node awake for one more frame if something changed because some components react to changes of the previous frame
+	if(!canSleep || sceneComponentUpdatedCount > 0 || node.isLocalTransformDirty())
+	{
+		node.requestUpdate(m_frame + 1);
+	}
 
 	ctx.m_perThread[tid].m_sceneMin = ctx.m_perThread[tid].m_sceneMin.min(componentUpdateInfo.m_sceneMin);
 	ctx.m_perThread[tid].m_sceneMax = ctx.m_perThread[tid].m_sceneMax.max(componentUpdateInfo.m_sceneMax);
 }
 
-void SceneGraph::updateNodes(U32 tid, UpdateSceneNodesCtx& ctx)
+void SceneGraph::updateNodes(U32 tid, U32 begin, U32 end, UpdateSceneNodesCtx& ctx)
 {
 	ANKI_TRACE_SCOPED_EVENT(SceneNodeUpdate);
 
-	while(1)
+	for(U32 i = begin; i < end; ++i)
 	{
-		// Fetch a batch of root scene nodes
-		constexpr U32 batchMaxSize = ANKI_CACHE_LINE_SIZE / sizeof(void*); // Read a cacheline worth of SceneNodeEntry
-		Array<SceneNode*, batchMaxSize> batch;
-		U32 batchSize = 0;
-
-		const U32 entryIndex = ctx.m_crntNodeIndex.fetchAdd(batchMaxSize);
-		if(entryIndex > ctx.m_lastNodeIndex)
+		if(!m_updatableNodes.indexExists(i))
 		{
-			break;
+			continue;
 		}
 
-		for(U32 i = entryIndex; i < min(entryIndex + batchMaxSize, ctx.m_lastNodeIndex + 1); ++i)
+		SceneNode& node = *m_updatableNodes[i];
+		ANKI_ASSERT(node.getParent() == nullptr);
+		if(node.isMarkedForDeletion()) [[unlikely]]
 		{
-			if(m_updatableNodes.indexExists(i))
-			{
-				batch[batchSize++] = m_updatableNodes[i];
-			}
+			ctx.m_perThread[tid].m_nodesForDeletion.emplaceBack(&node);
 		}
-
-		// Process nodes
-		for(U32 i = 0; i < batchSize; ++i)
+		else
 		{
-			SceneNode& node = *batch[i];
-			ANKI_ASSERT(node.getParent() == nullptr);
-			if(node.isMarkedForDeletion()) [[unlikely]]
-			{
-				ctx.m_perThread[tid].m_nodesForDeletion.emplaceBack(&node);
-			}
-			else
-			{
-				updateNode(tid, *batch[i], ctx);
-			}
+			updateNode(tid, node, ctx);
 		}
 	}
 }
@@ -570,11 +859,29 @@ Error SceneGraph::saveScene(CString filename, Scene& scene)
 
 	ANKI_LOGI("Saving scene: %s", filename.cstr());
 
-	File file;
-	ANKI_CHECK(file.open(filename, FileOpenFlag::kWrite));
+	if(getFileExtension(filename) == "ankiscenebin")
+	{
+		File file;
+		ANKI_CHECK(file.open(filename, FileOpenFlag::kWrite | FileOpenFlag::kBinary));
+		BinarySceneSerializer serializer(&file);
+		ANKI_CHECK(saveSceneInternal(serializer, scene));
+	}
+	else
+	{
+		File file;
+		ANKI_CHECK(file.open(filename, FileOpenFlag::kWrite));
+		TextSceneSerializer serializer(&file);
+		ANKI_CHECK(saveSceneInternal(serializer, scene));
+	}
+
+	const F64 timeDiffMs = F64(HighRezTimer::getCurrentTimeUs() - begin) / 1000.0;
+	ANKI_SCENE_LOGI("Saving scene finished. %fms", timeDiffMs);
 
-	TextSceneSerializer serializer(&file);
+	return Error::kNone;
+}
 
+Error SceneGraph::saveSceneInternal(SceneSerializer& serializer, Scene& scene)
+{
 	// Header
 	SceneString magic = "ANKISCEN";
 	ANKI_SERIALIZE(magic, 1);
@@ -681,9 +988,6 @@ Error SceneGraph::saveScene(CString filename, Scene& scene)
 	}
 #include <AnKi/Scene/Components/SceneComponentClasses.def.h>
 
-	const F64 timeDiffMs = F64(HighRezTimer::getCurrentTimeUs() - begin) / 1000.0;
-	ANKI_SCENE_LOGI("Saving scene finished. %fms", timeDiffMs);
-
 	return Error::kNone;
 }
 
@@ -718,39 +1022,119 @@ Error SceneGraph::loadScene(CString filepath, Scene*& scene)
 		return Error::kNone;
 	}
 
+	SceneLoader* loader;
+	ANKI_CHECK(beginSceneLoad(filepath, scene, loader));
+
+	Bool done;
+	const Error err = loadSceneSlice(*loader, kMaxSecond, done);
+	ANKI_ASSERT(err || done);
+	deleteInstance(SceneMemoryPool::getSingleton(), loader);
+	ANKI_CHECK(err);
+
+	ANKI_SCENE_LOGI("Loading scene finished. %fms", F64(HighRezTimer::getCurrentTimeUs() - begin) / 1000.0);
+	return Error::kNone;
+}
+
+Error SceneGraph::loadSceneAsync(CString filepath, Scene*& scene)
+{
+	ANKI_ASSERT(scene == nullptr);
+
+	ANKI_TRACE_FUNCTION();
+	forbidCallOnUpdate();
+
+	if(getFileExtension(filepath) == "lua")
+	{
+		// Can't slice a script
+		return loadScene(filepath, scene);
+	}
+
+	ANKI_LOGI("Loading scene incrementally: %s", filepath.cstr());
+
+	SceneLoader* loader;
+	ANKI_CHECK(beginSceneLoad(filepath, scene, loader));
+
+	scene->m_loading = true;
+	scene->m_loadingProgress = loader->m_serializer->getReadProgress();
+	m_sceneLoaders.emplaceBack(loader);
+
+	return Error::kNone;
+}
+
+Error SceneGraph::beginSceneLoad(CString filepath, Scene*& scene, SceneLoader*& loader)
+{
 	ResourceFilePtr file;
 	ANKI_CHECK(ResourceFilesystem::getSingleton().openFile(filepath, file));
 
-	TextSceneSerializer serializer(file.get());
+	loader = newInstance<SceneLoader>(SceneMemoryPool::getSingleton());
+	loader->m_file = std::move(file);
 
-	// Header
-	SceneString magic;
-	ANKI_SERIALIZE(magic, 1);
-	if(magic != "ANKISCEN")
+	if(getFileExtension(filepath) == "ankiscenebin")
 	{
-		ANKI_LOGE("Wrong magic value");
-		return Error::kUserData;
+		loader->m_serializer = newInstance<BinarySceneSerializer>(SceneMemoryPool::getSingleton(), loader->m_file.get());
+	}
+	else
+	{
+		loader->m_serializer = newInstance<TextSceneSerializer>(SceneMemoryPool::getSingleton(), loader->m_file.get());
 	}
 
-	U32 version = 0;
-	ANKI_SERIALIZE(version, 1);
-	if(version > kSceneBinaryVersion)
+	auto readHeader = [&]() -> Error {
+		SceneSerializer& serializer = *loader->m_serializer;
+
+		SceneString magic;
+		ANKI_SERIALIZE(magic, 1);
+		if(magic != "ANKISCEN")
+		{
+			ANKI_LOGE("Wrong magic value");
+			return Error::kUserData;
+		}
+
+		U32 version = 0;
+		ANKI_SERIALIZE(version, 1);
+		if(version > kSceneBinaryVersion)
+		{
+			ANKI_LOGE("Wrong version number");
+			return Error::kUserData;
+		}
+
+		U32 nodeCount = 0;
+		ANKI_SERIALIZE(nodeCount, 1);
+		loader->m_nodeCount = nodeCount;
+
+		return Error::kNone;
+	};
+
+	const Error err = readHeader();
+	if(err)
 	{
-		ANKI_LOGE("Wrong version number");
-		return Error::kUserData;
+		deleteInstance(SceneMemoryPool::getSingleton(), loader);
+		loader = nullptr;
+		return err;
 	}
 
 	scene = newEmptyScene(getBasename(filepath));
 	scene->m_filepath = filepath;
 	scene->m_canBeSaved = true;
+	loader->m_scene = scene;
 
-	// Scene nodes
-	SceneNode::SerializeCommonArgs serializationArgs;
-	U32 nodeCount = 0;
-	ANKI_SERIALIZE(nodeCount, 1);
+	return Error::kNone;
+}
+
+Error SceneGraph::loadSceneSlice(SceneLoader& loader, Second endTime, Bool& done)
+{
+	ANKI_TRACE_SCOPED_EVENT(SceneLoadSlice);
 
-	for(U32 i = 0; i < nodeCount; ++i)
+	SceneSerializer& serializer = *loader.m_serializer;
+	Scene& scene = *loader.m_scene;
+	done = false;
+
+	// Scene nodes
+	while(loader.m_loadedNodeCount < loader.m_nodeCount)
 	{
+		if(HighRezTimer::getCurrentTime() >= endTime)
+		{
+			return Error::kNone;
+		}
+
 		SceneString className;
 		ANKI_SERIALIZE(className, 1);
 
@@ -763,8 +1147,8 @@ Error SceneGraph::loadScene(CString filepath, Scene*& scene)
 		U32 uuid;
 		ANKI_SERIALIZE(uuid, 1);
 		initInf.m_nodeUuid = uuid;
-		initInf.m_sceneUuid = scene->m_sceneUuid;
-		initInf.m_sceneIndex = scene->m_arrayIndex;
+		initInf.m_sceneUuid = scene.m_sceneUuid;
+		initInf.m_sceneIndex = scene.m_arrayIndex;
 
 		SceneNode* node;
 		if(className != "SceneNode")
@@ -780,24 +1164,78 @@ Error SceneGraph::loadScene(CString filepath, Scene*& scene)
 		else
 		{
 			node = newInstance<SceneNode>(SceneMemoryPool::getSingleton(), initInf);
+			node->m_canSleep = true;
 		}
 
-		ANKI_CHECK(node->serializeCommon(serializer, serializationArgs));
+		node->m_sceneIndex = scene.m_arrayIndex;
+		node->m_sceneUuid = scene.m_sceneUuid;
+
+		// Register it before anything can fail so it will be cleaned up with the scene
+		m_deferredOps.m_nodesForRegistration.emplaceBack(node);
+		loader.m_serializationArgs.m_read.m_nodeUuidToNode.emplace(uuid, node);
+		++loader.m_loadedNodeCount;
+
+		ANKI_CHECK(node->serializeCommon(serializer, loader.m_serializationArgs));
 		ANKI_CHECK(node->serialize(serializer));
+	}
 
-		node->m_sceneIndex = scene->m_arrayIndex;
-		node->m_sceneUuid = scene->m_sceneUuid;
+	// Components. They are grouped by type and every group starts with the count
+	constexpr Array<Bool, U32(SceneComponentType::kCount)> kSerializable = {
+#define ANKI_DEFINE_SCENE_COMPONENT(name, weight, sceneNodeCanHaveMany, icon, serializable) serializable,
+#include <AnKi/Scene/Components/SceneComponentClasses.def.h>
+	};
 
-		m_deferredOps.m_nodesForRegistration.emplaceBack(node);
+	constexpr Array<const Char*, U32(SceneComponentType::kCount)> kCountNames = {
+#define ANKI_DEFINE_SCENE_COMPONENT(name, weight, sceneNodeCanHaveMany, icon, serializable) #name "Count",
+#include <AnKi/Scene/Components/SceneComponentClasses.def.h>
+	};
+
+	while(loader.m_componentType < SceneComponentType::kCount)
+	{
+		if(!kSerializable[loader.m_componentType])
+		{
+			++loader.m_componentType;
+			continue;
+		}
+
+		if(loader.m_componentCount == kMaxU32)
+		{
+			U32 count = 0;
+			ANKI_SERIALIZE_ALIAS(kCountNames[loader.m_componentType], count, 1);
+			loader.m_componentCount = count;
+			loader.m_loadedComponentCount = 0;
+		}
+
+		if(loader.m_loadedComponentCount == loader.m_componentCount)
+		{
+			++loader.m_componentType;
+			loader.m_componentCount = kMaxU32;
+			continue;
+		}
+
+		if(HighRezTimer::getCurrentTime() >= endTime)
+		{
+			return Error::kNone;
+		}
+
+		ANKI_CHECK(loadSceneComponent(loader));
+		++loader.m_loadedComponentCount;
 	}
 
-	// Components
+	done = true;
+	return Error::kNone;
+}
+
+Error SceneGraph::loadSceneComponent(SceneLoader& loader)
+{
+	SceneSerializer& serializer = *loader.m_serializer;
+
 	auto serializeComponent = [&](auto& compArray) -> Error {
 		U32 uuid;
 		ANKI_SERIALIZE(uuid, 1);
 
-		auto it2 = serializationArgs.m_read.m_componentUuidToNode.find(uuid);
-		if(it2 == serializationArgs.m_read.m_componentUuidToNode.getEnd())
+		auto it2 = loader.m_serializationArgs.m_read.m_componentUuidToNode.find(uuid);
+		if(it2 == loader.m_serializationArgs.m_read.m_componentUuidToNode.getEnd())
 		{
 			ANKI_SCENE_LOGE("Incorrect UUID");
 			return Error::kUserData;
@@ -806,7 +1244,7 @@ Error SceneGraph::loadScene(CString filepath, Scene*& scene)
 		SceneComponentInitInfo initInf;
 		initInf.m_node = *it2;
 		initInf.m_componentUuid = uuid;
-		initInf.m_sceneUuid = scene->m_sceneUuid;
+		initInf.m_sceneUuid = loader.m_scene->m_sceneUuid;
 
 		auto it = compArray.emplace(initInf);
 		SceneComponent& comp = *it;
@@ -818,22 +1256,74 @@ Error SceneGraph::loadScene(CString filepath, Scene*& scene)
 		return Error::kNone;
 	};
 
+	switch(loader.m_componentType)
+	{
 #define ANKI_DEFINE_SCENE_COMPONENT(name, weight, sceneNodeCanHaveMany, icon, serializable) \
-	if(serializable) \
-	{ \
-		U32 name##Count = 0; \
-		ANKI_SERIALIZE(name##Count, 1); \
-		for(U32 i = 0; i < name##Count; ++i) \
-		{ \
-			ANKI_CHECK(serializeComponent(SceneGraph::getSingleton().getComponentArrays().get##name##s())); \
-		} \
-	}
+	case SceneComponentType::k##name: \
+		return serializeComponent(m_componentArrays.get##name##s());
 #include <AnKi/Scene/Components/SceneComponentClasses.def.h>
+	default:
+		ANKI_ASSERT(0);
+	}
 
-	ANKI_SCENE_LOGI("Loading scene finished. %fms", F64(HighRezTimer::getCurrentTimeUs() - begin) / 1000.0);
 	return Error::kNone;
 }
 
+void SceneGraph::streamScenes()
+{
+	if(m_sceneLoaders.getSize() == 0) [[likely]]
+	{
+		return;
+	}
+
+	ANKI_TRACE_SCOPED_EVENT(SceneStreaming);
+
+	// All the loading scenes share the same budget. Serve them in order
+	const Second endTime = HighRezTimer::getCurrentTime() + g_cvarSceneStreamingLoadBudget / 1000.0;
+	while(m_sceneLoaders.getSize())
+	{
+		SceneLoader& loader = *m_sceneLoaders[0];
+		Scene& scene = *loader.m_scene;
+
+		Bool done = false;
+		const Error err = loadSceneSlice(loader, endTime, done);
+		scene.m_loadingProgress = (err || done) ? 1.0f : min(loader.m_serializer->getReadProgress(), 0.99f);
+
+		if(err)
+		{
+			ANKI_SCENE_LOGE("Failed to load scene. It's partially loaded: %s", scene.m_filepath.cstr());
+			scene.m_loadingFailed = true;
+		}
+		else if(done)
+		{
+			ANKI_SCENE_LOGI("Incremental loading of scene finished: %s", scene.m_filepath.cstr());
+		}
+		else
+		{
+			break;
+		}
+
+		scene.m_loading = false;
+		deleteInstance(SceneMemoryPool::getSingleton(), &loader);
+		m_sceneLoaders.erase(m_sceneLoaders.getBegin());
+	}
+}
+
+void SceneGraph::cancelSceneLoad(Scene& scene)
+{
+	for(U32 i = 0; i < m_sceneLoaders.getSize(); ++i)
+	{
+		if(m_sceneLoaders[i]->m_scene == &scene)
+		{
+			ANKI_SCENE_LOGI("Cancelling the loading of scene: %s", scene.m_filepath.cstr());
+			deleteInstance(SceneMemoryPool::getSingleton(), m_sceneLoaders[i]);
+			m_sceneLoaders.erase(m_sceneLoaders.getBegin() + i);
+			scene.m_loading = false;
+			break;
+		}
+	}
+}
+
 void SceneGraph::doDeferredOperations()
 {
 	// Register new nodes
@@ -857,6 +1347,8 @@ void SceneGraph::doDeferredOperations()
 		auto it = m_scenes[node->m_sceneIndex].m_nodes.emplace(node);
 		node->m_nodeArrayIndex = it.getArrayIndex();
 
+		m_transformStore.addHandle(node->m_transforms);
+
 		// Add to updatable
 		if(node->getParent() == nullptr)
 		{
@@ -927,8 +1419,16 @@ void SceneGraph::doDeferredOperations()
 			auto it = m_updatableNodes.emplace(child);
 			child->m_updatableNodesArrayIndex = it.getArrayIndex();
 		}
+
+		m_transformStore.setParent(child->m_transforms, (parent) ? &parent->m_transforms : nullptr);
+
+		// The world transform depends on the new parent. Also let the new parents know that there is something to update bellow them
+		child->markLocalTransformDirty();
 	}
 	m_deferredOps.m_nodesParentChanged.destroy();
+
+	// Re-sort the transforms if the hierarchy changed
+	m_transformStore.flushStructuralChanges();
 }
 
 Scene* SceneGraph::newEmptyScene(CString name)
@@ -986,6 +1486,11 @@ void SceneGraph::deleteScene(Scene* scene)
 		return;
 	}
 
+	if(scene->m_loading)
+	{
+		cancelSceneLoad(*scene);
+	}
+
 	if(scene->m_arrayIndex == m_activeSceneIndex)
 	{
 		m_activeSceneIndex = tryFindScene("_DefaultScene")->m_arrayIndex;
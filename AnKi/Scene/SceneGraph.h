@@ -11,6 +11,9 @@
 #include <AnKi/Util/HashMap.h>
 #include <AnKi/Util/BlockArray.h>
 #include <AnKi/Scene/Events/EventManager.h>
+#include <AnKi/Scene/AnimationPoseCache.h>
+#include <AnKi/Scene/SoftwareRasterizer.h>
+#include <AnKi/Scene/SpatialIndex.h>
 #include <AnKi/Resource/Common.h>
 #include <AnKi/Util/CVarSet.h>
 #include <AnKi/Core/Common.h>
@@ -19,6 +22,10 @@ namespace anki {
 
 ANKI_CVAR(NumericCVar<F32>, Scene, ProbeEffectiveDistance, 256.0f, 1.0f, kMaxF32, "How far various probes can render")
 ANKI_CVAR(NumericCVar<F32>, Scene, ProbeShadowEffectiveDistance, 32.0f, 1.0f, kMaxF32, "How far to render shadows for the various probes")
+ANKI_CVAR(BoolCVar, Scene, SkipSleepingNodes, true, "Skip the update of scene nodes and sub-trees that have nothing to do")
+ANKI_CVAR(NumericCVar<F32>, Scene, StreamingLoadBudget, 2.0f, 0.1f, 1000.0f, "Time in ms spent every frame for the scenes that load incrementally")
+ANKI_CVAR(BoolCVar, Scene, SoftwareOcclusionCulling, false,
+		  "Rasterize the occluder meshes on the CPU and use the depth for the occlusion culling of the main camera")
 
 // Gpu scene arrays
 ANKI_CVAR(NumericCVar<U32>, Scene, MinGpuSceneTransforms, 2 * 10 * 1024, 8, 100 * 1024, "The min number of transforms stored in the GPU scene")
@@ -124,6 +131,24 @@ public:
 		return m_sceneUuid;
 	}
 
+	// True while a scene that was loaded with SceneGraph::loadSceneAsync is still being populated.
+	Bool isLoading() const
+	{
+		return m_loading;
+	}
+
+	// How much of the scene is loaded. From 0 to 1.
+	F32 getLoadingProgress() const
+	{
+		return m_loadingProgress;
+	}
+
+	// The scene might be partially populated if the loading failed.
+	Bool loadingFailed() const
+	{
+		return m_loadingFailed;
+	}
+
 	ANKI_INTERNAL Bool canBeSaved() const
 	{
 		return m_canBeSaved;
@@ -148,9 +173,13 @@ private:
 
 	U8 m_arrayIndex = kMaxU8; // Index in SceneGraph::m_scenes
 
+	F32 m_loadingProgress = 1.0f;
+
 	Bool m_immutable : 1 = false; // Can't add or remove nodes from it
 	Bool m_canDelete : 1 = true;
 	Bool m_canBeSaved : 1 = false;
+	Bool m_loading : 1 = false;
+	Bool m_loadingFailed : 1 = false;
 };
 
 // The scene graph that  all the scene entities
@@ -171,6 +200,35 @@ public:
 		return m_framePool;
 	}
 
+	ANKI_INTERNAL AnimationPoseCache& getAnimationPoseCache()
+	{
+		return m_animationPoseCache;
+	}
+
+	// A BVH with the bounds of the renderables, lights and probes. While the scene is updating it reflects the previous frame.
+	const SpatialIndex& getSpatialIndex() const
+	{
+		return m_spatialIndex;
+	}
+
+	ANKI_INTERNAL SpatialIndex& getSpatialIndex()
+	{
+		return m_spatialIndex;
+	}
+
+	// Find the nodes that have renderables, lights or probes touching a sphere. The array is valid until the next update.
+	WeakArray<SceneNode*> findSceneNodesInSphere(Vec3 center, F32 radius) const;
+
+	// Find the nodes that have renderables, lights or probes a ray hits in [0, maxDistance]. The nodes are sorted from closest to furthest. The
+	// array is valid until the next update.
+	WeakArray<SceneNode*> findSceneNodesAlongRay(Vec3 origin, Vec3 direction, F32 maxDistance) const;
+
+	// The occluders of this frame rasterized from the point of view of the active camera. nullptr if the CPU occlusion culling didn't run.
+	ANKI_INTERNAL const SoftwareRasterizer* getOcclusionRasterizer() const
+	{
+		return (m_occlusionRasterizerValid) ? &m_occlusionRasterizer : nullptr;
+	}
+
 	SceneNode& getActiveCameraNode()
 	{
 		forbidCallOnUpdate();
@@ -230,6 +288,10 @@ public:
 
 	Error loadScene(CString filepath, Scene*& scene);
 
+	// Same as loadScene but it only reads the header. The nodes and components are created in the next frames in slices of
+	// Scene.StreamingLoadBudget. Use Scene::isLoading and Scene::getLoadingProgress to track it.
+	Error loadSceneAsync(CString filepath, Scene*& scene);
+
 	void deleteScene(Scene* scene);
 
 	U32 getSceneCount() const
@@ -306,6 +368,7 @@ public:
 			inf.m_sceneIndex = m_activeSceneIndex;
 			inf.m_sceneUuid = m_scenes[m_activeSceneIndex].m_sceneUuid;
 			node = newInstance<TNode>(SceneMemoryPool::getSingleton(), inf);
+			node->m_canSleep = std::is_same_v<TNode, SceneNode>; // Derived nodes may do work in update() so they never sleep
 			LockGuard lock(m_deferredOps.m_mtx);
 			m_deferredOps.m_nodesForRegistration.emplaceBack(node);
 		}
@@ -377,6 +440,8 @@ public:
 #endif
 
 private:
+	class SceneLoader;
+
 	class UpdateSceneNodesCtx;
 
 	class InitMemPoolDummy
@@ -389,9 +454,15 @@ private:
 	} m_initMemPoolDummy;
 
 	static constexpr U32 kForceSetSceneBoundsFrameCount = 60 * 2; // Re-set the scene bounds after 2".
+	static constexpr U32 kChildNodeBatchSize = 64; // Nodes with more children than that will update them in parallel
+	static constexpr UVec2 kOcclusionDepthSize{256, 128}; // The resolution of the CPU occlusion depth
 
 	mutable StackMemoryPool m_framePool;
 
+	AnimationPoseCache m_animationPoseCache{&m_framePool}; // Lives in the frame pool
+
+	SpatialIndex m_spatialIndex;
+
 	SceneBlockArray<Scene, BlockArrayConfig<4>> m_scenes;
 	U8 m_activeSceneIndex = 0;
 
@@ -406,6 +477,9 @@ private:
 
 	U64 m_frame = 0;
 
+	U32 m_unifiedGeometryBufferRelocationEpoch = 0;
+	U32 m_textureStreamingEpoch = 0;
+
 	Vec3 m_sceneMin = Vec3(-0.1f);
 	Vec3 m_sceneMax = Vec3(+0.1f);
 
@@ -419,6 +493,8 @@ private:
 		SpinLock m_mtx;
 	} m_deferredOps;
 
+	SceneDynamicArray<SceneLoader*> m_sceneLoaders; // Scenes that are loaded incrementally
+
 #if ANKI_WITH_EDITOR
 	Bool m_checkForResourceUpdates = false; // If true the components will have to re-check their resources for updates
 #endif
@@ -427,9 +503,14 @@ private:
 
 	SceneComponentArrays m_componentArrays;
 
+	SceneTransformStore m_transformStore;
+
 	LightComponent* m_activeDirLight = nullptr;
 	SkyboxComponent* m_activeSkybox = nullptr;
 
+	SoftwareRasterizer m_occlusionRasterizer;
+	Bool m_occlusionRasterizerValid = false;
+
 #if ANKI_ASSERTIONS_ENABLED
 	volatile Bool m_inUpdate = false;
 #endif
@@ -438,8 +519,14 @@ private:
 
 	~SceneGraph();
 
-	void updateNodes(U32 tid, UpdateSceneNodesCtx& ctx);
+	void updateNodes(U32 tid, U32 begin, U32 end, UpdateSceneNodesCtx& ctx);
 	void updateNode(U32 tid, SceneNode& node, UpdateSceneNodesCtx& ctx);
+	void updateSingleNode(U32 tid, SceneNode& node, UpdateSceneNodesCtx& ctx);
+
+	void rasterizeOccluders();
+
+	// Feed the texture streaming with the resolutions the visible materials need.
+	void requestTextureResolutions();
 
 	// Begin deferred operations //
 	void sceneNodeChangedNameDeferred(SceneNode& node, CString oldName)
@@ -459,6 +546,19 @@ private:
 
 	static void countSerializableNodes(SceneNode& root, U32& serializableNodeCount);
 
+	Error saveSceneInternal(SceneSerializer& serializer, Scene& scene);
+
+	Error beginSceneLoad(CString filepath, Scene*& scene, SceneLoader*& loader);
+
+	// Load nodes and components until the time is up or everything is loaded.
+	Error loadSceneSlice(SceneLoader& loader, Second endTime, Bool& done);
+
+	Error loadSceneComponent(SceneLoader& loader);
+
+	void streamScenes();
+
+	void cancelSceneLoad(Scene& scene);
+
 	void forbidCallOnUpdate() const
 	{
 		ANKI_ASSERT(!m_inUpdate && "Did a illegal function call from update()");
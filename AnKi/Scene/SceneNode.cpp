@@ -55,6 +55,7 @@ SceneNode::SceneNode(const SceneNodeInitInfo& inf)
 	: m_nodeUuid(inf.m_nodeUuid)
 	, m_sceneUuid(inf.m_sceneUuid)
 	, m_sceneIndex(U8(inf.m_sceneIndex))
+	, m_transforms(this)
 {
 	ANKI_ASSERT(m_nodeUuid > 0 && m_nodeUuid == inf.m_nodeUuid);
 	ANKI_ASSERT(m_sceneUuid > 0 && m_sceneUuid == inf.m_sceneUuid);
@@ -69,6 +70,11 @@ SceneNode::SceneNode(const SceneNodeInitInfo& inf)
 	newComponent<MoveComponent>();
 }
 
+void SceneComponent::markSceneNodeForUpdate()
+{
+	m_node->markForUpdate();
+}
+
 SceneNode::~SceneNode()
 {
 	for(SceneComponent* comp : m_components)
@@ -86,6 +92,11 @@ SceneNode::~SceneNode()
 			ANKI_ASSERT(0);
 		}
 	}
+
+	if(m_transforms.isInStore())
+	{
+		SceneGraph::getSingleton().m_transformStore.removeHandle(m_transforms);
+	}
 }
 
 void SceneNode::markForDeletion()
@@ -96,9 +107,32 @@ void SceneNode::markForDeletion()
 	});
 }
 
+void SceneNode::markForUpdate()
+{
+	// Request an update for the next frame as well. If the scene is updating right now the node might have been updated already
+	requestUpdate(SceneGraph::getSingleton().m_frame + 1);
+}
+
+void SceneNode::requestUpdate(U64 frame)
+{
+	m_updateRequestFrame.max(frame);
+
+	// Wake the path to the root. Stop early if a previous request already did that
+	for(SceneNode* node = this; node; node = node->m_parent)
+	{
+		if(node->m_subtreeUpdateRequestFrame.load() >= frame)
+		{
+			break;
+		}
+
+		node->m_subtreeUpdateRequestFrame.max(frame);
+	}
+}
+
 void SceneNode::addComponent(SceneComponent* newc)
 {
 	m_componentTypeMask |= 1 << SceneComponentTypeMask(newc->getType());
+	markForUpdate();
 
 	// Inform all other components that some component was added
 	for(SceneComponent* other : m_components)
@@ -131,41 +165,47 @@ void SceneNode::addComponent(SceneComponent* newc)
 
 Bool SceneNode::updateTransform()
 {
-	const Bool needsUpdate = m_localTransformDirty;
-	m_localTransformDirty = false;
-	const Bool updatedLastFrame = m_transformUpdatedThisFrame;
-	m_transformUpdatedThisFrame = needsUpdate;
+	SceneTransformFlag& flags = m_transforms.getFlags();
+	if(!(flags & SceneTransformFlag::kLocalDirty))
+	{
+		// Nothing changed since the SceneGraph propagated the transforms
+		return !!(flags & SceneTransformFlag::kMovedThisFrame);
+	}
 
-	if(needsUpdate || updatedLastFrame)
+	// Some component (eg script or physics) changed the local transform after the propagation. Re-compute the world
+	SceneTransforms& trfs = m_transforms.getTransforms();
+	if(!(flags & SceneTransformFlag::kMovedThisFrame))
 	{
-		m_prevWTrf = m_wtrf;
+		trfs.m_prevWorld = trfs.m_world;
 	}
 
-	// Update world transform
-	if(needsUpdate)
+	const SceneNode* parent = getParent();
+	if(parent == nullptr || !!(flags & SceneTransformFlag::kIgnoreParent))
 	{
-		const SceneNode* parent = getParent();
+		trfs.m_world = trfs.m_local;
+	}
+	else
+	{
+		trfs.m_world = parent->getWorldTransform().combineTransformations(trfs.m_local);
+	}
 
-		if(parent == nullptr || m_ignoreParentNodeTransform)
-		{
-			m_wtrf = m_ltrf;
-		}
-		else
-		{
-			m_wtrf = parent->getWorldTransform().combineTransformations(m_ltrf);
-		}
+	flags = (flags & ~SceneTransformFlag::kLocalDirty) | SceneTransformFlag::kMovedThisFrame;
 
-		// Make children dirty as well. Don't walk the whole tree because you will re-walk it later
-		visitChildrenMaxDepth(1, [](SceneNode& childNode) {
-			if(!childNode.m_ignoreParentNodeTransform)
-			{
-				childNode.m_localTransformDirty = true;
-			}
-			return FunctorContinue::kContinue;
-		});
-	}
+	// Make children dirty as well. Don't walk the whole tree because you will re-walk it later
+	markChildrenTransformDirty();
 
-	return needsUpdate;
+	return true;
+}
+
+void SceneNode::markChildrenTransformDirty()
+{
+	visitChildrenMaxDepth(1, [](SceneNode& childNode) {
+		if(!(childNode.m_transforms.getFlags() & SceneTransformFlag::kIgnoreParent))
+		{
+			childNode.markLocalTransformDirty();
+		}
+		return FunctorContinue::kContinue;
+	});
 }
 
 void SceneNode::setName(CString name)
@@ -180,17 +220,23 @@ Error SceneNode::serializeCommon(SceneSerializer& serializer, SerializeCommonArg
 	ANKI_ASSERT(m_serialize);
 
 	// Trf
-	Vec3 origin = m_ltrf.getOrigin().xyz;
+	Transform& ltrf = m_transforms.getTransforms().m_local;
+	Vec3 origin = ltrf.getOrigin().xyz;
 	ANKI_SERIALIZE(origin, 1);
-	m_ltrf.setOrigin(origin);
+	ltrf.setOrigin(origin);
 
-	Mat3 rotation = m_ltrf.getRotation().getRotationPart();
+	Mat3 rotation = ltrf.getRotation().getRotationPart();
 	ANKI_SERIALIZE(rotation, 1);
-	m_ltrf.setRotation(rotation);
+	ltrf.setRotation(rotation);
 
-	Vec3 scale = m_ltrf.getScale().xyz;
+	Vec3 scale = ltrf.getScale().xyz;
 	ANKI_SERIALIZE(scale, 1);
-	m_ltrf.setScale(scale);
+	ltrf.setScale(scale);
+
+	if(!serializer.isInWriteMode())
+	{
+		markLocalTransformDirty();
+	}
 
 	// Components
 	U32 componentCount = 0;
@@ -6,6 +6,7 @@
 #pragma once
 
 #include <AnKi/Scene/Components/SceneComponent.h>
+#include <AnKi/Scene/SceneTransformStore.h>
 #include <AnKi/Util/Hierarchy.h>
 #include <AnKi/Util/Enum.h>
 #include <AnKi/Util/DynamicBitSet.h>
@@ -185,6 +186,10 @@ public:
 
 	void markForDeletion();
 
+	// Nodes (and whole sub-trees) that have nothing to do are not updated by the scenegraph. Call this to have the node updated in the next
+	// scenegraph update. The transform setters and the setters of the components call it already.
+	void markForUpdate();
+
 	// Enable serialization for this node, its components and its children
 	void setSerialization(Bool enable)
 	{
@@ -435,131 +440,142 @@ public:
 	// Ignore parent nodes's transform.
 	void setIgnoreParentTransform(Bool ignore)
 	{
-		m_ignoreParentNodeTransform = ignore;
+		SceneTransformFlag& flags = m_transforms.getFlags();
+		flags = (ignore) ? (flags | SceneTransformFlag::kIgnoreParent) : (flags & ~SceneTransformFlag::kIgnoreParent);
 	}
 
 	const Transform& getLocalTransform() const
 	{
-		return m_ltrf;
+		return m_transforms.getTransforms().m_local;
 	}
 
 	void setLocalTransform(const Transform& x)
 	{
-		m_ltrf = x;
-		m_localTransformDirty = true;
+		m_transforms.getTransforms().m_local = x;
+		markLocalTransformDirty();
 	}
 
 	void setLocalOrigin(const Vec3& x)
 	{
-		m_ltrf.setOrigin(x);
-		m_localTransformDirty = true;
+		m_transforms.getTransforms().m_local.setOrigin(x);
+		markLocalTransformDirty();
 	}
 
 	Vec3 getLocalOrigin() const
 	{
-		return m_ltrf.getOrigin().xyz;
+		return getLocalTransform().getOrigin().xyz;
 	}
 
 	void setLocalRotation(const Mat3& x)
 	{
-		m_ltrf.setRotation(x);
-		m_localTransformDirty = true;
+		m_transforms.getTransforms().m_local.setRotation(x);
+		markLocalTransformDirty();
 	}
 
 	Mat3 getLocalRotation() const
 	{
-		return m_ltrf.getRotation().getRotationPart();
+		return getLocalTransform().getRotation().getRotationPart();
 	}
 
 	void setLocalScale(const Vec3& x)
 	{
-		m_ltrf.setScale(x);
-		m_localTransformDirty = true;
+		m_transforms.getTransforms().m_local.setScale(x);
+		markLocalTransformDirty();
 	}
 
 	Vec3 getLocalScale() const
 	{
-		return m_ltrf.getScale().xyz;
+		return getLocalTransform().getScale().xyz;
 	}
 
 	const Transform& getWorldTransform() const
 	{
-		return m_wtrf;
+		return m_transforms.getTransforms().m_world;
 	}
 
 	const Transform& getPreviousWorldTransform() const
 	{
-		return m_prevWTrf;
+		return m_transforms.getTransforms().m_prevWorld;
 	}
 
 	void rotateLocalX(F32 angleRad)
 	{
-		Mat3x4 r = m_ltrf.getRotation();
+		Transform& ltrf = m_transforms.getTransforms().m_local;
+		Mat3x4 r = ltrf.getRotation();
 		r.rotateXAxis(angleRad);
-		m_ltrf.setRotation(r);
-		m_localTransformDirty = true;
+		ltrf.setRotation(r);
+		markLocalTransformDirty();
 	}
 
 	void rotateLocalY(F32 angleRad)
 	{
-		Mat3x4 r = m_ltrf.getRotation();
+		Transform& ltrf = m_transforms.getTransforms().m_local;
+		Mat3x4 r = ltrf.getRotation();
 		r.rotateYAxis(angleRad);
-		m_ltrf.setRotation(r);
-		m_localTransformDirty = true;
+		ltrf.setRotation(r);
+		markLocalTransformDirty();
 	}
 
 	void rotateLocalZ(F32 angleRad)
 	{
-		Mat3x4 r = m_ltrf.getRotation();
+		Transform& ltrf = m_transforms.getTransforms().m_local;
+		Mat3x4 r = ltrf.getRotation();
 		r.rotateZAxis(angleRad);
-		m_ltrf.setRotation(r);
-		m_localTransformDirty = true;
+		ltrf.setRotation(r);
+		markLocalTransformDirty();
 	}
 
 	void moveLocalX(F32 distance)
 	{
-		Vec3 x_axis = m_ltrf.getRotation().getColumn(0);
-		m_ltrf.setOrigin(m_ltrf.getOrigin() + Vec4(x_axis, 0.0f) * distance);
-		m_localTransformDirty = true;
+		Transform& ltrf = m_transforms.getTransforms().m_local;
+		Vec3 x_axis = ltrf.getRotation().getColumn(0);
+		ltrf.setOrigin(ltrf.getOrigin() + Vec4(x_axis, 0.0f) * distance);
+		markLocalTransformDirty();
 	}
 
 	void moveLocalY(F32 distance)
 	{
-		Vec3 y_axis = m_ltrf.getRotation().getColumn(1);
-		m_ltrf.setOrigin(m_ltrf.getOrigin() + Vec4(y_axis, 0.0) * distance);
-		m_localTransformDirty = true;
+		Transform& ltrf = m_transforms.getTransforms().m_local;
+		Vec3 y_axis = ltrf.getRotation().getColumn(1);
+		ltrf.setOrigin(ltrf.getOrigin() + Vec4(y_axis, 0.0) * distance);
+		markLocalTransformDirty();
 	}
 
 	void moveLocalZ(F32 distance)
 	{
-		Vec3 z_axis = m_ltrf.getRotation().getColumn(2);
-		m_ltrf.setOrigin(m_ltrf.getOrigin() + Vec4(z_axis, 0.0) * distance);
-		m_localTransformDirty = true;
+		Transform& ltrf = m_transforms.getTransforms().m_local;
+		Vec3 z_axis = ltrf.getRotation().getColumn(2);
+		ltrf.setOrigin(ltrf.getOrigin() + Vec4(z_axis, 0.0) * distance);
+		markLocalTransformDirty();
 	}
 
 	void scale(F32 s)
 	{
-		m_ltrf.setScale(m_ltrf.getScale() * s);
-		m_localTransformDirty = true;
+		Transform& ltrf = m_transforms.getTransforms().m_local;
+		ltrf.setScale(ltrf.getScale() * s);
+		markLocalTransformDirty();
 	}
 
 	void lookAtPoint(const Vec4& point)
 	{
-		m_ltrf = m_ltrf.lookAt(point, Vec4::yAxis());
-		m_localTransformDirty = true;
+		Transform& ltrf = m_transforms.getTransforms().m_local;
+		ltrf = ltrf.lookAt(point, Vec4::yAxis());
+		markLocalTransformDirty();
 	}
 
 	Bool movedThisFrame() const
 	{
-		return m_transformUpdatedThisFrame;
+		return !!(m_transforms.getFlags() & SceneTransformFlag::kMovedThisFrame);
 	}
 
-	// Returns true if the transform got updated
+	// Re-computes the world transform if the local changed after the SceneGraph propagated the transforms. Returns true if the node moved
+	// this frame.
 	ANKI_INTERNAL Bool updateTransform();
 
+	// Returns true if the local transform changed since last frame
 	ANKI_INTERNAL Bool isLocalTransformDirty() const
 	{
-		return m_localTransformDirty;
+		return !!(m_transforms.getFlags() & (SceneTransformFlag::kLocalDirty | SceneTransformFlag::kLocalChangedThisFrame));
 	}
 
 	// End movement methods //
@@ -597,11 +613,9 @@ private:
 
 	// Flags
 	Bool m_markedForDeletion : 1 = false;
-	Bool m_localTransformDirty : 1 = true;
-	Bool m_ignoreParentNodeTransform : 1 = false;
-	Bool m_transformUpdatedThisFrame : 1 = true;
 	Bool m_serialize : 1 = true;
 	Bool m_updateOnPause : 1 = false;
+	Bool m_canSleep : 1 = false; // Set by the SceneGraph to nodes that don't do any work in update()
 
 	SceneNode* m_parent = nullptr;
 	SceneDynamicArray<SceneNode*> m_children;
@@ -612,12 +626,23 @@ private:
 
 	Timestamp m_maxComponentTimestamp = 0;
 
-	Transform m_ltrf = Transform::getIdentity(); // The transformation in local space
-	Transform m_wtrf = Transform::getIdentity(); // The transformation in world space (local combined with parent's transformation)
-	Transform m_prevWTrf = Transform::getIdentity(); // Keep the previous transformation for checking if it moved
+	Atomic<U64> m_updateRequestFrame = {0}; // The node will be updated up to that SceneGraph frame
+	Atomic<U64> m_subtreeUpdateRequestFrame = {0}; // Same as above but for the node or any of its children
+
+	SceneTransformHandle m_transforms; // The local, world and previous world transforms. They live in the SceneGraph's SceneTransformStore
 
 	void addComponent(SceneComponent* newc);
 
+	void requestUpdate(U64 frame);
+
+	void markChildrenTransformDirty();
+
+	void markLocalTransformDirty()
+	{
+		m_transforms.getFlags() |= SceneTransformFlag::kLocalDirty;
+		markForUpdate();
+	}
+
 	Error serializeCommon(SceneSerializer& serializer, SerializeCommonArgs& args);
 
 	// For the IntrusiveHierarchy interface
@@ -4,9 +4,22 @@
 // http://www.anki3d.org/LICENSE
 
 #include <AnKi/Scene/SceneSerializer.h>
+#include <AnKi/Util/Hash.h>
 
 namespace anki {
 
+constexpr U32 kBinarySceneSerializerVersion = 1;
+
+class BinarySceneSerializerHeader
+{
+public:
+	Array<Char, 8> m_magic;
+	U32 m_version;
+	U32 m_padding;
+};
+
+constexpr Array<Char, 8> kBinarySceneSerializerMagic = {'A', 'N', 'K', 'I', 'S', 'C', 'N', 'B'};
+
 Error SceneSerializer::write(CString name, ConstWeakArray<F64> values)
 {
 	Array<F32, 32> tmpArray;
@@ -41,7 +54,14 @@ Error SceneSerializer::read(CString name, WeakArray<F64> values)
 		ANKI_ASSERT(!"TODO");
 	}
 
-	return read(name, arr);
+	ANKI_CHECK(read(name, arr));
+
+	for(U32 i = 0; i < values.getSize(); ++i)
+	{
+		values[i] = arr[i];
+	}
+
+	return Error::kNone;
 }
 
 Error TextSceneSerializer::parseCurrentLine(SceneStringList& tokens, CString fieldName, U32 checkTokenCount)
@@ -80,4 +100,189 @@ Error TextSceneSerializer::parseCurrentLine(SceneStringList& tokens, CString fie
 	return Error::kNone;
 }
 
+BinarySceneSerializer::BinarySceneSerializer(ResourceFile* file)
+	: SceneSerializer(false)
+{
+	// Avoid the copy if the file is memory mapped
+	const PtrSize fileSize = file->getSize();
+	const U8* mapped = file->readMapped(fileSize);
+	if(mapped)
+	{
+		m_read.m_contents = {mapped, fileSize};
+	}
+	else if(fileSize > kMaxU32)
+	{
+		ANKI_SCENE_LOGE("Binary scene is too large to be read: %zu bytes", fileSize);
+		return; // The contents stay empty so all the reads fail
+	}
+	else
+	{
+		m_read.m_data.resize(U32(fileSize));
+		if(file->read(m_read.m_data.getBegin(), fileSize))
+		{
+			ANKI_SCENE_LOGE("Failed to read the binary scene");
+			m_read.m_data.destroy();
+			return; // The contents stay empty so all the reads fail
+		}
+
+		m_read.m_contents = {m_read.m_data.getBegin(), fileSize};
+	}
+
+	BinarySceneSerializerHeader header;
+	if(readBytes(&header, sizeof(header)) || header.m_magic != kBinarySceneSerializerMagic || header.m_version != kBinarySceneSerializerVersion)
+	{
+		ANKI_SCENE_LOGE("Wrong binary scene header");
+
+		// Make all the reads fail
+		m_read.m_offset = m_read.m_contents.getSize();
+	}
+}
+
+Error BinarySceneSerializer::writeRecord(CString name, RecordType type, U32 count, const void* payload, PtrSize payloadSize)
+{
+	File& file = *m_write.m_file;
+
+	if(!m_write.m_headerWritten)
+	{
+		BinarySceneSerializerHeader header = {};
+		header.m_magic = kBinarySceneSerializerMagic;
+		header.m_version = kBinarySceneSerializerVersion;
+		ANKI_CHECK(file.write(&header, sizeof(header)));
+		m_write.m_headerWritten = true;
+	}
+
+	// Name
+	const U64 nameHash = computeHash(name.cstr(), name.getLength());
+	auto it = m_write.m_nameHashToIndex.find(nameHash);
+	if(it != m_write.m_nameHashToIndex.getEnd())
+	{
+		ANKI_ASSERT(m_write.m_names[*it] == name && "Hash collision");
+		ANKI_CHECK(file.write(&(*it), sizeof(U32)));
+	}
+	else
+	{
+		const U32 nameIdx = m_write.m_names.getSize();
+		m_write.m_names.emplaceBack(name);
+		m_write.m_nameHashToIndex.emplace(nameHash, nameIdx);
+
+		const U32 nameSize = name.getLength() + 1; // Store the terminator as well so the reader can point to the name
+		ANKI_CHECK(file.write(&nameIdx, sizeof(nameIdx)));
+		ANKI_CHECK(file.write(&nameSize, sizeof(nameSize)));
+		ANKI_CHECK(file.write(name.cstr(), nameSize));
+	}
+
+	// Header and payload
+	ANKI_CHECK(file.write(&type, sizeof(type)));
+	ANKI_CHECK(file.write(&count, sizeof(count)));
+	if(payloadSize)
+	{
+		ANKI_CHECK(file.write(payload, payloadSize));
+	}
+
+	return Error::kNone;
+}
+
+Error BinarySceneSerializer::readBytes(void* out, PtrSize size)
+{
+	if(m_read.m_offset + size > m_read.m_contents.getSize())
+	{
+		ANKI_SCENE_LOGE("Reading past the end of the file");
+		return Error::kUserData;
+	}
+
+	memcpy(out, &m_read.m_contents[m_read.m_offset], size);
+	m_read.m_offset += size;
+	return Error::kNone;
+}
+
+Error BinarySceneSerializer::readRecordHeader(CString name, RecordType type, U32& count, const U8*& payload)
+{
+	U32 nameIdx;
+	ANKI_CHECK(readBytes(&nameIdx, sizeof(nameIdx)));
+
+	if(nameIdx == m_read.m_names.getSize())
+	{
+		// New name
+		U32 nameSize;
+		ANKI_CHECK(readBytes(&nameSize, sizeof(nameSize)));
+
+		if(nameSize == 0 || m_read.m_offset + nameSize > m_read.m_contents.getSize()
+		   || m_read.m_contents[m_read.m_offset + nameSize - 1] != '\0')
+		{
+			ANKI_SCENE_LOGE("Corrupted field name. Offset %zu", m_read.m_offset);
+			return Error::kUserData;
+		}
+
+		m_read.m_names.emplaceBack(reinterpret_cast<const Char*>(&m_read.m_contents[m_read.m_offset]));
+		m_read.m_offset += nameSize;
+	}
+	else if(nameIdx > m_read.m_names.getSize())
+	{
+		ANKI_SCENE_LOGE("Corrupted field name index. Offset %zu", m_read.m_offset);
+		return Error::kUserData;
+	}
+
+	if(m_read.m_names[nameIdx] != name)
+	{
+		ANKI_SCENE_LOGE("Wrong field. Got: %s, expecting: %s", m_read.m_names[nameIdx].cstr(), name.cstr());
+		return Error::kUserData;
+	}
+
+	RecordType recordType;
+	ANKI_CHECK(readBytes(&recordType, sizeof(recordType)));
+	if(recordType != type)
+	{
+		ANKI_SCENE_LOGE("Wrong type for field: %s", name.cstr());
+		return Error::kUserData;
+	}
+
+	ANKI_CHECK(readBytes(&count, sizeof(count)));
+
+	const PtrSize payloadSize = (type == RecordType::kString) ? count : PtrSize(count) * sizeof(U32);
+	if(m_read.m_offset + payloadSize > m_read.m_contents.getSize())
+	{
+		ANKI_SCENE_LOGE("Reading past the end of the file");
+		return Error::kUserData;
+	}
+
+	payload = &m_read.m_contents[m_read.m_offset];
+	m_read.m_offset += payloadSize;
+
+	return Error::kNone;
+}
+
+Error BinarySceneSerializer::readRecord(CString name, RecordType type, U32 count, void* payload, PtrSize payloadSize)
+{
+	U32 recordCount;
+	const U8* recordPayload;
+	ANKI_CHECK(readRecordHeader(name, type, recordCount, recordPayload));
+
+	if(recordCount != count)
+	{
+		ANKI_SCENE_LOGE("Incorrect number of elements for field: %s", name.cstr());
+		return Error::kUserData;
+	}
+
+	memcpy(payload, recordPayload, payloadSize);
+	return Error::kNone;
+}
+
+Error BinarySceneSerializer::read(CString name, SceneString& value)
+{
+	U32 length;
+	const U8* chars;
+	ANKI_CHECK(readRecordHeader(name, RecordType::kString, length, chars));
+
+	if(length)
+	{
+		value = SceneString(reinterpret_cast<const Char*>(chars), reinterpret_cast<const Char*>(chars) + length);
+	}
+	else
+	{
+		value = "";
+	}
+
+	return Error::kNone;
+}
+
 } // end namespace anki
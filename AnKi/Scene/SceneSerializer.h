@@ -39,6 +39,11 @@ public:
 	{
 	}
 
+	virtual ~SceneSerializer() = default;
+
+	// How much of the input was consumed. From 0 to 1. Only for read mode
+	virtual F32 getReadProgress() const = 0;
+
 	virtual Error write(CString name, ConstWeakArray<U32> values) = 0;
 	virtual Error read(CString name, WeakArray<U32> values) = 0;
 
@@ -218,6 +223,12 @@ public:
 
 		m_read.m_lines.splitString(txt, '\n');
 		m_read.m_linesIt = m_read.m_lines.getBegin();
+		m_read.m_lineCount = U32(m_read.m_lines.getSize());
+	}
+
+	F32 getReadProgress() const final
+	{
+		return (m_read.m_lineCount) ? F32(m_read.m_lineno) / F32(m_read.m_lineCount) : 1.0f;
 	}
 
 	Error write(CString name, ConstWeakArray<U32> values) final
@@ -352,9 +363,108 @@ private:
 		SceneStringList m_lines;
 		SceneStringList::Iterator m_linesIt;
 		U32 m_lineno = 0;
+		U32 m_lineCount = 0;
 	} m_read;
 
 	Error parseCurrentLine(SceneStringList& tokens, CString fieldName, U32 checkTokenCount = kMaxU32);
 };
 
+// Serialize in a binary format. It stores the same fields in the same order as TextSceneSerializer so a scene can be converted from one format
+// to the other by loading and saving it. The layout is:
+// - A BinarySceneSerializerHeader
+// - A number of records. Every record starts with the index of the field name in the name table, then the type and the number of elements (or
+//   the number of chars for strings) follow. The payload comes after that. The first time a name appears its index is equal to the size of the
+//   name table and the name itself (length and chars) is stored between the index and the type
+class BinarySceneSerializer : public SceneSerializer
+{
+public:
+	// Write mode
+	BinarySceneSerializer(File* file)
+		: SceneSerializer(true)
+	{
+		m_write.m_file = file;
+	}
+
+	// Read mode
+	BinarySceneSerializer(ResourceFile* file);
+
+	F32 getReadProgress() const final
+	{
+		return (m_read.m_contents.getSize()) ? F32(F64(m_read.m_offset) / F64(m_read.m_contents.getSize())) : 1.0f;
+	}
+
+	Error write(CString name, ConstWeakArray<U32> values) final
+	{
+		return writeRecord(name, RecordType::kU32, values.getSize(), values.getBegin(), values.getSizeInBytes());
+	}
+
+	Error read(CString name, WeakArray<U32> values) final
+	{
+		return readRecord(name, RecordType::kU32, values.getSize(), values.getBegin(), values.getSizeInBytes());
+	}
+
+	Error write(CString name, ConstWeakArray<I32> values) final
+	{
+		return writeRecord(name, RecordType::kI32, values.getSize(), values.getBegin(), values.getSizeInBytes());
+	}
+
+	Error read(CString name, WeakArray<I32> values) final
+	{
+		return readRecord(name, RecordType::kI32, values.getSize(), values.getBegin(), values.getSizeInBytes());
+	}
+
+	Error write(CString name, ConstWeakArray<F32> values) final
+	{
+		return writeRecord(name, RecordType::kF32, values.getSize(), values.getBegin(), values.getSizeInBytes());
+	}
+
+	Error read(CString name, WeakArray<F32> values) final
+	{
+		return readRecord(name, RecordType::kF32, values.getSize(), values.getBegin(), values.getSizeInBytes());
+	}
+
+	Error write(CString name, CString value) final
+	{
+		return writeRecord(name, RecordType::kString, value.getLength(), value.cstr(), value.getLength());
+	}
+
+	Error read(CString name, SceneString& value) final;
+
+private:
+	enum class RecordType : U8
+	{
+		kU32,
+		kI32,
+		kF32,
+		kString
+	};
+
+	class
+	{
+	public:
+		File* m_file = nullptr;
+		SceneDynamicArray<SceneString> m_names;
+		SceneHashMap<U64, U32> m_nameHashToIndex;
+		Bool m_headerWritten = false;
+	} m_write;
+
+	class
+	{
+	public:
+		SceneDynamicArray<U8> m_data; // The file contents if the file is not memory mapped
+		ConstWeakArray<U8, PtrSize> m_contents;
+		PtrSize m_offset = 0;
+		SceneDynamicArray<CString> m_names; // Points to m_contents
+	} m_read;
+
+	Error writeRecord(CString name, RecordType type, U32 count, const void* payload, PtrSize payloadSize);
+
+	Error readRecord(CString name, RecordType type, U32 count, void* payload, PtrSize payloadSize);
+
+	// Read the name and the header of the next record and return a pointer to its payload
+	Error readRecordHeader(CString name, RecordType type, U32& count, const U8*& payload);
+
+	Error readBytes(void* out, PtrSize size);
+};
+
 } // end namespace anki
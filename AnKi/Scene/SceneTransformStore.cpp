@@ -0,0 +1,256 @@
+// Copyright (C) 2009-present, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <AnKi/Scene/SceneTransformStore.h>
+#include <AnKi/Util/Tracer.h>
+#include <bit>
+
+namespace anki {
+
+SceneTransformHandle::SceneTransformHandle(void* userData)
+	: m_userData(userData)
+{
+	m_transforms = newInstance<SceneTransforms>(SceneMemoryPool::getSingleton());
+	m_flags = &m_detachedFlags;
+}
+
+SceneTransformHandle::~SceneTransformHandle()
+{
+	ANKI_ASSERT(!isInStore() && "Need to remove it from the store first");
+	if(m_transforms)
+	{
+		deleteInstance(SceneMemoryPool::getSingleton(), m_transforms);
+	}
+}
+
+SceneTransformStore::~SceneTransformStore()
+{
+	ANKI_ASSERT(getSize() == 0 && "Forgot to remove some handles");
+}
+
+void SceneTransformStore::addHandle(SceneTransformHandle& handle)
+{
+	ANKI_ASSERT(!handle.isInStore() && handle.m_transforms);
+
+	const SceneTransforms* oldTransforms = m_transforms.getBegin();
+	const SceneTransformFlag* oldFlags = m_flags.getBegin();
+
+	const U32 idx = m_flags.getSize();
+	m_flags.emplaceBack(handle.m_detachedFlags & ~SceneTransformFlag::kFree);
+	m_parents.emplaceBack(kMaxU32);
+	m_transforms.emplaceBack(*handle.m_transforms);
+	m_handles.emplaceBack(&handle);
+
+	deleteInstance(SceneMemoryPool::getSingleton(), handle.m_transforms);
+	handle.m_index = idx;
+
+	if(m_transforms.getBegin() != oldTransforms || m_flags.getBegin() != oldFlags)
+	{
+		// Storage moved, all the handles need to be updated
+		updateHandlePointers(0, idx + 1);
+	}
+	else
+	{
+		updateHandlePointers(idx, idx + 1);
+	}
+}
+
+void SceneTransformStore::removeHandle(SceneTransformHandle& handle)
+{
+	ANKI_ASSERT(handle.isInStore());
+	const U32 idx = handle.m_index;
+	ANKI_ASSERT(m_handles[idx] == &handle);
+
+	m_flags[idx] = SceneTransformFlag::kFree;
+	m_parents[idx] = kMaxU32;
+	m_handles[idx] = nullptr;
+	++m_freeCount;
+
+	// The handle is not usable after that
+	handle.m_transforms = nullptr;
+	handle.m_flags = nullptr;
+	handle.m_index = kMaxU32;
+}
+
+void SceneTransformStore::setParent(SceneTransformHandle& handle, const SceneTransformHandle* parent)
+{
+	ANKI_ASSERT(handle.isInStore());
+	ANKI_ASSERT(!parent || parent->isInStore());
+
+	const U32 parentIdx = (parent) ? parent->m_index : kMaxU32;
+	m_parents[handle.m_index] = parentIdx;
+
+	if(parentIdx != kMaxU32 && parentIdx > handle.m_index)
+	{
+		m_needsResort = true;
+	}
+}
+
+void SceneTransformStore::flushStructuralChanges()
+{
+	constexpr U32 kMinFreeCountToCompact = 1024;
+	const U32 oldCount = m_flags.getSize();
+	if(!m_needsResort && (m_freeCount < kMinFreeCountToCompact || m_freeCount < oldCount / 4))
+	{
+		return;
+	}
+
+	ANKI_TRACE_SCOPED_EVENT(SceneTransformStoreResort);
+
+	// Compute the depth of every element. The parents might not be placed before the children so walk up until a known depth is found
+	auto getParent = [this](U32 idx) {
+		const U32 parent = m_parents[idx];
+		return (parent == kMaxU32 || !!(m_flags[parent] & SceneTransformFlag::kFree)) ? kMaxU32 : parent;
+	};
+
+	constexpr U32 kUnknownDepth = kMaxU32;
+	SceneDynamicArray<U32> depths;
+	depths.resize(oldCount, kUnknownDepth);
+	U32 maxDepth = 0;
+	for(U32 i = 0; i < oldCount; ++i)
+	{
+		if(!!(m_flags[i] & SceneTransformFlag::kFree) || depths[i] != kUnknownDepth)
+		{
+			continue;
+		}
+
+		U32 top = i;
+		U32 chainLength = 0;
+		U32 topDepth = 0;
+		while(true)
+		{
+			const U32 parent = getParent(top);
+			if(parent == kMaxU32)
+			{
+				break;
+			}
+			else if(depths[parent] != kUnknownDepth)
+			{
+				topDepth = depths[parent] + 1;
+				break;
+			}
+
+			top = parent;
+			++chainLength;
+		}
+
+		U32 depth = topDepth + chainLength;
+		maxDepth = max(maxDepth, depth);
+		for(U32 crnt = i; crnt != top; crnt = getParent(crnt))
+		{
+			depths[crnt] = depth--;
+		}
+		depths[top] = topDepth;
+	}
+
+	// Stable counting sort based on the depth
+	SceneDynamicArray<U32> depthOffsets;
+	depthOffsets.resize(maxDepth + 2, 0);
+	for(U32 i = 0; i < oldCount; ++i)
+	{
+		if(!(m_flags[i] & SceneTransformFlag::kFree))
+		{
+			++depthOffsets[depths[i] + 1];
+		}
+	}
+
+	for(U32 d = 1; d < depthOffsets.getSize(); ++d)
+	{
+		depthOffsets[d] += depthOffsets[d - 1];
+	}
+
+	const U32 newCount = oldCount - m_freeCount;
+	SceneDynamicArray<U32> oldToNew;
+	oldToNew.resize(oldCount, kMaxU32);
+	for(U32 i = 0; i < oldCount; ++i)
+	{
+		if(!(m_flags[i] & SceneTransformFlag::kFree))
+		{
+			oldToNew[i] = depthOffsets[depths[i]]++;
+		}
+	}
+
+	// Move the data
+	SceneDynamicArray<SceneTransformFlag> newFlags;
+	SceneDynamicArray<U32> newParents;
+	SceneDynamicArray<SceneTransforms> newTransforms;
+	SceneDynamicArray<SceneTransformHandle*> newHandles;
+	newFlags.resize(newCount);
+	newParents.resize(newCount);
+	newTransforms.resize(newCount);
+	newHandles.resize(newCount);
+	for(U32 i = 0; i < oldCount; ++i)
+	{
+		const U32 n = oldToNew[i];
+		if(n == kMaxU32)
+		{
+			continue;
+		}
+
+		const U32 parent = m_parents[i];
+		newFlags[n] = m_flags[i];
+		newParents[n] = (parent == kMaxU32) ? kMaxU32 : oldToNew[parent];
+		newTransforms[n] = m_transforms[i];
+		newHandles[n] = m_handles[i];
+		ANKI_ASSERT(newParents[n] == kMaxU32 || newParents[n] < n);
+	}
+
+	m_flags = std::move(newFlags);
+	m_parents = std::move(newParents);
+	m_transforms = std::move(newTransforms);
+	m_handles = std::move(newHandles);
+	m_freeCount = 0;
+	m_needsResort = false;
+
+	updateHandlePointers(0, newCount);
+}
+
+void SceneTransformStore::updateHandlePointers(U32 begin, U32 end)
+{
+	for(U32 i = begin; i < end; ++i)
+	{
+		SceneTransformHandle* handle = m_handles[i];
+		if(handle)
+		{
+			handle->m_transforms = &m_transforms[i];
+			handle->m_flags = &m_flags[i];
+			handle->m_index = i;
+		}
+	}
+}
+
+U32 SceneTransformStore::findNextPendingWork(U32 begin) const
+{
+	const U32 count = m_flags.getSize();
+	U32 i = begin;
+
+#if ANKI_SIMD_SSE
+	// Check 16 flags at a time
+	const U8* flags = reinterpret_cast<const U8*>(m_flags.getBegin());
+	const __m128i pendingWorkMask = _mm_set1_epi8(I8(SceneTransformFlag::kPendingWork));
+	const __m128i zero = _mm_setzero_si128();
+	for(; i + 16 <= count; i += 16)
+	{
+		const __m128i pending = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(flags + i)), pendingWorkMask);
+		const U32 hasWork = U32(_mm_movemask_epi8(_mm_cmpeq_epi8(pending, zero))) ^ 0xFFFFu;
+		if(hasWork)
+		{
+			return i + U32(std::countr_zero(hasWork));
+		}
+	}
+#endif
+
+	for(; i < count; ++i)
+	{
+		if(!!(m_flags[i] & SceneTransformFlag::kPendingWork))
+		{
+			return i;
+		}
+	}
+
+	return count;
+}
+
+} // end namespace anki
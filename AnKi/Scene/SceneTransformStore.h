@@ -0,0 +1,169 @@
+// Copyright (C) 2009-present, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#pragma once
+
+#include <AnKi/Scene/Common.h>
+#include <AnKi/Math.h>
+
+namespace anki {
+
+enum class SceneTransformFlag : U8
+{
+	kNone = 0,
+	kLocalDirty = 1 << 0, // The local transform changed and the world needs to be re-computed
+	kMovedThisFrame = 1 << 1, // The world transform changed this frame
+	kIgnoreParent = 1 << 2, // The world transform is the local transform
+	kFree = 1 << 3, // The slot in the store is not used
+	kLocalChangedThisFrame = 1 << 4, // The local transform was dirty when the transforms got propagated this frame
+
+	kPendingWork = kLocalDirty | kMovedThisFrame // The free slots are not work so the scan skips them
+};
+ANKI_ENUM_ALLOW_NUMERIC_OPERATIONS(SceneTransformFlag)
+
+// The transforms of a single object.
+class SceneTransforms
+{
+public:
+	Transform m_local = Transform::getIdentity();
+	Transform m_world = Transform::getIdentity(); // The local combined with the parent's world
+	Transform m_prevWorld = Transform::getIdentity(); // The world transform of the previous frame
+};
+
+// It points to the transforms of an object. Until the handle is added to a SceneTransformStore the transforms live in a separate allocation.
+// The store moves things around so don't keep pointers to the transforms for longer than a frame.
+class SceneTransformHandle
+{
+	friend class SceneTransformStore;
+
+public:
+	SceneTransformHandle(void* userData = nullptr);
+
+	SceneTransformHandle(const SceneTransformHandle&) = delete; // Non-copyable
+
+	~SceneTransformHandle();
+
+	SceneTransformHandle& operator=(const SceneTransformHandle&) = delete; // Non-copyable
+
+	SceneTransforms& getTransforms() const
+	{
+		return *m_transforms;
+	}
+
+	SceneTransformFlag& getFlags() const
+	{
+		return *m_flags;
+	}
+
+	void* getUserData() const
+	{
+		return m_userData;
+	}
+
+	Bool isInStore() const
+	{
+		return m_index != kMaxU32;
+	}
+
+private:
+	SceneTransforms* m_transforms = nullptr;
+	SceneTransformFlag* m_flags = nullptr;
+	void* m_userData = nullptr;
+	U32 m_index = kMaxU32; // Index in the store
+	SceneTransformFlag m_detachedFlags = SceneTransformFlag::kLocalDirty | SceneTransformFlag::kMovedThisFrame;
+};
+
+// Keeps the transforms of the scene in contiguous arrays (flags, parents and transforms are separate arrays) sorted so that the parents are
+// always placed before their children. That way the world transforms can be propagated with a single linear pass that mostly scans the flags.
+// Structural changes (add, remove, re-parent) are not thread-safe, the rest is.
+class SceneTransformStore
+{
+public:
+	SceneTransformStore() = default;
+
+	SceneTransformStore(const SceneTransformStore&) = delete; // Non-copyable
+
+	~SceneTransformStore();
+
+	SceneTransformStore& operator=(const SceneTransformStore&) = delete; // Non-copyable
+
+	// Move the transforms of the handle to the store. The new object has no parent.
+	void addHandle(SceneTransformHandle& handle);
+
+	// Free the slot of the handle. The transforms are lost and the handle can't be used after that.
+	void removeHandle(SceneTransformHandle& handle);
+
+	void setParent(SceneTransformHandle& handle, const SceneTransformHandle* parent);
+
+	// Needs to be called after the structural changes and before updateWorldTransforms(). Re-sorts and compacts the arrays if needed.
+	void flushStructuralChanges();
+
+	// Compute the world transforms of everything that has a dirty local transform. For every object that moved the func is called and it may
+	// mark children as dirty (their local transform didn't change but the parent's world did).
+	template<typename TFunc>
+	void updateWorldTransforms(TFunc func);
+
+	U32 getSize() const
+	{
+		return m_flags.getSize() - m_freeCount;
+	}
+
+private:
+	SceneDynamicArray<SceneTransformFlag> m_flags;
+	SceneDynamicArray<U32> m_parents;
+	SceneDynamicArray<SceneTransforms> m_transforms;
+	SceneDynamicArray<SceneTransformHandle*> m_handles;
+
+	U32 m_freeCount = 0;
+	Bool m_needsResort = false; // Some objects are placed before their parents
+
+	void updateHandlePointers(U32 begin, U32 end);
+
+	// Skip the elements that have nothing to do
+	U32 findNextPendingWork(U32 begin) const;
+};
+
+template<typename TFunc>
+void SceneTransformStore::updateWorldTransforms(TFunc func)
+{
+	ANKI_ASSERT(!m_needsResort && "Forgot to call flushStructuralChanges()");
+
+	const U32 count = m_flags.getSize();
+	for(U32 i = findNextPendingWork(0); i < count; i = findNextPendingWork(i + 1))
+	{
+		SceneTransformFlag& flags = m_flags[i];
+		ANKI_ASSERT(!(flags & SceneTransformFlag::kFree));
+
+		SceneTransforms& trfs = m_transforms[i];
+		const Bool moved = !!(flags & SceneTransformFlag::kLocalDirty);
+
+		// The previous world transform needs to catch up if it moved last frame
+		trfs.m_prevWorld = trfs.m_world;
+
+		if(moved)
+		{
+			const U32 parent = m_parents[i];
+			if(parent == kMaxU32 || !!(flags & SceneTransformFlag::kIgnoreParent))
+			{
+				trfs.m_world = trfs.m_local;
+			}
+			else
+			{
+				ANKI_ASSERT(parent < i);
+				trfs.m_world = m_transforms[parent].m_world.combineTransformations(trfs.m_local);
+			}
+
+			flags = (flags & ~SceneTransformFlag::kLocalDirty) | SceneTransformFlag::kMovedThisFrame | SceneTransformFlag::kLocalChangedThisFrame;
+
+			func(*m_handles[i]);
+		}
+		else
+		{
+			flags &= ~(SceneTransformFlag::kMovedThisFrame | SceneTransformFlag::kLocalChangedThisFrame);
+		}
+	}
+}
+
+} // end namespace anki
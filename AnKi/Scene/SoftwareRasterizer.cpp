@@ -5,399 +5,581 @@
 
 #include <AnKi/Scene/SoftwareRasterizer.h>
 #include <AnKi/Collision/Aabb.h>
-#include <AnKi/Collision/Functions.h>
+#include <AnKi/Math/Simd.h>
 #include <AnKi/Util/Tracer.h>
 
 namespace anki {
 
-void SoftwareRasterizer::prepare(const Mat4& mv, const Mat4& p, U32 width, U32 height)
+namespace {
+
+// Just enough 4-wide SIMD for the rasterizer
+class F32x4
 {
-	m_mv = mv;
-	m_p = p;
-	m_mvp = p * mv;
+public:
+#if ANKI_SIMD_SSE
+	__m128 m_v;
 
-	extractClipPlanes(p, m_planesL);
-	extractClipPlanes(m_mvp, m_planesW);
+	static F32x4 splat(F32 f)
+	{
+		return {_mm_set1_ps(f)};
+	}
 
-	// Reset z buffer
-	ANKI_ASSERT(width > 0 && height > 0);
-	m_width = width;
-	m_height = height;
-	U32 size = width * height;
-	if(m_zbuffer.getSize() < size)
+	static F32x4 load(const F32* p)
 	{
-		m_zbuffer.resize(size);
+		return {_mm_loadu_ps(p)};
 	}
-	memset(&m_zbuffer[0], 0xFF, sizeof(m_zbuffer[0]) * size);
-}
 
-void SoftwareRasterizer::clipTriangle(const Vec4* inVerts, Vec4* outVerts, U& outVertCount) const
-{
-	ANKI_ASSERT(inVerts && outVerts);
+	void store(F32* p) const
+	{
+		_mm_storeu_ps(p, m_v);
+	}
 
-	const Plane& plane = m_planesL[FrustumPlaneType::kNear];
-	F32 clipZ = -plane.getOffset() - kEpsilonf;
-	ANKI_ASSERT(clipZ < 0.0);
+	F32x4 operator+(F32x4 b) const
+	{
+		return {_mm_add_ps(m_v, b.m_v)};
+	}
 
-	Array<Bool, 3> vertInside;
-	U vertInsideCount = 0;
-	for(U i = 0; i < 3; ++i)
+	F32x4 operator*(F32x4 b) const
 	{
-		vertInside[i] = inVerts[i].z < clipZ;
-		vertInsideCount += (vertInside[i]) ? 1 : 0;
+		return {_mm_mul_ps(m_v, b.m_v)};
 	}
 
-	switch(vertInsideCount)
+	F32x4 min(F32x4 b) const
 	{
-	case 0:
-		// All out
-		outVertCount = 0;
-		break;
-	case 3:
-		// All in
-		outVertCount = 3;
-		outVerts[0] = inVerts[0];
-		outVerts[1] = inVerts[1];
-		outVerts[2] = inVerts[2];
-		break;
-	case 1:
+		return {_mm_min_ps(m_v, b.m_v)};
+	}
+
+	F32x4 max(F32x4 b) const
 	{
-		U i, next, prev;
-		if(vertInside[0])
-		{
-			i = 0;
-			next = 1;
-			prev = 2;
-		}
-		else if(vertInside[1])
-		{
-			i = 1;
-			next = 2;
-			prev = 0;
-		}
-		else
+		return {_mm_max_ps(m_v, b.m_v)};
+	}
+
+	// Lanes that are >= 0. Returns a lane mask
+	F32x4 positiveMask() const
+	{
+		return {_mm_cmpge_ps(m_v, _mm_setzero_ps())};
+	}
+
+	Bool anyLane() const
+	{
+		return _mm_movemask_ps(m_v) != 0;
+	}
+
+	// Pick b in the lanes the mask is set and this in the rest
+	F32x4 select(F32x4 b, F32x4 mask) const
+	{
+		return {_mm_blendv_ps(m_v, b.m_v, mask.m_v)};
+	}
+#elif ANKI_SIMD_NEON
+	float32x4_t m_v;
+
+	static F32x4 splat(F32 f)
+	{
+		return {vdupq_n_f32(f)};
+	}
+
+	static F32x4 load(const F32* p)
+	{
+		return {vld1q_f32(p)};
+	}
+
+	void store(F32* p) const
+	{
+		vst1q_f32(p, m_v);
+	}
+
+	F32x4 operator+(F32x4 b) const
+	{
+		return {vaddq_f32(m_v, b.m_v)};
+	}
+
+	F32x4 operator*(F32x4 b) const
+	{
+		return {vmulq_f32(m_v, b.m_v)};
+	}
+
+	F32x4 min(F32x4 b) const
+	{
+		return {vminq_f32(m_v, b.m_v)};
+	}
+
+	F32x4 max(F32x4 b) const
+	{
+		return {vmaxq_f32(m_v, b.m_v)};
+	}
+
+	F32x4 positiveMask() const
+	{
+		return {vreinterpretq_f32_u32(vcgeq_f32(m_v, vdupq_n_f32(0.0f)))};
+	}
+
+	Bool anyLane() const
+	{
+		return vmaxvq_u32(vreinterpretq_u32_f32(m_v)) != 0;
+	}
+
+	F32x4 select(F32x4 b, F32x4 mask) const
+	{
+		return {vbslq_f32(vreinterpretq_u32_f32(mask.m_v), b.m_v, m_v)};
+	}
+#else
+	Array<F32, 4> m_v;
+
+	static F32x4 splat(F32 f)
+	{
+		return {{f, f, f, f}};
+	}
+
+	static F32x4 load(const F32* p)
+	{
+		return {{p[0], p[1], p[2], p[3]}};
+	}
+
+	void store(F32* p) const
+	{
+		memcpy(p, &m_v[0], sizeof(m_v));
+	}
+
+	template<typename TFunc>
+	F32x4 perLane(F32x4 b, TFunc func) const
+	{
+		F32x4 out;
+		for(U32 i = 0; i < 4; ++i)
 		{
-			i = 2;
-			next = 0;
-			prev = 1;
+			out.m_v[i] = func(m_v[i], b.m_v[i]);
 		}
+		return out;
+	}
 
-		// Find first intersection
-		Vec4 rayOrigin = inVerts[i].xyz0;
-		Vec4 rayDir = (inVerts[next].xyz0 - rayOrigin).normalize();
+	F32x4 operator+(F32x4 b) const
+	{
+		return perLane(b, [](F32 x, F32 y) {
+			return x + y;
+		});
+	}
 
-		Vec4 intersection0;
-		[[maybe_unused]] Bool intersects = testCollision(plane, Ray(rayOrigin, rayDir), intersection0);
-		ANKI_ASSERT(intersects);
+	F32x4 operator*(F32x4 b) const
+	{
+		return perLane(b, [](F32 x, F32 y) {
+			return x * y;
+		});
+	}
 
-		// Find second intersection
-		rayDir = (inVerts[prev].xyz0 - rayOrigin).normalize();
+	F32x4 min(F32x4 b) const
+	{
+		return perLane(b, [](F32 x, F32 y) {
+			return anki::min(x, y);
+		});
+	}
 
-		Vec4 intersection1;
-		intersects = testCollision(plane, Ray(rayOrigin, rayDir), intersection1);
-		ANKI_ASSERT(intersects);
+	F32x4 max(F32x4 b) const
+	{
+		return perLane(b, [](F32 x, F32 y) {
+			return anki::max(x, y);
+		});
+	}
 
-		// Finalize
-		outVerts[0] = inVerts[i];
-		outVerts[1] = intersection0.xyz1;
-		outVerts[2] = intersection1.xyz1;
-		outVertCount = 3;
+	F32x4 positiveMask() const
+	{
+		return perLane(*this, [](F32 x, [[maybe_unused]] F32 y) {
+			return (x >= 0.0f) ? 1.0f : 0.0f;
+		});
+	}
 
-		break;
+	Bool anyLane() const
+	{
+		return m_v[0] != 0.0f || m_v[1] != 0.0f || m_v[2] != 0.0f || m_v[3] != 0.0f;
 	}
-	case 2:
+
+	F32x4 select(F32x4 b, F32x4 mask) const
 	{
-		U in0, in1, out;
-		if(vertInside[0] && vertInside[1])
+		F32x4 out;
+		for(U32 i = 0; i < 4; ++i)
 		{
-			in0 = 0;
-			in1 = 1;
-			out = 2;
+			out.m_v[i] = (mask.m_v[i] != 0.0f) ? b.m_v[i] : m_v[i];
 		}
-		else if(vertInside[1] && vertInside[2])
+		return out;
+	}
+#endif
+};
+
+} // namespace
+
+void SoftwareRasterizer::prepare(const Mat4& viewProjection, U32 width, U32 height)
+{
+	ANKI_ASSERT(isPowerOfTwo(width) && isPowerOfTwo(height) && width >= kTileSize && height >= kTileSize);
+
+	m_viewProjMat = viewProjection;
+
+	if(m_size != UVec2(width, height))
+	{
+		m_size = UVec2(width, height);
+		m_tileCounts = m_size / kTileSize;
+
+		U32 mipCount = 0;
+		for(U32 s = min(width, height); s >= 1; s /= 2)
 		{
-			in0 = 1;
-			in1 = 2;
-			out = 0;
+			++mipCount;
 		}
-		else
+
+		m_mips.destroy();
+		m_mips.resize(mipCount);
+		for(U32 mip = 0; mip < mipCount; ++mip)
 		{
-			ANKI_ASSERT(vertInside[2] && vertInside[0]);
-			in0 = 2;
-			in1 = 0;
-			out = 1;
+			m_mips[mip].resize((width >> mip) * (height >> mip));
 		}
 
-		// Find first intersection
-		Vec4 rayOrigin = inVerts[in1].xyz0;
-		Vec4 rayDir = (inVerts[out].xyz0 - rayOrigin).normalize();
+		m_tileBins.destroy();
+		m_tileBins.resize(m_tileCounts.x * m_tileCounts.y);
+	}
 
-		Vec4 intersection0;
-		[[maybe_unused]] Bool intersects = testCollision(plane, Ray(rayOrigin, rayDir), intersection0);
-		ANKI_ASSERT(intersects);
+	// Keep the storage around since the next frame will need roughly the same
+	m_triangles.resize(0);
+	for(SceneDynamicArray<U32>& bin : m_tileBins)
+	{
+		bin.resize(0);
+	}
+}
 
-		// Find second intersection
-		rayOrigin = inVerts[in0].xyz0;
-		rayDir = (inVerts[out].xyz0 - rayOrigin).normalize();
+void SoftwareRasterizer::setupTriangle(const Vec4& a, const Vec4& b, const Vec4& c, Bool backfaceCulling,
+									   SceneDynamicArray<Triangle>& out) const
+{
+	// To screen space. The Y is flipped so the 1st row is the top of the screen, same as the UVs
+	const Vec2 size(m_size);
+	Array<Vec3, 3> v;
+	const Array<const Vec4*, 3> clip = {&a, &b, &c};
+	for(U32 i = 0; i < 3; ++i)
+	{
+		const Vec3 ndc = clip[i]->xyz / clip[i]->w;
+		v[i] = Vec3((ndc.x * 0.5f + 0.5f) * size.x, (0.5f - ndc.y * 0.5f) * size.y, ndc.z);
+	}
 
-		Vec4 intersection1;
-		intersects = testCollision(plane, Ray(rayOrigin, rayDir), intersection1);
-		ANKI_ASSERT(intersects);
+	// Counter-clockwise in NDC becomes clockwise because of the flip
+	F32 area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[1].y - v[0].y) * (v[2].x - v[0].x);
+	if(area >= 0.0f && backfaceCulling)
+	{
+		return;
+	}
+
+	if(absolute(area) < kEpsilonf)
+	{
+		// Degenerate
+		return;
+	}
 
-		// Two triangles
-		outVerts[0] = inVerts[in1];
-		outVerts[1] = intersection0;
-		outVerts[2] = intersection1;
-		outVerts[3] = intersection1;
-		outVerts[4] = inVerts[in0];
-		outVerts[5] = inVerts[in1];
-		outVertCount = 6;
+	// Make the winding consistent so all edge functions are positive inside
+	if(area < 0.0f)
+	{
+		std::swap(v[1], v[2]);
+		area = -area;
+	}
 
-		break;
+	// Bounding box. Sample at pixel centers
+	Vec2 bboxMin = Vec2(v[0].xy).min(v[1].xy).min(v[2].xy);
+	Vec2 bboxMax = Vec2(v[0].xy).max(v[1].xy).max(v[2].xy);
+	bboxMin = Vec2(std::ceil(bboxMin.x - 0.5f), std::ceil(bboxMin.y - 0.5f)).max(Vec2(0.0f));
+	bboxMax = Vec2(std::floor(bboxMax.x - 0.5f), std::floor(bboxMax.y - 0.5f)).min(size - 1.0f);
+	if(bboxMin.x > bboxMax.x || bboxMin.y > bboxMax.y)
+	{
+		// Doesn't touch any pixel center
+		return;
 	}
+
+	Triangle& tri = *out.emplaceBack();
+	for(U32 i = 0; i < 3; ++i)
+	{
+		const Vec3& p0 = v[i];
+		const Vec3& p1 = v[(i + 1) % 3];
+		tri.m_edges[i] = Vec3(p0.y - p1.y, p1.x - p0.x, p0.x * p1.y - p0.y * p1.x);
 	}
+
+	// Depth is linear in screen space after the perspective divide
+	const Vec3 d1 = v[1] - v[0];
+	const Vec3 d2 = v[2] - v[0];
+	const F32 dzdx = (d1.z * d2.y - d2.z * d1.y) / area;
+	const F32 dzdy = (d2.z * d1.x - d1.z * d2.x) / area;
+	tri.m_depthPlane = Vec3(dzdx, dzdy, v[0].z - dzdx * v[0].x - dzdy * v[0].y);
+
+	tri.m_min = {U16(bboxMin.x), U16(bboxMin.y)};
+	tri.m_max = {U16(bboxMax.x), U16(bboxMax.y)};
 }
 
-void SoftwareRasterizer::draw(const F32* verts, U vertCount, U stride, Bool backfaceCulling)
+void SoftwareRasterizer::draw(ConstWeakArray<Vec3> positions, ConstWeakArray<U32> indices, const Mat3x4& worldTransform, Bool backfaceCulling)
 {
-	ANKI_ASSERT(verts && vertCount > 0 && (vertCount % 3) == 0);
-	ANKI_ASSERT(stride >= sizeof(F32) * 3 && (stride % sizeof(F32)) == 0);
+	ANKI_TRACE_SCOPED_EVENT(SceneRasterizerDraw);
+	ANKI_ASSERT((indices.getSize() % 3) == 0);
+	ANKI_ASSERT(m_size.x > 0 && "Forgot to call prepare()");
+
+	// Transform all vertices once
+	const Mat4 mvp = m_viewProjMat * Mat4(worldTransform, Vec4(0.0f, 0.0f, 0.0f, 1.0f));
+	SceneDynamicArray<Vec4> clipPositions;
+	clipPositions.resize(positions.getSize());
+	for(U32 i = 0; i < positions.getSize(); ++i)
+	{
+		clipPositions[i] = mvp * positions[i].xyz1;
+	}
 
-	U floatStride = stride / sizeof(F32);
-	const F32* vertsEnd = verts + vertCount * floatStride;
-	while(verts != vertsEnd)
+	SceneDynamicArray<Triangle> triangles;
+	for(U32 i = 0; i < indices.getSize(); i += 3)
 	{
-		// Convert triangle to view space
-		Array<Vec4, 3> triVspace;
-		for(U j = 0; j < 3; ++j)
+		const Array<Vec4, 3> tri = {clipPositions[indices[i]], clipPositions[indices[i + 1]], clipPositions[indices[i + 2]]};
+
+		// Cull it if all vertices are outside the same frustum plane
+		Bool outside = false;
+		for(U32 axis = 0; axis < 2 && !outside; ++axis)
 		{
-			triVspace[j] = m_mv * Vec4(verts[0], verts[1], verts[2], 1.0);
-			verts += floatStride;
+			outside = (tri[0][axis] > tri[0].w && tri[1][axis] > tri[1].w && tri[2][axis] > tri[2].w)
+					  || (tri[0][axis] < -tri[0].w && tri[1][axis] < -tri[1].w && tri[2][axis] < -tri[2].w);
 		}
-
-		// Cull if backfacing
-		if(backfaceCulling)
+		outside = outside || (tri[0].z > tri[0].w && tri[1].z > tri[1].w && tri[2].z > tri[2].w);
+		outside = outside || (tri[0].z < 0.0f && tri[1].z < 0.0f && tri[2].z < 0.0f);
+		if(outside)
 		{
-			Vec4 norm = (triVspace[1] - triVspace[0]).cross(triVspace[2] - triVspace[1]);
-			ANKI_ASSERT(norm.w == 0.0f);
-
-			Vec4 eye = triVspace[0].xyz0;
-			if(norm.dot(eye) >= 0.0f)
-			{
-				continue;
-			}
+			continue;
 		}
 
-		// Clip it
-		Array<Vec4, 6> clippedTrisVspace;
-		U clippedCount = 0;
-		clipTriangle(&triVspace[0], &clippedTrisVspace[0], clippedCount);
-		if(clippedCount == 0)
+		if(tri[0].z >= 0.0f && tri[1].z >= 0.0f && tri[2].z >= 0.0f) [[likely]]
 		{
-			// Outside view
+			setupTriangle(tri[0], tri[1], tri[2], backfaceCulling, triangles);
 			continue;
 		}
 
-		// Rasterize
-		Array<Vec4, 3> clip;
-		for(U j = 0; j < clippedCount; j += 3)
+		// Clip against the near plane (z = 0 in clip space). The result is a polygon of 3 or 4 vertices
+		Array<Vec4, 4> poly;
+		U32 polyCount = 0;
+		for(U32 j = 0; j < 3; ++j)
 		{
-			for(U k = 0; k < 3; k++)
+			const Vec4& crnt = tri[j];
+			const Vec4& next = tri[(j + 1) % 3];
+
+			if(crnt.z >= 0.0f)
 			{
-				clip[k] = m_p * clippedTrisVspace[j + k].xyz1;
-				ANKI_ASSERT(clip[k].w > 0.0f);
+				poly[polyCount++] = crnt;
 			}
 
-			rasterizeTriangle(&clip[0]);
+			if((crnt.z >= 0.0f) != (next.z >= 0.0f))
+			{
+				const F32 t = crnt.z / (crnt.z - next.z);
+				poly[polyCount++] = linearInterpolate(crnt, next, t);
+			}
 		}
-	}
-}
 
-Bool SoftwareRasterizer::computeBarycetrinc(const Vec2& a, const Vec2& b, const Vec2& c, const Vec2& p, Vec3& uvw) const
-{
-	Vec2 dca = c - a;
-	Vec2 dba = b - a;
-	Vec2 dap = a - p;
+		for(U32 j = 1; j + 1 < polyCount; ++j)
+		{
+			setupTriangle(poly[0], poly[j], poly[j + 1], backfaceCulling, triangles);
+		}
+	}
 
-	Vec3 n(dca.x, dba.x, dap.x);
-	Vec3 m(dca.y, dba.y, dap.y);
+	if(triangles.getSize() == 0)
+	{
+		return;
+	}
 
-	Vec3 k = n.cross(m);
+	// Append and bin under the lock
+	LockGuard lock(m_mtx);
 
-	Bool skip = false;
-	if(!isZero(k.z))
+	const U32 firstTriangle = m_triangles.getSize();
+	m_triangles.resizeStorage(firstTriangle + triangles.getSize());
+	for(U32 i = 0; i < triangles.getSize(); ++i)
 	{
-		uvw = Vec3(1.0f - (k.x + k.y) / k.z, k.y / k.z, k.x / k.z);
+		const Triangle& tri = triangles[i];
+		m_triangles.emplaceBack(tri);
 
-		if(uvw.x < 0.0f || uvw.y < 0.0f || uvw.z < 0.0f)
+		for(U32 ty = tri.m_min[1] / kTileSize; ty <= tri.m_max[1] / kTileSize; ++ty)
 		{
-			skip = true;
+			for(U32 tx = tri.m_min[0] / kTileSize; tx <= tri.m_max[0] / kTileSize; ++tx)
+			{
+				m_tileBins[ty * m_tileCounts.x + tx].emplaceBack(firstTriangle + i);
+			}
 		}
 	}
-	else
-	{
-		skip = true;
-	}
-
-	return skip;
 }
 
-void SoftwareRasterizer::rasterizeTriangle(const Vec4* tri)
+void SoftwareRasterizer::rasterizeTile(U32 tileIdx)
 {
-	ANKI_ASSERT(tri);
+	ANKI_TRACE_SCOPED_EVENT(SceneRasterizerRasterize);
 
-	const Vec2 windowSize{F32(m_width), F32(m_height)};
-	Array<Vec3, 3> ndc;
-	Array<Vec2, 3> window;
-	Vec2 bboxMin(kMaxF32), bboxMax(kMinF32);
-	for(U i = 0; i < 3; i++)
-	{
-		ndc[i] = tri[i].xyz / tri[i].w;
-		window[i] = (ndc[i].xy / 2.0f + 0.5f) * windowSize;
+	const UVec2 tile(tileIdx % m_tileCounts.x, tileIdx / m_tileCounts.x);
+	const UVec2 tileMin = tile * kTileSize;
+	const UVec2 tileMax = tileMin + (kTileSize - 1);
+	F32* depth = m_mips[0].getBegin();
 
-		for(U32 j = 0; j < 2; j++)
+	// Clear
+	for(U32 y = tileMin.y; y <= tileMax.y; ++y)
+	{
+		for(U32 x = tileMin.x; x <= tileMax.x; x += 4)
 		{
-			bboxMin[j] = std::floor(min(bboxMin[j], window[i][j]));
-			bboxMin[j] = clamp(bboxMin[j], 0.0f, windowSize[j]);
-
-			bboxMax[j] = std::ceil(max(bboxMax[j], window[i][j]));
-			bboxMax[j] = clamp(bboxMax[j], 0.0f, windowSize[j]);
+			F32x4::splat(1.0f).store(&depth[y * m_size.x + x]);
 		}
 	}
 
-	for(F32 y = bboxMin.y + 0.5f; y < bboxMax.y + 0.5f; y += 1.0f)
+	const F32x4 laneOffsets = F32x4::load(Array<F32, 4>{0.0f, 1.0f, 2.0f, 3.0f}.getBegin());
+
+	for(U32 triIdx : m_tileBins[tileIdx])
 	{
-		for(F32 x = bboxMin.x + 0.5f; x < bboxMax.x + 0.5f; x += 1.0f)
+		const Triangle& tri = m_triangles[triIdx];
+
+		// Start from a multiple of 4 so the rows of 4 pixels stay inside the tile
+		const U32 minX = max<U32>(tri.m_min[0], tileMin.x) & ~3u;
+		const U32 maxX = min<U32>(tri.m_max[0], tileMax.x);
+		const U32 minY = max<U32>(tri.m_min[1], tileMin.y);
+		const U32 maxY = min<U32>(tri.m_max[1], tileMax.y);
+
+		Array<F32x4, 3> edgeDx;
+		Array<F32x4, 3> edgeStep;
+		for(U32 e = 0; e < 3; ++e)
 		{
-			Vec2 p(x, y);
-			Vec3 bc;
-			if(!computeBarycetrinc(window[0], window[1], window[2], p, bc))
-			{
-				const F32 z0 = ndc[0].z;
-				const F32 z1 = ndc[1].z;
-				const F32 z2 = ndc[2].z;
+			edgeDx[e] = F32x4::splat(tri.m_edges[e].x) * laneOffsets;
+			edgeStep[e] = F32x4::splat(tri.m_edges[e].x * 4.0f);
+		}
+		const F32x4 depthDx = F32x4::splat(tri.m_depthPlane.x) * laneOffsets;
+		const F32x4 depthStep = F32x4::splat(tri.m_depthPlane.x * 4.0f);
 
-				F32 depth = z0 * bc[0] + z1 * bc[1] + z2 * bc[2];
-				ANKI_ASSERT(depth >= 0.0 && depth <= 1.0);
+		for(U32 y = minY; y <= maxY; ++y)
+		{
+			const F32 py = F32(y) + 0.5f;
+			const F32 px = F32(minX) + 0.5f;
 
-				// Clamp it to a bit less that 1.0f because 1.0f will produce a 0 depthi
-				depth = min(depth, 1.0f - kEpsilonf);
+			Array<F32x4, 3> w;
+			for(U32 e = 0; e < 3; ++e)
+			{
+				w[e] = F32x4::splat(tri.m_edges[e].x * px + tri.m_edges[e].y * py + tri.m_edges[e].z) + edgeDx[e];
+			}
+			F32x4 z = F32x4::splat(tri.m_depthPlane.x * px + tri.m_depthPlane.y * py + tri.m_depthPlane.z) + depthDx;
 
-				// Store the min of the current value and new one
-				const U32 depthi = U32(depth * F32(kMaxU32));
-				m_zbuffer[U32(y) * m_width + U32(x)].min(depthi);
+			F32* row = &depth[y * m_size.x];
+			for(U32 x = minX; x <= maxX; x += 4)
+			{
+				const F32x4 mask = w[0].min(w[1]).min(w[2]).positiveMask();
+				if(mask.anyLane())
+				{
+					const F32x4 crntDepth = F32x4::load(&row[x]);
+					const F32x4 newDepth = crntDepth.min(z.max(F32x4::splat(0.0f)));
+					crntDepth.select(newDepth, mask).store(&row[x]);
+				}
+
+				for(U32 e = 0; e < 3; ++e)
+				{
+					w[e] = w[e] + edgeStep[e];
+				}
+				z = z + depthStep;
 			}
 		}
 	}
-}
 
-Bool SoftwareRasterizer::visibilityTest(const Aabb& aabb) const
-{
-	ANKI_TRACE_SCOPED_EVENT(SceneRasterizerTest);
-	Bool inside = visibilityTestInternal(aabb);
-
-	return inside;
+	// Build the mips that fall inside the tile
+	for(U32 mip = 1; mip < m_mips.getSize() && (kTileSize >> mip) > 0; ++mip)
+	{
+		downscaleRegion(mip - 1, tileMin >> mip, UVec2(kTileSize >> mip));
+	}
 }
 
-Bool SoftwareRasterizer::visibilityTestInternal(const Aabb& aabb) const
+void SoftwareRasterizer::downscaleRegion(U32 srcMip, UVec2 dstOffset, UVec2 dstSize)
 {
-	// Set the AABB points
-	const Vec4& minv = aabb.getMin();
-	const Vec4& maxv = aabb.getMax();
-	Array<Vec4, 8> boxPoints;
-	boxPoints[0] = minv.xyz1;
-	boxPoints[1] = Vec4(minv.x, maxv.y, minv.z, 1.0f);
-	boxPoints[2] = Vec4(minv.x, maxv.y, maxv.z, 1.0f);
-	boxPoints[3] = Vec4(minv.x, minv.y, maxv.z, 1.0f);
-	boxPoints[4] = maxv.xyz1;
-	boxPoints[5] = Vec4(maxv.x, minv.y, maxv.z, 1.0f);
-	boxPoints[6] = Vec4(maxv.x, minv.y, minv.z, 1.0f);
-	boxPoints[7] = Vec4(maxv.x, maxv.y, minv.z, 1.0f);
+	const U32 srcWidth = m_size.x >> srcMip;
+	const U32 dstWidth = srcWidth / 2;
+	const F32* src = m_mips[srcMip].getBegin();
+	F32* dst = m_mips[srcMip + 1].getBegin();
 
-	// Transform points
-	for(Vec4& p : boxPoints)
+	for(U32 y = dstOffset.y; y < dstOffset.y + dstSize.y; ++y)
 	{
-		p = m_mvp * p;
-	}
-
-	// Check of a point touches the near plane
-	for(const Vec4& p : boxPoints)
-	{
-		if(p.w <= 0.0f)
+		const F32* srcRow0 = &src[(y * 2) * srcWidth];
+		const F32* srcRow1 = &src[(y * 2 + 1) * srcWidth];
+		for(U32 x = dstOffset.x; x < dstOffset.x + dstSize.x; ++x)
 		{
-			// Don't bother clipping. Just mark it as visible.
-			return true;
+			dst[y * dstWidth + x] = max(max(srcRow0[x * 2], srcRow0[x * 2 + 1]), max(srcRow1[x * 2], srcRow1[x * 2 + 1]));
 		}
 	}
+}
 
-	// Compute the min and max bounds
-	Vec4 bboxMin(kMaxF32);
-	Vec4 bboxMax(kMinF32);
-	for(Vec4& p : boxPoints)
-	{
-		// Perspecrive divide
-		p /= p.w;
-
-		// To [0, 1]
-		p *= Vec4(0.5f, 0.5f, 1.0f, 1.0f);
-		p += Vec4(0.5f, 0.5f, 0.0f, 0.0f);
-
-		// To [0, m_width|m_height]
-		p *= Vec4(F32(m_width), F32(m_height), 1.0f, 1.0f);
+void SoftwareRasterizer::buildHierarchicalDepth()
+{
+	ANKI_TRACE_SCOPED_EVENT(SceneRasterizerHzb);
 
-		// Min
-		bboxMin = bboxMin.min(p);
+	for(U32 mip = 1; mip < m_mips.getSize(); ++mip)
+	{
+		if((kTileSize >> mip) > 0)
+		{
+			// Done by rasterizeTile()
+			continue;
+		}
 
-		// Max
-		bboxMax = bboxMax.max(p);
+		downscaleRegion(mip - 1, UVec2(0u), m_size >> mip);
 	}
+}
 
-	// Fix the bounds
-	bboxMin.x = floorf(bboxMin.x);
-	bboxMin.x = clamp(bboxMin.x, 0.0f, F32(m_width));
+void SoftwareRasterizer::visibilityTest(ConstWeakArray<Aabb> aabbs, WeakArray<Bool> visible) const
+{
+	ANKI_TRACE_SCOPED_EVENT(SceneRasterizerTest);
+	ANKI_ASSERT(aabbs.getSize() == visible.getSize());
 
-	bboxMax.x = ceilf(bboxMax.x);
-	bboxMax.x = clamp(bboxMax.x, 0.0f, F32(m_width));
+	// The corners of a box are (c0 * x + c1 * y + c2 * z + c3) where cN the columns of the matrix. Precompute the columns
+	const Vec4 col0 = m_viewProjMat.getColumn(0);
+	const Vec4 col1 = m_viewProjMat.getColumn(1);
+	const Vec4 col2 = m_viewProjMat.getColumn(2);
+	const Vec4 col3 = m_viewProjMat.getColumn(3);
+	const Vec2 texSize(m_size);
+	const F32 lastMip = F32(m_mips.getSize() - 1);
 
-	bboxMin.y = floorf(bboxMin.y);
-	bboxMin.y = clamp(bboxMin.y, 0.0f, F32(m_height));
+	for(U32 i = 0; i < aabbs.getSize(); ++i)
+	{
+		const Vec4& aabbMin = aabbs[i].getMin();
+		const Vec4& aabbMax = aabbs[i].getMax();
 
-	bboxMax.y = ceilf(bboxMax.y);
-	bboxMax.y = clamp(bboxMax.y, 0.0f, F32(m_height));
+		const Array<Vec4, 2> xs = {col0 * aabbMin.x, col0 * aabbMax.x};
+		const Array<Vec4, 2> ys = {col1 * aabbMin.y, col1 * aabbMax.y};
+		const Array<Vec4, 2> zs = {col2 * aabbMin.z + col3, col2 * aabbMax.z + col3};
 
-	// Loop the tiles
-	F32 minZ = bboxMin.z;
-	for(F32 y = bboxMin.y; y < bboxMax.y; y += 1.0f)
-	{
-		for(F32 x = bboxMin.x; x < bboxMax.x; x += 1.0f)
+		Vec4 minNdc(kMaxF32);
+		Vec4 maxNdc(kMinF32);
+		Bool touchesNearPlane = false;
+		for(U32 c = 0; c < 8; ++c)
 		{
-			const U32 idx = U32(y) * m_width + U32(x);
-			const U32 depthi = m_zbuffer[idx].getNonAtomically();
-			const F32 depthf = F32(depthi) / F32(kMaxU32);
-			if(minZ < depthf)
+			const Vec4 clip = xs[c & 1] + ys[(c >> 1) & 1] + zs[c >> 2];
+			if(clip.w <= kEpsilonf)
 			{
-				return true;
+				touchesNearPlane = true;
+				break;
 			}
-		}
-	}
 
-	return false;
-}
+			const Vec4 ndc = clip / clip.w;
+			minNdc = minNdc.min(ndc);
+			maxNdc = maxNdc.max(ndc);
+		}
 
-void SoftwareRasterizer::fillDepthBuffer(ConstWeakArray<F32> depthValues)
-{
-	ANKI_ASSERT(m_zbuffer.getSize() == depthValues.getSize());
+		if(touchesNearPlane)
+		{
+			visible[i] = true;
+			continue;
+		}
 
-	U32 count = depthValues.getSize();
-	while(count--)
-	{
-		F32 depth = depthValues[count];
-		ANKI_ASSERT(depth >= 0.0f && depth <= 1.0f);
+		// Same as cullHzb() in the shaders so the CPU and GPU tests agree
+		const Vec2 minUv = (Vec2(minNdc.x, -maxNdc.y) * 0.5f + 0.5f).clamp(0.0f, 1.0f);
+		const Vec2 maxUv = (Vec2(maxNdc.x, -minNdc.y) * 0.5f + 0.5f).clamp(0.0f, 1.0f);
+		const Vec2 sizeXY = (maxUv - minUv) * texSize;
+		F32 mip = std::ceil(std::log2(max(max(sizeXY.x, sizeXY.y), 1.0f)));
+
+		// Try to use a more detailed mip if you can
+		const F32 levelLower = max(mip - 1.0f, 0.0f);
+		const Vec2 mipSize = texSize / std::pow(2.0f, levelLower);
+		const Vec2 a = minUv * mipSize;
+		const Vec2 b = maxUv * mipSize;
+		const Vec2 dims = Vec2(std::ceil(b.x), std::ceil(b.y)) - Vec2(std::floor(a.x), std::floor(a.y));
+		if(dims.x <= 2.0f && dims.y <= 2.0f)
+		{
+			mip = levelLower;
+		}
 
-		depth = min(depth, 1.0f - kEpsilonf); // See a few lines above why is that
+		const U32 m = U32(min(mip, lastMip));
+		const UVec2 size = m_size >> m;
+		const F32* depth = m_mips[m].getBegin();
+		auto sample = [&](Vec2 uv) {
+			const UVec2 texel = UVec2(uv * Vec2(size)).min(size - 1u);
+			return depth[texel.y * size.x + texel.x];
+		};
 
-		const U32 depthi = U32(depth * F32(kMaxU32));
-		m_zbuffer[count].setNonAtomically(depthi);
+		const F32 maxDepth = max(max(sample(minUv), sample(maxUv)), max(sample(Vec2(minUv.x, maxUv.y)), sample(Vec2(maxUv.x, minUv.y))));
+		visible[i] = minNdc.z <= maxDepth;
 	}
 }
 
@@ -7,58 +7,108 @@
 
 #include <AnKi/Scene/Common.h>
 #include <AnKi/Math.h>
-#include <AnKi/Collision/Plane.h>
+#include <AnKi/Collision/Forward.h>
 #include <AnKi/Util/WeakArray.h>
+#include <AnKi/Util/Thread.h>
 
 namespace anki {
 
-/// @addtogroup scene
-/// @{
-
-/// Software rasterizer for visibility tests.
+// Rasterizes occluder triangles on the CPU into a low resolution depth buffer and builds a hierarchical (max) depth out of it. The depth is in
+// [0, 1] with 0 being the near plane. The usage is:
+// - prepare()
+// - draw() from any thread
+// - rasterizeTile() for all tiles, from any thread
+// - buildHierarchicalDepth()
+// - visibilityTest() from any thread
 class SoftwareRasterizer
 {
 public:
-	/// Prepare for rendering. Call it before every draw.
-	void prepare(const Mat4& mv, const Mat4& p, U32 width, U32 height);
+	static constexpr U32 kTileSize = 32;
+
+	SoftwareRasterizer() = default;
+
+	SoftwareRasterizer(const SoftwareRasterizer&) = delete; // Non-copyable
+
+	SoftwareRasterizer& operator=(const SoftwareRasterizer&) = delete; // Non-copyable
+
+	// Prepare for rendering. Call it before every frame. The width and height need to be powers of two and not smaller than kTileSize.
+	void prepare(const Mat4& viewProjection, U32 width, U32 height);
+
+	// Transform, clip and bin the triangles of an indexed mesh. Thread-safe against other draw() calls.
+	void draw(ConstWeakArray<Vec3> positions, ConstWeakArray<U32> indices, const Mat3x4& worldTransform, Bool backfaceCulling);
+
+	U32 getTileCount() const
+	{
+		return m_tileCounts.x * m_tileCounts.y;
+	}
 
-	/// Render some verts.
-	/// @param[in] verts Pointer to the first vertex to draw.
-	/// @param vertCount The number of verts to draw.
-	/// @param stride The stride (in bytes) of the next vertex.
-	/// @param backfaceCulling If true it will do backface culling.
-	/// @note It's thread-safe against other draw() invocations only.
-	void draw(const F32* verts, U vertCount, U stride, Bool backfaceCulling);
+	// Rasterize the triangles that touch a tile. Call it after all draw() calls. Thread-safe against other tiles.
+	void rasterizeTile(U32 tileIdx);
 
-	/// Fill the depth buffer with some values.
-	void fillDepthBuffer(ConstWeakArray<F32> depthValues);
+	// Build the coarse mips of the hierarchical depth. Call it after all tiles are rasterized.
+	void buildHierarchicalDepth();
 
-	/// Perform visibility tests.
-	/// @param aabb The Aabb in of the cs in world space.
-	/// @return Return true if it's visible and false otherwise.
-	Bool visibilityTest(const Aabb& aabb) const;
+	// Test a number of AABBs (in world space) against the hierarchical depth. Thread-safe.
+	void visibilityTest(ConstWeakArray<Aabb> aabbs, WeakArray<Bool> visible) const;
+
+	Bool visibilityTest(const Aabb& aabb) const
+	{
+		Bool visible;
+		visibilityTest(ConstWeakArray<Aabb>(&aabb, 1), WeakArray<Bool>(&visible, 1));
+		return visible;
+	}
+
+	const Mat4& getViewProjectionMatrix() const
+	{
+		return m_viewProjMat;
+	}
+
+	UVec2 getSize() const
+	{
+		return m_size;
+	}
+
+	// The mip count follows the convention of computeMaxMipmapCount2d() so the depth can be uploaded as is.
+	U32 getMipCount() const
+	{
+		return m_mips.getSize();
+	}
+
+	// Get a mip of the hierarchical depth. Every mip is tightly packed and the 1st row is the top of the screen. Mip 0 is the depth buffer.
+	ConstWeakArray<F32> getHierarchicalDepth(U32 mip) const
+	{
+		return m_mips[mip];
+	}
+
+	U32 getTriangleCount() const
+	{
+		return m_triangles.getSize();
+	}
 
 private:
-	Mat4 m_mv; ///< ModelView.
-	Mat4 m_p; ///< Projection.
-	Mat4 m_mvp;
-	Array<Plane, 6> m_planesL; ///< In view space.
-	Array<Plane, 6> m_planesW; ///< In world space.
-	U32 m_width;
-	U32 m_height;
-	SceneDynamicArray<Atomic<U32>> m_zbuffer;
+	// A triangle in screen space, ready to be rasterized.
+	class Triangle
+	{
+	public:
+		Array<Vec3, 3> m_edges; // Edge functions (a * x + b * y + c). A pixel is inside if all are positive
+		Vec3 m_depthPlane; // Depth is (a * x + b * y + c)
+		Array<U16, 2> m_min; // Bounding box in pixels
+		Array<U16, 2> m_max; // Bounding box in pixels (inclusive)
+	};
+
+	Mat4 m_viewProjMat = Mat4::getIdentity();
+	UVec2 m_size = UVec2(0u);
+	UVec2 m_tileCounts = UVec2(0u);
 
-	/// @param tri In clip space.
-	void rasterizeTriangle(const Vec4* tri);
+	SceneDynamicArray<SceneDynamicArray<F32>> m_mips;
 
-	Bool computeBarycetrinc(const Vec2& a, const Vec2& b, const Vec2& c, const Vec2& p, Vec3& uvw) const;
+	SpinLock m_mtx;
+	SceneDynamicArray<Triangle> m_triangles;
+	SceneDynamicArray<SceneDynamicArray<U32>> m_tileBins; // The triangles that touch each tile
 
-	/// Clip triangle in the near plane.
-	/// @note Triangles in view space.
-	void clipTriangle(const Vec4* inTriangle, Vec4* outTriangles, U& outTriangleCount) const;
+	void setupTriangle(const Vec4& a, const Vec4& b, const Vec4& c, Bool backfaceCulling, SceneDynamicArray<Triangle>& out) const;
 
-	Bool visibilityTestInternal(const Aabb& aabb) const;
+	void downscaleRegion(U32 srcMip, UVec2 dstOffset, UVec2 dstSize);
 };
-/// @}
 
 } // end namespace anki
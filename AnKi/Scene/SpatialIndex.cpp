@@ -0,0 +1,348 @@
+// Copyright (C) 2009-present, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <AnKi/Scene/SpatialIndex.h>
+#include <AnKi/Scene/SceneGraph.h>
+#include <AnKi/Util/Tracer.h>
+
+namespace anki {
+
+static Aabb mergeAabbs(const Aabb& a, const Aabb& b)
+{
+	return Aabb(a.getMin().min(b.getMin()), a.getMax().max(b.getMax()));
+}
+
+static F32 computeSurfaceArea(const Aabb& aabb)
+{
+	const Vec3 d = (aabb.getMax() - aabb.getMin()).xyz;
+	return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+static Bool aabbContains(const Aabb& outer, const Aabb& inner)
+{
+	return outer.getMin().xyz <= inner.getMin().xyz && outer.getMax().xyz >= inner.getMax().xyz;
+}
+
+U32 SpatialIndex::newObject(SceneComponent* component, SceneComponentType type)
+{
+	ANKI_ASSERT(component && type < SceneComponentType::kCount);
+	LockGuard lock(m_mtx);
+
+	U32 objectIdx;
+	if(m_freeObjects.getSize())
+	{
+		objectIdx = m_freeObjects.getBack();
+		m_freeObjects.popBack();
+	}
+	else
+	{
+		objectIdx = m_objects.getSize();
+		m_objects.emplaceBack();
+	}
+
+	Object& obj = m_objects[objectIdx];
+	obj = Object();
+	obj.m_component = component;
+	obj.m_type = type;
+	return objectIdx;
+}
+
+void SpatialIndex::updateObject(U32 objectIdx, const Aabb& aabb)
+{
+	LockGuard lock(m_mtx);
+	Object& obj = m_objects[objectIdx];
+	ANKI_ASSERT(!obj.m_deleted);
+	obj.m_aabb = aabb;
+	obj.m_hasAabb = true;
+	markDirty(objectIdx);
+}
+
+void SpatialIndex::deleteObject(U32 objectIdx)
+{
+	LockGuard lock(m_mtx);
+	Object& obj = m_objects[objectIdx];
+	ANKI_ASSERT(!obj.m_deleted);
+	obj.m_deleted = true;
+	obj.m_component = nullptr;
+	markDirty(objectIdx);
+}
+
+void SpatialIndex::markDirty(U32 objectIdx)
+{
+	Object& obj = m_objects[objectIdx];
+	if(!obj.m_dirty)
+	{
+		obj.m_dirty = true;
+		m_dirtyObjects.emplaceBack(objectIdx);
+	}
+}
+
+void SpatialIndex::flush()
+{
+	ANKI_TRACE_SCOPED_EVENT(SceneSpatialIndexFlush);
+
+	for(U32 objectIdx : m_dirtyObjects)
+	{
+		Object& obj = m_objects[objectIdx];
+		ANKI_ASSERT(obj.m_dirty);
+		obj.m_dirty = false;
+
+		if(obj.m_deleted)
+		{
+			if(obj.m_leaf != kMaxU32)
+			{
+				removeLeaf(obj.m_leaf);
+				deleteNode(obj.m_leaf);
+				--m_objectCount;
+			}
+
+			obj = Object();
+			m_freeObjects.emplaceBack(objectIdx);
+			continue;
+		}
+
+		ANKI_ASSERT(obj.m_hasAabb);
+
+		if(obj.m_leaf != kMaxU32)
+		{
+			Node& leaf = m_nodes[obj.m_leaf];
+			leaf.m_objectAabb = obj.m_aabb;
+
+			if(aabbContains(leaf.m_aabb, obj.m_aabb))
+			{
+				// Moved a little, the tree stays the same
+				continue;
+			}
+
+			removeLeaf(obj.m_leaf);
+		}
+		else
+		{
+			obj.m_leaf = newNode();
+			++m_objectCount;
+		}
+
+		Node& leaf = m_nodes[obj.m_leaf];
+		leaf.m_aabb = Aabb(obj.m_aabb.getMin() - Vec4(Vec3(kAabbMargin), 0.0f), obj.m_aabb.getMax() + Vec4(Vec3(kAabbMargin), 0.0f));
+		leaf.m_objectAabb = obj.m_aabb;
+		leaf.m_component = obj.m_component;
+		leaf.m_typeMask = SceneComponentTypeMask(1u << U32(obj.m_type));
+		leaf.m_height = 0;
+		insertLeaf(obj.m_leaf);
+	}
+
+	m_dirtyObjects.resize(0);
+}
+
+U32 SpatialIndex::newNode()
+{
+	U32 nodeIdx;
+	if(m_freeNodes != kMaxU32)
+	{
+		nodeIdx = m_freeNodes;
+		m_freeNodes = m_nodes[nodeIdx].m_parent;
+	}
+	else
+	{
+		nodeIdx = m_nodes.getSize();
+		m_nodes.emplaceBack();
+	}
+
+	m_nodes[nodeIdx] = Node();
+	return nodeIdx;
+}
+
+void SpatialIndex::deleteNode(U32 nodeIdx)
+{
+	m_nodes[nodeIdx] = Node();
+	m_nodes[nodeIdx].m_parent = m_freeNodes;
+	m_freeNodes = nodeIdx;
+}
+
+void SpatialIndex::insertLeaf(U32 leaf)
+{
+	if(m_root == kMaxU32)
+	{
+		m_root = leaf;
+		m_nodes[leaf].m_parent = kMaxU32;
+		return;
+	}
+
+	// Find the best sibling. Descend to the child that increases the surface area the least
+	const Aabb leafAabb = m_nodes[leaf].m_aabb;
+	U32 sibling = m_root;
+	while(!m_nodes[sibling].isLeaf())
+	{
+		const Node& node = m_nodes[sibling];
+
+		const F32 area = computeSurfaceArea(node.m_aabb);
+		const F32 combinedArea = computeSurfaceArea(mergeAabbs(node.m_aabb, leafAabb));
+
+		// The cost of creating a new parent for this node and the new leaf
+		const F32 cost = 2.0f * combinedArea;
+
+		// The minimum cost of pushing the leaf further down the tree
+		const F32 inheritanceCost = 2.0f * (combinedArea - area);
+
+		Array<F32, 2> childCosts;
+		for(U32 i = 0; i < 2; ++i)
+		{
+			const Node& child = m_nodes[node.m_children[i]];
+			const F32 newArea = computeSurfaceArea(mergeAabbs(child.m_aabb, leafAabb));
+			childCosts[i] = ((child.isLeaf()) ? newArea : newArea - computeSurfaceArea(child.m_aabb)) + inheritanceCost;
+		}
+
+		if(cost < childCosts[0] && cost < childCosts[1])
+		{
+			break;
+		}
+
+		sibling = (childCosts[0] < childCosts[1]) ? node.m_children[0] : node.m_children[1];
+	}
+
+	// Create a new parent
+	const U32 oldParent = m_nodes[sibling].m_parent;
+	const U32 newParent = newNode();
+	m_nodes[newParent].m_parent = oldParent;
+	m_nodes[newParent].m_children = {sibling, leaf};
+	m_nodes[sibling].m_parent = newParent;
+	m_nodes[leaf].m_parent = newParent;
+
+	if(oldParent != kMaxU32)
+	{
+		Node& p = m_nodes[oldParent];
+		p.m_children[(p.m_children[0] == sibling) ? 0 : 1] = newParent;
+	}
+	else
+	{
+		m_root = newParent;
+	}
+
+	// Walk back up and fix the bounds
+	U32 nodeIdx = newParent;
+	while(nodeIdx != kMaxU32)
+	{
+		refit(nodeIdx);
+		nodeIdx = balance(nodeIdx);
+		nodeIdx = m_nodes[nodeIdx].m_parent;
+	}
+}
+
+void SpatialIndex::removeLeaf(U32 leaf)
+{
+	if(leaf == m_root)
+	{
+		m_root = kMaxU32;
+		return;
+	}
+
+	const U32 parent = m_nodes[leaf].m_parent;
+	const U32 grandParent = m_nodes[parent].m_parent;
+	const U32 sibling = (m_nodes[parent].m_children[0] == leaf) ? m_nodes[parent].m_children[1] : m_nodes[parent].m_children[0];
+
+	deleteNode(parent);
+	m_nodes[sibling].m_parent = grandParent;
+
+	if(grandParent == kMaxU32)
+	{
+		m_root = sibling;
+		return;
+	}
+
+	Node& gp = m_nodes[grandParent];
+	gp.m_children[(gp.m_children[0] == parent) ? 0 : 1] = sibling;
+
+	U32 nodeIdx = grandParent;
+	while(nodeIdx != kMaxU32)
+	{
+		refit(nodeIdx);
+		nodeIdx = balance(nodeIdx);
+		nodeIdx = m_nodes[nodeIdx].m_parent;
+	}
+}
+
+void SpatialIndex::refit(U32 nodeIdx)
+{
+	Node& node = m_nodes[nodeIdx];
+	ANKI_ASSERT(!node.isLeaf());
+	const Node& a = m_nodes[node.m_children[0]];
+	const Node& b = m_nodes[node.m_children[1]];
+	node.m_aabb = mergeAabbs(a.m_aabb, b.m_aabb);
+	node.m_height = 1 + max(a.m_height, b.m_height);
+	node.m_typeMask = a.m_typeMask | b.m_typeMask;
+}
+
+U32 SpatialIndex::balance(U32 aIdx)
+{
+	Node& a = m_nodes[aIdx];
+	if(a.isLeaf() || a.m_height < 2)
+	{
+		return aIdx;
+	}
+
+	// Pick the child that is too tall (if any) and rotate it up
+	const I32 diff = I32(m_nodes[a.m_children[1]].m_height) - I32(m_nodes[a.m_children[0]].m_height);
+	if(diff >= -1 && diff <= 1)
+	{
+		return aIdx;
+	}
+
+	const U32 tallSide = (diff > 1) ? 1 : 0;
+	const U32 cIdx = a.m_children[tallSide];
+	Node& c = m_nodes[cIdx];
+	ANKI_ASSERT(!c.isLeaf());
+
+	// C takes the place of A
+	c.m_parent = a.m_parent;
+	a.m_parent = cIdx;
+	if(c.m_parent != kMaxU32)
+	{
+		Node& p = m_nodes[c.m_parent];
+		p.m_children[(p.m_children[0] == aIdx) ? 0 : 1] = cIdx;
+	}
+	else
+	{
+		m_root = cIdx;
+	}
+
+	// A becomes a child of C and it takes the shorter child of C. C keeps the taller one
+	const U32 fIdx = c.m_children[0];
+	const U32 gIdx = c.m_children[1];
+	const Bool fTaller = m_nodes[fIdx].m_height > m_nodes[gIdx].m_height;
+	const U32 keep = (fTaller) ? fIdx : gIdx;
+	const U32 give = (fTaller) ? gIdx : fIdx;
+
+	c.m_children = {aIdx, keep};
+	a.m_children[tallSide] = give;
+	m_nodes[give].m_parent = aIdx;
+	ANKI_ASSERT(a.m_children[1 - tallSide] != kMaxU32);
+
+	refit(aIdx);
+	refit(cIdx);
+	return cIdx;
+}
+
+void SpatialIndexHandle::allocate(SceneComponent& component)
+{
+	ANKI_ASSERT(!isValid());
+	m_objectIdx = SceneGraph::getSingleton().getSpatialIndex().newObject(&component, component.getType());
+}
+
+void SpatialIndexHandle::update(const Aabb& aabb) const
+{
+	ANKI_ASSERT(isValid());
+	SceneGraph::getSingleton().getSpatialIndex().updateObject(m_objectIdx, aabb);
+}
+
+void SpatialIndexHandle::free()
+{
+	if(isValid())
+	{
+		SceneGraph::getSingleton().getSpatialIndex().deleteObject(m_objectIdx);
+		m_objectIdx = kMaxU32;
+	}
+}
+
+} // end namespace anki
@@ -0,0 +1,330 @@
+// Copyright (C) 2009-present, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#pragma once
+
+#include <AnKi/Scene/Common.h>
+#include <AnKi/Scene/Components/SceneComponent.h>
+#include <AnKi/Collision/Aabb.h>
+#include <AnKi/Collision/Sphere.h>
+#include <AnKi/Collision/Plane.h>
+#include <AnKi/Collision/Ray.h>
+#include <AnKi/Collision/Functions.h>
+#include <AnKi/Util/Thread.h>
+#include <AnKi/Util/WeakArray.h>
+
+namespace anki {
+
+// A BVH over the world bounds of scene components. It's a dynamic AABB tree: objects are inserted and removed one by one and the tree is kept
+// balanced with rotations. The leaves hold enlarged bounds so objects that move a little don't touch the tree at all.
+// The changes (new, update, delete) are thread-safe and they are deferred until flush(). The queries are thread-safe against each other but not
+// against flush().
+class SpatialIndex
+{
+public:
+	static constexpr F32 kAabbMargin = 0.2f; // How much the bounds of the leaves are enlarged
+
+	SpatialIndex() = default;
+
+	SpatialIndex(const SpatialIndex&) = delete; // Non-copyable
+
+	SpatialIndex& operator=(const SpatialIndex&) = delete; // Non-copyable
+
+	// Add a new object. It will be inserted into the tree after the 1st updateObject(). Thread-safe.
+	U32 newObject(SceneComponent* component, SceneComponentType type);
+
+	// Set the world bounds of an object. Thread-safe.
+	void updateObject(U32 objectIdx, const Aabb& aabb);
+
+	// Remove an object. Thread-safe.
+	void deleteObject(U32 objectIdx);
+
+	// Apply the changes to the tree. Not thread-safe.
+	void flush();
+
+	// Visit the objects whose bounds overlap with an AABB. The func is (SceneComponent* component) -> void.
+	template<typename TFunc>
+	void visitAabb(const Aabb& aabb, SceneComponentTypeMask typeMask, TFunc func) const
+	{
+		visit(
+			typeMask,
+			[&](const Aabb& nodeAabb) {
+				return testCollision(nodeAabb, aabb);
+			},
+			func);
+	}
+
+	// Visit the objects whose bounds overlap with a sphere. The func is (SceneComponent* component) -> void.
+	template<typename TFunc>
+	void visitSphere(const Sphere& sphere, SceneComponentTypeMask typeMask, TFunc func) const
+	{
+		visit(
+			typeMask,
+			[&](const Aabb& nodeAabb) {
+				return testCollision(nodeAabb, sphere);
+			},
+			func);
+	}
+
+	// Visit the objects whose bounds are inside or intersect a convex volume made out of planes (like a frustum). The normals of the planes
+	// point inwards. The func is (SceneComponent* component) -> void.
+	template<typename TFunc>
+	void visitPlanes(ConstWeakArray<Plane> planes, SceneComponentTypeMask typeMask, TFunc func) const;
+
+	// Same as visitPlanes() for the frustum of a view projection matrix.
+	template<typename TFunc>
+	void visitFrustum(const Mat4& viewProjection, SceneComponentTypeMask typeMask, TFunc func) const
+	{
+		Array<Plane, 6> planes;
+		extractClipPlanes(viewProjection, planes);
+		visitPlanes(planes, typeMask, func);
+	}
+
+	// Visit the objects whose bounds a ray hits in [0, maxDistance]. The direction of the ray should be normalized. The objects are not visited
+	// in order. The func is (SceneComponent* component, F32 hitDistance) -> void.
+	template<typename TFunc>
+	void visitRay(const Ray& ray, F32 maxDistance, SceneComponentTypeMask typeMask, TFunc func) const;
+
+	U32 getObjectCount() const
+	{
+		return m_objectCount;
+	}
+
+	// The height of the tree. 0 is an empty tree or a tree with a single leaf.
+	U32 getTreeHeight() const
+	{
+		return (m_root != kMaxU32) ? m_nodes[m_root].m_height : 0;
+	}
+
+private:
+	static constexpr U32 kMaxStackSize = 128;
+
+	class Node
+	{
+	public:
+		Aabb m_aabb; // Enlarged for leaves
+		Aabb m_objectAabb; // The actual bounds. For leaves only
+		SceneComponent* m_component = nullptr; // For leaves only
+		U32 m_parent = kMaxU32; // Or the next free node
+		Array<U32, 2> m_children = {kMaxU32, kMaxU32};
+		U32 m_height = 0; // Leaves are at 0
+		SceneComponentTypeMask m_typeMask = SceneComponentTypeMask::kNone; // The types of the objects in the sub-tree
+
+		Bool isLeaf() const
+		{
+			return m_children[0] == kMaxU32;
+		}
+	};
+
+	class Object
+	{
+	public:
+		Aabb m_aabb;
+		SceneComponent* m_component = nullptr;
+		U32 m_leaf = kMaxU32;
+		SceneComponentType m_type = SceneComponentType::kCount;
+		Bool m_hasAabb = false;
+		Bool m_dirty = false;
+		Bool m_deleted = false;
+	};
+
+	// The tree. Only flush() touches it
+	SceneDynamicArray<Node> m_nodes;
+	U32 m_root = kMaxU32;
+	U32 m_freeNodes = kMaxU32;
+	U32 m_objectCount = 0;
+
+	// The objects. Guarded by the lock
+	SpinLock m_mtx;
+	SceneDynamicArray<Object> m_objects;
+	SceneDynamicArray<U32> m_freeObjects;
+	SceneDynamicArray<U32> m_dirtyObjects;
+
+	template<typename TTestFunc, typename TFunc>
+	void visit(SceneComponentTypeMask typeMask, TTestFunc testAabb, TFunc func) const;
+
+	void markDirty(U32 objectIdx);
+
+	U32 newNode();
+	void deleteNode(U32 nodeIdx);
+
+	void insertLeaf(U32 leaf);
+	void removeLeaf(U32 leaf);
+
+	// Re-compute the bounds, height and type mask of an inner node out of its children.
+	void refit(U32 nodeIdx);
+
+	// Rotate the sub-tree if it's imbalanced. Returns the new root of the sub-tree.
+	U32 balance(U32 nodeIdx);
+};
+
+// It's what components hold to be part of the SceneGraph's SpatialIndex.
+class SpatialIndexHandle
+{
+public:
+	SpatialIndexHandle() = default;
+
+	SpatialIndexHandle(const SpatialIndexHandle&) = delete; // Non-copyable
+
+	~SpatialIndexHandle()
+	{
+		free();
+	}
+
+	SpatialIndexHandle& operator=(const SpatialIndexHandle&) = delete; // Non-copyable
+
+	Bool isValid() const
+	{
+		return m_objectIdx != kMaxU32;
+	}
+
+	// Add the component to the index. It doesn't show up in queries before update() is called.
+	void allocate(SceneComponent& component);
+
+	// Set the world bounds of the component.
+	void update(const Aabb& aabb) const;
+
+	void free();
+
+private:
+	U32 m_objectIdx = kMaxU32;
+};
+
+template<typename TTestFunc, typename TFunc>
+void SpatialIndex::visit(SceneComponentTypeMask typeMask, TTestFunc testAabb, TFunc func) const
+{
+	if(m_root == kMaxU32)
+	{
+		return;
+	}
+
+	Array<U32, kMaxStackSize> stack;
+	U32 stackSize = 0;
+	stack[stackSize++] = m_root;
+
+	while(stackSize)
+	{
+		const Node& node = m_nodes[stack[--stackSize]];
+
+		if(!(node.m_typeMask & typeMask))
+		{
+			continue;
+		}
+
+		if(node.isLeaf())
+		{
+			if(testAabb(node.m_objectAabb))
+			{
+				func(node.m_component);
+			}
+		}
+		else if(testAabb(node.m_aabb))
+		{
+			ANKI_ASSERT(stackSize + 2 <= kMaxStackSize);
+			stack[stackSize++] = node.m_children[0];
+			stack[stackSize++] = node.m_children[1];
+		}
+	}
+}
+
+template<typename TFunc>
+void SpatialIndex::visitPlanes(ConstWeakArray<Plane> planes, SceneComponentTypeMask typeMask, TFunc func) const
+{
+	ANKI_ASSERT(planes.getSize() <= 32);
+	if(m_root == kMaxU32)
+	{
+		return;
+	}
+
+	// Every entry holds the planes the sub-tree needs to be tested against. A node that is completely inside a plane doesn't test its children
+	// against it
+	class Entry
+	{
+	public:
+		U32 m_node;
+		U32 m_planeMask;
+	};
+
+	Array<Entry, kMaxStackSize> stack;
+	U32 stackSize = 0;
+	stack[stackSize++] = {m_root, (planes.getSize() == 32) ? kMaxU32 : (1u << planes.getSize()) - 1u};
+
+	while(stackSize)
+	{
+		const Entry entry = stack[--stackSize];
+		const Node& node = m_nodes[entry.m_node];
+
+		if(!(node.m_typeMask & typeMask))
+		{
+			continue;
+		}
+
+		const Aabb& aabb = (node.isLeaf()) ? node.m_objectAabb : node.m_aabb;
+		U32 planeMask = entry.m_planeMask;
+		Bool outside = false;
+		for(U32 i = 0; i < planes.getSize() && !outside; ++i)
+		{
+			if(!(planeMask & (1u << i)))
+			{
+				continue;
+			}
+
+			const F32 test = testPlane(planes[i], aabb);
+			outside = test < 0.0f;
+			if(test > 0.0f)
+			{
+				planeMask &= ~(1u << i);
+			}
+		}
+
+		if(outside)
+		{
+			continue;
+		}
+
+		if(node.isLeaf())
+		{
+			func(node.m_component);
+		}
+		else
+		{
+			ANKI_ASSERT(stackSize + 2 <= kMaxStackSize);
+			stack[stackSize++] = {node.m_children[0], planeMask};
+			stack[stackSize++] = {node.m_children[1], planeMask};
+		}
+	}
+}
+
+template<typename TFunc>
+void SpatialIndex::visitRay(const Ray& ray, F32 maxDistance, SceneComponentTypeMask typeMask, TFunc func) const
+{
+	const Vec3 origin = ray.getOrigin().xyz;
+	const Vec3 dir = ray.getDirection().xyz;
+	const Vec3 invDir(1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z); // Infinities are fine
+
+	// The slab test. Returns the distance of the entry point or a negative value if it misses
+	auto hitDistance = [&](const Aabb& aabb) {
+		const Vec3 t0 = (aabb.getMin().xyz - origin) * invDir;
+		const Vec3 t1 = (aabb.getMax().xyz - origin) * invDir;
+		const Vec3 tmin = t0.min(t1);
+		const Vec3 tmax = t0.max(t1);
+		const F32 enter = max(max(tmin.x, tmin.y), max(tmin.z, 0.0f));
+		const F32 exit = min(min(tmax.x, tmax.y), min(tmax.z, maxDistance));
+		return (enter <= exit) ? enter : -1.0f;
+	};
+
+	F32 distance = 0.0f;
+	visit(
+		typeMask,
+		[&](const Aabb& aabb) {
+			distance = hitDistance(aabb);
+			return distance >= 0.0f;
+		},
+		[&](SceneComponent* component) {
+			func(component, distance);
+		});
+}
+
+} // end namespace anki
@@ -2080,11 +2080,52 @@ static inline int wrapMeshComponentsetMeshFilename(lua_State* l)
 	return 1;
 }
 
+// Wrap method MeshComponent::setOccluder.
+static inline int wrapMeshComponentsetOccluder(lua_State* l)
+{
+	[[maybe_unused]] LuaUserData* ud;
+	[[maybe_unused]] void* voidp;
+	[[maybe_unused]] PtrSize size;
+
+	if(LuaBinder::checkArgsCount(l, ANKI_FILE, __LINE__, ANKI_FUNC, 2)) [[unlikely]]
+	{
+		return lua_error(l);
+	}
+
+	// Get "this" as "self"
+	if(LuaBinder::checkUserData(l, ANKI_FILE, __LINE__, ANKI_FUNC, 1, g_luaUserDataTypeInfoMeshComponent, ud)) [[unlikely]]
+	{
+		return lua_error(l);
+	}
+
+	MeshComponent* self = ud->getData<MeshComponent>();
+
+	// Pop arguments
+	Bool arg0;
+	if(LuaBinder::checkNumber(l, ANKI_FILE, __LINE__, ANKI_FUNC, 2, arg0)) [[unlikely]]
+	{
+		return lua_error(l);
+	}
+
+	// Call the method
+	MeshComponent& ret = self->setOccluder(arg0);
+
+	// Push return value
+	voidp = lua_newuserdata(l, sizeof(LuaUserData));
+	ud = static_cast<LuaUserData*>(voidp);
+	luaL_setmetatable(l, "MeshComponent");
+	extern LuaUserDataTypeInfo g_luaUserDataTypeInfoMeshComponent;
+	ud->initPointed(&g_luaUserDataTypeInfoMeshComponent, &ret);
+
+	return 1;
+}
+
 // Wrap class MeshComponent.
 static inline void wrapMeshComponent(lua_State* l)
 {
 	LuaBinder::createClass(l, &g_luaUserDataTypeInfoMeshComponent);
 	LuaBinder::pushLuaCFuncMethod(l, "setMeshFilename", wrapMeshComponentsetMeshFilename);
+	LuaBinder::pushLuaCFuncMethod(l, "setOccluder", wrapMeshComponentsetOccluder);
 	lua_settop(l, 0);
 }
 
@@ -4292,6 +4333,117 @@ static inline int wrapSceneGraphtryFindSceneNode(lua_State* l)
 	return 1;
 }
 
+// Wrap method SceneGraph::findSceneNodesInSphere.
+static inline int wrapSceneGraphfindSceneNodesInSphere(lua_State* l)
+{
+	[[maybe_unused]] LuaUserData* ud;
+	[[maybe_unused]] void* voidp;
+	[[maybe_unused]] PtrSize size;
+
+	if(LuaBinder::checkArgsCount(l, ANKI_FILE, __LINE__, ANKI_FUNC, 3)) [[unlikely]]
+	{
+		return lua_error(l);
+	}
+
+	// Get "this" as "self"
+	if(LuaBinder::checkUserData(l, ANKI_FILE, __LINE__, ANKI_FUNC, 1, g_luaUserDataTypeInfoSceneGraph, ud)) [[unlikely]]
+	{
+		return lua_error(l);
+	}
+
+	SceneGraph* self = ud->getData<SceneGraph>();
+
+	// Pop arguments
+	extern LuaUserDataTypeInfo g_luaUserDataTypeInfoVec3;
+	if(LuaBinder::checkUserData(l, ANKI_FILE, __LINE__, ANKI_FUNC, 2, g_luaUserDataTypeInfoVec3, ud)) [[unlikely]]
+	{
+		return lua_error(l);
+	}
+
+	Vec3* iarg0 = ud->getData<Vec3>();
+	Vec3 arg0(*iarg0);
+
+	F32 arg1;
+	if(LuaBinder::checkNumber(l, ANKI_FILE, __LINE__, ANKI_FUNC, 3, arg1)) [[unlikely]]
+	{
+		return lua_error(l);
+	}
+
+	// Call the method
+	WeakArraySceneNodePtr ret = self->findSceneNodesInSphere(arg0, arg1);
+
+	// Push return value
+	size = LuaUserData::computeSizeForGarbageCollected<WeakArraySceneNodePtr>();
+	voidp = lua_newuserdata(l, size);
+	luaL_setmetatable(l, "WeakArraySceneNodePtr");
+	ud = static_cast<LuaUserData*>(voidp);
+	extern LuaUserDataTypeInfo g_luaUserDataTypeInfoWeakArraySceneNodePtr;
+	ud->initGarbageCollected(&g_luaUserDataTypeInfoWeakArraySceneNodePtr);
+	::new(ud->getData<WeakArraySceneNodePtr>()) WeakArraySceneNodePtr(std::move(ret));
+
+	return 1;
+}
+
+// Wrap method SceneGraph::findSceneNodesAlongRay.
+static inline int wrapSceneGraphfindSceneNodesAlongRay(lua_State* l)
+{
+	[[maybe_unused]] LuaUserData* ud;
+	[[maybe_unused]] void* voidp;
+	[[maybe_unused]] PtrSize size;
+
+	if(LuaBinder::checkArgsCount(l, ANKI_FILE, __LINE__, ANKI_FUNC, 4)) [[unlikely]]
+	{
+		return lua_error(l);
+	}
+
+	// Get "this" as "self"
+	if(LuaBinder::checkUserData(l, ANKI_FILE, __LINE__, ANKI_FUNC, 1, g_luaUserDataTypeInfoSceneGraph, ud)) [[unlikely]]
+	{
+		return lua_error(l);
+	}
+
+	SceneGraph* self = ud->getData<SceneGraph>();
+
+	// Pop arguments
+	extern LuaUserDataTypeInfo g_luaUserDataTypeInfoVec3;
+	if(LuaBinder::checkUserData(l, ANKI_FILE, __LINE__, ANKI_FUNC, 2, g_luaUserDataTypeInfoVec3, ud)) [[unlikely]]
+	{
+		return lua_error(l);
+	}
+
+	Vec3* iarg0 = ud->getData<Vec3>();
+	Vec3 arg0(*iarg0);
+
+	extern LuaUserDataTypeInfo g_luaUserDataTypeInfoVec3;
+	if(LuaBinder::checkUserData(l, ANKI_FILE, __LINE__, ANKI_FUNC, 3, g_luaUserDataTypeInfoVec3, ud)) [[unlikely]]
+	{
+		return lua_error(l);
+	}
+
+	Vec3* iarg1 = ud->getData<Vec3>();
+	Vec3 arg1(*iarg1);
+
+	F32 arg2;
+	if(LuaBinder::checkNumber(l, ANKI_FILE, __LINE__, ANKI_FUNC, 4, arg2)) [[unlikely]]
+	{
+		return lua_error(l);
+	}
+
+	// Call the method
+	WeakArraySceneNodePtr ret = self->findSceneNodesAlongRay(arg0, arg1, arg2);
+
+	// Push return value
+	size = LuaUserData::computeSizeForGarbageCollected<WeakArraySceneNodePtr>();
+	voidp = lua_newuserdata(l, size);
+	luaL_setmetatable(l, "WeakArraySceneNodePtr");
+	ud = static_cast<LuaUserData*>(voidp);
+	extern LuaUserDataTypeInfo g_luaUserDataTypeInfoWeakArraySceneNodePtr;
+	ud->initGarbageCollected(&g_luaUserDataTypeInfoWeakArraySceneNodePtr);
+	::new(ud->getData<WeakArraySceneNodePtr>()) WeakArraySceneNodePtr(std::move(ret));
+
+	return 1;
+}
+
 // Wrap class SceneGraph.
 static inline void wrapSceneGraph(lua_State* l)
 {
@@ -4299,6 +4451,8 @@ static inline void wrapSceneGraph(lua_State* l)
 	LuaBinder::pushLuaCFuncMethod(l, "newSceneNode", wrapSceneGraphnewSceneNode);
 	LuaBinder::pushLuaCFuncMethod(l, "setActiveCameraNode", wrapSceneGraphsetActiveCameraNode);
 	LuaBinder::pushLuaCFuncMethod(l, "tryFindSceneNode", wrapSceneGraphtryFindSceneNode);
+	LuaBinder::pushLuaCFuncMethod(l, "findSceneNodesInSphere", wrapSceneGraphfindSceneNodesInSphere);
+	LuaBinder::pushLuaCFuncMethod(l, "findSceneNodesAlongRay", wrapSceneGraphfindSceneNodesAlongRay);
 	lua_settop(l, 0);
 }
 
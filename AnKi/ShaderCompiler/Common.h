@@ -64,6 +64,18 @@ public:
 	virtual Error joinTasks() = 0;
 };
 
+/// An interface that caches the compiled IL (SPIR-V or DXIL) of shader variants. The key is a hash of everything that affects the
+/// compilation so the cache can be shared between programs and between runs.
+class ShaderCompilerCacheInterface
+{
+public:
+	/// Thread-safe. Returns false if the key is not in the cache.
+	virtual Bool find(U64 key, ShaderCompilerDynamicArray<U8>& il) = 0;
+
+	/// Thread-safe. Failing to store is not an error, the variant will be compiled next time.
+	virtual void store(U64 key, ConstWeakArray<U8> il) = 0;
+};
+
 class ShaderCompilerDefine
 {
 public:
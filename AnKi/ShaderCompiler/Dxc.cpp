@@ -281,6 +281,53 @@ Error compileHlslToDxil(CString src, ShaderType shaderType, Bool compileWith16bi
 	return compileHlsl(src, shaderType, compileWith16bitTypes, debugInfo, sm, compilerArgs, false, dxil, errorMessage);
 }
 
+Error getDxcVersion(ShaderCompilerString& version, ShaderCompilerString& errorMessage)
+{
+	static Array<Char, 128> cachedVersion = {}; // Not a ShaderCompilerString because it outlives the memory pool
+	static Mutex cachedVersionMtx;
+
+	LockGuard lock(cachedVersionMtx);
+
+	if(cachedVersion[0] == '\0')
+	{
+		ANKI_CHECK(lazyDxcInit(errorMessage));
+
+		CComPtr<IDxcCompiler3> dxcCompiler;
+		ANKI_DXC_CHECK(g_DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&dxcCompiler)));
+
+		CComPtr<IDxcVersionInfo> versionInfo;
+		ANKI_DXC_CHECK(dxcCompiler->QueryInterface(IID_PPV_ARGS(&versionInfo)));
+
+		U32 major, minor;
+		ANKI_DXC_CHECK(versionInfo->GetVersion(&major, &minor));
+		version.sprintf("%u.%u", major, minor);
+
+		// The commit info is optional, older DXC builds don't have it
+		CComPtr<IDxcVersionInfo2> versionInfo2;
+		if(SUCCEEDED(dxcCompiler->QueryInterface(IID_PPV_ARGS(&versionInfo2))))
+		{
+			U32 commitCount;
+			char* commitHash = nullptr;
+			if(SUCCEEDED(versionInfo2->GetCommitInfo(&commitCount, &commitHash)) && commitHash)
+			{
+				version.sprintf("%u.%u.%u.%s", major, minor, commitCount, commitHash);
+				CoTaskMemFree(commitHash);
+			}
+		}
+
+		if(version.getLength() >= cachedVersion.getSize())
+		{
+			errorMessage.sprintf("DXC version string is too long: %s", version.cstr());
+			return Error::kFunctionFailed;
+		}
+
+		memcpy(&cachedVersion[0], version.cstr(), version.getLength() + 1);
+	}
+
+	version = &cachedVersion[0];
+	return Error::kNone;
+}
+
 #if ANKI_OS_WINDOWS
 Error doReflectionDxil(ConstWeakArray<U8> dxil, ShaderType type, ShaderReflection& refl, ShaderCompilerString& errorMessage)
 {
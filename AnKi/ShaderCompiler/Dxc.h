@@ -25,6 +25,9 @@ Error compileHlslToSpirv(CString src, ShaderType shaderType, Bool compileWith16b
 Error compileHlslToDxil(CString src, ShaderType shaderType, Bool compileWith16bitTypes, Bool debugInfo, ShaderModel sm,
 						ConstWeakArray<CString> compilerArgs, ShaderCompilerDynamicArray<U8>& dxil, ShaderCompilerString& errorMessage);
 
+/// Get a string that identifies the DXC build (version and commit). It's computed once and cached.
+Error getDxcVersion(ShaderCompilerString& version, ShaderCompilerString& errorMessage);
+
 Error doReflectionDxil(ConstWeakArray<U8> dxil, ShaderType type, ShaderReflection& refl, ShaderCompilerString& errorMessage);
 /// @}
 
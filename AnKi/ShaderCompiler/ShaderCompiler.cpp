@@ -94,20 +94,193 @@ static Bool spinDials(ShaderCompilerDynamicArray<U32>& dials, ConstWeakArray<Sha
 	return done;
 }
 
+/// Compute the key of a variant in the ShaderCompilerCacheInterface. It should contain everything that affects the compiler's output.
+static U64 computeVariantCacheKey(U64 sourceCodeHash, U64 compilerVersionHash, ShaderType shaderType, Bool spirv, Bool debugInfo, ShaderModel sm,
+								  ConstWeakArray<CString> compilerArgs)
+{
+	class Desc
+	{
+	public:
+		U64 m_sourceCodeHash;
+		U64 m_compilerVersionHash;
+		U32 m_version;
+		ShaderType m_shaderType;
+		Bool m_spirv;
+		Bool m_debugInfo;
+		ShaderModel m_sm;
+	};
+
+	Desc desc;
+	zeroMemory(desc);
+	desc.m_sourceCodeHash = sourceCodeHash;
+	desc.m_compilerVersionHash = compilerVersionHash;
+	desc.m_version = kShaderVariantCacheVersion;
+	desc.m_shaderType = shaderType;
+	desc.m_spirv = spirv;
+	desc.m_debugInfo = debugInfo;
+	desc.m_sm = sm;
+
+	U64 key = computeObjectHash(desc);
+	for(CString arg : compilerArgs)
+	{
+		key = appendHash(arg.cstr(), arg.getLength() + 1, key);
+	}
+
+	return key;
+}
+
+/// Finds the code blocks and the variants that were already compiled. The hashes are split in shards with separate locks so the compilation
+/// threads rarely wait for each other.
+class VariantDedupTable
+{
+public:
+	VariantDedupTable(ShaderCompilerDynamicArray<ShaderBinaryVariant>& variants, ShaderCompilerDynamicArray<ShaderBinaryCodeBlock>& codeBlocks)
+		: m_variants(variants)
+		, m_codeBlocks(codeBlocks)
+	{
+	}
+
+	/// Thread-safe. Returns kMaxU32 if the source was not compiled before.
+	U32 findSource(U64 sourceCodeHash)
+	{
+		Shard& shard = getShard(sourceCodeHash);
+		LockGuard lock(shard.m_mtx);
+		auto it = shard.m_sourceHashToCodeBlock.find(sourceCodeHash);
+		return (it != shard.m_sourceHashToCodeBlock.getEnd()) ? *it : kMaxU32;
+	}
+
+	/// Thread-safe. Returns kMaxU32 if there is no code block with that IL.
+	U32 findIl(U64 ilHash)
+	{
+		Shard& shard = getShard(ilHash);
+		LockGuard lock(shard.m_mtx);
+		auto it = shard.m_ilHashToCodeBlock.find(ilHash);
+		return (it != shard.m_ilHashToCodeBlock.getEnd()) ? *it : kMaxU32;
+	}
+
+	/// Thread-safe. Remember the code block of a source. Different sources might compile to the same IL.
+	void addSource(U64 sourceCodeHash, U32 codeBlockIdx)
+	{
+		Shard& shard = getShard(sourceCodeHash);
+		LockGuard lock(shard.m_mtx);
+		if(shard.m_sourceHashToCodeBlock.find(sourceCodeHash) == shard.m_sourceHashToCodeBlock.getEnd())
+		{
+			shard.m_sourceHashToCodeBlock.emplace(sourceCodeHash, codeBlockIdx);
+		}
+	}
+
+	/// Thread-safe. Add a code block if there is no other with the same IL. Returns the index of the code block.
+	U32 addCodeBlock(U64 sourceCodeHash, U64 ilHash, ShaderCompilerDynamicArray<U8>& il, const ShaderReflection& refl)
+	{
+		U32 idx;
+		{
+			Shard& shard = getShard(ilHash);
+			LockGuard lock(shard.m_mtx);
+
+			auto it = shard.m_ilHashToCodeBlock.find(ilHash);
+			if(it == shard.m_ilHashToCodeBlock.getEnd())
+			{
+				{
+					LockGuard lock2(m_codeBlocksMtx);
+					idx = m_codeBlocks.getSize();
+
+					ShaderBinaryCodeBlock& codeBlock = *m_codeBlocks.emplaceBack();
+					il.moveAndReset(codeBlock.m_binary);
+					codeBlock.m_hash = ilHash;
+					codeBlock.m_reflection = refl;
+				}
+
+				shard.m_ilHashToCodeBlock.emplace(ilHash, idx);
+			}
+			else
+			{
+				idx = *it;
+			}
+		}
+
+		addSource(sourceCodeHash, idx);
+		return idx;
+	}
+
+	/// Thread-safe. Find a variant with the same code blocks or create a new one. Returns the index of the variant.
+	U32 addVariant(ShaderCompilerDynamicArray<ShaderBinaryTechniqueCodeBlocks>& codeBlockIndices)
+	{
+		const U64 hash = computeHash(codeBlockIndices.getBegin(), codeBlockIndices.getSizeInBytes());
+
+		LockGuard lock(m_variantsMtx);
+
+		auto it = m_variantHashToIdx.find(hash);
+		if(it != m_variantHashToIdx.getEnd())
+		{
+			const ShaderBinaryVariant& variant = m_variants[*it];
+			ANKI_ASSERT(variant.m_techniqueCodeBlocks.getSize() == codeBlockIndices.getSize());
+			if(memcmp(variant.m_techniqueCodeBlocks.getBegin(), codeBlockIndices.getBegin(), codeBlockIndices.getSizeInBytes()) == 0)
+			{
+				return *it;
+			}
+		}
+
+		const U32 idx = m_variants.getSize();
+		ShaderBinaryVariant* variant = m_variants.emplaceBack();
+		codeBlockIndices.moveAndReset(variant->m_techniqueCodeBlocks);
+
+		if(it == m_variantHashToIdx.getEnd())
+		{
+			m_variantHashToIdx.emplace(hash, idx);
+		}
+
+		return idx;
+	}
+
+private:
+	/// The keys are already hashes.
+	class HashHasher
+	{
+	public:
+		U64 operator()(U64 hash) const
+		{
+			return hash;
+		}
+	};
+
+	class Shard
+	{
+	public:
+		Mutex m_mtx;
+		ShaderCompilerHashMap<U64, U32, HashHasher> m_sourceHashToCodeBlock;
+		ShaderCompilerHashMap<U64, U32, HashHasher> m_ilHashToCodeBlock;
+	};
+
+	static constexpr U32 kShardCount = 16;
+
+	Array<Shard, kShardCount> m_shards;
+
+	ShaderCompilerDynamicArray<ShaderBinaryVariant>& m_variants;
+	ShaderCompilerHashMap<U64, U32, HashHasher> m_variantHashToIdx;
+	Mutex m_variantsMtx;
+
+	ShaderCompilerDynamicArray<ShaderBinaryCodeBlock>& m_codeBlocks;
+	Mutex m_codeBlocksMtx;
+
+	Shard& getShard(U64 hash)
+	{
+		// Use the high bits, the hash maps use the low ones
+		return m_shards[(hash >> 32) % kShardCount];
+	}
+};
+
 static void compileVariantAsync(const ShaderParser& parser, Bool spirv, Bool debugInfo, ShaderModel sm, ShaderBinaryMutation& mutation,
-								ShaderCompilerDynamicArray<ShaderBinaryVariant>& variants,
-								ShaderCompilerDynamicArray<ShaderBinaryCodeBlock>& codeBlocks, ShaderCompilerDynamicArray<U64>& sourceCodeHashes,
-								ShaderCompilerAsyncTaskInterface& taskManager, Mutex& mtx, Atomic<I32>& error)
+								VariantDedupTable& dedupTable, ShaderCompilerAsyncTaskInterface& taskManager, ShaderCompilerCacheInterface* cache,
+								U64 compilerVersionHash, Atomic<I32>& error)
 {
 	class Ctx
 	{
 	public:
 		const ShaderParser* m_parser;
 		ShaderBinaryMutation* m_mutation;
-		ShaderCompilerDynamicArray<ShaderBinaryVariant>* m_variants;
-		ShaderCompilerDynamicArray<ShaderBinaryCodeBlock>* m_codeBlocks;
-		ShaderCompilerDynamicArray<U64>* m_sourceCodeHashes;
-		Mutex* m_mtx;
+		VariantDedupTable* m_dedupTable;
+		ShaderCompilerCacheInterface* m_cache;
+		U64 m_compilerVersionHash;
 		Atomic<I32>* m_err;
 		Bool m_spirv;
 		Bool m_debugInfo;
@@ -117,10 +290,9 @@ static void compileVariantAsync(const ShaderParser& parser, Bool spirv, Bool deb
 	Ctx* ctx = newInstance<Ctx>(ShaderCompilerMemoryPool::getSingleton());
 	ctx->m_parser = &parser;
 	ctx->m_mutation = &mutation;
-	ctx->m_variants = &variants;
-	ctx->m_codeBlocks = &codeBlocks;
-	ctx->m_sourceCodeHashes = &sourceCodeHashes;
-	ctx->m_mtx = &mtx;
+	ctx->m_dedupTable = &dedupTable;
+	ctx->m_cache = cache;
+	ctx->m_compilerVersionHash = compilerVersionHash;
 	ctx->m_err = &error;
 	ctx->m_spirv = spirv;
 	ctx->m_debugInfo = debugInfo;
@@ -157,7 +329,6 @@ static void compileVariantAsync(const ShaderParser& parser, Bool spirv, Bool deb
 
 		ShaderCompilerString compilerErrorLog;
 		Error err = Error::kNone;
-		U newCodeBlockCount = 0;
 		for(U32 t = 0; t < techniqueCount && !err; ++t)
 		{
 			const ShaderParserTechnique& technique = ctx.m_parser->getTechniques()[t];
@@ -171,45 +342,52 @@ static void compileVariantAsync(const ShaderParser& parser, Bool spirv, Bool deb
 
 				if(technique.m_activeMutators[shaderType] != kMaxU64)
 				{
-					LockGuard lock(*ctx.m_mtx);
-
-					ANKI_ASSERT(ctx.m_sourceCodeHashes->getSize() == ctx.m_codeBlocks->getSize());
-
-					Bool found = false;
-					for(U32 i = 0; i < ctx.m_sourceCodeHashes->getSize(); ++i)
-					{
-						if((*ctx.m_sourceCodeHashes)[i] == sourceCodeHash)
-						{
-							codeBlockIndices[t].m_codeBlockIndices[shaderType] = i;
-							found = true;
-							break;
-						}
-					}
-
-					if(found)
+					const U32 codeBlockIdx = ctx.m_dedupTable->findSource(sourceCodeHash);
+					if(codeBlockIdx != kMaxU32)
 					{
+						codeBlockIndices[t].m_codeBlockIndices[shaderType] = codeBlockIdx;
 						continue;
 					}
 				}
 
+				// Try the cache before invoking the compiler
 				ShaderCompilerDynamicArray<U8> il;
-				if(ctx.m_spirv)
+				const U64 cacheKey = (ctx.m_cache) ? computeVariantCacheKey(sourceCodeHash, ctx.m_compilerVersionHash, shaderType, ctx.m_spirv,
+																			 ctx.m_debugInfo, ctx.m_sm, ctx.m_parser->getExtraCompilerArgs())
+												   : 0;
+				if(!ctx.m_cache || !ctx.m_cache->find(cacheKey, il))
 				{
-					err = compileHlslToSpirv(source, shaderType, true, ctx.m_debugInfo, ctx.m_sm, ctx.m_parser->getExtraCompilerArgs(), il,
-											 compilerErrorLog);
-				}
-				else
-				{
-					err = compileHlslToDxil(source, shaderType, true, ctx.m_debugInfo, ctx.m_sm, ctx.m_parser->getExtraCompilerArgs(), il,
-											compilerErrorLog);
-				}
+					if(ctx.m_spirv)
+					{
+						err = compileHlslToSpirv(source, shaderType, true, ctx.m_debugInfo, ctx.m_sm, ctx.m_parser->getExtraCompilerArgs(), il,
+												 compilerErrorLog);
+					}
+					else
+					{
+						err = compileHlslToDxil(source, shaderType, true, ctx.m_debugInfo, ctx.m_sm, ctx.m_parser->getExtraCompilerArgs(), il,
+												compilerErrorLog);
+					}
 
-				if(err)
-				{
-					break;
+					if(err)
+					{
+						break;
+					}
+
+					if(ctx.m_cache)
+					{
+						ctx.m_cache->store(cacheKey, il);
+					}
 				}
 
+				// Skip the reflection if the IL is already there
 				const U64 newHash = computeHash(il.getBegin(), il.getSizeInBytes());
+				const U32 existingCodeBlockIdx = ctx.m_dedupTable->findIl(newHash);
+				if(existingCodeBlockIdx != kMaxU32)
+				{
+					ctx.m_dedupTable->addSource(sourceCodeHash, existingCodeBlockIdx);
+					codeBlockIndices[t].m_codeBlockIndices[shaderType] = existingCodeBlockIdx;
+					continue;
+				}
 
 				ShaderReflection refl;
 				if(ctx.m_spirv)
@@ -232,35 +410,7 @@ static void compileVariantAsync(const ShaderParser& parser, Bool spirv, Bool deb
 				}
 
 				// Add the binary if not already there
-				{
-					LockGuard lock(*ctx.m_mtx);
-
-					Bool found = false;
-					for(U32 j = 0; j < ctx.m_codeBlocks->getSize(); ++j)
-					{
-						if((*ctx.m_codeBlocks)[j].m_hash == newHash)
-						{
-							codeBlockIndices[t].m_codeBlockIndices[shaderType] = j;
-							found = true;
-							break;
-						}
-					}
-
-					if(!found)
-					{
-						codeBlockIndices[t].m_codeBlockIndices[shaderType] = ctx.m_codeBlocks->getSize();
-
-						auto& codeBlock = *ctx.m_codeBlocks->emplaceBack();
-						il.moveAndReset(codeBlock.m_binary);
-						codeBlock.m_hash = newHash;
-						codeBlock.m_reflection = refl;
-
-						ctx.m_sourceCodeHashes->emplaceBack(sourceCodeHash);
-						ANKI_ASSERT(ctx.m_sourceCodeHashes->getSize() == ctx.m_codeBlocks->getSize());
-
-						++newCodeBlockCount;
-					}
-				}
+				codeBlockIndices[t].m_codeBlockIndices[shaderType] = ctx.m_dedupTable->addCodeBlock(sourceCodeHash, newHash, il, refl);
 			}
 		}
 
@@ -276,50 +426,8 @@ static void compileVariantAsync(const ShaderParser& parser, Bool spirv, Bool deb
 			return;
 		}
 
-		// Do variant stuff
-		{
-			LockGuard lock(*ctx.m_mtx);
-
-			Bool createVariant = true;
-			if(newCodeBlockCount == 0)
-			{
-				// No new code blocks generated, search all variants to see if there is a duplicate
-
-				for(U32 i = 0; i < ctx.m_variants->getSize(); ++i)
-				{
-					Bool same = true;
-					for(U32 t = 0; t < techniqueCount; ++t)
-					{
-						const ShaderBinaryTechniqueCodeBlocks& a = (*ctx.m_variants)[i].m_techniqueCodeBlocks[t];
-						const ShaderBinaryTechniqueCodeBlocks& b = codeBlockIndices[t];
-
-						if(memcmp(&a, &b, sizeof(a)) != 0)
-						{
-							// Not the same
-							same = false;
-							break;
-						}
-					}
-
-					if(same)
-					{
-						createVariant = false;
-						ctx.m_mutation->m_variantIndex = i;
-						break;
-					}
-				}
-			}
-
-			// Create a new variant
-			if(createVariant)
-			{
-				ctx.m_mutation->m_variantIndex = ctx.m_variants->getSize();
-
-				ShaderBinaryVariant* variant = ctx.m_variants->emplaceBack();
-
-				codeBlockIndices.moveAndReset(variant->m_techniqueCodeBlocks);
-			}
-		}
+		// Do variant stuff. Always search for an identical variant since another thread might have created the code blocks first
+		ctx.m_mutation->m_variantIndex = ctx.m_dedupTable->addVariant(codeBlockIndices);
 	};
 
 	taskManager.enqueueTask(callback, ctx);
@@ -327,7 +435,7 @@ static void compileVariantAsync(const ShaderParser& parser, Bool spirv, Bool deb
 
 static Error compileShaderProgramInternal(CString fname, Bool spirv, Bool debugInfo, ShaderModel sm, ShaderCompilerFilesystemInterface& fsystem,
 										  ShaderCompilerPostParseInterface* postParseCallback, ShaderCompilerAsyncTaskInterface* taskManager_,
-										  ConstWeakArray<ShaderCompilerDefine> defines_, ShaderBinary*& binary)
+										  ShaderCompilerCacheInterface* cache, ConstWeakArray<ShaderCompilerDefine> defines_, ShaderBinary*& binary)
 {
 	ShaderCompilerMemoryPool& memPool = ShaderCompilerMemoryPool::getSingleton();
 
@@ -350,6 +458,21 @@ static Error compileShaderProgramInternal(CString fname, Bool spirv, Bool debugI
 		return Error::kNone;
 	}
 
+	// The cached variants are only valid for the compiler that produced them
+	U64 compilerVersionHash = 0;
+	if(cache)
+	{
+		ShaderCompilerString compilerVersion;
+		ShaderCompilerString errorMessage;
+		if(getDxcVersion(compilerVersion, errorMessage))
+		{
+			ANKI_SHADER_COMPILER_LOGE("Failed to get the DXC version: %s", errorMessage.cstr());
+			return Error::kFunctionFailed;
+		}
+
+		compilerVersionHash = compilerVersion.computeHash();
+	}
+
 	// Get mutators
 	U32 mutationCount = 0;
 	if(parser.getMutators().getSize() > 0)
@@ -378,7 +501,6 @@ static Error compileShaderProgramInternal(CString fname, Bool spirv, Bool debugI
 	}
 
 	// Create all variants
-	Mutex mtx;
 	Atomic<I32> errorAtomic(0);
 	class SyncronousShaderCompilerAsyncTaskInterface : public ShaderCompilerAsyncTaskInterface
 	{
@@ -405,7 +527,7 @@ static Error compileShaderProgramInternal(CString fname, Bool spirv, Bool debugI
 		dials.resize(parser.getMutators().getSize(), 0);
 		ShaderCompilerDynamicArray<ShaderBinaryVariant> variants;
 		ShaderCompilerDynamicArray<ShaderBinaryCodeBlock> codeBlocks;
-		ShaderCompilerDynamicArray<U64> sourceCodeHashes;
+		VariantDedupTable dedupTable(variants, codeBlocks);
 		ShaderCompilerDynamicArray<ShaderBinaryMutation> mutations;
 		mutations.resize(mutationCount);
 		ShaderCompilerHashMap<U64, U32> mutationHashToIdx;
@@ -441,7 +563,7 @@ static Error compileShaderProgramInternal(CString fname, Bool spirv, Bool debugI
 			{
 				// New and unique mutation and thus variant, add it
 
-				compileVariantAsync(parser, spirv, debugInfo, sm, mutation, variants, codeBlocks, sourceCodeHashes, taskManager, mtx, errorAtomic);
+				compileVariantAsync(parser, spirv, debugInfo, sm, mutation, dedupTable, taskManager, cache, compilerVersionHash, errorAtomic);
 
 				ANKI_ASSERT(mutationHashToIdx.find(mutation.m_hash) == mutationHashToIdx.getEnd());
 				mutationHashToIdx.emplace(mutation.m_hash, mutationCount - 1);
@@ -466,10 +588,9 @@ static Error compileShaderProgramInternal(CString fname, Bool spirv, Bool debugI
 		newArray(memPool, 1, binary->m_mutations);
 		ShaderCompilerDynamicArray<ShaderBinaryVariant> variants;
 		ShaderCompilerDynamicArray<ShaderBinaryCodeBlock> codeBlocks;
-		ShaderCompilerDynamicArray<U64> sourceCodeHashes;
+		VariantDedupTable dedupTable(variants, codeBlocks);
 
-		compileVariantAsync(parser, spirv, debugInfo, sm, binary->m_mutations[0], variants, codeBlocks, sourceCodeHashes, taskManager, mtx,
-							errorAtomic);
+		compileVariantAsync(parser, spirv, debugInfo, sm, binary->m_mutations[0], dedupTable, taskManager, cache, compilerVersionHash, errorAtomic);
 
 		ANKI_CHECK(taskManager.joinTasks());
 		ANKI_CHECK(Error(errorAtomic.getNonAtomically()));
@@ -538,9 +659,9 @@ static Error compileShaderProgramInternal(CString fname, Bool spirv, Bool debugI
 
 Error compileShaderProgram(CString fname, Bool spirv, Bool debugInfo, ShaderModel sm, ShaderCompilerFilesystemInterface& fsystem,
 						   ShaderCompilerPostParseInterface* postParseCallback, ShaderCompilerAsyncTaskInterface* taskManager,
-						   ConstWeakArray<ShaderCompilerDefine> defines, ShaderBinary*& binary)
+						   ShaderCompilerCacheInterface* cache, ConstWeakArray<ShaderCompilerDefine> defines, ShaderBinary*& binary)
 {
-	const Error err = compileShaderProgramInternal(fname, spirv, debugInfo, sm, fsystem, postParseCallback, taskManager, defines, binary);
+	const Error err = compileShaderProgramInternal(fname, spirv, debugInfo, sm, fsystem, postParseCallback, taskManager, cache, defines, binary);
 	if(err)
 	{
 		ANKI_SHADER_COMPILER_LOGE("Failed to compile: %s", fname.cstr());
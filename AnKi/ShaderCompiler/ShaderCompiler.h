@@ -17,6 +17,9 @@ namespace anki {
 inline constexpr const char* kShaderBinaryMagic = "ANKISP1"; // WARNING: If changed change kShaderBinaryVersion
 constexpr U32 kShaderBinaryVersion = 1;
 
+/// Bump it to invalidate all the entries of the shader variant caches (eg when the compiler or the way it's invoked changes).
+constexpr U32 kShaderVariantCacheVersion = 1;
+
 template<typename TFile>
 Error deserializeShaderBinaryFromAnyFile(TFile& file, ShaderBinary*& binary, BaseMemoryPool& pool)
 {
@@ -40,9 +43,10 @@ inline Error deserializeShaderBinaryFromFile(CString fname, ShaderBinary*& binar
 }
 
 /// Takes an AnKi special shader program and spits a binary.
+/// @param cache Optional. If present the compiled variants will be looked up and stored there.
 Error compileShaderProgram(CString fname, Bool spirv, Bool debugInfo, ShaderModel sm, ShaderCompilerFilesystemInterface& fsystem,
 						   ShaderCompilerPostParseInterface* postParseCallback, ShaderCompilerAsyncTaskInterface* taskManager,
-						   ConstWeakArray<ShaderCompilerDefine> defines, ShaderBinary*& binary);
+						   ShaderCompilerCacheInterface* cache, ConstWeakArray<ShaderCompilerDefine> defines, ShaderBinary*& binary);
 
 /// Free the binary created ONLY by compileShaderProgram.
 void freeShaderBinary(ShaderBinary*& binary);
@@ -0,0 +1,137 @@
+// Copyright (C) 2009-present, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <AnKi/ShaderCompiler/ShaderVariantCache.h>
+#include <AnKi/Util/File.h>
+#include <AnKi/Util/Filesystem.h>
+#include <AnKi/Util/Process.h>
+#include <AnKi/Util/Hash.h>
+
+namespace anki {
+
+inline constexpr const char* kShaderVariantCacheMagic = "ANKISVC1";
+
+static Atomic<U32> g_nextTmpFileId = {1};
+
+/// The header of every file in the cache. The IL follows.
+class ShaderVariantCacheFileHeader
+{
+public:
+	Array<U8, 8> m_magic;
+	U64 m_key;
+	U64 m_ilHash;
+	U64 m_ilSize;
+};
+
+Error ShaderVariantDiskCache::init(CString directory)
+{
+	ANKI_ASSERT(m_directory.isEmpty());
+
+	if(!directoryExists(directory))
+	{
+		ANKI_CHECK(createDirectory(directory));
+	}
+
+	m_directory = directory;
+	return Error::kNone;
+}
+
+void ShaderVariantDiskCache::getFilename(U64 key, ShaderCompilerString& fname) const
+{
+	fname.sprintf("%s/%016" PRIx64 ".svc", m_directory.cstr(), key);
+}
+
+Bool ShaderVariantDiskCache::find(U64 key, ShaderCompilerDynamicArray<U8>& il)
+{
+	ANKI_ASSERT(!m_directory.isEmpty());
+
+	ShaderCompilerString fname;
+	getFilename(key, fname);
+
+	Bool hit = false;
+	if(fileExists(fname))
+	{
+		File file;
+		ShaderVariantCacheFileHeader header;
+		if(!file.open(fname, FileOpenFlag::kRead | FileOpenFlag::kBinary) && file.getSize() >= sizeof(header) && !file.read(&header, sizeof(header))
+		   && memcmp(&header.m_magic[0], kShaderVariantCacheMagic, sizeof(header.m_magic)) == 0 && header.m_key == key
+		   && header.m_ilSize > 0 && header.m_ilSize == file.getSize() - sizeof(header))
+		{
+			il.resize(U32(header.m_ilSize));
+			hit = !file.read(il.getBegin(), il.getSizeInBytes()) && computeHash(il.getBegin(), il.getSizeInBytes()) == header.m_ilHash;
+		}
+
+		if(!hit)
+		{
+			ANKI_SHADER_COMPILER_LOGW("Corrupted shader variant cache file, will recompile: %s", fname.cstr());
+			il.destroy();
+		}
+	}
+
+	if(hit)
+	{
+		m_hitCount.fetchAdd(1);
+		m_hitByteCount.fetchAdd(il.getSizeInBytes());
+	}
+	else
+	{
+		m_missCount.fetchAdd(1);
+	}
+
+	return hit;
+}
+
+void ShaderVariantDiskCache::store(U64 key, ConstWeakArray<U8> il)
+{
+	ANKI_ASSERT(!m_directory.isEmpty() && il.getSize() > 0);
+
+	ShaderCompilerString fname;
+	getFilename(key, fname);
+
+	// Write to a file that no other thread or process uses and then move it in place. Renaming is atomic so readers will never see half a file
+	ShaderCompilerString tmpFname;
+	tmpFname.sprintf("%s.%u.%u.tmp", fname.cstr(), getCurrentProcessId(), g_nextTmpFileId.fetchAdd(1));
+
+	ShaderVariantCacheFileHeader header;
+	memcpy(&header.m_magic[0], kShaderVariantCacheMagic, sizeof(header.m_magic));
+	header.m_key = key;
+	header.m_ilHash = computeHash(il.getBegin(), il.getSizeInBytes());
+	header.m_ilSize = il.getSizeInBytes();
+
+	Error err = Error::kNone;
+	{
+		File file;
+		err = file.open(tmpFname, FileOpenFlag::kWrite | FileOpenFlag::kBinary);
+		if(!err)
+		{
+			err = file.write(&header, sizeof(header));
+		}
+
+		if(!err)
+		{
+			err = file.write(il.getBegin(), il.getSizeInBytes());
+		}
+	}
+
+	if(!err)
+	{
+		err = renameFile(tmpFname, fname);
+	}
+
+	if(err)
+	{
+		ANKI_SHADER_COMPILER_LOGW("Failed to store shader variant to the cache: %s", fname.cstr());
+		if(fileExists(tmpFname))
+		{
+			[[maybe_unused]] const Error err2 = removeFile(tmpFname);
+		}
+	}
+	else
+	{
+		m_storeCount.fetchAdd(1);
+	}
+}
+
+} // end namespace anki
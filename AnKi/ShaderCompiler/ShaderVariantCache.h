@@ -0,0 +1,62 @@
+// Copyright (C) 2009-present, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#pragma once
+
+#include <AnKi/ShaderCompiler/Common.h>
+#include <AnKi/Util/Atomic.h>
+
+namespace anki {
+
+/// @addtogroup shader_compiler
+/// @{
+
+/// A content-addressed ShaderCompilerCacheInterface that stores every variant in a separate file inside a directory. Many processes can share
+/// the same directory since the files are written to a temporary and then renamed.
+class ShaderVariantDiskCache final : public ShaderCompilerCacheInterface
+{
+public:
+	/// Create the directory if it's not there.
+	Error init(CString directory);
+
+	Bool find(U64 key, ShaderCompilerDynamicArray<U8>& il) final;
+
+	void store(U64 key, ConstWeakArray<U8> il) final;
+
+	U32 getHitCount() const
+	{
+		return m_hitCount.load();
+	}
+
+	U32 getMissCount() const
+	{
+		return m_missCount.load();
+	}
+
+	/// Number of variants that were stored successfully.
+	U32 getStoreCount() const
+	{
+		return m_storeCount.load();
+	}
+
+	/// Bytes of IL read from the cache.
+	PtrSize getHitByteCount() const
+	{
+		return m_hitByteCount.load();
+	}
+
+private:
+	ShaderCompilerString m_directory;
+
+	Atomic<U32> m_hitCount = {0};
+	Atomic<U32> m_missCount = {0};
+	Atomic<U32> m_storeCount = {0};
+	Atomic<PtrSize> m_hitByteCount = {0};
+
+	void getFilename(U64 key, ShaderCompilerString& fname) const;
+};
+/// @}
+
+} // end namespace anki
@@ -32,6 +32,7 @@
 #include <AnKi/Util/Thread.h>
 #include <AnKi/Util/ThreadPool.h>
 #include <AnKi/Util/ThreadJobManager.h>
+#include <AnKi/Util/TaskGraph.h>
 #include <AnKi/Util/INotify.h>
 #include <AnKi/Util/SparseArray.h>
 #include <AnKi/Util/BlockArray.h>
@@ -157,4 +157,63 @@ private:
 	}
 };
 
+// A read-only memory mapped view of a whole file. The OS pages the contents in on demand so the data can be accessed without any intermediate
+// copies or read syscalls. Special files (see File) can't be mapped.
+class MemoryMappedFile
+{
+public:
+	MemoryMappedFile() = default;
+
+	MemoryMappedFile(const MemoryMappedFile&) = delete; // Non-copyable
+
+	MemoryMappedFile(MemoryMappedFile&& b)
+	{
+		*this = std::move(b);
+	}
+
+	~MemoryMappedFile()
+	{
+		close();
+	}
+
+	MemoryMappedFile& operator=(const MemoryMappedFile&) = delete; // Non-copyable
+
+	MemoryMappedFile& operator=(MemoryMappedFile&& b)
+	{
+		close();
+		m_data = b.m_data;
+		m_size = b.m_size;
+		b.m_data = nullptr;
+		b.m_size = 0;
+		return *this;
+	}
+
+	// Map a file. Empty files can't be mapped but that's not an error, the file just stays closed.
+	Error open(CString filename);
+
+	// Unmap the file.
+	void close();
+
+	Bool isOpen() const
+	{
+		return m_data != nullptr;
+	}
+
+	const U8* getData() const
+	{
+		ANKI_ASSERT(isOpen());
+		return m_data;
+	}
+
+	PtrSize getSize() const
+	{
+		ANKI_ASSERT(isOpen());
+		return m_size;
+	}
+
+private:
+	const U8* m_data = nullptr;
+	PtrSize m_size = 0;
+};
+
 } // end namespace anki
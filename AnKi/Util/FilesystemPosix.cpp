@@ -9,6 +9,7 @@
 #define _FILE_OFFSET_BITS 64
 
 #include <AnKi/Util/Filesystem.h>
+#include <AnKi/Util/File.h>
 #include <AnKi/Util/Assert.h>
 #include <AnKi/Util/Thread.h>
 #include <cstring>
@@ -20,6 +21,8 @@
 #include <cstdlib>
 #include <time.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 #if ANKI_OS_ANDROID
 #	include <android_native_app_glue.h>
 #endif
@@ -277,4 +280,57 @@ Error getApplicationPath(String& out)
 	return Error::kNone;
 }
 
+Error MemoryMappedFile::open(CString filename)
+{
+	ANKI_ASSERT(!isOpen());
+
+	const int fd = ::open(filename.cstr(), O_RDONLY);
+	if(fd < 0)
+	{
+		ANKI_UTIL_LOGE("open() failed: %s", filename.cstr());
+		return Error::kFileAccess;
+	}
+
+	struct stat st;
+	if(fstat(fd, &st) != 0)
+	{
+		ANKI_UTIL_LOGE("fstat() failed: %s", filename.cstr());
+		::close(fd);
+		return Error::kFileAccess;
+	}
+
+	if(st.st_size <= 0)
+	{
+		// Nothing to map
+		::close(fd);
+		return Error::kNone;
+	}
+
+	void* data = mmap(nullptr, PtrSize(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd); // The mapping keeps a reference to the file
+	if(data == MAP_FAILED)
+	{
+		ANKI_UTIL_LOGE("mmap() failed: %s", filename.cstr());
+		return Error::kFileAccess;
+	}
+
+	// Resources are usually consumed front to back so ask for aggressive read-ahead
+	madvise(data, PtrSize(st.st_size), MADV_SEQUENTIAL);
+	madvise(data, PtrSize(st.st_size), MADV_WILLNEED);
+
+	m_data = static_cast<const U8*>(data);
+	m_size = PtrSize(st.st_size);
+	return Error::kNone;
+}
+
+void MemoryMappedFile::close()
+{
+	if(m_data)
+	{
+		munmap(const_cast<U8*>(m_data), m_size);
+		m_data = nullptr;
+		m_size = 0;
+	}
+}
+
 } // end namespace anki
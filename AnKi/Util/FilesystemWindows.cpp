@@ -4,6 +4,7 @@
 // http://www.anki3d.org/LICENSE
 
 #include <AnKi/Util/Filesystem.h>
+#include <AnKi/Util/File.h>
 #include <AnKi/Util/Assert.h>
 #include <AnKi/Util/Logger.h>
 #include <AnKi/Util/Win32Minimal.h>
@@ -221,4 +222,62 @@ Error getApplicationPath(String& out)
 	return Error::kNone;
 }
 
+Error MemoryMappedFile::open(CString filename)
+{
+	ANKI_ASSERT(!isOpen());
+
+	const HANDLE file = CreateFileA(filename.cstr(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+									FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if(file == INVALID_HANDLE_VALUE)
+	{
+		ANKI_UTIL_LOGE("CreateFileA() failed: %s", filename.cstr());
+		return Error::kFileAccess;
+	}
+
+	LARGE_INTEGER size;
+	if(!GetFileSizeEx(file, &size))
+	{
+		ANKI_UTIL_LOGE("GetFileSizeEx() failed: %s", filename.cstr());
+		CloseHandle(file);
+		return Error::kFileAccess;
+	}
+
+	if(size.QuadPart <= 0)
+	{
+		// Nothing to map
+		CloseHandle(file);
+		return Error::kNone;
+	}
+
+	const HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	CloseHandle(file); // The mapping keeps a reference to the file
+	if(!mapping)
+	{
+		ANKI_UTIL_LOGE("CreateFileMappingA() failed: %s", filename.cstr());
+		return Error::kFileAccess;
+	}
+
+	void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping); // The view keeps a reference to the mapping
+	if(!data)
+	{
+		ANKI_UTIL_LOGE("MapViewOfFile() failed: %s", filename.cstr());
+		return Error::kFileAccess;
+	}
+
+	m_data = static_cast<const U8*>(data);
+	m_size = PtrSize(size.QuadPart);
+	return Error::kNone;
+}
+
+void MemoryMappedFile::close()
+{
+	if(m_data)
+	{
+		UnmapViewOfFile(m_data);
+		m_data = nullptr;
+		m_size = 0;
+	}
+}
+
 } // end namespace anki
@@ -51,6 +51,7 @@ class BaseStringList;
 
 class ThreadHive;
 class ThreadJobManager;
+class TaskGraph;
 
 template<typename TFunc, typename TMemoryPool = SingletonMemoryPoolWrapper<DefaultMemoryPool>, PtrSize kPreallocatedStorage = ANKI_SAFE_ALIGNMENT>
 class Function;
@@ -96,6 +96,9 @@ public:
 	// Adam Sawicki metric. 0.0 is no fragmentation, 1.0 is totally fragmented.
 	[[nodiscard]] F32 computeExternalFragmentationSawicki(PtrSize baseSize = 1) const;
 
+	// The size of the largest free block of all chunks. Allocations bigger than that will need a new chunk.
+	[[nodiscard]] PtrSize computeLargestFreeBlockSize() const;
+
 	TLock& getLock() const
 	{
 		return m_lock;
@@ -604,4 +604,24 @@ F32 SegregatedListsAllocatorBuilder<TChunk, TInterface, TLock, TMemoryPool>::com
 	return maxFragmentation;
 }
 
+template<typename TChunk, typename TInterface, typename TLock, typename TMemoryPool>
+PtrSize SegregatedListsAllocatorBuilder<TChunk, TInterface, TLock, TMemoryPool>::computeLargestFreeBlockSize() const
+{
+	LockGuard<TLock> lock(m_lock);
+
+	PtrSize largestFreeBlockSize = 0;
+	for(const TChunk* chunk : m_chunks)
+	{
+		for(U32 c = 0; c < m_interface.getClassCount(); ++c)
+		{
+			for(const FreeBlock& block : chunk->m_freeLists[c])
+			{
+				largestFreeBlockSize = max(largestFreeBlockSize, block.m_size);
+			}
+		}
+	}
+
+	return largestFreeBlockSize;
+}
+
 } // end namespace anki
@@ -0,0 +1,187 @@
+// Copyright (C) 2009-present, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <AnKi/Util/TaskGraph.h>
+
+namespace anki {
+
+class TaskGraph::Task
+{
+public:
+	Func m_func;
+	ParallelForFunc m_parallelForFunc;
+	U32 m_begin = 0;
+	U32 m_end = 0;
+	U32 m_grainSize = 0; ///< Zero if it's not a parallel for.
+
+	DynamicArray<U32, MemoryPoolPtrWrapper<BaseMemoryPool>> m_successors;
+	U32 m_dependencyCount = 0;
+
+	Atomic<U32> m_pendingDependencyCount = {0};
+	Atomic<U32> m_pendingJobCount = {0};
+
+	Task(BaseMemoryPool* pool)
+		: m_successors(pool)
+	{
+	}
+};
+
+TaskGraph::TaskGraph(ThreadJobManager& manager, BaseMemoryPool* pool)
+	: m_manager(&manager)
+	, m_pool(pool)
+	, m_tasks(pool)
+{
+	ANKI_ASSERT(pool);
+}
+
+TaskGraph::~TaskGraph()
+{
+	ANKI_ASSERT((!m_submitted || isDone()) && "Forgot to wait");
+
+	for(Task* task : m_tasks)
+	{
+		deleteInstance(*m_pool, task);
+	}
+}
+
+TaskGraphTask TaskGraph::newTaskInternal(std::initializer_list<TaskGraphTask> dependencies)
+{
+	ANKI_ASSERT(!m_submitted && "Can't add tasks after submit");
+
+	TaskGraphTask handle;
+	handle.m_idx = m_tasks.getSize();
+	m_tasks.emplaceBack(newInstance<Task>(*m_pool, m_pool));
+
+	for(TaskGraphTask dep : dependencies)
+	{
+		addDependency(dep, handle);
+	}
+
+	return handle;
+}
+
+TaskGraphTask TaskGraph::newTask(const Func& func, std::initializer_list<TaskGraphTask> dependencies)
+{
+	const TaskGraphTask handle = newTaskInternal(dependencies);
+	m_tasks[handle.m_idx]->m_func = func;
+	return handle;
+}
+
+TaskGraphTask TaskGraph::newParallelFor(U32 begin, U32 end, U32 grainSize, const ParallelForFunc& func,
+										std::initializer_list<TaskGraphTask> dependencies)
+{
+	ANKI_ASSERT(begin <= end && grainSize > 0);
+
+	const TaskGraphTask handle = newTaskInternal(dependencies);
+	Task& task = *m_tasks[handle.m_idx];
+	task.m_parallelForFunc = func;
+	task.m_begin = begin;
+	task.m_end = end;
+	task.m_grainSize = grainSize;
+	return handle;
+}
+
+void TaskGraph::addDependency(TaskGraphTask before, TaskGraphTask after)
+{
+	ANKI_ASSERT(!m_submitted && "Can't add dependencies after submit");
+	ANKI_ASSERT(before.isValid() && after.isValid() && before.m_idx != after.m_idx);
+
+	m_tasks[before.m_idx]->m_successors.emplaceBack(after.m_idx);
+	++m_tasks[after.m_idx]->m_dependencyCount;
+}
+
+void TaskGraph::submit()
+{
+	ANKI_ASSERT(!m_submitted);
+	m_submitted = true;
+
+	if(m_tasks.getSize() == 0)
+	{
+		return;
+	}
+
+	// Initialize all the counters before any task starts decrementing them
+	for(Task* task : m_tasks)
+	{
+		task->m_pendingDependencyCount.setNonAtomically(task->m_dependencyCount);
+	}
+	m_pendingTaskCount.store(m_tasks.getSize(), AtomicMemoryOrder::kRelease);
+
+	U32 rootCount = 0;
+	for(U32 i = 0; i < m_tasks.getSize(); ++i)
+	{
+		if(m_tasks[i]->m_dependencyCount == 0)
+		{
+			launchTask(i);
+			++rootCount;
+		}
+	}
+
+	ANKI_ASSERT(rootCount > 0 && "The graph has a cycle");
+}
+
+void TaskGraph::wait()
+{
+	ANKI_ASSERT(m_submitted);
+	m_manager->waitForAllTasksToFinish();
+	ANKI_ASSERT(isDone() && "The graph has a cycle");
+}
+
+void TaskGraph::launchTask(U32 taskIdx)
+{
+	Task& task = *m_tasks[taskIdx];
+
+	if(task.m_grainSize == 0)
+	{
+		task.m_pendingJobCount.store(1, AtomicMemoryOrder::kRelaxed);
+		m_manager->dispatchTask([this, taskIdx](U32 threadId) {
+			m_tasks[taskIdx]->m_func(threadId);
+			jobDone(taskIdx);
+		});
+	}
+	else
+	{
+		const U32 jobCount = (task.m_end - task.m_begin + task.m_grainSize - 1) / task.m_grainSize;
+		if(jobCount == 0)
+		{
+			// Empty range, nothing to execute
+			task.m_pendingJobCount.store(1, AtomicMemoryOrder::kRelaxed);
+			jobDone(taskIdx);
+			return;
+		}
+
+		task.m_pendingJobCount.store(jobCount, AtomicMemoryOrder::kRelaxed);
+		for(U32 begin = task.m_begin; begin < task.m_end; begin += task.m_grainSize)
+		{
+			const U32 end = min(begin + task.m_grainSize, task.m_end);
+			m_manager->dispatchTask([this, taskIdx, begin, end](U32 threadId) {
+				m_tasks[taskIdx]->m_parallelForFunc(threadId, begin, end);
+				jobDone(taskIdx);
+			});
+		}
+	}
+}
+
+void TaskGraph::jobDone(U32 taskIdx)
+{
+	Task& task = *m_tasks[taskIdx];
+	if(task.m_pendingJobCount.fetchSub(1, AtomicMemoryOrder::kAcqRel) != 1)
+	{
+		return;
+	}
+
+	// Task is done, start the successors that were waiting for it
+	for(U32 successorIdx : task.m_successors)
+	{
+		if(m_tasks[successorIdx]->m_pendingDependencyCount.fetchSub(1, AtomicMemoryOrder::kAcqRel) == 1)
+		{
+			launchTask(successorIdx);
+		}
+	}
+
+	m_pendingTaskCount.fetchSub(1, AtomicMemoryOrder::kRelease);
+}
+
+} // end namespace anki
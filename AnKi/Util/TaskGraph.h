@@ -0,0 +1,109 @@
+// Copyright (C) 2009-present, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#pragma once
+
+#include <AnKi/Util/ThreadJobManager.h>
+#include <initializer_list>
+
+namespace anki {
+
+/// @addtogroup util_thread
+/// @{
+
+/// Handle to a task of a TaskGraph. @memberof TaskGraph
+class TaskGraphTask
+{
+	friend class TaskGraph;
+
+public:
+	TaskGraphTask() = default;
+
+	Bool isValid() const
+	{
+		return m_idx != kMaxU32;
+	}
+
+private:
+	U32 m_idx = kMaxU32;
+};
+
+/// A directed acyclic graph of tasks that runs on top of a ThreadJobManager. A task is dispatched the moment all of its dependencies are done so
+/// there are no global barriers between the stages of the graph. The thread that finishes the last dependency of a task is the one that
+/// dispatches it (continuation) so the successor will most likely run on the same thread.
+/// The graph is built from a single thread, submitted once and then waited.
+class TaskGraph
+{
+public:
+	using Func = ThreadJobManager::Func;
+	using ParallelForFunc = Function<void(U32 threadId, U32 begin, U32 end)>;
+
+	TaskGraph(ThreadJobManager& manager, BaseMemoryPool* pool = &DefaultMemoryPool::getSingleton());
+
+	TaskGraph(const TaskGraph&) = delete; // Non-copyable
+
+	~TaskGraph();
+
+	TaskGraph& operator=(const TaskGraph&) = delete; // Non-copyable
+
+	/// Create a new task.
+	/// @param func The work.
+	/// @param dependencies The task will start after those tasks are done.
+	TaskGraphTask newTask(const Func& func, std::initializer_list<TaskGraphTask> dependencies = {});
+
+	/// Create a task that splits the range [begin, end) into chunks of grainSize elements and executes the chunks in parallel. The task is done
+	/// when all the chunks are done.
+	/// @param dependencies The task will start after those tasks are done.
+	TaskGraphTask newParallelFor(U32 begin, U32 end, U32 grainSize, const ParallelForFunc& func,
+								 std::initializer_list<TaskGraphTask> dependencies = {});
+
+	/// Create a task that will run after @a task is done.
+	TaskGraphTask newContinuation(TaskGraphTask task, const Func& func)
+	{
+		return newTask(func, {task});
+	}
+
+	/// Make @a after start when @a before is done.
+	void addDependency(TaskGraphTask before, TaskGraphTask after);
+
+	/// Start executing the tasks that have no dependencies.
+	void submit();
+
+	/// Wait for all the tasks of the graph to finish. The calling thread executes tasks while it waits. It will also wait for any other task that
+	/// was dispatched to the ThreadJobManager.
+	void wait();
+
+	/// Check if all the tasks of the graph are done. It's thread-safe.
+	Bool isDone() const
+	{
+		return m_submitted && m_pendingTaskCount.load(AtomicMemoryOrder::kAcquire) == 0;
+	}
+
+	U32 getTaskCount() const
+	{
+		return m_tasks.getSize();
+	}
+
+private:
+	class Task;
+
+	ThreadJobManager* m_manager;
+	BaseMemoryPool* m_pool;
+
+	DynamicArray<Task*, MemoryPoolPtrWrapper<BaseMemoryPool>> m_tasks;
+	Atomic<U32> m_pendingTaskCount = {0};
+	Bool m_submitted = false;
+
+	TaskGraphTask newTaskInternal(std::initializer_list<TaskGraphTask> dependencies);
+
+	/// Dispatch the jobs of a task that has all its dependencies done.
+	void launchTask(U32 taskIdx);
+
+	/// Called when a job of a task completes. The last job completes the task.
+	void jobDone(U32 taskIdx);
+};
+/// @}
+
+} // end namespace anki
@@ -8,6 +8,184 @@
 
 namespace anki {
 
+/// Maps a ThreadJobManager to the queue the current thread owns in it. It's a cache of the owners that the managers keep so overwriting an entry
+/// doesn't lose the queue.
+class ThreadLocalQueueRef
+{
+public:
+	U64 m_managerUuid = 0;
+	U32 m_queueIdx = kMaxU32;
+};
+
+static thread_local Array<ThreadLocalQueueRef, 4> g_threadLocalQueueRefs;
+static thread_local U32 g_threadLocalQueueRefNext = 0;
+static thread_local U32 g_threadLocalStealSeed = 0;
+static thread_local U64 g_threadUuid = 0;
+static Atomic<U64> g_managerUuidCounter = {1};
+static Atomic<U64> g_threadUuidCounter = {1};
+
+/// The live managers. The threads that exit visit them to release the queues they own.
+static Mutex g_managersMtx;
+static ThreadJobManager* g_managersHead = nullptr;
+
+/// Releases the queues of a thread when it exits.
+class ThreadJobManager::ThreadQueueReleaser
+{
+public:
+	Bool m_ownsQueues = false;
+
+	~ThreadQueueReleaser()
+	{
+		if(m_ownsQueues)
+		{
+			LockGuard lock(g_managersMtx);
+			for(ThreadJobManager* manager = g_managersHead; manager; manager = manager->m_nextManager)
+			{
+				manager->releaseThreadQueue(g_threadUuid);
+			}
+		}
+	}
+};
+
+static thread_local ThreadJobManager::ThreadQueueReleaser g_threadQueueReleaser;
+
+static U64 getThreadUuid()
+{
+	if(g_threadUuid == 0)
+	{
+		g_threadUuid = g_threadUuidCounter.fetchAdd(1);
+	}
+
+	return g_threadUuid;
+}
+
+static void cpuPause()
+{
+#if ANKI_SIMD_SSE
+	_mm_pause();
+#else
+	std::this_thread::yield();
+#endif
+}
+
+/// Chase-Lev work-stealing deque. The owner pushes and pops from the bottom, the thieves steal from the top.
+class alignas(ANKI_CACHE_LINE_SIZE) ThreadJobManager::Queue
+{
+public:
+	Queue(U32 size)
+	{
+		ANKI_ASSERT(isPowerOfTwo(size));
+		m_slots.resize(size);
+		m_mask = size - 1;
+	}
+
+	/// Called by the owner only.
+	Bool pushBottom(const Func& func)
+	{
+		const I64 b = m_bottom.load(AtomicMemoryOrder::kRelaxed);
+		const I64 t = m_top.load(AtomicMemoryOrder::kAcquire);
+		if(b - t >= I64(m_slots.getSize()))
+		{
+			return false;
+		}
+
+		Slot& slot = m_slots[U32(b & m_mask)];
+
+		// A thief might still be moving the previous task out of that slot
+		const I64 prevOccupantSequence = 2 * (b - I64(m_slots.getSize())) + 1;
+		while(slot.m_sequence.load(AtomicMemoryOrder::kAcquire) == prevOccupantSequence)
+		{
+			cpuPause();
+		}
+
+		slot.m_func = func;
+		slot.m_sequence.store(2 * b + 1, AtomicMemoryOrder::kRelease);
+		m_bottom.store(b + 1, AtomicMemoryOrder::kRelease);
+		return true;
+	}
+
+	/// Called by the owner only.
+	Bool popBottom(Func& func)
+	{
+		const I64 b = m_bottom.load(AtomicMemoryOrder::kRelaxed) - 1;
+		m_bottom.store(b, AtomicMemoryOrder::kRelaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		I64 t = m_top.load(AtomicMemoryOrder::kRelaxed);
+
+		if(t > b)
+		{
+			// Empty
+			m_bottom.store(b + 1, AtomicMemoryOrder::kRelaxed);
+			return false;
+		}
+
+		if(t == b)
+		{
+			// Last task, race against the thieves
+			const Bool won = m_top.compareExchange(t, t + 1, AtomicMemoryOrder::kSeqCst, AtomicMemoryOrder::kRelaxed);
+			m_bottom.store(b + 1, AtomicMemoryOrder::kRelaxed);
+			if(!won)
+			{
+				return false;
+			}
+		}
+
+		takeSlot(b, func);
+		return true;
+	}
+
+	/// Can be called by any thread.
+	Bool steal(Func& func)
+	{
+		I64 t = m_top.load(AtomicMemoryOrder::kAcquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		const I64 b = m_bottom.load(AtomicMemoryOrder::kAcquire);
+
+		if(t >= b || !m_top.compareExchange(t, t + 1, AtomicMemoryOrder::kSeqCst, AtomicMemoryOrder::kRelaxed))
+		{
+			return false;
+		}
+
+		takeSlot(t, func);
+		return true;
+	}
+
+	/// It's approximate.
+	Bool isEmpty() const
+	{
+		return m_bottom.load(AtomicMemoryOrder::kRelaxed) <= m_top.load(AtomicMemoryOrder::kRelaxed);
+	}
+
+private:
+	class Slot
+	{
+	public:
+		Func m_func;
+
+		/// 2*index+1 when the task of that index is in the slot and 2*index+2 when it was moved out.
+		Atomic<I64> m_sequence = {0};
+	};
+
+	alignas(ANKI_CACHE_LINE_SIZE) Atomic<I64> m_top = {0};
+	alignas(ANKI_CACHE_LINE_SIZE) Atomic<I64> m_bottom = {0};
+	alignas(ANKI_CACHE_LINE_SIZE) DynamicArray<Slot> m_slots;
+	I64 m_mask = 0;
+
+	void takeSlot(I64 idx, Func& func)
+	{
+		Slot& slot = m_slots[U32(idx & m_mask)];
+
+		// The owner publishes the bottom after it fills the slot so this loop is just for memory visibility
+		while(slot.m_sequence.load(AtomicMemoryOrder::kAcquire) != 2 * idx + 1)
+		{
+			cpuPause();
+		}
+
+		func = std::move(slot.m_func);
+		slot.m_sequence.store(2 * idx + 2, AtomicMemoryOrder::kRelease);
+	}
+};
+
 class ThreadJobManager::WorkerThread
 {
 public:
@@ -33,7 +211,29 @@ public:
 
 ThreadJobManager::ThreadJobManager(U32 threadCount, Bool pinToCores, U32 queueSize)
 {
-	ANKI_ASSERT(threadCount);
+	ANKI_ASSERT(threadCount && queueSize);
+	m_uuid = g_managerUuidCounter.fetchAdd(1);
+
+	// Create the queues before the threads start stealing from them
+	queueSize = nextPowerOfTwo(queueSize);
+	m_queues.resize(threadCount + kMaxExternalThreads + 1);
+	for(Queue*& queue : m_queues)
+	{
+		queue = newInstance<Queue>(DefaultMemoryPool::getSingleton(), queueSize);
+	}
+
+	m_queueOwners.resize(threadCount + kMaxExternalThreads, 0);
+
+	{
+		LockGuard lock(g_managersMtx);
+		m_nextManager = g_managersHead;
+		if(g_managersHead)
+		{
+			g_managersHead->m_prevManager = this;
+		}
+		g_managersHead = this;
+	}
+
 	m_threads.resize(threadCount);
 	for(U32 i = 0; i < threadCount; ++i)
 	{
@@ -41,12 +241,29 @@ ThreadJobManager::ThreadJobManager(U32 threadCount, Bool pinToCores, U32 queueSi
 		threadName.sprintf("JobManager#%u", i);
 		m_threads[i] = newInstance<WorkerThread>(DefaultMemoryPool::getSingleton(), this, i, pinToCores, threadName);
 	}
-
-	m_tasks.resize(queueSize);
 }
 
 ThreadJobManager::~ThreadJobManager()
 {
+	// The threads that exit from now on shouldn't touch this manager
+	{
+		LockGuard lock(g_managersMtx);
+		if(m_prevManager)
+		{
+			m_prevManager->m_nextManager = m_nextManager;
+		}
+		else
+		{
+			ANKI_ASSERT(g_managersHead == this);
+			g_managersHead = m_nextManager;
+		}
+
+		if(m_nextManager)
+		{
+			m_nextManager->m_prevManager = m_prevManager;
+		}
+	}
+
 	{
 		LockGuard lock(m_mtx);
 		m_quit = true;
@@ -59,55 +276,255 @@ ThreadJobManager::~ThreadJobManager()
 		[[maybe_unused]] const Error err = thread->m_thread.join();
 		deleteInstance(DefaultMemoryPool::getSingleton(), thread);
 	}
+
+	for(Queue* queue : m_queues)
+	{
+		deleteInstance(DefaultMemoryPool::getSingleton(), queue);
+	}
 }
 
-Bool ThreadJobManager::pushBackTask(const Func& func)
+void ThreadJobManager::dispatchTask(const Func& func)
 {
-	LockGuard lock(m_tasksMtx);
-	const U32 next = (m_tasksBack + 1) % m_tasks.getSize();
-	if(next != m_tasksFront)
+	m_tasksInFlightCount.fetchAdd(1, AtomicMemoryOrder::kRelaxed);
+
+	const U32 queueIdx = getOrCreateThreadQueue();
+	while(!pushBackTask(queueIdx, func))
 	{
-		m_tasks[m_tasksBack] = func;
-		m_tasksBack = next;
-		return true;
+		// Queue is full, make some room by executing a task. External threads can only do that if they grab the helper thread ID
+		wakeUpWorkers();
+
+		const Bool isWorker = queueIdx < m_threads.getSize();
+		const Bool isHelper = !isWorker && m_helperThreadIdTaken.exchange(1, AtomicMemoryOrder::kAcquire) == 0;
+
+		Func task;
+		if((isWorker || isHelper) && popTask(queueIdx, task))
+		{
+			runTask(task, (isWorker) ? queueIdx : m_threads.getSize());
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+
+		if(isHelper)
+		{
+			m_helperThreadIdTaken.store(0, AtomicMemoryOrder::kRelease);
+		}
 	}
 
-	return false;
+	wakeUpWorkers();
 }
 
-Bool ThreadJobManager::popFrontTask(Func& func)
+void ThreadJobManager::waitForAllTasksToFinish()
 {
-	LockGuard lock(m_tasksMtx);
+	const U32 queueIdx = getOrCreateThreadQueue();
+	ANKI_ASSERT(queueIdx >= m_threads.getSize() && "Can't wait from inside a task");
 
-	if(m_tasksBack != m_tasksFront)
+	// Execute tasks until there is nothing left to steal
+	if(m_helperThreadIdTaken.exchange(1, AtomicMemoryOrder::kAcquire) == 0)
 	{
-		func = m_tasks[m_tasksFront];
-		m_tasksFront = (m_tasksFront + 1) % m_tasks.getSize();
-		return true;
+		Func task;
+		while(m_tasksInFlightCount.load(AtomicMemoryOrder::kAcquire) != 0 && popTask(queueIdx, task))
+		{
+			runTask(task, m_threads.getSize());
+		}
+
+		m_helperThreadIdTaken.store(0, AtomicMemoryOrder::kRelease);
+	}
+
+	// The remaining tasks are executing in other threads, block
+	LockGuard lock(m_waitMtx);
+	while(m_tasksInFlightCount.load(AtomicMemoryOrder::kAcquire) != 0)
+	{
+		m_waitCvar.wait(m_waitMtx);
+	}
+}
+
+U32 ThreadJobManager::getOrCreateThreadQueue()
+{
+	for(const ThreadLocalQueueRef& ref : g_threadLocalQueueRefs)
+	{
+		if(ref.m_managerUuid == m_uuid)
+		{
+			return ref.m_queueIdx;
+		}
+	}
+
+	// Not in the cache. Find the queue this thread owns or claim a free one
+	const U64 threadUuid = getThreadUuid();
+	U32 queueIdx = kMaxU32;
+	for(U32 i = 0; i < m_queueOwners.getSize() && queueIdx == kMaxU32; ++i)
+	{
+		queueIdx = (m_queueOwners[i].load(AtomicMemoryOrder::kAcquire) == threadUuid) ? i : kMaxU32;
+	}
+
+	for(U32 i = m_threads.getSize(); i < m_queueOwners.getSize() && queueIdx == kMaxU32; ++i)
+	{
+		U64 noOwner = 0;
+		if(m_queueOwners[i].compareExchange(noOwner, threadUuid, AtomicMemoryOrder::kAcqRel, AtomicMemoryOrder::kRelaxed))
+		{
+			queueIdx = i;
+			m_externalQueueCount.max(i - m_threads.getSize() + 1);
+			g_threadQueueReleaser.m_ownsQueues = true;
+		}
+	}
+
+	if(queueIdx == kMaxU32)
+	{
+		// All taken, go to the shared one
+		queueIdx = getSharedQueueIndex();
+	}
+
+	ThreadLocalQueueRef& ref = g_threadLocalQueueRefs[g_threadLocalQueueRefNext++ % g_threadLocalQueueRefs.getSize()];
+	ref.m_managerUuid = m_uuid;
+	ref.m_queueIdx = queueIdx;
+
+	return queueIdx;
+}
+
+void ThreadJobManager::releaseThreadQueue(U64 threadUuid)
+{
+	for(U32 i = m_threads.getSize(); i < m_queueOwners.getSize(); ++i)
+	{
+		U64 owner = threadUuid;
+		if(m_queueOwners[i].compareExchange(owner, 0, AtomicMemoryOrder::kRelease, AtomicMemoryOrder::kRelaxed))
+		{
+			// The tasks that are left in the queue can still be stolen and the next owner will continue from where this one stopped
+			break;
+		}
+	}
+}
+
+Bool ThreadJobManager::pushBackTask(U32 queueIdx, const Func& func)
+{
+	if(queueIdx == getSharedQueueIndex())
+	{
+		LockGuard lock(m_sharedQueueMtx);
+		return m_queues[queueIdx]->pushBottom(func);
+	}
+	else
+	{
+		return m_queues[queueIdx]->pushBottom(func);
+	}
+}
+
+Bool ThreadJobManager::popTask(U32 queueIdx, Func& func)
+{
+	Bool found;
+	if(queueIdx == getSharedQueueIndex())
+	{
+		LockGuard lock(m_sharedQueueMtx);
+		found = m_queues[queueIdx]->popBottom(func);
+	}
+	else
+	{
+		found = m_queues[queueIdx]->popBottom(func);
+	}
+
+	return found || stealTask(queueIdx, func);
+}
+
+Bool ThreadJobManager::stealTask(U32 thiefQueueIdx, Func& func)
+{
+	// Visit the workers, the external threads that got a queue and the shared queue
+	const U32 externalQueueCount = min(m_externalQueueCount.load(AtomicMemoryOrder::kRelaxed), kMaxExternalThreads);
+	const U32 queueCount = m_threads.getSize() + externalQueueCount + 1;
+
+	// Start from a pseudo-random victim so the thieves don't all go after the same queue
+	U32& seed = g_threadLocalStealSeed;
+	seed = (seed) ? seed : (thiefQueueIdx + 1) * 2654435761u;
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+
+	for(U32 i = 0; i < queueCount; ++i)
+	{
+		U32 victimIdx = (seed + i) % queueCount;
+		victimIdx = (victimIdx == queueCount - 1) ? getSharedQueueIndex() : victimIdx;
+
+		if(victimIdx != thiefQueueIdx && m_queues[victimIdx]->steal(func))
+		{
+			return true;
+		}
 	}
 
 	return false;
 }
 
+Bool ThreadJobManager::anyQueuedTasks() const
+{
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	for(const Queue* queue : m_queues)
+	{
+		if(!queue->isEmpty())
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void ThreadJobManager::runTask(Func& func, U32 threadId)
+{
+	func(threadId);
+	func.destroy();
+
+	const U32 prevCount = m_tasksInFlightCount.fetchSub(1, AtomicMemoryOrder::kAcqRel);
+	ANKI_ASSERT(prevCount > 0);
+	if(prevCount == 1)
+	{
+		LockGuard lock(m_waitMtx);
+		m_waitCvar.notifyAll();
+	}
+}
+
+void ThreadJobManager::wakeUpWorkers()
+{
+	// Pairs with the fence in anyQueuedTasks() so a worker that goes to sleep will either see the new task or get notified
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if(m_sleepingThreadCount.load(AtomicMemoryOrder::kRelaxed) > 0)
+	{
+		LockGuard lock(m_mtx);
+		m_cvar.notifyOne();
+	}
+}
+
 void ThreadJobManager::threadRun(U32 threadId)
 {
+	m_queueOwners[threadId].store(getThreadUuid(), AtomicMemoryOrder::kRelease);
+
+	constexpr U32 kIdleSpinCount = 16;
+	U32 idleSpins = 0;
 	while(true)
 	{
 		Func func;
-		if(popFrontTask(func))
+		if(popTask(threadId, func))
 		{
-			func(threadId);
-			[[maybe_unused]] const U32 count = m_tasksInFlightCount.fetchSub(1);
-			ANKI_ASSERT(count > 0);
+			runTask(func, threadId);
+			idleSpins = 0;
+		}
+		else if(idleSpins < kIdleSpinCount)
+		{
+			++idleSpins;
+			std::this_thread::yield();
 		}
 		else
 		{
+			idleSpins = 0;
+
 			LockGuard lock(m_mtx);
 			if(m_quit)
 			{
 				break;
 			}
-			m_cvar.wait(m_mtx);
+
+			m_sleepingThreadCount.fetchAdd(1, AtomicMemoryOrder::kSeqCst);
+			if(!anyQueuedTasks())
+			{
+				m_cvar.wait(m_mtx);
+			}
+			m_sleepingThreadCount.fetchSub(1, AtomicMemoryOrder::kRelaxed);
 		}
 	}
 }
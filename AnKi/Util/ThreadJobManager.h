@@ -15,12 +15,17 @@ namespace anki {
 /// @{
 
 /// Parallel task dispatcher. You feed it with tasks and sends them for execution in parallel and then waits for all to finish.
+/// Every thread that dispatches tasks owns a work-stealing (Chase-Lev) queue. Tasks are pushed and popped from the bottom of the owner's
+/// queue without locking and idle threads steal from the top of the other queues.
 class ThreadJobManager
 {
 public:
 	using Func = Function<void(U32 threadId)>;
 
 	/// Constructor.
+	/// @param threadCount The number of worker threads.
+	/// @param pinToCores Pin the worker threads to cores.
+	/// @param queueSize The capacity of the queue of each thread. Will be rounded up to the next power of two.
 	ThreadJobManager(U32 threadCount, Bool pinToCores = false, U32 queueSize = 256);
 
 	ThreadJobManager(const ThreadJobManager&) = delete; // Non-copyable
@@ -29,54 +34,78 @@ public:
 
 	ThreadJobManager& operator=(const ThreadJobManager&) = delete; // Non-copyable
 
-	/// Assign a task to a working thread
-	void dispatchTask(const Func& func)
-	{
-		m_tasksInFlightCount.fetchAdd(1);
-
-		while(!pushBackTask(func))
-		{
-			m_cvar.notifyOne();
-			std::this_thread::yield();
-		}
+	/// Assign a task to a working thread. Can be called from any thread, including from inside tasks.
+	void dispatchTask(const Func& func);
 
-		m_cvar.notifyOne();
-	}
-
-	/// Wait for all tasks to finish.
-	void waitForAllTasksToFinish()
-	{
-		while(m_tasksInFlightCount.load() != 0)
-		{
-			m_cvar.notifyOne();
-			std::this_thread::yield();
-		}
-	}
+	/// Wait for all tasks to finish. The calling thread will be executing queued tasks while it waits and it will block when there is
+	/// nothing left to steal.
+	void waitForAllTasksToFinish();
 
+	/// Get the number of threads that might execute tasks. It's the number of worker threads plus one for the thread that waits in
+	/// waitForAllTasksToFinish(). The threadId passed to the tasks is in [0, getThreadCount()).
 	U32 getThreadCount() const
 	{
-		return m_threads.getSize();
+		return m_threads.getSize() + 1;
 	}
 
+	class ThreadQueueReleaser; ///< Internal.
+
 private:
 	class WorkerThread;
+	class Queue;
+
+	static constexpr U32 kMaxExternalThreads = 8;
 
 	DynamicArray<WorkerThread*> m_threads;
 
-	DynamicArray<Func> m_tasks;
-	U32 m_tasksFront = 0;
-	U32 m_tasksBack = 0;
-	Mutex m_tasksMtx;
+	/// The queues of the worker threads come first, then kMaxExternalThreads queues for other threads and last a queue that is shared by
+	/// the external threads that didn't get a queue of their own.
+	DynamicArray<Queue*> m_queues;
+	DynamicArray<Atomic<U64>> m_queueOwners; ///< The thread that owns each queue (except the shared one). Zero if no one owns it.
+	Atomic<U32> m_externalQueueCount = {0}; ///< The max number of external queues that had an owner.
+	Mutex m_sharedQueueMtx; ///< Serializes the owner side of the shared queue.
 
 	Atomic<U32> m_tasksInFlightCount = {0};
+	Atomic<U32> m_sleepingThreadCount = {0};
+	Atomic<U32> m_helperThreadIdTaken = {0}; ///< Only one waiting thread at a time can execute tasks.
 
-	ConditionVariable m_cvar;
+	ConditionVariable m_cvar; ///< Worker threads sleep on that.
 	Mutex m_mtx;
 
+	ConditionVariable m_waitCvar; ///< Threads that wait for all tasks to finish sleep on that.
+	Mutex m_waitMtx;
+
+	U64 m_uuid = 0;
 	Bool m_quit = false;
 
-	Bool pushBackTask(const Func& func);
-	Bool popFrontTask(Func& func);
+	/// The list of all the live managers.
+	ThreadJobManager* m_prevManager = nullptr;
+	ThreadJobManager* m_nextManager = nullptr;
+
+	/// Get the queue the calling thread owns.
+	U32 getOrCreateThreadQueue();
+
+	/// Give back the queue of a thread that exits.
+	void releaseThreadQueue(U64 threadUuid);
+
+	U32 getSharedQueueIndex() const
+	{
+		return m_queues.getSize() - 1;
+	}
+
+	/// Push to the bottom of the queue of the calling thread.
+	Bool pushBackTask(U32 queueIdx, const Func& func);
+
+	/// Pop from the bottom of the queue of the calling thread or steal from the other queues.
+	Bool popTask(U32 queueIdx, Func& func);
+
+	Bool stealTask(U32 thiefQueueIdx, Func& func);
+
+	Bool anyQueuedTasks() const;
+
+	void runTask(Func& func, U32 threadId);
+
+	void wakeUpWorkers();
 
 	void threadRun(U32 threadId);
 };
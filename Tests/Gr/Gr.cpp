@@ -127,6 +127,79 @@ ANKI_TEST(Gr, ClearScreen)
 	commonDestroy();
 }
 
+ANKI_TEST(Gr, EndFrameInParallel)
+{
+	commonInit();
+
+	// Present in a thread while the main thread does what the next frame would do before GrManager::beginFrame
+	constexpr U kIterations = 100;
+	for(U i = 0; i < kIterations; ++i)
+	{
+		GrManager::getSingleton().beginFrame();
+
+		TexturePtr presentTex = GrManager::getSingleton().acquireNextPresentableTexture();
+
+		CommandBufferInitInfo cinit;
+		cinit.m_flags = CommandBufferFlag::kGeneralWork | CommandBufferFlag::kSmallBatch;
+		CommandBufferPtr cmdb = GrManager::getSingleton().newCommandBuffer(cinit);
+
+		const TextureBarrierInfo barrier = {TextureView(presentTex.get(), TextureSubresourceDesc::all()), TextureUsageBit::kNone,
+											TextureUsageBit::kRtvDsvWrite};
+		cmdb->setPipelineBarrier({&barrier, 1}, {}, {});
+
+		RenderTarget rt;
+		rt.m_textureView = TextureView(presentTex.get(), TextureSubresourceDesc::all());
+		rt.m_clearValue.m_colorf = {0.0f, F32(i) / F32(kIterations), 0.0f, 1.0f};
+		cmdb->beginRenderPass({rt});
+		cmdb->endRenderPass();
+
+		const TextureBarrierInfo barrier2 = {TextureView(presentTex.get(), TextureSubresourceDesc::all()), TextureUsageBit::kRtvDsvWrite,
+											 TextureUsageBit::kPresent};
+		cmdb->setPipelineBarrier({&barrier2, 1}, {}, {});
+
+		cmdb->endRecording();
+		GrManager::getSingleton().submit(cmdb.get());
+
+		// Release the references before the present so they end up in the deferred deletion of endFrame
+		cmdb.reset(nullptr);
+		presentTex.reset(nullptr);
+
+		Thread presentThread("Present");
+		presentThread.start(nullptr, [](ThreadCallbackInfo&) -> Error {
+			GrManager::getSingleton().endFrame();
+			return Error::kNone;
+		});
+
+		// Everything bellow is allowed to run in parallel with endFrame
+		BufferPtr buff =
+			GrManager::getSingleton().newBuffer(BufferInitInfo(1_KB, BufferUsageBit::kCopyDestination, BufferMapAccessBit::kRead, "Parallel"));
+
+		CommandBufferPtr cmdb2 = GrManager::getSingleton().newCommandBuffer(cinit);
+		cmdb2->zeroBuffer(BufferView(buff.get()));
+		cmdb2->endRecording();
+
+		FencePtr fence;
+		GrManager::getSingleton().submit(cmdb2.get(), {}, &fence);
+		ANKI_TEST_EXPECT_EQ(fence->clientWait(kMaxSecond), true);
+
+		const U32* mapped = static_cast<const U32*>(buff->map(0, kMaxPtrSize));
+		ANKI_TEST_EXPECT_EQ(mapped[0], 0u);
+		buff->unmap();
+
+		if((i % 10) == 0)
+		{
+			GrManager::getSingleton().finish();
+		}
+
+		cmdb2.reset(nullptr);
+		buff.reset(nullptr);
+
+		ANKI_TEST_EXPECT_NO_ERR(presentThread.join());
+	}
+
+	commonDestroy();
+}
+
 ANKI_TEST(Gr, SimpleCompute)
 {
 	commonInit();
@@ -350,6 +423,74 @@ void main()
 	commonDestroy();
 }
 
+ANKI_TEST(Gr, CopyTextureToTexture)
+{
+	commonInit();
+
+	{
+		constexpr const char* kSrc = R"(
+Texture2D<float4> g_tex : register(t0);
+RWStructuredBuffer<float4> g_out : register(u0);
+
+[numthreads(2, 2, 1)]
+void main(uint2 svDispatchThreadId : SV_DISPATCHTHREADID)
+{
+	g_out[svDispatchThreadId.y * 2 + svDispatchThreadId.x] = g_tex.Load(int3(svDispatchThreadId, 0));
+}
+)";
+		ShaderPtr compShader = createShader(kSrc, ShaderType::kCompute);
+
+		ShaderProgramInitInfo progInit("Program");
+		progInit.m_computeShader = compShader.get();
+		ShaderProgramPtr prog = GrManager::getSingleton().newShaderProgram(progInit);
+
+		const Array<Vec4, 4> texels = {Vec4(1.0f, 2.0f, 3.0f, 4.0f), Vec4(5.0f, 6.0f, 7.0f, 8.0f), Vec4(9.0f, 10.0f, 11.0f, 12.0f),
+									   Vec4(13.0f, 14.0f, 15.0f, 16.0f)};
+
+		TextureInitInfo texInit;
+		texInit.m_width = texInit.m_height = 2;
+		texInit.m_format = Format::kR32G32B32A32_Sfloat;
+		texInit.m_usage = TextureUsageBit::kCopySource;
+		TexturePtr srcTex = createTexture2d(texInit, ConstWeakArray<Vec4>(texels));
+
+		texInit.m_usage = TextureUsageBit::kSrvCompute | TextureUsageBit::kCopyDestination;
+		TexturePtr dstTex = GrManager::getSingleton().newTexture(texInit);
+
+		BufferPtr outBuff = createBuffer(BufferUsageBit::kAllUav | BufferUsageBit::kAllSrv, Vec4(0.0f), 4, "out");
+
+		// Record
+		CommandBufferInitInfo cmdbInit;
+		cmdbInit.m_flags |= CommandBufferFlag::kSmallBatch;
+		CommandBufferPtr cmdb = GrManager::getSingleton().newCommandBuffer(cmdbInit);
+
+		Array<TextureBarrierInfo, 2> barriers;
+		barriers[0] = {TextureView(srcTex.get()), TextureUsageBit::kCopyDestination, TextureUsageBit::kCopySource};
+		barriers[1] = {TextureView(dstTex.get()), TextureUsageBit::kNone, TextureUsageBit::kCopyDestination};
+		cmdb->setPipelineBarrier(barriers, {}, {});
+
+		cmdb->copyTextureToTexture(TextureView(srcTex.get(), TextureSubresourceDesc::firstSurface()),
+								   TextureView(dstTex.get(), TextureSubresourceDesc::firstSurface()));
+
+		barriers[0] = {TextureView(dstTex.get()), TextureUsageBit::kCopyDestination, TextureUsageBit::kSrvCompute};
+		cmdb->setPipelineBarrier({&barriers[0], 1}, {}, {});
+
+		cmdb->bindShaderProgram(prog.get());
+		cmdb->bindSrv(0, 0, TextureView(dstTex.get(), TextureSubresourceDesc::all()));
+		cmdb->bindUav(0, 0, BufferView(outBuff.get()));
+		cmdb->dispatchCompute(1, 1, 1);
+		cmdb->endRecording();
+
+		FencePtr signalFence;
+		GrManager::getSingleton().submit(cmdb.get(), {}, &signalFence);
+		signalFence->clientWait(kMaxSecond);
+
+		// Check
+		validateBuffer(outBuff, ConstWeakArray<Vec4>(texels));
+	}
+
+	commonDestroy();
+}
+
 ANKI_TEST(Gr, CoordinateSystem)
 {
 	commonInit();
@@ -0,0 +1,252 @@
+// Copyright (C) 2009-present, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <Tests/Framework/Framework.h>
+#include <AnKi/Resource/AnimationResource.h>
+#include <AnKi/Resource/ResourceFilesystem.h>
+#include <AnKi/Util/Filesystem.h>
+#include <AnKi/Util/File.h>
+#include <AnKi/Util/HighRezTimer.h>
+
+using namespace anki;
+
+namespace {
+
+class TestChannel
+{
+public:
+	ResourceString m_name;
+	ResourceDynamicArray<AnimationKeyframe<Vec3>> m_positions;
+	ResourceDynamicArray<AnimationKeyframe<Quat>> m_rotations;
+	ResourceDynamicArray<AnimationKeyframe<F32>> m_scales;
+};
+
+// What interpolate() used to do. Scan the keyframes every time
+template<typename T, typename TFunc>
+T scanKeyframes(const ResourceDynamicArray<AnimationKeyframe<T>>& keys, Second time, T defaultValue, TFunc lerp)
+{
+	for(U32 i = 0; i + 1 < keys.getSize(); ++i)
+	{
+		if(time >= keys[i].m_time && time <= keys[i + 1].m_time)
+		{
+			const F32 u = F32((time - keys[i].m_time) / (keys[i + 1].m_time - keys[i].m_time));
+			return lerp(keys[i].m_value, keys[i + 1].m_value, u);
+		}
+	}
+
+	return defaultValue;
+}
+
+void scanChannel(const TestChannel& ch, Second time, AnimationChannelSample& out)
+{
+	out.m_position = scanKeyframes(ch.m_positions, time, Vec3(0.0f), [](const Vec3& a, const Vec3& b, F32 u) {
+		return linearInterpolate(a, b, u);
+	});
+	out.m_rotation = scanKeyframes(ch.m_rotations, time, Quat::getIdentity(), [](const Quat& a, const Quat& b, F32 u) {
+		return a.slerp(b, u);
+	});
+	out.m_scale = scanKeyframes(ch.m_scales, time, 1.0f, [](F32 a, F32 b, F32 u) {
+		return linearInterpolate(a, b, u);
+	});
+}
+
+} // namespace
+
+ANKI_TEST(Resource, AnimationResource)
+{
+	DefaultMemoryPool::allocateSingleton(allocAligned, nullptr);
+	ResourceMemoryPool::allocateSingleton(allocAligned, nullptr);
+
+	{
+		constexpr U32 kChannelCount = 64;
+		constexpr U32 kKeyCount = 61; // 2 seconds at 30 keys per second
+
+		String tmpDir;
+		ANKI_TEST_EXPECT_NO_ERR(getTempDirectory(tmpDir));
+		ResourceString dataDir;
+		dataDir.sprintf("%s/AnimationResourceTest", tmpDir.cstr());
+		if(directoryExists(dataDir))
+		{
+			ANKI_TEST_EXPECT_NO_ERR(removeDirectory(dataDir));
+		}
+		ANKI_TEST_EXPECT_NO_ERR(createDirectory(dataDir));
+
+		// Create some channels. The last one doesn't move
+		ResourceDynamicArray<TestChannel> channels;
+		channels.resize(kChannelCount);
+		for(U32 c = 0; c < kChannelCount; ++c)
+		{
+			TestChannel& ch = channels[c];
+			ch.m_name.sprintf("bone%u", c);
+
+			ch.m_positions.resize(kKeyCount);
+			ch.m_rotations.resize(kKeyCount);
+			ch.m_scales.resize((c % 4 == 0) ? kKeyCount : 0);
+			for(U32 k = 0; k < kKeyCount; ++k)
+			{
+				const Second time = Second(k) / 30.0;
+				const F32 angle = (c == kChannelCount - 1) ? 0.5f : F32(k) * 0.1f + F32(c);
+				ch.m_positions[k] = {time, (c == kChannelCount - 1) ? Vec3(1.0f, 2.0f, 3.0f) : Vec3(sin(angle), F32(k) * 0.01f, F32(c))};
+				ch.m_rotations[k] = {time, Quat(Axisang(angle, Vec3(0.0f, 1.0f, 0.0f)))};
+				if(ch.m_scales.getSize())
+				{
+					ch.m_scales[k] = {time, 1.0f + F32(k) * 0.02f};
+				}
+			}
+		}
+
+		// Write the text version
+		{
+			File file;
+			ResourceString fname;
+			fname.sprintf("%s/Text.ankianim", dataDir.cstr());
+			ANKI_TEST_EXPECT_NO_ERR(file.open(fname, FileOpenFlag::kWrite));
+			ANKI_TEST_EXPECT_NO_ERR(file.writeText("<animation><channels>\n"));
+			for(const TestChannel& ch : channels)
+			{
+				ANKI_TEST_EXPECT_NO_ERR(file.writeTextf("<channel name=\"%s\">\n<positionKeys>\n", ch.m_name.cstr()));
+				for(const auto& key : ch.m_positions)
+				{
+					ANKI_TEST_EXPECT_NO_ERR(
+						file.writeTextf("<key time=\"%.9f\">%.9f %.9f %.9f</key>\n", key.m_time, key.m_value.x, key.m_value.y, key.m_value.z));
+				}
+				ANKI_TEST_EXPECT_NO_ERR(file.writeText("</positionKeys>\n<rotationKeys>\n"));
+				for(const auto& key : ch.m_rotations)
+				{
+					const Quat& q = key.m_value;
+					ANKI_TEST_EXPECT_NO_ERR(file.writeTextf("<key time=\"%.9f\">%.9f %.9f %.9f %.9f</key>\n", key.m_time, q.x, q.y, q.z, q.w));
+				}
+				ANKI_TEST_EXPECT_NO_ERR(file.writeText("</rotationKeys>\n"));
+				if(ch.m_scales.getSize())
+				{
+					ANKI_TEST_EXPECT_NO_ERR(file.writeText("<scaleKeys>\n"));
+					for(const auto& key : ch.m_scales)
+					{
+						ANKI_TEST_EXPECT_NO_ERR(file.writeTextf("<key time=\"%.9f\">%.9f</key>\n", key.m_time, key.m_value));
+					}
+					ANKI_TEST_EXPECT_NO_ERR(file.writeText("</scaleKeys>\n"));
+				}
+				ANKI_TEST_EXPECT_NO_ERR(file.writeText("</channel>\n"));
+			}
+			ANKI_TEST_EXPECT_NO_ERR(file.writeText("</channels></animation>\n"));
+		}
+
+		// Write the binary version the way the importer does
+		{
+			AnimationBinaryHeader header;
+			ResourceDynamicArray<AnimationBinaryChannel> binChannels;
+			ResourceDynamicArray<Vec3> positions;
+			ResourceDynamicArray<I16Vec4> rotations;
+			ResourceDynamicArray<F32> scales;
+			ANKI_TEST_EXPECT_NO_ERR(
+				sampleAnimationKeyframes(ConstWeakArray<TestChannel>(channels), header, binChannels, positions, rotations, scales));
+			ANKI_TEST_EXPECT_EQ(header.m_frameCount, kKeyCount);
+			ANKI_TEST_EXPECT_EQ(header.m_positionTrackCount, kChannelCount - 1);
+			ANKI_TEST_EXPECT_EQ(header.m_rotationTrackCount, kChannelCount - 1);
+			ANKI_TEST_EXPECT_EQ(header.m_scaleTrackCount, kChannelCount / 4);
+
+			File file;
+			ResourceString fname;
+			fname.sprintf("%s/Binary.ankianim", dataDir.cstr());
+			ANKI_TEST_EXPECT_NO_ERR(file.open(fname, FileOpenFlag::kWrite | FileOpenFlag::kBinary));
+			ANKI_TEST_EXPECT_NO_ERR(file.write(&header, sizeof(header)));
+			ANKI_TEST_EXPECT_NO_ERR(file.write(binChannels.getBegin(), binChannels.getSizeInBytes()));
+			ANKI_TEST_EXPECT_NO_ERR(file.write(positions.getBegin(), positions.getSizeInBytes()));
+			ANKI_TEST_EXPECT_NO_ERR(file.write(rotations.getBegin(), rotations.getSizeInBytes()));
+			ANKI_TEST_EXPECT_NO_ERR(file.write(scales.getBegin(), scales.getSizeInBytes()));
+			file.close();
+
+			// A position track that no channel points to
+			++header.m_positionTrackCount;
+			positions.resize(positions.getSize() + header.m_frameCount, Vec3(0.0f));
+			fname.sprintf("%s/UnusedTrack.ankianim", dataDir.cstr());
+			ANKI_TEST_EXPECT_NO_ERR(file.open(fname, FileOpenFlag::kWrite | FileOpenFlag::kBinary));
+			ANKI_TEST_EXPECT_NO_ERR(file.write(&header, sizeof(header)));
+			ANKI_TEST_EXPECT_NO_ERR(file.write(binChannels.getBegin(), binChannels.getSizeInBytes()));
+			ANKI_TEST_EXPECT_NO_ERR(file.write(positions.getBegin(), positions.getSizeInBytes()));
+			ANKI_TEST_EXPECT_NO_ERR(file.write(rotations.getBegin(), rotations.getSizeInBytes()));
+			ANKI_TEST_EXPECT_NO_ERR(file.write(scales.getBegin(), scales.getSizeInBytes()));
+		}
+
+		g_cvarRsrcDataPaths = dataDir.toCString();
+		ResourceFilesystem::allocateSingleton();
+		ANKI_TEST_EXPECT_NO_ERR(ResourceFilesystem::getSingleton().init());
+
+		{
+			AnimationResource textAnim("Text.ankianim", 1);
+			ANKI_TEST_EXPECT_NO_ERR(textAnim.load("Text.ankianim", false));
+			AnimationResource binAnim("Binary.ankianim", 2);
+			ANKI_TEST_EXPECT_NO_ERR(binAnim.load("Binary.ankianim", false));
+
+			ANKI_TEST_EXPECT_EQ(binAnim.getChannels().getSize(), kChannelCount);
+			ANKI_TEST_EXPECT_EQ(textAnim.getFrameCount(), binAnim.getFrameCount());
+			ANKI_TEST_EXPECT_EQ(binAnim.getChannels()[3].m_name, "bone3");
+
+			AnimationResource unusedTrackAnim("UnusedTrack.ankianim", 3);
+			ANKI_TEST_EXPECT_EQ(unusedTrackAnim.load("UnusedTrack.ankianim", false), Error::kUserData);
+
+			// Compare against the keyframes
+			ResourceDynamicArray<AnimationChannelSample> samples;
+			samples.resize(kChannelCount);
+			for(U32 i = 0; i < 100; ++i)
+			{
+				const Second time = 2.0 * Second(i) / 100.0;
+				binAnim.interpolateAll(time, WeakArray<AnimationChannelSample>(samples));
+
+				for(U32 c = 0; c < kChannelCount; ++c)
+				{
+					AnimationChannelSample expected;
+					scanChannel(channels[c], time, expected);
+
+					Vec3 pos;
+					Quat rot;
+					F32 scale;
+					textAnim.interpolate(c, time, pos, rot, scale);
+
+					ANKI_TEST_EXPECT_LT((pos - expected.m_position).length(), 0.001f);
+					ANKI_TEST_EXPECT_GT(absolute(Vec4(rot).dot(Vec4(expected.m_rotation))), 0.9999f);
+					ANKI_TEST_EXPECT_LT(absolute(scale - expected.m_scale), 0.001f);
+
+					ANKI_TEST_EXPECT_LT((samples[c].m_position - pos).length(), 0.0001f);
+					ANKI_TEST_EXPECT_GT(absolute(Vec4(samples[c].m_rotation).dot(Vec4(rot))), 0.99999f);
+					ANKI_TEST_EXPECT_LT(absolute(samples[c].m_scale - scale), 0.0001f);
+				}
+			}
+
+			// Benchmark against scanning the keyframes
+			constexpr U32 kIterations = 20000;
+			F32 sink = 0.0f;
+			Second begin = HighRezTimer::getCurrentTime();
+			for(U32 i = 0; i < kIterations; ++i)
+			{
+				const Second time = 2.0 * Second(i % 997) / 997.0;
+				for(U32 c = 0; c < kChannelCount; ++c)
+				{
+					scanChannel(channels[c], time, samples[c]);
+				}
+				sink += samples[i % kChannelCount].m_scale;
+			}
+			const Second scanTime = HighRezTimer::getCurrentTime() - begin;
+
+			begin = HighRezTimer::getCurrentTime();
+			for(U32 i = 0; i < kIterations; ++i)
+			{
+				const Second time = 2.0 * Second(i % 997) / 997.0;
+				binAnim.interpolateAll(time, WeakArray<AnimationChannelSample>(samples));
+				sink += samples[i % kChannelCount].m_scale;
+			}
+			const Second sampledTime = HighRezTimer::getCurrentTime() - begin;
+
+			ANKI_TEST_LOGI("%u channels x %u times: keyframe scan %fms, uniform sampling %fms (%fx) %f", kChannelCount, kIterations,
+						   scanTime * 1000.0, sampledTime * 1000.0, scanTime / sampledTime, sink);
+		}
+
+		ResourceFilesystem::freeSingleton();
+		ANKI_TEST_EXPECT_NO_ERR(removeDirectory(dataDir));
+	}
+
+	ResourceMemoryPool::freeSingleton();
+	DefaultMemoryPool::freeSingleton();
+}
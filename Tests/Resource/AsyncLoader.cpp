@@ -266,3 +266,377 @@ ANKI_TEST(Resource, AsyncLoader)
 #endif
 
 } // namespace
+
+namespace {
+
+class StageTask : public AsyncLoaderTask
+{
+public:
+	Second m_ioTime = 0.0; ///< Time to wait for the "disk".
+	Second m_decodeTime = 0.0; ///< Time to spin the CPU.
+	Atomic<U32>* m_ioCount = nullptr;
+	Atomic<U32>* m_decodeCount = nullptr;
+	Atomic<U32>* m_release = nullptr; ///< If not null the decode stage waits for it to become non-zero.
+	Second* m_doneTime = nullptr;
+	U32* m_decodeIndex = nullptr; ///< The value of m_decodeCount when the decode happened.
+	Bool m_ioDone = false;
+	Bool m_fail = false;
+
+	Bool hasIoStage() const override
+	{
+		return true;
+	}
+
+	Error io([[maybe_unused]] AsyncLoaderTaskContext& ctx) override
+	{
+		if(m_ioTime > 0.0)
+		{
+			HighRezTimer::sleep(m_ioTime);
+		}
+
+		m_ioDone = true;
+		if(m_ioCount)
+		{
+			m_ioCount->fetchAdd(1);
+		}
+
+		return (m_fail) ? Error::kFunctionFailed : Error::kNone;
+	}
+
+	Error operator()([[maybe_unused]] AsyncLoaderTaskContext& ctx) override
+	{
+		if(!m_ioDone)
+		{
+			return Error::kFunctionFailed;
+		}
+
+		const Second end = HighRezTimer::getCurrentTime() + m_decodeTime;
+		while(HighRezTimer::getCurrentTime() < end)
+		{
+		}
+
+		while(m_release && m_release->load() == 0)
+		{
+			HighRezTimer::sleep(0.1_ms);
+		}
+
+		if(m_doneTime)
+		{
+			*m_doneTime = HighRezTimer::getCurrentTime();
+		}
+
+		if(m_decodeCount)
+		{
+			const U32 idx = m_decodeCount->fetchAdd(1, AtomicMemoryOrder::kRelease);
+			if(m_decodeIndex)
+			{
+				*m_decodeIndex = idx;
+			}
+		}
+
+		return Error::kNone;
+	}
+};
+
+// Runs twice. The 1st time it waits for a release and then it resubmits itself.
+class ResubmitTask : public AsyncLoaderTask
+{
+public:
+	Atomic<U32>* m_release = nullptr;
+	Atomic<U32>* m_decodeCount = nullptr;
+	U32* m_decodeIndex = nullptr;
+	Bool m_resubmitted = false;
+
+	Error operator()(AsyncLoaderTaskContext& ctx) override
+	{
+		if(!m_resubmitted)
+		{
+			while(m_release->load() == 0)
+			{
+				HighRezTimer::sleep(0.1_ms);
+			}
+
+			m_resubmitted = true;
+			ctx.m_resubmitTask = true;
+		}
+		else
+		{
+			*m_decodeIndex = m_decodeCount->fetchAdd(1);
+		}
+
+		return Error::kNone;
+	}
+};
+
+class NonCancellableTask : public StageTask
+{
+public:
+	Bool isCancellable() const override
+	{
+		return false;
+	}
+};
+
+void waitForTasks(const AsyncLoader& loader)
+{
+	while(loader.getTasksInFlightCount() != 0)
+	{
+		HighRezTimer::sleep(0.1_ms);
+	}
+}
+
+} // namespace
+
+ANKI_TEST(Resource, AsyncLoaderStages)
+{
+	ResourceMemoryPool::allocateSingleton(allocAligned, nullptr);
+
+	// All tasks pass from both stages. Also try running the I/O in the decode threads
+	for(U32 ioThreadCount : {0u, 1u, 2u})
+	{
+		AsyncLoader loader(3, ioThreadCount);
+		Atomic<U32> ioCount = {0};
+		Atomic<U32> decodeCount = {0};
+
+		constexpr U32 kTaskCount = 200;
+		for(U32 i = 0; i < kTaskCount; ++i)
+		{
+			StageTask* task = loader.newTask<StageTask>();
+			task->m_ioCount = &ioCount;
+			task->m_decodeCount = &decodeCount;
+			task->m_fail = (i == kTaskCount / 2);
+			loader.submitTask(task, AsyncLoaderPriority(i % U32(AsyncLoaderPriority::kCount)));
+		}
+
+		waitForTasks(loader);
+		ANKI_TEST_EXPECT_EQ(ioCount.load(), kTaskCount);
+		ANKI_TEST_EXPECT_EQ(decodeCount.load(), kTaskCount - 1);
+	}
+
+	// Low priority work can't block the high priority work
+	{
+		AsyncLoader loader(2, 1);
+		Atomic<U32> release = {0};
+		Atomic<U32> decodeCount = {0};
+
+		for(U32 i = 0; i < 10; ++i)
+		{
+			StageTask* task = loader.newTask<StageTask>();
+			task->m_release = &release;
+			task->m_decodeCount = &decodeCount;
+			loader.submitTask(task, AsyncLoaderPriority::kLow);
+		}
+
+		Second highDoneTime = 0.0;
+		StageTask* task = loader.newTask<StageTask>();
+		task->m_doneTime = &highDoneTime;
+		task->m_decodeCount = &decodeCount;
+		loader.submitTask(task, AsyncLoaderPriority::kHigh);
+
+		const Second timeout = HighRezTimer::getCurrentTime() + 5.0;
+		while(decodeCount.load(AtomicMemoryOrder::kAcquire) == 0 && HighRezTimer::getCurrentTime() < timeout)
+		{
+			HighRezTimer::sleep(0.1_ms);
+		}
+
+		ANKI_TEST_EXPECT_EQ(decodeCount.load(), 1);
+		ANKI_TEST_EXPECT_NEQ(highDoneTime, 0.0);
+
+		release.store(1);
+		waitForTasks(loader);
+		ANKI_TEST_EXPECT_EQ(decodeCount.load(), 11);
+	}
+
+	ResourceMemoryPool::freeSingleton();
+}
+
+ANKI_TEST(Resource, AsyncLoaderTaskHandles)
+{
+	ResourceMemoryPool::allocateSingleton(allocAligned, nullptr);
+
+	// Cancel and re-prioritize queued tasks
+	{
+		AsyncLoader loader(1, 0);
+		Atomic<U32> release = {0};
+		Atomic<U32> decodeCount = {0};
+
+		// Block the only thread
+		StageTask* blocker = loader.newTask<StageTask>();
+		blocker->m_release = &release;
+		const AsyncLoaderTaskHandle blockerHandle = loader.submitTask(blocker, AsyncLoaderPriority::kHigh);
+		while(blockerHandle.getState() != AsyncLoaderTaskState::kRunning)
+		{
+			HighRezTimer::sleep(0.1_ms);
+		}
+
+		Array<U32, 3> decodeIndices = {kMaxU32, kMaxU32, kMaxU32};
+		Array<AsyncLoaderTaskHandle, 3> handles;
+		for(U32 i = 0; i < 3; ++i)
+		{
+			StageTask* task = loader.newTask<StageTask>();
+			task->m_decodeCount = &decodeCount;
+			task->m_decodeIndex = &decodeIndices[i];
+			handles[i] = loader.submitTask(task, AsyncLoaderPriority::kLow);
+			ANKI_TEST_EXPECT_EQ(handles[i].getState(), AsyncLoaderTaskState::kQueued);
+		}
+
+		loader.cancelTask(handles[1]);
+		ANKI_TEST_EXPECT_EQ(handles[1].getState(), AsyncLoaderTaskState::kCancelled);
+		ANKI_TEST_EXPECT_EQ(loader.getTasksInFlightCount(), 3);
+
+		loader.setTaskPriority(handles[2], AsyncLoaderPriority::kHigh);
+
+		release.store(1);
+		waitForTasks(loader);
+
+		ANKI_TEST_EXPECT_EQ(blockerHandle.getState(), AsyncLoaderTaskState::kCompleted);
+		ANKI_TEST_EXPECT_EQ(handles[0].getState(), AsyncLoaderTaskState::kCompleted);
+		ANKI_TEST_EXPECT_EQ(handles[2].getState(), AsyncLoaderTaskState::kCompleted);
+		ANKI_TEST_EXPECT_EQ(handles[1].isDone(), true);
+		ANKI_TEST_EXPECT_EQ(decodeCount.load(), 2);
+		ANKI_TEST_EXPECT_EQ(decodeIndices[2], 0);
+		ANKI_TEST_EXPECT_EQ(decodeIndices[0], 1);
+		ANKI_TEST_EXPECT_EQ(decodeIndices[1], kMaxU32);
+	}
+
+	// Cancel while the I/O stage runs. The decode stage shouldn't run
+	{
+		AsyncLoader loader(1, 1);
+		Atomic<U32> ioCount = {0};
+		Atomic<U32> decodeCount = {0};
+
+		StageTask* task = loader.newTask<StageTask>();
+		task->m_ioTime = 50.0_ms;
+		task->m_ioCount = &ioCount;
+		task->m_decodeCount = &decodeCount;
+		const AsyncLoaderTaskHandle handle = loader.submitTask(task, AsyncLoaderPriority::kMedium);
+		while(handle.getState() != AsyncLoaderTaskState::kRunning)
+		{
+			HighRezTimer::sleep(0.1_ms);
+		}
+
+		loader.cancelTask(handle);
+		waitForTasks(loader);
+
+		ANKI_TEST_EXPECT_EQ(handle.getState(), AsyncLoaderTaskState::kCancelled);
+		ANKI_TEST_EXPECT_EQ(ioCount.load(), 1);
+		ANKI_TEST_EXPECT_EQ(decodeCount.load(), 0);
+	}
+
+	// The priority changes while the task is running are kept when it resubmits
+	{
+		AsyncLoader loader(1, 0);
+		Atomic<U32> release = {0};
+		Atomic<U32> decodeCount = {0};
+
+		U32 resubmitDecodeIndex = kMaxU32;
+		ResubmitTask* resubmitTask = loader.newTask<ResubmitTask>();
+		resubmitTask->m_release = &release;
+		resubmitTask->m_decodeCount = &decodeCount;
+		resubmitTask->m_decodeIndex = &resubmitDecodeIndex;
+		const AsyncLoaderTaskHandle handle = loader.submitTask(resubmitTask, AsyncLoaderPriority::kLow);
+		while(handle.getState() != AsyncLoaderTaskState::kRunning)
+		{
+			HighRezTimer::sleep(0.1_ms);
+		}
+
+		U32 mediumDecodeIndex = kMaxU32;
+		StageTask* task = loader.newTask<StageTask>();
+		task->m_decodeCount = &decodeCount;
+		task->m_decodeIndex = &mediumDecodeIndex;
+		loader.submitTask(task, AsyncLoaderPriority::kMedium);
+
+		loader.setTaskPriority(handle, AsyncLoaderPriority::kHigh);
+		release.store(1);
+		waitForTasks(loader);
+
+		ANKI_TEST_EXPECT_EQ(resubmitDecodeIndex, 0);
+		ANKI_TEST_EXPECT_EQ(mediumDecodeIndex, 1);
+	}
+
+	// Tasks that can't be cancelled
+	{
+		AsyncLoader loader(1, 0);
+		Atomic<U32> release = {0};
+		Atomic<U32> decodeCount = {0};
+
+		StageTask* blocker = loader.newTask<StageTask>();
+		blocker->m_release = &release;
+		const AsyncLoaderTaskHandle blockerHandle = loader.submitTask(blocker, AsyncLoaderPriority::kHigh);
+		while(blockerHandle.getState() != AsyncLoaderTaskState::kRunning)
+		{
+			HighRezTimer::sleep(0.1_ms);
+		}
+
+		NonCancellableTask* task = loader.newTask<NonCancellableTask>();
+		task->m_decodeCount = &decodeCount;
+		const AsyncLoaderTaskHandle handle = loader.submitTask(task, AsyncLoaderPriority::kLow);
+		loader.cancelTask(handle);
+		ANKI_TEST_EXPECT_EQ(handle.getState(), AsyncLoaderTaskState::kQueued);
+
+		release.store(1);
+		waitForTasks(loader);
+		ANKI_TEST_EXPECT_EQ(handle.getState(), AsyncLoaderTaskState::kCompleted);
+		ANKI_TEST_EXPECT_EQ(decodeCount.load(), 1);
+	}
+
+	// A failed task
+	{
+		AsyncLoader loader(1, 1);
+		StageTask* task = loader.newTask<StageTask>();
+		task->m_fail = true;
+		const AsyncLoaderTaskHandle handle = loader.submitTask(task, AsyncLoaderPriority::kMedium);
+		waitForTasks(loader);
+		ANKI_TEST_EXPECT_EQ(handle.getState(), AsyncLoaderTaskState::kFailed);
+	}
+
+	ResourceMemoryPool::freeSingleton();
+}
+
+ANKI_TEST(Resource, AsyncLoaderBench)
+{
+	ResourceMemoryPool::allocateSingleton(allocAligned, nullptr);
+
+	constexpr U32 kTaskCount = 400;
+	constexpr Second kIoTime = 1.0_ms;
+	constexpr Second kDecodeTime = 0.5_ms;
+
+	class Config
+	{
+	public:
+		U32 m_threadCount;
+		U32 m_ioThreadCount;
+		CString m_name;
+	};
+
+	for(const Config& config : {Config{1, 0, "single thread"}, Config{2, 2, "2 decode+2 I/O threads"}, Config{4, 4, "4 decode+4 I/O threads"}})
+	{
+		AsyncLoader loader(config.m_threadCount, config.m_ioThreadCount);
+
+		// A long streaming queue of low priority work and then a single high priority task
+		const Second begin = HighRezTimer::getCurrentTime();
+		for(U32 i = 0; i < kTaskCount; ++i)
+		{
+			StageTask* task = loader.newTask<StageTask>();
+			task->m_ioTime = kIoTime;
+			task->m_decodeTime = kDecodeTime;
+			loader.submitTask(task, AsyncLoaderPriority::kLow);
+		}
+
+		Second highDoneTime = 0.0;
+		const Second highBegin = HighRezTimer::getCurrentTime();
+		StageTask* task = loader.newTask<StageTask>();
+		task->m_ioTime = kIoTime;
+		task->m_decodeTime = kDecodeTime;
+		task->m_doneTime = &highDoneTime;
+		loader.submitTask(task, AsyncLoaderPriority::kHigh);
+
+		waitForTasks(loader);
+		const Second totalTime = HighRezTimer::getCurrentTime() - begin;
+
+		ANKI_TEST_LOGI("%s: %f tasks/sec, high priority latency %fms", config.m_name.cstr(), F64(kTaskCount + 1) / totalTime,
+					   (highDoneTime - highBegin) * 1000.0);
+	}
+
+	ResourceMemoryPool::freeSingleton();
+}
@@ -5,6 +5,10 @@
 
 #include <Tests/Framework/Framework.h>
 #include <AnKi/Resource/ResourceFilesystem.h>
+#include <AnKi/Util/Filesystem.h>
+#include <AnKi/Util/HighRezTimer.h>
+#include <ZLib/contrib/minizip/zip.h>
+#include <ZLib/contrib/minizip/unzip.h>
 
 ANKI_TEST(Resource, ResourceFilesystem)
 {
@@ -31,3 +35,299 @@ ANKI_TEST(Resource, ResourceFilesystem)
 		ANKI_TEST_EXPECT_EQ(txt, "hell\n");
 	}
 }
+
+ANKI_TEST(Resource, ResourceFilesystemArchive)
+{
+	DefaultMemoryPool::allocateSingleton(allocAligned, nullptr);
+	ResourceMemoryPool::allocateSingleton(allocAligned, nullptr);
+
+	{
+		constexpr U32 kFileCount = 1000;
+		constexpr U32 kFileSize = 16_KB;
+		constexpr U32 kReadOffset = kFileSize / 2;
+		constexpr U32 kReadSize = 256;
+		auto expectedByte = [](U32 file, U32 offset) {
+			return U8((file * 7 + offset) % 251);
+		};
+
+		// Create an archive where half of the files are stored and the rest compressed
+		String archiveFname;
+		{
+			String tmpDir;
+			ANKI_TEST_EXPECT_NO_ERR(getTempDirectory(tmpDir));
+			archiveFname.sprintf("%s/ResourceFilesystemBench.ankizip", tmpDir.cstr());
+
+			zipFile zfile = zipOpen(archiveFname.cstr(), APPEND_STATUS_CREATE);
+			ANKI_TEST_EXPECT_NEQ(zfile, nullptr);
+
+			DynamicArray<U8> data;
+			data.resize(kFileSize);
+			for(U32 i = 0; i < kFileCount; ++i)
+			{
+				for(U32 j = 0; j < kFileSize; ++j)
+				{
+					data[j] = expectedByte(i, j);
+				}
+
+				String fname;
+				fname.sprintf("dir/file%u.ankimesh", i);
+				const Bool stored = (i % 2) == 0;
+				const I32 method = (stored) ? 0 : Z_DEFLATED;
+				ANKI_TEST_EXPECT_EQ(zipOpenNewFileInZip(zfile, fname.cstr(), nullptr, nullptr, 0, nullptr, 0, nullptr, method, Z_DEFAULT_COMPRESSION),
+									ZIP_OK);
+				ANKI_TEST_EXPECT_EQ(zipWriteInFileInZip(zfile, data.getBegin(), kFileSize), ZIP_OK);
+				ANKI_TEST_EXPECT_EQ(zipCloseFileInZip(zfile), ZIP_OK);
+			}
+
+			ANKI_TEST_EXPECT_EQ(zipClose(zfile, nullptr), ZIP_OK);
+		}
+
+		// The old way: Open the archive and search the central directory for every file and seek by reading from the beginning
+		F64 legacyTime;
+		{
+			const F64 begin = HighRezTimer::getCurrentTime();
+
+			Array<U8, kReadOffset + kReadSize> data;
+			for(U32 i = 0; i < kFileCount; ++i)
+			{
+				String fname;
+				fname.sprintf("dir/file%u.ankimesh", i);
+
+				unzFile zfile = unzOpen(archiveFname.cstr());
+				ANKI_TEST_EXPECT_EQ(unzLocateFile(zfile, fname.cstr(), 1), UNZ_OK);
+				ANKI_TEST_EXPECT_EQ(unzOpenCurrentFile(zfile), UNZ_OK);
+
+				for(U32 offset = 0; offset < kReadOffset + kReadSize; offset += 128)
+				{
+					ANKI_TEST_EXPECT_EQ(unzReadCurrentFile(zfile, &data[offset], 128), 128);
+				}
+
+				ANKI_TEST_EXPECT_EQ(data[kReadOffset], expectedByte(i, kReadOffset));
+
+				unzCloseCurrentFile(zfile);
+				unzClose(zfile);
+			}
+
+			legacyTime = HighRezTimer::getCurrentTime() - begin;
+		}
+
+		// Using the ResourceFilesystem
+		F64 newTime;
+		{
+			ResourceFilesystem fs;
+			ANKI_TEST_EXPECT_NO_ERR(fs.addNewPath(archiveFname, ResourceStringList(), ResourceStringList()));
+
+			const F64 begin = HighRezTimer::getCurrentTime();
+
+			Array<U8, kReadSize> data;
+			for(U32 i = 0; i < kFileCount; ++i)
+			{
+				ResourceString fname;
+				fname.sprintf("dir/file%u.ankimesh", i);
+
+				ResourceFilePtr file;
+				ANKI_TEST_EXPECT_NO_ERR(fs.openFile(fname, file));
+				ANKI_TEST_EXPECT_EQ(file->getSize(), kFileSize);
+
+				ANKI_TEST_EXPECT_NO_ERR(file->seek(kReadOffset, FileSeekOrigin::kBeginning));
+				ANKI_TEST_EXPECT_NO_ERR(file->read(&data[0], kReadSize));
+				for(U32 j = 0; j < kReadSize; ++j)
+				{
+					ANKI_TEST_EXPECT_EQ(data[j], expectedByte(i, kReadOffset + j));
+				}
+			}
+
+			newTime = HighRezTimer::getCurrentTime() - begin;
+
+			// Seek backwards
+			for(U32 i = 0; i < 2; ++i)
+			{
+				ResourceString fname;
+				fname.sprintf("dir/file%u.ankimesh", i);
+
+				ResourceFilePtr file;
+				ANKI_TEST_EXPECT_NO_ERR(fs.openFile(fname, file));
+				ANKI_TEST_EXPECT_NO_ERR(file->seek(kFileSize - 4, FileSeekOrigin::kBeginning));
+				ANKI_TEST_EXPECT_NO_ERR(file->seek(1, FileSeekOrigin::kBeginning));
+				ANKI_TEST_EXPECT_NO_ERR(file->seek(1, FileSeekOrigin::kCurrent));
+				ANKI_TEST_EXPECT_NO_ERR(file->read(&data[0], 1));
+				ANKI_TEST_EXPECT_EQ(data[0], expectedByte(i, 2));
+				ANKI_TEST_EXPECT_ERR(file->seek(kFileSize + 1, FileSeekOrigin::kBeginning), Error::kFunctionFailed);
+			}
+		}
+
+		ANKI_TEST_LOGI("Opening %u archived files and reading from the middle: legacy %fms, new %fms, speedup %fx", kFileCount,
+					   legacyTime * 1000.0, newTime * 1000.0, legacyTime / newTime);
+
+		ANKI_TEST_EXPECT_NO_ERR(removeFile(archiveFname));
+	}
+
+	ResourceMemoryPool::freeSingleton();
+	DefaultMemoryPool::freeSingleton();
+}
+
+ANKI_TEST(Resource, ResourceFilesystemIndex)
+{
+	DefaultMemoryPool::allocateSingleton(allocAligned, nullptr);
+	ResourceMemoryPool::allocateSingleton(allocAligned, nullptr);
+
+	{
+		String tmpDir;
+		ANKI_TEST_EXPECT_NO_ERR(getTempDirectory(tmpDir));
+
+		// Create 2 data paths that share some files
+		Array<String, 2> dataPaths;
+		for(U32 i = 0; i < 2; ++i)
+		{
+			dataPaths[i].sprintf("%s/ResourceFilesystemIndex%u", tmpDir.cstr(), i);
+			ANKI_TEST_EXPECT_NO_ERR(createDirectory(dataPaths[i]));
+
+			String dir;
+			dir.sprintf("%s/meshes", dataPaths[i].cstr());
+			ANKI_TEST_EXPECT_NO_ERR(createDirectory(dir));
+
+			for(CString fname : {"meshes/a.ankimesh", "meshes/b.ankimesh", "c.ankimesh"})
+			{
+				String fullFname;
+				fullFname.sprintf("%s/%s", dataPaths[i].cstr(), fname.cstr());
+				File file;
+				ANKI_TEST_EXPECT_NO_ERR(file.open(fullFname, FileOpenFlag::kWrite));
+				ANKI_TEST_EXPECT_NO_ERR(file.writeTextf("%u", i));
+			}
+		}
+
+		ResourceFilesystem fs;
+		ANKI_TEST_EXPECT_NO_ERR(fs.addNewPath(dataPaths[0], ResourceStringList(), ResourceStringList()));
+		ANKI_TEST_EXPECT_NO_ERR(fs.addNewPath(dataPaths[1], ResourceStringList(), ResourceStringList()));
+
+		// The last data path has the highest priority
+		ResourceFilePtr file;
+		ANKI_TEST_EXPECT_NO_ERR(fs.openFile("meshes/b.ankimesh", file));
+		ResourceString txt;
+		ANKI_TEST_EXPECT_NO_ERR(file->readAllText(txt));
+		ANKI_TEST_EXPECT_EQ(txt, "1");
+
+		// Prefix queries visit every file once
+		U32 count = 0;
+		fs.iterateAllFilenames("meshes/", [&](CString fname) {
+			ANKI_TEST_EXPECT_EQ(fname.find("meshes/"), 0);
+			++count;
+			return FunctorContinue::kContinue;
+		});
+		ANKI_TEST_EXPECT_EQ(count, 2);
+
+		count = 0;
+		fs.iterateAllFilenames("", [&]([[maybe_unused]] CString fname) {
+			++count;
+			return FunctorContinue::kContinue;
+		});
+		ANKI_TEST_EXPECT_EQ(count, 3);
+
+		for(const String& dataPath : dataPaths)
+		{
+			ANKI_TEST_EXPECT_NO_ERR(removeDirectory(dataPath));
+		}
+	}
+
+	ResourceMemoryPool::freeSingleton();
+	DefaultMemoryPool::freeSingleton();
+}
+
+ANKI_TEST(Resource, ResourceFilesystemMapped)
+{
+	DefaultMemoryPool::allocateSingleton(allocAligned, nullptr);
+	ResourceMemoryPool::allocateSingleton(allocAligned, nullptr);
+
+	{
+		constexpr PtrSize kFileSize = 64_MB;
+		constexpr PtrSize kChunkSize = 256_KB; // Something like a mip or a vertex buffer
+		constexpr U32 kIterationCount = 8;
+
+		String tmpDir;
+		ANKI_TEST_EXPECT_NO_ERR(getTempDirectory(tmpDir));
+		String dataPath;
+		dataPath.sprintf("%s/ResourceFilesystemMapped", tmpDir.cstr());
+		ANKI_TEST_EXPECT_NO_ERR(createDirectory(dataPath));
+
+		auto expectedByte = [](PtrSize offset) {
+			return U8((offset * 7) ^ (offset >> 12));
+		};
+
+		{
+			DynamicArray<U8> data;
+			data.resize(kFileSize);
+			for(PtrSize i = 0; i < kFileSize; ++i)
+			{
+				data[i] = expectedByte(i);
+			}
+
+			String fname;
+			fname.sprintf("%s/big.ankimesh", dataPath.cstr());
+			File file;
+			ANKI_TEST_EXPECT_NO_ERR(file.open(fname, FileOpenFlag::kWrite | FileOpenFlag::kBinary));
+			ANKI_TEST_EXPECT_NO_ERR(file.write(data.getBegin(), kFileSize));
+
+			fname.sprintf("%s/empty.ankimtl", dataPath.cstr());
+			ANKI_TEST_EXPECT_NO_ERR(file.open(fname, FileOpenFlag::kWrite));
+		}
+
+		ResourceFilesystem fs;
+		ANKI_TEST_EXPECT_NO_ERR(fs.addNewPath(dataPath, ResourceStringList(), ResourceStringList()));
+
+		// Correctness
+		{
+			g_cvarRsrcMemoryMapFiles = true;
+			ResourceFilePtr file;
+			ANKI_TEST_EXPECT_NO_ERR(fs.openFile("big.ankimesh", file));
+			ANKI_TEST_EXPECT_EQ(file->getSize(), kFileSize);
+
+			ANKI_TEST_EXPECT_NO_ERR(file->seek(1000, FileSeekOrigin::kBeginning));
+			const U8* mapped = file->readMapped(16);
+			ANKI_TEST_EXPECT_NEQ(mapped, nullptr);
+			ANKI_TEST_EXPECT_EQ(mapped[0], expectedByte(1000));
+
+			U8 byte;
+			ANKI_TEST_EXPECT_NO_ERR(file->read(&byte, 1));
+			ANKI_TEST_EXPECT_EQ(byte, expectedByte(1016));
+
+			ANKI_TEST_EXPECT_NO_ERR(file->seek(kFileSize - 1, FileSeekOrigin::kBeginning));
+			ANKI_TEST_EXPECT_EQ(file->readMapped(2), nullptr);
+			ANKI_TEST_EXPECT_ERR(file->seek(kFileSize + 1, FileSeekOrigin::kBeginning), Error::kFileAccess);
+
+			// Empty files can't be mapped, they fallback to regular files
+			ANKI_TEST_EXPECT_NO_ERR(fs.openFile("empty.ankimtl", file));
+			ANKI_TEST_EXPECT_EQ(file->readMapped(0), nullptr);
+		}
+
+		// Bench. Copy the file in chunks to some "staging" memory
+		DynamicArray<U8> staging;
+		staging.resize(kFileSize);
+		Array<F64, 2> times = {};
+		for(U32 mapped = 0; mapped < 2; ++mapped)
+		{
+			g_cvarRsrcMemoryMapFiles = mapped;
+			for(U32 it = 0; it < kIterationCount; ++it)
+			{
+				const F64 begin = HighRezTimer::getCurrentTime();
+				ResourceFilePtr file;
+				ANKI_TEST_EXPECT_NO_ERR(fs.openFile("big.ankimesh", file));
+				for(PtrSize offset = 0; offset < kFileSize; offset += kChunkSize)
+				{
+					ANKI_TEST_EXPECT_NO_ERR(file->read(&staging[offset], kChunkSize));
+				}
+				times[mapped] += HighRezTimer::getCurrentTime() - begin;
+			}
+
+			ANKI_TEST_EXPECT_EQ(staging[kFileSize / 2 + 3], expectedByte(kFileSize / 2 + 3));
+		}
+
+		g_cvarRsrcMemoryMapFiles = true;
+		ANKI_TEST_LOGI("Reading a %zuMB file in %zuKB chunks: read() %fms, mapped %fms, speedup %fx", kFileSize / 1_MB, kChunkSize / 1_KB,
+					   times[0] * 1000.0 / kIterationCount, times[1] * 1000.0 / kIterationCount, times[0] / times[1]);
+
+		ANKI_TEST_EXPECT_NO_ERR(removeDirectory(dataPath));
+	}
+
+	ResourceMemoryPool::freeSingleton();
+	DefaultMemoryPool::freeSingleton();
+}
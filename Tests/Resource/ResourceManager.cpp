@@ -69,6 +69,133 @@ ANKI_TEST(Resource, ResourceManager)
 		}
 	}
 
+	// Load the same resource from many threads at the same time. All of them should get the same resource
+	{
+		class ThreadData
+		{
+		public:
+			CString m_filename;
+			DummyResourcePtr m_rsrc;
+			Error m_err = Error::kNone;
+		};
+
+		constexpr U32 kThreadCount = 8;
+		Array<ThreadData, kThreadCount> threadData;
+		Array<Thread*, kThreadCount> threads;
+
+		for(const CString& fname : {CString("concurrent"), CString("concurrent_error")})
+		{
+			for(U32 i = 0; i < kThreadCount; ++i)
+			{
+				threadData[i].m_filename = fname;
+				threads[i] = new Thread("Load");
+				threads[i]->start(&threadData[i], [](ThreadCallbackInfo& info) -> Error {
+					ThreadData& data = *static_cast<ThreadData*>(info.m_userData);
+					data.m_err = ResourceManager::getSingleton().loadResource(data.m_filename, data.m_rsrc);
+					return Error::kNone;
+				});
+			}
+
+			for(U32 i = 0; i < kThreadCount; ++i)
+			{
+				ANKI_TEST_EXPECT_NO_ERR(threads[i]->join());
+				delete threads[i];
+			}
+
+			for(U32 i = 0; i < kThreadCount; ++i)
+			{
+				if(fname == "concurrent")
+				{
+					ANKI_TEST_EXPECT_NO_ERR(threadData[i].m_err);
+					ANKI_TEST_EXPECT_EQ(threadData[i].m_rsrc.get(), threadData[0].m_rsrc.get());
+				}
+				else
+				{
+					ANKI_TEST_EXPECT_EQ(threadData[i].m_err, Error::kUserData);
+					ANKI_TEST_EXPECT_EQ(threadData[i].m_rsrc.isCreated(), false);
+				}
+
+				threadData[i].m_rsrc.reset(nullptr);
+			}
+		}
+	}
+
+	// Unreferenced resources stay around until the budget is exceeded
+	{
+		U32 uuid;
+		{
+			DummyResourcePtr a;
+			ANKI_TEST_EXPECT_NO_ERR(resources->loadResource("lru", a));
+			uuid = a->getUuid();
+		}
+
+		const PtrSize cpuMemory = resources->getCpuMemoryUsage();
+		ANKI_TEST_EXPECT_GEQ(cpuMemory, 128);
+
+		{
+			// Revived
+			DummyResourcePtr a;
+			ANKI_TEST_EXPECT_NO_ERR(resources->loadResource("lru", a));
+			ANKI_TEST_EXPECT_EQ(a->getUuid(), uuid);
+		}
+
+		// Exceed the budget, the unreferenced resources should go
+		const PtrSize oldBudget = g_cvarRsrcCpuMemoryBudget;
+		g_cvarRsrcCpuMemoryBudget = 1;
+		{
+			DummyResourcePtr b;
+			ANKI_TEST_EXPECT_NO_ERR(resources->loadResource("lru2", b));
+		}
+		ANKI_TEST_EXPECT_EQ(resources->getCpuMemoryUsage(), 0);
+
+		{
+			DummyResourcePtr a;
+			ANKI_TEST_EXPECT_NO_ERR(resources->loadResource("lru", a));
+			ANKI_TEST_EXPECT_NEQ(a->getUuid(), uuid);
+		}
+
+		g_cvarRsrcCpuMemoryBudget = oldBudget;
+		resources->evictUnreferencedResources();
+		ANKI_TEST_EXPECT_EQ(resources->getCpuMemoryUsage(), 0);
+	}
+
+	// Load, release and evict the same resources from many threads. The budget is tiny so every release evicts something while other threads
+	// revive the same resources
+	{
+		const PtrSize oldBudget = g_cvarRsrcCpuMemoryBudget;
+		g_cvarRsrcCpuMemoryBudget = 1;
+
+		constexpr U32 kThreadCount = 8;
+		Array<Thread*, kThreadCount> threads;
+		Array<Error, kThreadCount> errors = {Error::kNone, Error::kNone, Error::kNone, Error::kNone,
+											 Error::kNone, Error::kNone, Error::kNone, Error::kNone};
+		for(U32 i = 0; i < kThreadCount; ++i)
+		{
+			threads[i] = new Thread("Evict");
+			threads[i]->start(&errors[i], [](ThreadCallbackInfo& info) -> Error {
+				Error& err = *static_cast<Error*>(info.m_userData);
+				constexpr Array<CString, 3> kFilenames = {"evict0", "evict1", "evict2"};
+				for(U32 it = 0; it < 2000 && !err; ++it)
+				{
+					DummyResourcePtr a;
+					err = ResourceManager::getSingleton().loadResource(kFilenames[it % kFilenames.getSize()], a);
+				}
+				return Error::kNone;
+			});
+		}
+
+		for(U32 i = 0; i < kThreadCount; ++i)
+		{
+			ANKI_TEST_EXPECT_NO_ERR(threads[i]->join());
+			delete threads[i];
+			ANKI_TEST_EXPECT_NO_ERR(errors[i]);
+		}
+
+		g_cvarRsrcCpuMemoryBudget = oldBudget;
+		resources->evictUnreferencedResources();
+		ANKI_TEST_EXPECT_EQ(resources->getCpuMemoryUsage(), 0);
+	}
+
 	// Delete
 	ResourceManager::freeSingleton();
 }
@@ -0,0 +1,242 @@
+// Copyright (C) 2009-present, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <Tests/Framework/Framework.h>
+#include <AnKi/Scene/AnimationPoseCache.h>
+#include <AnKi/Resource/SkeletonResource.h>
+#include <AnKi/Resource/AnimationResource.h>
+#include <AnKi/Resource/ResourceFilesystem.h>
+#include <AnKi/Util/Filesystem.h>
+#include <AnKi/Util/File.h>
+#include <AnKi/Util/HighRezTimer.h>
+
+using namespace anki;
+
+namespace {
+
+// What SkinComponent used to do. Walk the hierarchy recursively
+void visitBones(const Bone& bone, const Mat3x4& parentTrf, ConstWeakArray<AnimationChannelSample> locals, const BitSet<128>& bonesAnimated,
+				WeakArray<Mat3x4> out)
+{
+	Mat3x4 outMat;
+	if(bonesAnimated.get(bone.getIndex()))
+	{
+		const AnimationChannelSample& t = locals[bone.getIndex()];
+		outMat = parentTrf.combineTransformations(Mat3x4(t.m_position, Mat3(t.m_rotation), Vec3(t.m_scale)));
+	}
+	else
+	{
+		outMat = parentTrf.combineTransformations(bone.getTransform());
+	}
+
+	out[bone.getIndex()] = outMat.combineTransformations(bone.getVertexTransform());
+
+	for(const Bone* child : bone.getChildren())
+	{
+		visitBones(*child, outMat, locals, bonesAnimated, out);
+	}
+}
+
+} // namespace
+
+ANKI_TEST(Scene, AnimationPoseCache)
+{
+	DefaultMemoryPool::allocateSingleton(allocAligned, nullptr);
+	SceneMemoryPool::allocateSingleton(allocAligned, nullptr);
+	ResourceMemoryPool::allocateSingleton(allocAligned, nullptr);
+
+	{
+		constexpr U32 kBoneCount = 64;
+		constexpr U32 kKeyCount = 31;
+		constexpr U32 kCharacterCount = 1000;
+		constexpr U32 kCrowdGroups = 8; // Characters in the same group play the clip in sync
+
+		String tmpDir;
+		ANKI_TEST_EXPECT_NO_ERR(getTempDirectory(tmpDir));
+		ResourceString dataDir;
+		dataDir.sprintf("%s/AnimationPoseCacheTest", tmpDir.cstr());
+		if(directoryExists(dataDir))
+		{
+			ANKI_TEST_EXPECT_NO_ERR(removeDirectory(dataDir));
+		}
+		ANKI_TEST_EXPECT_NO_ERR(createDirectory(dataDir));
+
+		// Write a skeleton that is a binary tree
+		{
+			File file;
+			ResourceString fname;
+			fname.sprintf("%s/Test.ankiskel", dataDir.cstr());
+			ANKI_TEST_EXPECT_NO_ERR(file.open(fname, FileOpenFlag::kWrite));
+			ANKI_TEST_EXPECT_NO_ERR(file.writeText("<skeleton><bones>\n"));
+			for(U32 b = 0; b < kBoneCount; ++b)
+			{
+				ResourceString parent;
+				if(b > 0)
+				{
+					parent.sprintf(" parent=\"bone%u\"", (b - 1) / 2);
+				}
+
+				ANKI_TEST_EXPECT_NO_ERR(file.writeTextf("<bone name=\"bone%u\" transform=\"1 0 0 0 0 1 0 1 0 0 1 0\" "
+														"boneTransform=\"1 0 0 0 0 1 0 -%u 0 0 1 0\"%s/>\n",
+														b, b, parent.cstr()));
+			}
+			ANKI_TEST_EXPECT_NO_ERR(file.writeText("</bones></skeleton>\n"));
+		}
+
+		// Write an animation that moves all bones but the last
+		{
+			File file;
+			ResourceString fname;
+			fname.sprintf("%s/Test.ankianim", dataDir.cstr());
+			ANKI_TEST_EXPECT_NO_ERR(file.open(fname, FileOpenFlag::kWrite));
+			ANKI_TEST_EXPECT_NO_ERR(file.writeText("<animation><channels>\n"));
+			for(U32 c = 0; c < kBoneCount - 1; ++c)
+			{
+				ANKI_TEST_EXPECT_NO_ERR(file.writeTextf("<channel name=\"bone%u\">\n<positionKeys>\n", c));
+				for(U32 k = 0; k < kKeyCount; ++k)
+				{
+					ANKI_TEST_EXPECT_NO_ERR(file.writeTextf("<key time=\"%f\">0 1 %f</key>\n", F32(k) / 30.0f, sin(F32(k + c) * 0.2f)));
+				}
+				ANKI_TEST_EXPECT_NO_ERR(file.writeText("</positionKeys>\n<rotationKeys>\n"));
+				for(U32 k = 0; k < kKeyCount; ++k)
+				{
+					const Quat q(Axisang(F32(k) * 0.05f + F32(c) * 0.1f, Vec3(0.0f, 0.0f, 1.0f)));
+					ANKI_TEST_EXPECT_NO_ERR(file.writeTextf("<key time=\"%f\">%f %f %f %f</key>\n", F32(k) / 30.0f, q.x, q.y, q.z, q.w));
+				}
+				ANKI_TEST_EXPECT_NO_ERR(file.writeText("</rotationKeys>\n</channel>\n"));
+			}
+			ANKI_TEST_EXPECT_NO_ERR(file.writeText("</channels></animation>\n"));
+		}
+
+		g_cvarRsrcDataPaths = dataDir.toCString();
+		ResourceFilesystem::allocateSingleton();
+		ANKI_TEST_EXPECT_NO_ERR(ResourceFilesystem::getSingleton().init());
+
+		{
+			SkeletonResource skeleton("Test.ankiskel", 1);
+			ANKI_TEST_EXPECT_NO_ERR(skeleton.load("Test.ankiskel", false));
+			AnimationResource anim("Test.ankianim", 2);
+			ANKI_TEST_EXPECT_NO_ERR(anim.load("Test.ankianim", false));
+
+			const U32 channelCount = anim.getChannels().getSize();
+			SceneDynamicArray<U32> channelBones;
+			channelBones.resize(channelCount);
+			for(U32 i = 0; i < channelCount; ++i)
+			{
+				channelBones[i] = skeleton.tryFindBone(anim.getChannels()[i].m_name.toCString())->getIndex();
+			}
+
+			SceneDynamicArray<AnimationChannelSample> samples;
+			samples.resize(channelCount);
+			SceneDynamicArray<AnimationChannelSample> locals;
+			locals.resize(kBoneCount, AnimationChannelSample{Vec3(0.0f), Quat::getIdentity(), 1.0f});
+			SceneDynamicArray<Mat3x4> pose;
+			pose.resize(kBoneCount);
+			SceneDynamicArray<Mat3x4> legacyPose;
+			legacyPose.resize(kBoneCount);
+
+			auto evaluate = [&](Second time, BitSet<128>& bonesAnimated) {
+				anim.interpolateAll(time, WeakArray<AnimationChannelSample>(samples));
+				bonesAnimated.unsetAll();
+				for(U32 i = 0; i < channelCount; ++i)
+				{
+					locals[channelBones[i]] = samples[i];
+					bonesAnimated.set(channelBones[i]);
+				}
+			};
+
+			StackMemoryPool framePool;
+			framePool.init(allocAligned, nullptr, 1_MB, 2.0, 0, true, "AnimationPoseCacheTest");
+			AnimationPoseCache cache(&framePool);
+
+			// The flat evaluation and the cache should match the recursive walk
+			for(U32 i = 0; i < 10; ++i)
+			{
+				const Second time = Second(i) / 10.0;
+				BitSet<128> bonesAnimated(false);
+				evaluate(time, bonesAnimated);
+
+				Vec3 minExtend, maxExtend;
+				computeSkeletonPose(skeleton, WeakArray<AnimationChannelSample>(locals), bonesAnimated, WeakArray<Mat3x4>(pose), minExtend,
+									maxExtend);
+				visitBones(skeleton.getRootBone(), Mat3x4::getIdentity(), WeakArray<AnimationChannelSample>(locals), bonesAnimated,
+						   WeakArray<Mat3x4>(legacyPose));
+
+				const AnimationPoseCache::Pose& cached = cache.getPose(skeleton, anim, WeakArray<U32>(channelBones), time);
+				ANKI_TEST_EXPECT_EQ(&cached, &cache.getPose(skeleton, anim, WeakArray<U32>(channelBones), time));
+				ANKI_TEST_EXPECT_EQ(cached.m_minExtend, minExtend);
+				ANKI_TEST_EXPECT_EQ(cached.m_maxExtend, maxExtend);
+
+				for(U32 b = 0; b < kBoneCount; ++b)
+				{
+					ANKI_TEST_EXPECT_EQ(pose[b], legacyPose[b]);
+					ANKI_TEST_EXPECT_EQ(cached.m_boneTransforms[b], pose[b]);
+				}
+			}
+
+			// Benchmark a crowd
+			constexpr U32 kFrameCount = 20;
+			F32 sink = 0.0f;
+			Second begin = HighRezTimer::getCurrentTime();
+			for(U32 f = 0; f < kFrameCount; ++f)
+			{
+				for(U32 c = 0; c < kCharacterCount; ++c)
+				{
+					const Second time = Second(f) / 60.0 + Second(c % kCrowdGroups) * 0.1;
+					BitSet<128> bonesAnimated(false);
+					evaluate(time, bonesAnimated);
+					visitBones(skeleton.getRootBone(), Mat3x4::getIdentity(), WeakArray<AnimationChannelSample>(locals), bonesAnimated,
+							   WeakArray<Mat3x4>(legacyPose));
+					sink += legacyPose[c % kBoneCount](0, 3);
+				}
+			}
+			const Second legacyTime = HighRezTimer::getCurrentTime() - begin;
+
+			begin = HighRezTimer::getCurrentTime();
+			for(U32 f = 0; f < kFrameCount; ++f)
+			{
+				for(U32 c = 0; c < kCharacterCount; ++c)
+				{
+					const Second time = Second(f) / 60.0 + Second(c % kCrowdGroups) * 0.1;
+					BitSet<128> bonesAnimated(false);
+					evaluate(time, bonesAnimated);
+					Vec3 minExtend, maxExtend;
+					computeSkeletonPose(skeleton, WeakArray<AnimationChannelSample>(locals), bonesAnimated, WeakArray<Mat3x4>(pose), minExtend,
+										maxExtend);
+					sink += pose[c % kBoneCount](0, 3);
+				}
+			}
+			const Second flatTime = HighRezTimer::getCurrentTime() - begin;
+
+			begin = HighRezTimer::getCurrentTime();
+			for(U32 f = 0; f < kFrameCount; ++f)
+			{
+				cache.reset();
+				framePool.reset();
+
+				for(U32 c = 0; c < kCharacterCount; ++c)
+				{
+					const Second time = Second(f) / 60.0 + Second(c % kCrowdGroups) * 0.1;
+					const AnimationPoseCache::Pose& cached = cache.getPose(skeleton, anim, WeakArray<U32>(channelBones), time);
+					memcpy(pose.getBegin(), cached.m_boneTransforms.getBegin(), cached.m_boneTransforms.getSizeInBytes());
+					sink += pose[c % kBoneCount](0, 3);
+				}
+			}
+			const Second cacheTime = HighRezTimer::getCurrentTime() - begin;
+
+			ANKI_TEST_LOGI("%u characters x %u frames: recursive %fms, flat %fms, pose cache %fms (%fx) %f", kCharacterCount, kFrameCount,
+						   legacyTime * 1000.0, flatTime * 1000.0, cacheTime * 1000.0, legacyTime / cacheTime, sink);
+
+			cache.reset();
+		}
+
+		ResourceFilesystem::freeSingleton();
+		ANKI_TEST_EXPECT_NO_ERR(removeDirectory(dataDir));
+	}
+
+	ResourceMemoryPool::freeSingleton();
+	SceneMemoryPool::freeSingleton();
+	DefaultMemoryPool::freeSingleton();
+}
@@ -0,0 +1,135 @@
+// Copyright (C) 2009-present, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <Tests/Framework/Framework.h>
+#include <AnKi/Core/App.h>
+#include <AnKi/Scene/SceneGraph.h>
+#include <AnKi/Resource/ResourceFilesystem.h>
+#include <AnKi/Util/Filesystem.h>
+
+using namespace anki;
+
+namespace {
+
+// Creates and saves a scene, loads it back with SceneGraph::loadSceneAsync and follows the loading in the main loop
+class SceneLoadingApp : public App
+{
+public:
+	static constexpr U32 kNodeCount = 10000;
+
+	String m_dataDir;
+	Scene* m_sceneToSave = nullptr;
+	Scene* m_scene = nullptr;
+	F32 m_prevProgress = 0.0f;
+	U32 m_loadingFrameCount = 0;
+	U32 m_loadedNodeCount = 0;
+	Bool m_headerOnly = false;
+	Bool m_loadingFinished = false;
+	Bool m_loadingFailed = false;
+	Bool m_progressDecreased = false;
+
+	SceneLoadingApp()
+		: App("SceneLoading", 0, nullptr)
+	{
+	}
+
+	Error userPreInit() override
+	{
+		g_cvarWindowFullscreen = 0;
+		g_cvarSceneStreamingLoadBudget = 0.1f;
+
+		String tmpDir;
+		ANKI_CHECK(getTempDirectory(tmpDir));
+		m_dataDir.sprintf("%s/SceneLoadingTest", tmpDir.cstr());
+		if(directoryExists(m_dataDir))
+		{
+			ANKI_CHECK(removeDirectory(m_dataDir));
+		}
+		ANKI_CHECK(createDirectory(m_dataDir));
+
+		g_cvarRsrcDataPaths = String().sprintf("%s:%s", CString(g_cvarRsrcDataPaths).cstr(), m_dataDir.cstr());
+		return Error::kNone;
+	}
+
+	Error userMainLoop(Bool& quit, [[maybe_unused]] Second elapsedTime) override
+	{
+		SceneGraph& sceneGraph = SceneGraph::getSingleton();
+
+		if(m_sceneToSave == nullptr && m_scene == nullptr)
+		{
+			// Create the scene. The nodes will be registered to it in the scene update
+			m_sceneToSave = sceneGraph.newEmptyScene("ToSave");
+			m_sceneToSave->setCanBeSaved(true);
+			sceneGraph.setActiveScene(m_sceneToSave);
+
+			for(U32 i = 0; i < kNodeCount; ++i)
+			{
+				sceneGraph.newSceneNode<SceneNode>(String().sprintf("Node%u", i));
+			}
+		}
+		else if(m_sceneToSave)
+		{
+			if(m_sceneToSave->getSceneNodeCount() < kNodeCount)
+			{
+				return Error::kNone;
+			}
+
+			// Save it and load it back incrementally
+			String filename;
+			filename.sprintf("%s/Sliced.ankiscenebin", m_dataDir.cstr());
+			ANKI_CHECK(sceneGraph.saveScene(filename, *m_sceneToSave));
+			sceneGraph.deleteScene(m_sceneToSave);
+			m_sceneToSave = nullptr;
+
+			ANKI_CHECK(ResourceFilesystem::getSingleton().refreshAll());
+
+			ANKI_CHECK(sceneGraph.loadSceneAsync("Sliced.ankiscenebin", m_scene));
+			m_headerOnly = m_scene->isLoading() && m_scene->getLoadingProgress() < 1.0f;
+			m_prevProgress = m_scene->getLoadingProgress();
+		}
+		else if(m_loadingFinished)
+		{
+			// The nodes that were created in the last slice are registered by now
+			m_loadedNodeCount = m_scene->getSceneNodeCount();
+			m_loadingFailed = m_scene->loadingFailed();
+			quit = true;
+		}
+		else
+		{
+			const F32 progress = m_scene->getLoadingProgress();
+			m_progressDecreased = m_progressDecreased || progress < m_prevProgress;
+			m_prevProgress = progress;
+
+			if(m_scene->isLoading())
+			{
+				++m_loadingFrameCount;
+			}
+			else
+			{
+				m_loadingFinished = true;
+			}
+		}
+
+		return Error::kNone;
+	}
+};
+
+} // namespace
+
+ANKI_TEST(Scene, SceneLoading)
+{
+	SceneLoadingApp* app = new SceneLoadingApp();
+	ANKI_TEST_EXPECT_NO_ERR(app->mainLoop());
+
+	ANKI_TEST_EXPECT_EQ(app->m_headerOnly, true);
+	ANKI_TEST_EXPECT_EQ(app->m_loadingFinished, true);
+	ANKI_TEST_EXPECT_EQ(app->m_loadingFailed, false);
+	ANKI_TEST_EXPECT_EQ(app->m_prevProgress, 1.0f);
+	ANKI_TEST_EXPECT_EQ(app->m_progressDecreased, false);
+	ANKI_TEST_EXPECT_GT(app->m_loadingFrameCount, 1);
+	ANKI_TEST_EXPECT_EQ(app->m_loadedNodeCount, SceneLoadingApp::kNodeCount);
+
+	delete app;
+}
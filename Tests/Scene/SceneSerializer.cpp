@@ -0,0 +1,351 @@
+// Copyright (C) 2009-present, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <Tests/Framework/Framework.h>
+#include <AnKi/Scene/SceneSerializer.h>
+#include <AnKi/Util/Filesystem.h>
+#include <AnKi/Util/HighRezTimer.h>
+
+using namespace anki;
+
+namespace {
+
+// Holds the whole file in memory
+class MemoryResourceFile : public ResourceFile
+{
+public:
+	ResourceDynamicArray<U8> m_data;
+	PtrSize m_offset = 0;
+	Bool m_failReads = false; // Simulate an I/O error
+
+	Error load(CString filename)
+	{
+		File file;
+		ANKI_CHECK(file.open(filename, FileOpenFlag::kRead | FileOpenFlag::kBinary));
+		m_data.resize(U32(file.getSize()));
+		return file.read(m_data.getBegin(), m_data.getSize());
+	}
+
+	Error read(void* buff, PtrSize size) final
+	{
+		if(m_failReads)
+		{
+			return Error::kFileAccess;
+		}
+
+		if(m_offset + size > m_data.getSize())
+		{
+			return Error::kUserData;
+		}
+
+		memcpy(buff, m_data.getBegin() + m_offset, size);
+		m_offset += size;
+		return Error::kNone;
+	}
+
+	Error readAllText(ResourceString& out) final
+	{
+		out = (m_data.getSize()) ? ResourceString(reinterpret_cast<const Char*>(m_data.getBegin()), reinterpret_cast<const Char*>(m_data.getEnd()))
+								 : ResourceString();
+		return Error::kNone;
+	}
+
+	Error readU32(U32& u) final
+	{
+		return read(&u, sizeof(u));
+	}
+
+	Error readF32(F32& f) final
+	{
+		return read(&f, sizeof(f));
+	}
+
+	Error seek(PtrSize offset, FileSeekOrigin origin) final
+	{
+		m_offset = (origin == FileSeekOrigin::kBeginning) ? offset : (origin == FileSeekOrigin::kCurrent) ? m_offset + offset : m_data.getSize();
+		return Error::kNone;
+	}
+
+	PtrSize getSize() const final
+	{
+		return m_data.getSize();
+	}
+};
+
+enum class TestEnum : U8
+{
+	kA,
+	kB,
+	kC
+};
+
+// The values are exact in the text format as well
+class TestData
+{
+public:
+	U32 m_u32 = 0;
+	I32 m_i32 = 0;
+	F32 m_f32 = 0.0f;
+	F64 m_f64 = 0.0;
+	Vec3 m_vec3 = Vec3(0.0f);
+	Vec4 m_vec4 = Vec4(0.0f);
+	Mat3x4 m_mat = Mat3x4::getIdentity();
+	TestEnum m_enum = TestEnum::kA;
+	SceneString m_string;
+	SceneDynamicArray<U32> m_array;
+
+	void init(U32 seed)
+	{
+		m_u32 = 1000 + seed;
+		m_i32 = -I32(seed) - 1;
+		m_f32 = 1.5f + F32(seed);
+		m_f64 = -2.25 * F64(seed);
+		m_vec3 = Vec3(0.25f, -0.5f, F32(seed));
+		m_vec4 = Vec4(1.0f, 2.0f, 3.0f, -F32(seed));
+		m_mat = Mat3x4(Vec3(F32(seed), 1.0f, 2.0f), Mat3::getIdentity());
+		m_enum = TestEnum(seed % 3);
+		m_string.sprintf("Node %u\twith spaces", seed);
+
+		m_array.resize(16 + seed % 8);
+		for(U32 i = 0; i < m_array.getSize(); ++i)
+		{
+			m_array[i] = seed * 100 + i;
+		}
+	}
+
+	Error serialize(SceneSerializer& serializer)
+	{
+		ANKI_SERIALIZE_ALIAS("u32", m_u32, 1);
+		ANKI_SERIALIZE_ALIAS("i32", m_i32, 1);
+		ANKI_SERIALIZE_ALIAS("f32", m_f32, 1);
+		ANKI_SERIALIZE_ALIAS("f64", m_f64, 1);
+		ANKI_SERIALIZE_ALIAS("vec3", m_vec3, 1);
+		ANKI_SERIALIZE_ALIAS("vec4", m_vec4, 1);
+		ANKI_SERIALIZE_ALIAS("mat", m_mat, 1);
+		ANKI_SERIALIZE_ALIAS("enum", m_enum, 1);
+		ANKI_SERIALIZE_ALIAS("string", m_string, 1);
+
+		U32 arraySize = m_array.getSize();
+		ANKI_SERIALIZE(arraySize, 1);
+		m_array.resize(arraySize);
+		ANKI_SERIALIZE_ALIAS("array", m_array, 1);
+
+		return Error::kNone;
+	}
+
+	Bool operator==(const TestData& b) const
+	{
+		Bool same = m_u32 == b.m_u32 && m_i32 == b.m_i32 && m_f32 == b.m_f32 && m_f64 == b.m_f64 && m_vec3 == b.m_vec3 && m_vec4 == b.m_vec4
+					&& m_mat == b.m_mat && m_enum == b.m_enum && m_string == b.m_string && m_array.getSize() == b.m_array.getSize();
+		for(U32 i = 0; same && i < m_array.getSize(); ++i)
+		{
+			same = m_array[i] == b.m_array[i];
+		}
+
+		return same;
+	}
+};
+
+Error writeScene(SceneSerializer& serializer, SceneDynamicArray<TestData>& datas)
+{
+	U32 count = datas.getSize();
+	ANKI_SERIALIZE(count, 1);
+	for(TestData& data : datas)
+	{
+		ANKI_CHECK(data.serialize(serializer));
+	}
+
+	return Error::kNone;
+}
+
+Error readScene(SceneSerializer& serializer, SceneDynamicArray<TestData>& datas)
+{
+	U32 count = 0;
+	ANKI_SERIALIZE(count, 1);
+	datas.resize(count);
+	for(TestData& data : datas)
+	{
+		ANKI_CHECK(data.serialize(serializer));
+	}
+
+	return Error::kNone;
+}
+
+template<typename TSerializer>
+Error writeFile(CString filename, SceneDynamicArray<TestData>& datas)
+{
+	File file;
+	ANKI_CHECK(file.open(filename, FileOpenFlag::kWrite | FileOpenFlag::kBinary));
+	TSerializer serializer(&file);
+	return writeScene(serializer, datas);
+}
+
+template<typename TSerializer>
+Error readFile(CString filename, SceneDynamicArray<TestData>& datas, Second* readTime = nullptr)
+{
+	MemoryResourceFile file;
+	ANKI_CHECK(file.load(filename));
+
+	const Second begin = HighRezTimer::getCurrentTime();
+	TSerializer serializer(&file);
+	const Error err = readScene(serializer, datas);
+	if(readTime)
+	{
+		*readTime = HighRezTimer::getCurrentTime() - begin;
+	}
+
+	return err;
+}
+
+SceneDynamicArray<TestData> createTestData(U32 count)
+{
+	SceneDynamicArray<TestData> datas;
+	datas.resize(count);
+	for(U32 i = 0; i < count; ++i)
+	{
+		datas[i].init(i);
+	}
+
+	return datas;
+}
+
+} // namespace
+
+ANKI_TEST(Scene, SceneSerializer)
+{
+	DefaultMemoryPool::allocateSingleton(allocAligned, nullptr);
+	SceneMemoryPool::allocateSingleton(allocAligned, nullptr);
+	ResourceMemoryPool::allocateSingleton(allocAligned, nullptr);
+
+	{
+		String tmpDir;
+		ANKI_TEST_EXPECT_NO_ERR(getTempDirectory(tmpDir));
+		String textFname, binFname, textFname2;
+		textFname.sprintf("%s/SceneSerializerTest.ankiscene", tmpDir.cstr());
+		binFname.sprintf("%s/SceneSerializerTest.ankiscenebin", tmpDir.cstr());
+		textFname2.sprintf("%s/SceneSerializerTest2.ankiscene", tmpDir.cstr());
+
+		SceneDynamicArray<TestData> datas = createTestData(32);
+
+		// Binary round trip
+		{
+			ANKI_TEST_EXPECT_NO_ERR(writeFile<BinarySceneSerializer>(binFname, datas));
+
+			SceneDynamicArray<TestData> datas2;
+			ANKI_TEST_EXPECT_NO_ERR(readFile<BinarySceneSerializer>(binFname, datas2));
+			ANKI_TEST_EXPECT_EQ(datas2.getSize(), datas.getSize());
+			for(U32 i = 0; i < datas.getSize(); ++i)
+			{
+				ANKI_TEST_EXPECT_EQ(datas2[i] == datas[i], true);
+			}
+		}
+
+		// Text -> binary -> text should give the same text
+		{
+			ANKI_TEST_EXPECT_NO_ERR(writeFile<TextSceneSerializer>(textFname, datas));
+
+			SceneDynamicArray<TestData> datas2;
+			ANKI_TEST_EXPECT_NO_ERR(readFile<TextSceneSerializer>(textFname, datas2));
+			ANKI_TEST_EXPECT_NO_ERR(writeFile<BinarySceneSerializer>(binFname, datas2));
+
+			SceneDynamicArray<TestData> datas3;
+			ANKI_TEST_EXPECT_NO_ERR(readFile<BinarySceneSerializer>(binFname, datas3));
+			ANKI_TEST_EXPECT_NO_ERR(writeFile<TextSceneSerializer>(textFname2, datas3));
+
+			MemoryResourceFile text, text2;
+			ANKI_TEST_EXPECT_NO_ERR(text.load(textFname));
+			ANKI_TEST_EXPECT_NO_ERR(text2.load(textFname2));
+			ANKI_TEST_EXPECT_EQ(text.getSize(), text2.getSize());
+			ANKI_TEST_EXPECT_EQ(memcmp(text.m_data.getBegin(), text2.m_data.getBegin(), text.getSize()), 0);
+
+			for(U32 i = 0; i < datas.getSize(); ++i)
+			{
+				ANKI_TEST_EXPECT_EQ(datas3[i] == datas[i], true);
+			}
+		}
+
+		// Reading a field with the wrong name or type should fail
+		{
+			ANKI_TEST_EXPECT_NO_ERR(writeFile<BinarySceneSerializer>(binFname, datas));
+
+			MemoryResourceFile file;
+			ANKI_TEST_EXPECT_NO_ERR(file.load(binFname));
+			BinarySceneSerializer serializer(&file);
+
+			F32 count;
+			ANKI_TEST_EXPECT_ERR(serializer.serialize("count", 1, false, count), Error::kUserData);
+		}
+
+		// Truncated file
+		{
+			File file;
+			ANKI_TEST_EXPECT_NO_ERR(file.open(binFname, FileOpenFlag::kWrite | FileOpenFlag::kBinary));
+			U32 garbage = 0;
+			ANKI_TEST_EXPECT_NO_ERR(file.write(&garbage, sizeof(garbage)));
+			file.close();
+
+			SceneDynamicArray<TestData> datas2;
+			ANKI_TEST_EXPECT_ERR(readFile<BinarySceneSerializer>(binFname, datas2), Error::kUserData);
+		}
+
+		// I/O error. All the reads should fail without aborting
+		{
+			ANKI_TEST_EXPECT_NO_ERR(writeFile<BinarySceneSerializer>(binFname, datas));
+
+			MemoryResourceFile file;
+			ANKI_TEST_EXPECT_NO_ERR(file.load(binFname));
+			file.m_failReads = true;
+			BinarySceneSerializer serializer(&file);
+
+			SceneDynamicArray<TestData> datas2;
+			ANKI_TEST_EXPECT_ERR(readScene(serializer, datas2), Error::kUserData);
+		}
+
+		ANKI_TEST_EXPECT_NO_ERR(removeFile(textFname));
+		ANKI_TEST_EXPECT_NO_ERR(removeFile(textFname2));
+		ANKI_TEST_EXPECT_NO_ERR(removeFile(binFname));
+	}
+
+	ResourceMemoryPool::freeSingleton();
+	SceneMemoryPool::freeSingleton();
+	DefaultMemoryPool::freeSingleton();
+}
+
+ANKI_TEST(Scene, SceneSerializerBench)
+{
+	DefaultMemoryPool::allocateSingleton(allocAligned, nullptr);
+	SceneMemoryPool::allocateSingleton(allocAligned, nullptr);
+	ResourceMemoryPool::allocateSingleton(allocAligned, nullptr);
+
+	{
+		String tmpDir;
+		ANKI_TEST_EXPECT_NO_ERR(getTempDirectory(tmpDir));
+		String textFname, binFname;
+		textFname.sprintf("%s/SceneSerializerBench.ankiscene", tmpDir.cstr());
+		binFname.sprintf("%s/SceneSerializerBench.ankiscenebin", tmpDir.cstr());
+
+		for(U32 count : {1'000u, 10'000u, 100'000u})
+		{
+			SceneDynamicArray<TestData> datas = createTestData(count);
+			ANKI_TEST_EXPECT_NO_ERR(writeFile<TextSceneSerializer>(textFname, datas));
+			ANKI_TEST_EXPECT_NO_ERR(writeFile<BinarySceneSerializer>(binFname, datas));
+
+			Second textTime, binTime;
+			SceneDynamicArray<TestData> datas2;
+			ANKI_TEST_EXPECT_NO_ERR(readFile<TextSceneSerializer>(textFname, datas2, &textTime));
+			SceneDynamicArray<TestData> datas3;
+			ANKI_TEST_EXPECT_NO_ERR(readFile<BinarySceneSerializer>(binFname, datas3, &binTime));
+
+			ANKI_TEST_LOGI("%u objects: text %fms, binary %fms, speedup %fx", count, textTime * 1000.0, binTime * 1000.0, textTime / binTime);
+		}
+
+		ANKI_TEST_EXPECT_NO_ERR(removeFile(textFname));
+		ANKI_TEST_EXPECT_NO_ERR(removeFile(binFname));
+	}
+
+	ResourceMemoryPool::freeSingleton();
+	SceneMemoryPool::freeSingleton();
+	DefaultMemoryPool::freeSingleton();
+}
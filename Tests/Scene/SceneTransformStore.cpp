@@ -0,0 +1,281 @@
+// Copyright (C) 2009-present, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <Tests/Framework/Framework.h>
+#include <AnKi/Scene/SceneTransformStore.h>
+#include <AnKi/Util/HighRezTimer.h>
+
+using namespace anki;
+
+namespace {
+
+// Mimics the old way the transforms got updated: Every node is a separate allocation and the tree is walked recursively
+class LegacyNode
+{
+public:
+	Transform m_local = Transform::getIdentity();
+	Transform m_world = Transform::getIdentity();
+	Transform m_prevWorld = Transform::getIdentity();
+	LegacyNode* m_parent = nullptr;
+	SceneDynamicArray<LegacyNode*> m_children;
+	Bool m_localDirty = true;
+	Bool m_movedThisFrame = true;
+	Bool m_padding[64] = {}; // The rest of the SceneNode
+
+	void update()
+	{
+		const Bool movedLastFrame = m_movedThisFrame;
+		m_movedThisFrame = m_localDirty;
+		m_localDirty = false;
+
+		if(m_movedThisFrame || movedLastFrame)
+		{
+			m_prevWorld = m_world;
+		}
+
+		if(m_movedThisFrame)
+		{
+			m_world = (m_parent) ? m_parent->m_world.combineTransformations(m_local) : m_local;
+
+			for(LegacyNode* child : m_children)
+			{
+				child->m_localDirty = true;
+			}
+		}
+
+		for(LegacyNode* child : m_children)
+		{
+			child->update();
+		}
+	}
+};
+
+class Node
+{
+public:
+	SceneTransformHandle m_handle;
+	Node* m_parent = nullptr;
+	SceneDynamicArray<Node*> m_children;
+
+	Node()
+		: m_handle(this)
+	{
+	}
+
+	void setLocalOrigin(const Vec3& origin)
+	{
+		m_handle.getTransforms().m_local.setOrigin(origin);
+		m_handle.getFlags() |= SceneTransformFlag::kLocalDirty;
+	}
+};
+
+void updateWorldTransforms(SceneTransformStore& store)
+{
+	store.updateWorldTransforms([](SceneTransformHandle& handle) {
+		for(Node* child : static_cast<Node*>(handle.getUserData())->m_children)
+		{
+			if(!(child->m_handle.getFlags() & SceneTransformFlag::kIgnoreParent))
+			{
+				child->m_handle.getFlags() |= SceneTransformFlag::kLocalDirty;
+			}
+		}
+	});
+}
+
+Vec3 computeWorldOrigin(const Node& node)
+{
+	Transform trf = node.m_handle.getTransforms().m_local;
+	for(const Node* parent = node.m_parent; parent; parent = parent->m_parent)
+	{
+		trf = parent->m_handle.getTransforms().m_local.combineTransformations(trf);
+	}
+
+	return trf.getOrigin().xyz;
+}
+
+} // namespace
+
+ANKI_TEST(Scene, SceneTransformStore)
+{
+	SceneMemoryPool::allocateSingleton(allocAligned, nullptr);
+
+	{
+		SceneTransformStore store;
+		constexpr U32 kNodeCount = 64;
+		Array<Node, kNodeCount> nodes;
+
+		// Add them and then make every node the child of the node that comes after it. That forces a re-sort
+		for(U32 i = 0; i < kNodeCount; ++i)
+		{
+			nodes[i].setLocalOrigin(Vec3(F32(i + 1), 0.0f, 0.0f));
+			store.addHandle(nodes[i].m_handle);
+		}
+
+		for(U32 i = 0; i < kNodeCount - 1; ++i)
+		{
+			nodes[i].m_parent = &nodes[i + 1];
+			nodes[i + 1].m_children.emplaceBack(&nodes[i]);
+			store.setParent(nodes[i].m_handle, &nodes[i + 1].m_handle);
+		}
+
+		store.flushStructuralChanges();
+		updateWorldTransforms(store);
+
+		for(const Node& node : nodes)
+		{
+			ANKI_TEST_EXPECT_EQ(node.m_handle.getTransforms().m_world.getOrigin().xyz, computeWorldOrigin(node));
+			ANKI_TEST_EXPECT_EQ(!!(node.m_handle.getFlags() & SceneTransformFlag::kMovedThisFrame), true);
+		}
+
+		// Nothing changed, the moved flag should go away and the previous transform should catch up
+		updateWorldTransforms(store);
+		for(const Node& node : nodes)
+		{
+			ANKI_TEST_EXPECT_EQ(!!(node.m_handle.getFlags() & SceneTransformFlag::kMovedThisFrame), false);
+			ANKI_TEST_EXPECT_EQ(node.m_handle.getTransforms().m_prevWorld.getOrigin(), node.m_handle.getTransforms().m_world.getOrigin());
+		}
+
+		// Move a node in the middle of the chain. Only it and its children should move
+		constexpr U32 kMovedNode = kNodeCount / 2;
+		nodes[kMovedNode].setLocalOrigin(Vec3(0.0f, 10.0f, 0.0f));
+		updateWorldTransforms(store);
+		for(U32 i = 0; i < kNodeCount; ++i)
+		{
+			ANKI_TEST_EXPECT_EQ(nodes[i].m_handle.getTransforms().m_world.getOrigin().xyz, computeWorldOrigin(nodes[i]));
+			ANKI_TEST_EXPECT_EQ(!!(nodes[i].m_handle.getFlags() & SceneTransformFlag::kMovedThisFrame), i <= kMovedNode);
+		}
+
+		// Remove the root and half of the others
+		for(U32 i = kNodeCount / 2; i < kNodeCount; ++i)
+		{
+			store.removeHandle(nodes[i].m_handle);
+		}
+		nodes[kNodeCount / 2 - 1].m_parent = nullptr;
+		store.flushStructuralChanges();
+		ANKI_TEST_EXPECT_EQ(store.getSize(), kNodeCount / 2);
+
+		nodes[0].setLocalOrigin(Vec3(0.0f, 0.0f, 5.0f));
+		updateWorldTransforms(store);
+		ANKI_TEST_EXPECT_EQ(!!(nodes[0].m_handle.getFlags() & SceneTransformFlag::kMovedThisFrame), true);
+		ANKI_TEST_EXPECT_EQ(!!(nodes[1].m_handle.getFlags() & SceneTransformFlag::kMovedThisFrame), false);
+
+		for(U32 i = 0; i < kNodeCount / 2; ++i)
+		{
+			store.removeHandle(nodes[i].m_handle);
+		}
+		store.flushStructuralChanges();
+		ANKI_TEST_EXPECT_EQ(store.getSize(), 0);
+	}
+
+	SceneMemoryPool::freeSingleton();
+}
+
+ANKI_TEST(Scene, SceneTransformStoreBench)
+{
+	SceneMemoryPool::allocateSingleton(allocAligned, nullptr);
+
+	constexpr U32 kFrameCount = 16;
+	constexpr U32 kTreeSize = 64; // Small trees of 64 nodes where every node has 4 children
+	constexpr U32 kMovedNodesPerFrame = 10; // Per 1000
+
+	for(U32 nodeCount : {10'000u, 100'000u, 1'000'000u})
+	{
+		srand(nodeCount);
+
+		// Legacy
+		F64 legacyTime = 0.0;
+		{
+			SceneDynamicArray<LegacyNode*> nodes;
+			SceneDynamicArray<LegacyNode*> roots;
+			nodes.resize(nodeCount);
+			for(U32 i = 0; i < nodeCount; ++i)
+			{
+				nodes[i] = newInstance<LegacyNode>(SceneMemoryPool::getSingleton());
+
+				const U32 idxInTree = i % kTreeSize;
+				if(idxInTree == 0)
+				{
+					roots.emplaceBack(nodes[i]);
+				}
+				else
+				{
+					LegacyNode* parent = nodes[i - idxInTree + (idxInTree - 1) / 4];
+					nodes[i]->m_parent = parent;
+					parent->m_children.emplaceBack(nodes[i]);
+				}
+			}
+
+			for(U32 frame = 0; frame < kFrameCount; ++frame)
+			{
+				for(U32 i = 0; i < nodeCount * kMovedNodesPerFrame / 1000; ++i)
+				{
+					LegacyNode& node = *nodes[U32(rand()) % nodeCount];
+					node.m_local.setOrigin(node.m_local.getOrigin() + Vec4(1.0f, 0.0f, 0.0f, 0.0f));
+					node.m_localDirty = true;
+				}
+
+				const F64 begin = HighRezTimer::getCurrentTime();
+				for(LegacyNode* root : roots)
+				{
+					root->update();
+				}
+				legacyTime += HighRezTimer::getCurrentTime() - begin;
+			}
+
+			for(LegacyNode* node : nodes)
+			{
+				deleteInstance(SceneMemoryPool::getSingleton(), node);
+			}
+		}
+
+		// Store
+		F64 storeTime = 0.0;
+		{
+			SceneTransformStore store;
+			SceneDynamicArray<Node*> nodes;
+			nodes.resize(nodeCount);
+			for(U32 i = 0; i < nodeCount; ++i)
+			{
+				nodes[i] = newInstance<Node>(SceneMemoryPool::getSingleton());
+				store.addHandle(nodes[i]->m_handle);
+
+				const U32 idxInTree = i % kTreeSize;
+				if(idxInTree != 0)
+				{
+					Node* parent = nodes[i - idxInTree + (idxInTree - 1) / 4];
+					nodes[i]->m_parent = parent;
+					parent->m_children.emplaceBack(nodes[i]);
+					store.setParent(nodes[i]->m_handle, &parent->m_handle);
+				}
+			}
+			store.flushStructuralChanges();
+
+			for(U32 frame = 0; frame < kFrameCount; ++frame)
+			{
+				for(U32 i = 0; i < nodeCount * kMovedNodesPerFrame / 1000; ++i)
+				{
+					Node& node = *nodes[U32(rand()) % nodeCount];
+					node.setLocalOrigin(node.m_handle.getTransforms().m_local.getOrigin().xyz + Vec3(1.0f, 0.0f, 0.0f));
+				}
+
+				const F64 begin = HighRezTimer::getCurrentTime();
+				updateWorldTransforms(store);
+				storeTime += HighRezTimer::getCurrentTime() - begin;
+			}
+
+			for(Node* node : nodes)
+			{
+				store.removeHandle(node->m_handle);
+				deleteInstance(SceneMemoryPool::getSingleton(), node);
+			}
+			store.flushStructuralChanges();
+		}
+
+		ANKI_TEST_LOGI("%u nodes: legacy %fms/frame, store %fms/frame, speedup %fx", nodeCount, legacyTime * 1000.0 / kFrameCount,
+					   storeTime * 1000.0 / kFrameCount, legacyTime / storeTime);
+	}
+
+	SceneMemoryPool::freeSingleton();
+}
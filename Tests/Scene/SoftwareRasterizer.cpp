@@ -0,0 +1,264 @@
+// Copyright (C) 2009-present, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <Tests/Framework/Framework.h>
+#include <AnKi/Scene/SoftwareRasterizer.h>
+#include <AnKi/Collision/Aabb.h>
+#include <AnKi/Util/TaskGraph.h>
+#include <AnKi/Util/HighRezTimer.h>
+#include <AnKi/Util/System.h>
+
+using namespace anki;
+
+namespace {
+
+// The triangles of a box
+void appendBox(Vec3 center, Vec3 halfSize, SceneDynamicArray<Vec3>& positions, SceneDynamicArray<U32>& indices)
+{
+	const U32 first = positions.getSize();
+	for(U32 i = 0; i < 8; ++i)
+	{
+		const Vec3 sign((i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, (i & 4) ? 1.0f : -1.0f);
+		positions.emplaceBack(center + halfSize * sign);
+	}
+
+	constexpr Array<U32, 36> kBoxIndices = {0, 2, 1, 1, 2, 3, 4, 5, 6, 5, 7, 6, 0, 1, 4, 1, 5, 4,
+											2, 6, 3, 3, 6, 7, 0, 4, 2, 2, 4, 6, 1, 3, 5, 3, 7, 5};
+	for(U32 idx : kBoxIndices)
+	{
+		indices.emplaceBack(first + idx);
+	}
+}
+
+// The way the rasterizer used to work. Scalar, a barycentric test per pixel and no tiles
+void legacyRasterize(const Mat4& viewProj, ConstWeakArray<Vec3> positions, ConstWeakArray<U32> indices, UVec2 size,
+					 SceneDynamicArray<F32>& depth)
+{
+	for(U32 i = 0; i < indices.getSize(); i += 3)
+	{
+		Array<Vec3, 3> window;
+		Bool behind = false;
+		for(U32 j = 0; j < 3; ++j)
+		{
+			const Vec4 clip = viewProj * positions[indices[i + j]].xyz1;
+			behind = behind || clip.w <= kEpsilonf;
+			const Vec3 ndc = clip.xyz / clip.w;
+			window[j] = Vec3((ndc.x * 0.5f + 0.5f) * F32(size.x), (0.5f - ndc.y * 0.5f) * F32(size.y), ndc.z);
+		}
+
+		if(behind)
+		{
+			continue;
+		}
+
+		Vec2 bboxMin = Vec2(window[0].xy).min(window[1].xy).min(window[2].xy).max(Vec2(0.0f));
+		Vec2 bboxMax = Vec2(window[0].xy).max(window[1].xy).max(window[2].xy).min(Vec2(size));
+
+		for(F32 y = std::floor(bboxMin.y) + 0.5f; y < bboxMax.y; y += 1.0f)
+		{
+			for(F32 x = std::floor(bboxMin.x) + 0.5f; x < bboxMax.x; x += 1.0f)
+			{
+				const Vec2 dca = window[2].xy - window[0].xy;
+				const Vec2 dba = window[1].xy - window[0].xy;
+				const Vec2 dap = window[0].xy - Vec2(x, y);
+				const Vec3 k = Vec3(dca.x, dba.x, dap.x).cross(Vec3(dca.y, dba.y, dap.y));
+				if(isZero(k.z))
+				{
+					continue;
+				}
+
+				const Vec3 uvw(1.0f - (k.x + k.y) / k.z, k.y / k.z, k.x / k.z);
+				if(uvw.x < 0.0f || uvw.y < 0.0f || uvw.z < 0.0f)
+				{
+					continue;
+				}
+
+				const F32 z = window[0].z * uvw.x + window[1].z * uvw.y + window[2].z * uvw.z;
+				F32& d = depth[U32(y) * size.x + U32(x)];
+				d = min(d, z);
+			}
+		}
+	}
+}
+
+} // namespace
+
+ANKI_TEST(Scene, SoftwareRasterizer)
+{
+	DefaultMemoryPool::allocateSingleton(allocAligned, nullptr);
+	SceneMemoryPool::allocateSingleton(allocAligned, nullptr);
+
+	{
+		constexpr UVec2 kSize(256, 128);
+
+		// Camera at the origin looking at -Z
+		const Mat4 proj = Mat4::calculatePerspectiveProjectionMatrix(toRad(90.0f), toRad(60.0f), 0.1f, 200.0f);
+		const Mat3x4 identity = Mat3x4::getIdentity();
+
+		SoftwareRasterizer rasterizer;
+
+		// A wall in front of the camera
+		{
+			SceneDynamicArray<Vec3> positions;
+			SceneDynamicArray<U32> indices;
+			appendBox(Vec3(0.0f, 0.0f, -10.5f), Vec3(5.0f, 5.0f, 0.5f), positions, indices);
+
+			rasterizer.prepare(proj, kSize.x, kSize.y);
+			rasterizer.draw(positions, indices, identity, true);
+			ANKI_TEST_EXPECT_EQ(rasterizer.getTriangleCount(), 2); // Only the face towards the camera survives backface culling
+			for(U32 t = 0; t < rasterizer.getTileCount(); ++t)
+			{
+				rasterizer.rasterizeTile(t);
+			}
+			rasterizer.buildHierarchicalDepth();
+
+			// The center pixel should have the depth of the front face
+			const Vec4 clip = proj * Vec4(0.0f, 0.0f, -10.0f, 1.0f);
+			const F32 centerDepth = rasterizer.getHierarchicalDepth(0)[(kSize.y / 2) * kSize.x + kSize.x / 2];
+			ANKI_TEST_EXPECT_LT(absolute(centerDepth - clip.z / clip.w), 0.0001f);
+			ANKI_TEST_EXPECT_EQ(rasterizer.getHierarchicalDepth(rasterizer.getMipCount() - 1).getSize(), 2);
+
+			// Behind the wall
+			ANKI_TEST_EXPECT_EQ(rasterizer.visibilityTest(Aabb(Vec3(-1.0f, -1.0f, -21.0f), Vec3(1.0f, 1.0f, -20.0f))), false);
+
+			// In front of the wall
+			ANKI_TEST_EXPECT_EQ(rasterizer.visibilityTest(Aabb(Vec3(-1.0f, -1.0f, -6.0f), Vec3(1.0f, 1.0f, -5.0f))), true);
+
+			// Behind but peeking on the side of the wall
+			ANKI_TEST_EXPECT_EQ(rasterizer.visibilityTest(Aabb(Vec3(8.0f, -1.0f, -21.0f), Vec3(12.0f, 1.0f, -20.0f))), true);
+
+			// Touches the near plane
+			ANKI_TEST_EXPECT_EQ(rasterizer.visibilityTest(Aabb(Vec3(-1.0f, -1.0f, -1.0f), Vec3(1.0f, 1.0f, 1.0f))), true);
+
+			// Match the legacy rasterizer
+			SceneDynamicArray<F32> legacyDepth;
+			legacyDepth.resize(kSize.x * kSize.y, 1.0f);
+			legacyRasterize(proj, positions, indices, kSize, legacyDepth);
+			U32 mismatches = 0;
+			for(U32 i = 0; i < legacyDepth.getSize(); ++i)
+			{
+				mismatches += absolute(legacyDepth[i] - rasterizer.getHierarchicalDepth(0)[i]) > 0.0001f;
+			}
+			ANKI_TEST_EXPECT_LT(mismatches, kSize.x * 2); // Allow some differences at the edges
+		}
+
+		// Benchmark a few thousand occluder triangles
+		{
+			constexpr U32 kBoxCount = 400;
+			constexpr U32 kIterations = 50;
+
+			SceneDynamicArray<SceneDynamicArray<Vec3>> boxPositions;
+			SceneDynamicArray<SceneDynamicArray<U32>> boxIndices;
+			boxPositions.resize(kBoxCount);
+			boxIndices.resize(kBoxCount);
+			SceneDynamicArray<Vec3> allPositions;
+			SceneDynamicArray<U32> allIndices;
+			for(U32 i = 0; i < kBoxCount; ++i)
+			{
+				const Vec3 center(F32(i % 20) * 3.0f - 30.0f, F32((i / 20) % 5) * 3.0f - 7.0f, -10.0f - F32(i / 100) * 10.0f - F32(i % 7));
+				const Vec3 halfSize(1.0f + F32(i % 3) * 0.5f, 1.0f, 1.0f);
+				appendBox(center, halfSize, boxPositions[i], boxIndices[i]);
+				appendBox(center, halfSize, allPositions, allIndices);
+			}
+
+			SceneDynamicArray<Aabb> aabbs;
+			aabbs.resize(10 * 1024);
+			for(U32 i = 0; i < aabbs.getSize(); ++i)
+			{
+				const Vec3 center(F32(i % 64) - 32.0f, F32((i / 64) % 16) - 8.0f, -5.0f - F32(i % 97));
+				aabbs[i] = Aabb(center - 0.5f, center + 0.5f);
+			}
+			SceneDynamicArray<Bool> visible;
+			visible.resize(aabbs.getSize());
+
+			SceneDynamicArray<F32> legacyDepth;
+			legacyDepth.resize(kSize.x * kSize.y);
+			Second begin = HighRezTimer::getCurrentTime();
+			for(U32 i = 0; i < kIterations; ++i)
+			{
+				legacyDepth.fill(1.0f);
+				legacyRasterize(proj, allPositions, allIndices, kSize, legacyDepth);
+			}
+			const Second legacyTime = HighRezTimer::getCurrentTime() - begin;
+
+			begin = HighRezTimer::getCurrentTime();
+			for(U32 i = 0; i < kIterations; ++i)
+			{
+				rasterizer.prepare(proj, kSize.x, kSize.y);
+				for(U32 b = 0; b < kBoxCount; ++b)
+				{
+					rasterizer.draw(boxPositions[b], boxIndices[b], identity, true);
+				}
+				for(U32 t = 0; t < rasterizer.getTileCount(); ++t)
+				{
+					rasterizer.rasterizeTile(t);
+				}
+				rasterizer.buildHierarchicalDepth();
+			}
+			const Second singleThreadTime = HighRezTimer::getCurrentTime() - begin;
+			const U32 triangleCount = rasterizer.getTriangleCount();
+
+			U32 mismatches = 0;
+			for(U32 i = 0; i < legacyDepth.getSize(); ++i)
+			{
+				mismatches += absolute(legacyDepth[i] - rasterizer.getHierarchicalDepth(0)[i]) > 0.0001f;
+			}
+			ANKI_TEST_EXPECT_LT(mismatches, legacyDepth.getSize() / 20);
+
+			ThreadJobManager jobManager(getCpuCoresCount());
+			begin = HighRezTimer::getCurrentTime();
+			for(U32 i = 0; i < kIterations; ++i)
+			{
+				rasterizer.prepare(proj, kSize.x, kSize.y);
+
+				TaskGraph graph(jobManager);
+				const TaskGraphTask draws = graph.newParallelFor(0, kBoxCount, 16, [&]([[maybe_unused]] U32 tid, U32 start, U32 end) {
+					for(U32 b = start; b < end; ++b)
+					{
+						rasterizer.draw(boxPositions[b], boxIndices[b], identity, true);
+					}
+				});
+				const TaskGraphTask tiles = graph.newParallelFor(
+					0, rasterizer.getTileCount(), 1,
+					[&]([[maybe_unused]] U32 tid, U32 start, U32 end) {
+						for(U32 t = start; t < end; ++t)
+						{
+							rasterizer.rasterizeTile(t);
+						}
+					},
+					{draws});
+				graph.newContinuation(tiles, [&]([[maybe_unused]] U32 tid) {
+					rasterizer.buildHierarchicalDepth();
+				});
+				graph.submit();
+				graph.wait();
+			}
+			const Second multiThreadTime = HighRezTimer::getCurrentTime() - begin;
+
+			begin = HighRezTimer::getCurrentTime();
+			U32 visibleCount = 0;
+			for(U32 i = 0; i < kIterations; ++i)
+			{
+				rasterizer.visibilityTest(aabbs, WeakArray<Bool>(visible));
+				visibleCount = 0;
+				for(Bool v : visible)
+				{
+					visibleCount += v;
+				}
+			}
+			const Second testTime = HighRezTimer::getCurrentTime() - begin;
+			ANKI_TEST_EXPECT_GT(visibleCount, 0);
+			ANKI_TEST_EXPECT_LT(visibleCount, aabbs.getSize());
+
+			ANKI_TEST_LOGI("%u triangles at %ux%u: legacy %fms, tiled SIMD %fms, multithreaded %fms (%u threads)", triangleCount, kSize.x,
+						   kSize.y, legacyTime * 1000.0 / kIterations, singleThreadTime * 1000.0 / kIterations,
+						   multiThreadTime * 1000.0 / kIterations, getCpuCoresCount());
+			ANKI_TEST_LOGI("%u AABBs tested in %fms, %u visible", aabbs.getSize(), testTime * 1000.0 / kIterations, visibleCount);
+		}
+	}
+
+	SceneMemoryPool::freeSingleton();
+	DefaultMemoryPool::freeSingleton();
+}
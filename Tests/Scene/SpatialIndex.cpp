@@ -0,0 +1,346 @@
+// Copyright (C) 2009-present, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <Tests/Framework/Framework.h>
+#include <AnKi/Scene/SpatialIndex.h>
+#include <AnKi/Util/HighRezTimer.h>
+
+using namespace anki;
+
+namespace {
+
+// The tree never touches the components so fake them
+SceneComponent* indexToComponent(U32 idx)
+{
+	return reinterpret_cast<SceneComponent*>(PtrSize(idx + 1) * 16);
+}
+
+U32 componentToIndex(const SceneComponent* comp)
+{
+	return U32(reinterpret_cast<PtrSize>(comp) / 16 - 1);
+}
+
+Vec3 randomPoint(F32 worldSize)
+{
+	return Vec3(getRandomRange(-worldSize, worldSize), getRandomRange(-worldSize, worldSize), getRandomRange(-worldSize, worldSize));
+}
+
+Aabb randomAabb(F32 worldSize)
+{
+	const Vec3 center = randomPoint(worldSize);
+	const Vec3 halfSize(getRandomRange(0.1f, 4.0f), getRandomRange(0.1f, 4.0f), getRandomRange(0.1f, 4.0f));
+	return Aabb(center - halfSize, center + halfSize);
+}
+
+class TestObject
+{
+public:
+	Aabb m_aabb;
+	U32 m_indexObject = kMaxU32;
+	SceneComponentType m_type = SceneComponentType::kMaterial;
+	Bool m_alive = false;
+};
+
+// Run the same queries on the tree and on the brute force and compare
+void compareQueries(const SpatialIndex& index, ConstWeakArray<TestObject> objects, F32 worldSize)
+{
+	SceneDynamicArray<U8> fromTree;
+	fromTree.resize(objects.getSize());
+	constexpr SceneComponentTypeMask kMaterialMask = SceneComponentTypeMask::kMaterial;
+	constexpr SceneComponentTypeMask kAllMask = SceneComponentTypeMask::kMaterial | SceneComponentTypeMask::kLight;
+
+	auto compare = [&](auto bruteForceTest, SceneComponentTypeMask mask) {
+		for(U32 i = 0; i < objects.getSize(); ++i)
+		{
+			const Bool typeMatches = !!(SceneComponentTypeMask(1u << U32(objects[i].m_type)) & mask);
+			const Bool expected = objects[i].m_alive && typeMatches && bruteForceTest(objects[i].m_aabb);
+			ANKI_TEST_EXPECT_EQ(fromTree[i], expected);
+		}
+	};
+
+	for(U32 q = 0; q < 32; ++q)
+	{
+		const SceneComponentTypeMask mask = (q & 1) ? kMaterialMask : kAllMask;
+
+		// AABB
+		{
+			const Aabb query = randomAabb(worldSize);
+			memset(fromTree.getBegin(), 0, fromTree.getSizeInBytes());
+			index.visitAabb(query, mask, [&](SceneComponent* comp) {
+				ANKI_TEST_EXPECT_EQ(fromTree[componentToIndex(comp)], 0);
+				fromTree[componentToIndex(comp)] = 1;
+			});
+
+			compare(
+				[&](const Aabb& aabb) {
+					return testCollision(aabb, query);
+				},
+				mask);
+		}
+
+		// Sphere
+		{
+			const Sphere query(randomPoint(worldSize), getRandomRange(1.0f, worldSize / 4.0f));
+			memset(fromTree.getBegin(), 0, fromTree.getSizeInBytes());
+			index.visitSphere(query, mask, [&](SceneComponent* comp) {
+				fromTree[componentToIndex(comp)] = 1;
+			});
+
+			compare(
+				[&](const Aabb& aabb) {
+					return testCollision(aabb, query);
+				},
+				mask);
+		}
+
+		// Frustum
+		{
+			const Vec3 eye = randomPoint(worldSize);
+			const Mat3 rot = Mat3(Euler(getRandomRange(-kPi, kPi), getRandomRange(-kPi, kPi), 0.0f));
+			const Mat4 view = Mat4(eye, rot).invertTransformation();
+			const Mat4 proj = Mat4::calculatePerspectiveProjectionMatrix(toRad(90.0f), toRad(60.0f), 0.1f, worldSize);
+			const Mat4 viewProj = proj * view;
+
+			memset(fromTree.getBegin(), 0, fromTree.getSizeInBytes());
+			index.visitFrustum(viewProj, mask, [&](SceneComponent* comp) {
+				fromTree[componentToIndex(comp)] = 1;
+			});
+
+			Array<Plane, 6> planes;
+			extractClipPlanes(viewProj, planes);
+			compare(
+				[&](const Aabb& aabb) {
+					for(const Plane& plane : planes)
+					{
+						if(testPlane(plane, aabb) < 0.0f)
+						{
+							return false;
+						}
+					}
+					return true;
+				},
+				mask);
+		}
+
+		// Ray
+		{
+			const Vec3 dir = Vec3(getRandomRange(-1.0f, 1.0f), getRandomRange(-1.0f, 1.0f), getRandomRange(-1.0f, 1.0f)).normalize();
+			const Ray query(randomPoint(worldSize), dir);
+			memset(fromTree.getBegin(), 0, fromTree.getSizeInBytes());
+			index.visitRay(query, kMaxF32, mask, [&](SceneComponent* comp, F32 distance) {
+				ANKI_TEST_EXPECT_GEQ(distance, 0.0f);
+				fromTree[componentToIndex(comp)] = 1;
+			});
+
+			compare(
+				[&](const Aabb& aabb) {
+					return testCollision(aabb, query);
+				},
+				mask);
+		}
+	}
+}
+
+} // namespace
+
+ANKI_TEST(Scene, SpatialIndex)
+{
+	DefaultMemoryPool::allocateSingleton(allocAligned, nullptr);
+	SceneMemoryPool::allocateSingleton(allocAligned, nullptr);
+
+	// Correctness
+	{
+		constexpr U32 kObjectCount = 2000;
+		constexpr F32 kWorldSize = 200.0f;
+
+		SpatialIndex index;
+		SceneDynamicArray<TestObject> objects;
+		objects.resize(kObjectCount);
+
+		for(U32 i = 0; i < kObjectCount; ++i)
+		{
+			TestObject& obj = objects[i];
+			obj.m_type = (i % 3) ? SceneComponentType::kMaterial : SceneComponentType::kLight;
+			obj.m_aabb = randomAabb(kWorldSize);
+			obj.m_indexObject = index.newObject(indexToComponent(i), obj.m_type);
+			obj.m_alive = true;
+			index.updateObject(obj.m_indexObject, obj.m_aabb);
+		}
+
+		// Nothing is visible before the flush
+		ANKI_TEST_EXPECT_EQ(index.getObjectCount(), 0);
+		index.flush();
+		ANKI_TEST_EXPECT_EQ(index.getObjectCount(), kObjectCount);
+		ANKI_TEST_EXPECT_LEQ(index.getTreeHeight(), 2 * U32(log2(F32(kObjectCount))));
+
+		compareQueries(index, objects, kWorldSize);
+
+		// Move some a little and some a lot. Delete some
+		U32 aliveCount = kObjectCount;
+		for(U32 i = 0; i < kObjectCount; ++i)
+		{
+			TestObject& obj = objects[i];
+			const U32 action = i % 4;
+			if(action == 0)
+			{
+				const Vec4 offset(getRandomRange(-0.1f, 0.1f), getRandomRange(-0.1f, 0.1f), getRandomRange(-0.1f, 0.1f), 0.0f);
+				obj.m_aabb = Aabb(obj.m_aabb.getMin() + offset, obj.m_aabb.getMax() + offset);
+				index.updateObject(obj.m_indexObject, obj.m_aabb);
+			}
+			else if(action == 1)
+			{
+				obj.m_aabb = randomAabb(kWorldSize);
+				index.updateObject(obj.m_indexObject, obj.m_aabb);
+			}
+			else if(action == 2 && (i % 8) == 2)
+			{
+				index.deleteObject(obj.m_indexObject);
+				obj.m_alive = false;
+				--aliveCount;
+			}
+		}
+
+		index.flush();
+		ANKI_TEST_EXPECT_EQ(index.getObjectCount(), aliveCount);
+		ANKI_TEST_EXPECT_LEQ(index.getTreeHeight(), 2 * U32(log2(F32(aliveCount))));
+
+		compareQueries(index, objects, kWorldSize);
+
+		// Re-use the deleted slots
+		for(U32 i = 0; i < kObjectCount; ++i)
+		{
+			TestObject& obj = objects[i];
+			if(!obj.m_alive)
+			{
+				obj.m_aabb = randomAabb(kWorldSize);
+				obj.m_indexObject = index.newObject(indexToComponent(i), obj.m_type);
+				obj.m_alive = true;
+				index.updateObject(obj.m_indexObject, obj.m_aabb);
+			}
+		}
+
+		index.flush();
+		ANKI_TEST_EXPECT_EQ(index.getObjectCount(), kObjectCount);
+
+		compareQueries(index, objects, kWorldSize);
+
+		// Delete everything
+		for(TestObject& obj : objects)
+		{
+			index.deleteObject(obj.m_indexObject);
+		}
+		index.flush();
+		ANKI_TEST_EXPECT_EQ(index.getObjectCount(), 0);
+		ANKI_TEST_EXPECT_EQ(index.getTreeHeight(), 0);
+	}
+
+	// Benchmark the queries against a linear scan
+	{
+		constexpr U32 kObjectCount = 20000;
+		constexpr U32 kQueryCount = 1000;
+		constexpr F32 kWorldSize = 1000.0f;
+
+		SpatialIndex index;
+		SceneDynamicArray<Aabb> aabbs;
+		SceneDynamicArray<U32> indexObjects;
+		for(U32 i = 0; i < kObjectCount; ++i)
+		{
+			aabbs.emplaceBack(randomAabb(kWorldSize));
+			indexObjects.emplaceBack(index.newObject(indexToComponent(i), SceneComponentType::kMaterial));
+			index.updateObject(indexObjects.getBack(), aabbs.getBack());
+		}
+
+		Second begin = HighRezTimer::getCurrentTime();
+		index.flush();
+		const Second buildTime = HighRezTimer::getCurrentTime() - begin;
+
+		// Move 10% of them
+		begin = HighRezTimer::getCurrentTime();
+		for(U32 i = 0; i < kObjectCount; i += 10)
+		{
+			const Vec4 offset(getRandomRange(-5.0f, 5.0f), 0.0f, getRandomRange(-5.0f, 5.0f), 0.0f);
+			aabbs[i] = Aabb(aabbs[i].getMin() + offset, aabbs[i].getMax() + offset);
+			index.updateObject(indexObjects[i], aabbs[i]);
+		}
+		index.flush();
+		const Second updateTime = HighRezTimer::getCurrentTime() - begin;
+
+		SceneDynamicArray<Sphere> spheres;
+		for(U32 q = 0; q < kQueryCount; ++q)
+		{
+			spheres.emplaceBack(randomPoint(kWorldSize), 20.0f);
+		}
+
+		U32 treeHitCount = 0;
+		begin = HighRezTimer::getCurrentTime();
+		for(const Sphere& sphere : spheres)
+		{
+			index.visitSphere(sphere, SceneComponentTypeMask::kMaterial, [&](SceneComponent*) {
+				++treeHitCount;
+			});
+		}
+		const Second treeSphereTime = HighRezTimer::getCurrentTime() - begin;
+
+		U32 linearHitCount = 0;
+		begin = HighRezTimer::getCurrentTime();
+		for(const Sphere& sphere : spheres)
+		{
+			for(const Aabb& aabb : aabbs)
+			{
+				linearHitCount += testCollision(aabb, sphere);
+			}
+		}
+		const Second linearSphereTime = HighRezTimer::getCurrentTime() - begin;
+		ANKI_TEST_EXPECT_EQ(treeHitCount, linearHitCount);
+
+		// Frustum queries
+		const Mat4 proj = Mat4::calculatePerspectiveProjectionMatrix(toRad(90.0f), toRad(60.0f), 0.1f, 200.0f);
+		SceneDynamicArray<Mat4> viewProjs;
+		for(U32 q = 0; q < kQueryCount / 10; ++q)
+		{
+			const Mat4 camTrf(randomPoint(kWorldSize), Mat3(Euler(0.0f, getRandomRange(-kPi, kPi), 0.0f)));
+			viewProjs.emplaceBack(proj * camTrf.invertTransformation());
+		}
+
+		treeHitCount = 0;
+		begin = HighRezTimer::getCurrentTime();
+		for(const Mat4& viewProj : viewProjs)
+		{
+			index.visitFrustum(viewProj, SceneComponentTypeMask::kMaterial, [&](SceneComponent*) {
+				++treeHitCount;
+			});
+		}
+		const Second treeFrustumTime = HighRezTimer::getCurrentTime() - begin;
+
+		linearHitCount = 0;
+		begin = HighRezTimer::getCurrentTime();
+		for(const Mat4& viewProj : viewProjs)
+		{
+			Array<Plane, 6> planes;
+			extractClipPlanes(viewProj, planes);
+			for(const Aabb& aabb : aabbs)
+			{
+				Bool inside = true;
+				for(U32 p = 0; p < 6 && inside; ++p)
+				{
+					inside = testPlane(planes[p], aabb) >= 0.0f;
+				}
+				linearHitCount += inside;
+			}
+		}
+		const Second linearFrustumTime = HighRezTimer::getCurrentTime() - begin;
+		ANKI_TEST_EXPECT_EQ(treeHitCount, linearHitCount);
+
+		ANKI_TEST_LOGI("%u objects: build %fms, moving 10%% %fms, tree height %u", kObjectCount, buildTime * 1000.0, updateTime * 1000.0,
+					   index.getTreeHeight());
+		ANKI_TEST_LOGI("Sphere query: tree %fus, linear %fus", treeSphereTime * 1000000.0 / kQueryCount,
+					   linearSphereTime * 1000000.0 / kQueryCount);
+		ANKI_TEST_LOGI("Frustum query: tree %fus, linear %fus", treeFrustumTime * 1000000.0 / viewProjs.getSize(),
+					   linearFrustumTime * 1000000.0 / viewProjs.getSize());
+	}
+
+	SceneMemoryPool::freeSingleton();
+	DefaultMemoryPool::freeSingleton();
+}
@@ -0,0 +1,171 @@
+// Copyright (C) 2009-present, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <Tests/Framework/Framework.h>
+#include <AnKi/ShaderCompiler/ShaderCompiler.h>
+#include <AnKi/Util/ThreadJobManager.h>
+#include <AnKi/Util/HashMap.h>
+#include <AnKi/Util/HighRezTimer.h>
+#include <AnKi/Util/System.h>
+
+using namespace anki;
+
+namespace {
+
+// 4*4*4*2*2*2*2 mutations. The vertex shader and the 2nd technique ignore most of the mutators and different values of D, E and F compile to
+// the same pixel shader so there is plenty of source and IL to dedup
+constexpr const char* kSyntheticProgram = R"(
+#pragma anki mutator A 0 1 2 3
+#pragma anki mutator B 0 1 2 3
+#pragma anki mutator C 0 1 2 3
+#pragma anki mutator D 0 1
+#pragma anki mutator E 0 1
+#pragma anki mutator F 0 1
+#pragma anki mutator G 0 1
+
+#pragma anki technique vert mutators A B
+#pragma anki technique pixel mutators A B C D E F G
+#pragma anki technique Shadows vert pixel mutators A
+
+#if ANKI_VERTEX_SHADER
+float4 main(uint vertId : SV_VERTEXID) : SV_POSITION
+{
+#	if ANKI_TECHNIQUE_Shadows
+	return float4(float(vertId) * float(A + 1), 0.0, 0.0, 1.0);
+#	else
+	return float4(float(vertId) * float(A + 1), float(B), 0.0, 1.0);
+#	endif
+}
+#endif
+
+#if ANKI_PIXEL_SHADER
+float4 main(float4 svPosition : SV_POSITION) : SV_TARGET0
+{
+#	if ANKI_TECHNIQUE_Shadows
+	return float4(svPosition.x * float(A), 0.0, 0.0, 1.0);
+#	else
+	return float4(svPosition.x * float(A), float(B), float(C + G * 4), float(D + E + F));
+#	endif
+}
+#endif
+)";
+
+class SyntheticFilesystem : public ShaderCompilerFilesystemInterface
+{
+public:
+	Error readAllText([[maybe_unused]] CString filename, ShaderCompilerString& txt) final
+	{
+		txt = kSyntheticProgram;
+		return Error::kNone;
+	}
+};
+
+class JobManagerTaskInterface : public ShaderCompilerAsyncTaskInterface
+{
+public:
+	ThreadJobManager* m_jobManager = nullptr;
+
+	void enqueueTask(void (*callback)(void* userData), void* userData) final
+	{
+		m_jobManager->dispatchTask([callback, userData]([[maybe_unused]] U32 threadIdx) {
+			callback(userData);
+		});
+	}
+
+	Error joinTasks() final
+	{
+		m_jobManager->waitForAllTasksToFinish();
+		return Error::kNone;
+	}
+};
+
+// Keeps the IL in memory. Used to take the compiler (DXC) out of the measurements
+class MemoryCache : public ShaderCompilerCacheInterface
+{
+public:
+	Mutex m_mtx;
+	ShaderCompilerHashMap<U64, ShaderCompilerDynamicArray<U8>> m_map;
+
+	Bool find(U64 key, ShaderCompilerDynamicArray<U8>& il) final
+	{
+		LockGuard lock(m_mtx);
+		auto it = m_map.find(key);
+		if(it == m_map.getEnd())
+		{
+			return false;
+		}
+
+		il = *it;
+		return true;
+	}
+
+	void store(U64 key, ConstWeakArray<U8> il) final
+	{
+		ShaderCompilerDynamicArray<U8> copy;
+		copy.resize(il.getSize());
+		memcpy(copy.getBegin(), il.getBegin(), il.getSizeInBytes());
+
+		LockGuard lock(m_mtx);
+		if(m_map.find(key) == m_map.getEnd())
+		{
+			m_map.emplace(key, std::move(copy));
+		}
+	}
+};
+
+} // namespace
+
+ANKI_TEST(ShaderCompiler, VariantDedupBench)
+{
+	DefaultMemoryPool::allocateSingleton(allocAligned, nullptr);
+	ShaderCompilerMemoryPool::allocateSingleton(allocAligned, nullptr);
+
+	{
+		SyntheticFilesystem fsystem;
+		MemoryCache cache;
+		ThreadJobManager jobManager(getCpuCoresCount(), false);
+		JobManagerTaskInterface taskManager;
+		taskManager.m_jobManager = &jobManager;
+
+		U32 codeBlockCount = 0;
+		U32 variantCount = 0;
+
+		// The 1st pass compiles everything and populates the cache. The rest measure everything but the compiler
+		for(U32 pass = 0; pass < 3; ++pass)
+		{
+			const Bool threaded = pass != 1;
+			ShaderBinary* binary = nullptr;
+
+			const Second begin = HighRezTimer::getCurrentTime();
+			ANKI_TEST_EXPECT_NO_ERR(compileShaderProgram("Synthetic.ankiprog", true, false, ShaderModel::k6_8, fsystem, nullptr,
+														 (threaded) ? &taskManager : nullptr, &cache, {}, binary));
+			const Second time = HighRezTimer::getCurrentTime() - begin;
+
+			const U32 mutationCount = binary->m_mutations.getSize();
+			ANKI_TEST_EXPECT_EQ(mutationCount, 4 * 4 * 4 * 2 * 2 * 2 * 2);
+
+			// Must generate the same binary no matter the threading or the cache
+			if(pass == 0)
+			{
+				codeBlockCount = binary->m_codeBlocks.getSize();
+				variantCount = binary->m_variants.getSize();
+			}
+			else
+			{
+				ANKI_TEST_EXPECT_EQ(binary->m_codeBlocks.getSize(), codeBlockCount);
+				ANKI_TEST_EXPECT_EQ(binary->m_variants.getSize(), variantCount);
+			}
+
+			ANKI_TEST_LOGI("%s %s: %u mutations, %u variants, %u code blocks in %fms (%f mutations/sec)", (pass == 0) ? "Cold" : "Cached",
+						   (threaded) ? "threaded" : "single thread", mutationCount, binary->m_variants.getSize(), binary->m_codeBlocks.getSize(),
+						   time * 1000.0, F64(mutationCount) / time);
+
+			freeShaderBinary(binary);
+		}
+	}
+
+	ShaderCompilerMemoryPool::freeSingleton();
+	DefaultMemoryPool::freeSingleton();
+}
@@ -0,0 +1,93 @@
+// Copyright (C) 2009-present, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <Tests/Framework/Framework.h>
+#include <AnKi/ShaderCompiler/ShaderVariantCache.h>
+#include <AnKi/Util/Filesystem.h>
+#include <AnKi/Util/File.h>
+
+using namespace anki;
+
+ANKI_TEST(ShaderCompiler, ShaderVariantDiskCache)
+{
+	DefaultMemoryPool::allocateSingleton(allocAligned, nullptr);
+	ShaderCompilerMemoryPool::allocateSingleton(allocAligned, nullptr);
+
+	{
+		String tmpDir;
+		ANKI_TEST_EXPECT_NO_ERR(getTempDirectory(tmpDir));
+		String cacheDir;
+		cacheDir.sprintf("%s/ShaderVariantCacheTest", tmpDir.cstr());
+		if(directoryExists(cacheDir))
+		{
+			ANKI_TEST_EXPECT_NO_ERR(removeDirectory(cacheDir));
+		}
+
+		Array<U8, 64> il;
+		for(U32 i = 0; i < il.getSize(); ++i)
+		{
+			il[i] = U8(i * 3);
+		}
+
+		// Miss then hit
+		{
+			ShaderVariantDiskCache cache;
+			ANKI_TEST_EXPECT_NO_ERR(cache.init(cacheDir));
+
+			ShaderCompilerDynamicArray<U8> out;
+			ANKI_TEST_EXPECT_EQ(cache.find(0x1234, out), false);
+
+			cache.store(0x1234, il);
+			cache.store(0x5678, ConstWeakArray<U8>(il.getBegin(), 16));
+			ANKI_TEST_EXPECT_EQ(cache.getStoreCount(), 2);
+
+			ANKI_TEST_EXPECT_EQ(cache.find(0x1234, out), true);
+			ANKI_TEST_EXPECT_EQ(out.getSize(), il.getSize());
+			ANKI_TEST_EXPECT_EQ(memcmp(out.getBegin(), il.getBegin(), il.getSize()), 0);
+
+			ANKI_TEST_EXPECT_EQ(cache.getHitCount(), 1);
+			ANKI_TEST_EXPECT_EQ(cache.getMissCount(), 1);
+			ANKI_TEST_EXPECT_EQ(cache.getHitByteCount(), il.getSize());
+		}
+
+		// Another cache (think another process) sees the same entries
+		{
+			ShaderVariantDiskCache cache;
+			ANKI_TEST_EXPECT_NO_ERR(cache.init(cacheDir));
+
+			ShaderCompilerDynamicArray<U8> out;
+			ANKI_TEST_EXPECT_EQ(cache.find(0x5678, out), true);
+			ANKI_TEST_EXPECT_EQ(out.getSize(), 16);
+			ANKI_TEST_EXPECT_EQ(memcmp(out.getBegin(), il.getBegin(), 16), 0);
+		}
+
+		// Corrupt an entry. It should be a miss and the next store should fix it
+		{
+			String fname;
+			fname.sprintf("%s/%016" PRIx64 ".svc", cacheDir.cstr(), U64(0x1234));
+			{
+				File file;
+				ANKI_TEST_EXPECT_NO_ERR(file.open(fname, FileOpenFlag::kWrite | FileOpenFlag::kBinary));
+				ANKI_TEST_EXPECT_NO_ERR(file.write(il.getBegin(), 40));
+			}
+
+			ShaderVariantDiskCache cache;
+			ANKI_TEST_EXPECT_NO_ERR(cache.init(cacheDir));
+
+			ShaderCompilerDynamicArray<U8> out;
+			ANKI_TEST_EXPECT_EQ(cache.find(0x1234, out), false);
+			ANKI_TEST_EXPECT_EQ(out.getSize(), 0);
+
+			cache.store(0x1234, il);
+			ANKI_TEST_EXPECT_EQ(cache.find(0x1234, out), true);
+			ANKI_TEST_EXPECT_EQ(memcmp(out.getBegin(), il.getBegin(), il.getSize()), 0);
+		}
+
+		ANKI_TEST_EXPECT_NO_ERR(removeDirectory(cacheDir));
+	}
+
+	ShaderCompilerMemoryPool::freeSingleton();
+	DefaultMemoryPool::freeSingleton();
+}
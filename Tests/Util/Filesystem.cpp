@@ -120,3 +120,33 @@ ANKI_TEST(Util, WalkDir)
 
 	ANKI_TEST_EXPECT_EQ(count, 1);
 }
+
+ANKI_TEST(Util, MemoryMappedFile)
+{
+	// Non-empty file
+	{
+		File file;
+		ANKI_TEST_EXPECT_NO_ERR(file.open("./mapped", FileOpenFlag::kWrite));
+		ANKI_TEST_EXPECT_NO_ERR(file.writeText("1234"));
+	}
+
+	{
+		MemoryMappedFile mapped;
+		ANKI_TEST_EXPECT_NO_ERR(mapped.open("./mapped"));
+		ANKI_TEST_EXPECT_EQ(mapped.isOpen(), true);
+		ANKI_TEST_EXPECT_EQ(mapped.getSize(), 4);
+		ANKI_TEST_EXPECT_EQ(memcmp(mapped.getData(), "1234", 4), 0);
+	}
+
+	// Empty file is not an error but it's not mapped
+	{
+		File file;
+		ANKI_TEST_EXPECT_NO_ERR(file.open("./mapped", FileOpenFlag::kWrite));
+	}
+
+	{
+		MemoryMappedFile mapped;
+		ANKI_TEST_EXPECT_NO_ERR(mapped.open("./mapped"));
+		ANKI_TEST_EXPECT_EQ(mapped.isOpen(), false);
+	}
+}
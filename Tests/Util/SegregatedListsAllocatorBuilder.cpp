@@ -231,3 +231,83 @@ ANKI_TEST(Util, SegregatedListsAllocatorBuilderBenchmark)
 	fuzzyTest<false, 2000000, true, false>();
 	DefaultMemoryPool::freeSingleton();
 }
+
+ANKI_TEST(Util, SegregatedListsAllocatorBuilderCompaction)
+{
+	DefaultMemoryPool::allocateSingleton(allocAligned, nullptr);
+
+	{
+		SLAlloc sl;
+
+		class Alloc
+		{
+		public:
+			SegregatedListsAllocatorBuilderChunk* m_chunk;
+			PtrSize m_address;
+		};
+
+		constexpr U32 kAllocCount = 200;
+		constexpr PtrSize kAllocSize = 256_KB;
+		std::vector<Alloc> allocs(kAllocCount);
+		for(Alloc& alloc : allocs)
+		{
+			ANKI_TEST_EXPECT_NO_ERR(sl.allocate(kAllocSize, 4, alloc.m_chunk, alloc.m_address));
+		}
+
+		// Punch holes
+		std::vector<Alloc> liveAllocs;
+		for(U32 i = 0; i < kAllocCount; ++i)
+		{
+			if((i % 2) == 0)
+			{
+				sl.free(allocs[i].m_chunk, allocs[i].m_address, kAllocSize);
+			}
+			else
+			{
+				liveAllocs.push_back(allocs[i]);
+			}
+		}
+
+		ANKI_TEST_EXPECT_NO_ERR(sl.validate());
+		const F32 fragmentationBefore = sl.computeExternalFragmentationSawicki();
+		const PtrSize largestFreeBlockBefore = sl.computeLargestFreeBlockSize();
+
+		// Compact the same way the UnifiedGeometryBuffer does. Start from the top and move to a lower address if the allocator gives one
+		std::sort(liveAllocs.begin(), liveAllocs.end(), [](const Alloc& a, const Alloc& b) {
+			return a.m_address > b.m_address;
+		});
+
+		U32 moveCount = 0;
+		for(Alloc& alloc : liveAllocs)
+		{
+			Alloc newAlloc;
+			ANKI_TEST_EXPECT_NO_ERR(sl.allocate(kAllocSize, 4, newAlloc.m_chunk, newAlloc.m_address));
+
+			if(newAlloc.m_chunk == alloc.m_chunk && newAlloc.m_address < alloc.m_address)
+			{
+				sl.free(alloc.m_chunk, alloc.m_address, kAllocSize);
+				alloc = newAlloc;
+				++moveCount;
+			}
+			else
+			{
+				sl.free(newAlloc.m_chunk, newAlloc.m_address, kAllocSize);
+			}
+		}
+
+		ANKI_TEST_EXPECT_NO_ERR(sl.validate());
+		ANKI_TEST_EXPECT_GT(moveCount, 0);
+		ANKI_TEST_EXPECT_LT(sl.computeExternalFragmentationSawicki(), fragmentationBefore);
+		ANKI_TEST_EXPECT_GT(sl.computeLargestFreeBlockSize(), largestFreeBlockBefore);
+
+		for(const Alloc& alloc : liveAllocs)
+		{
+			sl.free(alloc.m_chunk, alloc.m_address, kAllocSize);
+		}
+
+		ANKI_TEST_EXPECT_NO_ERR(sl.validate());
+		ANKI_TEST_EXPECT_EQ(sl.computeLargestFreeBlockSize(), 0);
+	}
+
+	DefaultMemoryPool::freeSingleton();
+}
@@ -0,0 +1,99 @@
+// Copyright (C) 2009-present, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <Tests/Framework/Framework.h>
+#include <AnKi/Util/TaskGraph.h>
+#include <AnKi/Util/System.h>
+
+using namespace anki;
+
+ANKI_TEST(Util, TaskGraph)
+{
+	DefaultMemoryPool::allocateSingleton(allocAligned, nullptr);
+
+	{
+		ThreadJobManager manager(getCpuCoresCount(), false, 16);
+
+		// A diamond: A -> (parallel for B, C) -> D. D checks that everything before it completed
+		for(U32 iteration = 0; iteration < 100; ++iteration)
+		{
+			constexpr U32 kElementCount = 1000;
+			Array<U32, kElementCount> elements = {};
+			Atomic<U32> aDone = {0};
+			Atomic<U32> cDone = {0};
+			Atomic<U32> dChecksPassed = {0};
+
+			TaskGraph graph(manager);
+
+			const TaskGraphTask a = graph.newTask([&]([[maybe_unused]] U32 tid) {
+				aDone.store(1);
+			});
+
+			const TaskGraphTask b = graph.newParallelFor(
+				0, kElementCount, 7,
+				[&]([[maybe_unused]] U32 tid, U32 begin, U32 end) {
+					for(U32 i = begin; i < end; ++i)
+					{
+						elements[i] += aDone.load() + i;
+					}
+				},
+				{a});
+
+			const TaskGraphTask c = graph.newContinuation(a, [&]([[maybe_unused]] U32 tid) {
+				cDone.store(aDone.load());
+			});
+
+			graph.newTask(
+				[&]([[maybe_unused]] U32 tid) {
+					Bool ok = cDone.load() == 1;
+					for(U32 i = 0; i < kElementCount; ++i)
+					{
+						ok = ok && elements[i] == i + 1;
+					}
+
+					dChecksPassed.store(ok);
+				},
+				{b, c});
+
+			graph.submit();
+			graph.wait();
+
+			ANKI_TEST_EXPECT_EQ(graph.isDone(), true);
+			ANKI_TEST_EXPECT_EQ(dChecksPassed.load(), 1);
+		}
+
+		// Long chain with an empty parallel for in the middle
+		{
+			constexpr U32 kChainLength = 64;
+			U32 counter = 0;
+
+			TaskGraph graph(manager);
+			TaskGraphTask prev;
+			for(U32 i = 0; i < kChainLength; ++i)
+			{
+				const TaskGraphTask crnt = graph.newTask([&counter, i]([[maybe_unused]] U32 tid) {
+					if(counter == i)
+					{
+						++counter;
+					}
+				});
+
+				if(prev.isValid())
+				{
+					graph.addDependency(prev, crnt);
+				}
+
+				prev = graph.newParallelFor(0, 0, 1, []([[maybe_unused]] U32 tid, [[maybe_unused]] U32 begin, [[maybe_unused]] U32 end) {}, {crnt});
+			}
+
+			graph.submit();
+			graph.wait();
+
+			ANKI_TEST_EXPECT_EQ(counter, kChainLength);
+		}
+	}
+
+	DefaultMemoryPool::freeSingleton();
+}
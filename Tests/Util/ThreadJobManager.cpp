@@ -36,6 +36,83 @@ ANKI_TEST(Util, ThreadJobManager)
 		ANKI_TEST_EXPECT_EQ(atomic.load(), kTaskCount);
 	}
 
+	// Tasks that dispatch other tasks
+	{
+		constexpr U32 kTaskCount = 128;
+		constexpr U32 kSubtaskCount = 64;
+
+		ThreadJobManager manager(getCpuCoresCount(), false, 16);
+
+		Atomic<U32> atomic(0);
+		DynamicArray<Atomic<U32>> perThreadCounts;
+		perThreadCounts.resize(manager.getThreadCount(), 0);
+
+		for(U32 i = 0; i < kTaskCount; ++i)
+		{
+			manager.dispatchTask([&]([[maybe_unused]] U32 parentTid) {
+				for(U32 j = 0; j < kSubtaskCount; ++j)
+				{
+					manager.dispatchTask([&](U32 tid) {
+						ANKI_TEST_EXPECT_LT(tid, manager.getThreadCount());
+						perThreadCounts[tid].fetchAdd(1);
+						atomic.fetchAdd(1);
+					});
+				}
+			});
+		}
+
+		manager.waitForAllTasksToFinish();
+
+		ANKI_TEST_EXPECT_EQ(atomic.load(), kTaskCount * kSubtaskCount);
+
+		U32 sum = 0;
+		for(Atomic<U32>& count : perThreadCounts)
+		{
+			sum += count.load();
+		}
+		ANKI_TEST_EXPECT_EQ(sum, kTaskCount * kSubtaskCount);
+	}
+
+	// Short lived threads that dispatch to many managers. The queues of the threads that exit go to the next ones
+	{
+		constexpr U32 kManagerCount = 6;
+		constexpr U32 kThreadCount = 32;
+		constexpr U32 kTaskCount = 16;
+
+		Array<ThreadJobManager*, kManagerCount> managers;
+		for(ThreadJobManager*& manager : managers)
+		{
+			manager = newInstance<ThreadJobManager>(DefaultMemoryPool::getSingleton(), 2, false, 16);
+		}
+
+		Atomic<U32> atomic(0);
+		for(U32 i = 0; i < kThreadCount; ++i)
+		{
+			Thread thread("ExternalThread");
+			thread.start(&managers, [](ThreadCallbackInfo& info) -> Error {
+				for(ThreadJobManager* manager : *static_cast<Array<ThreadJobManager*, kManagerCount>*>(info.m_userData))
+				{
+					for(U32 j = 0; j < kTaskCount; ++j)
+					{
+						manager->dispatchTask([]([[maybe_unused]] U32 tid) {
+						});
+					}
+					manager->waitForAllTasksToFinish();
+				}
+				return Error::kNone;
+			});
+			ANKI_TEST_EXPECT_NO_ERR(thread.join());
+			atomic.fetchAdd(1);
+		}
+
+		for(ThreadJobManager* manager : managers)
+		{
+			deleteInstance(DefaultMemoryPool::getSingleton(), manager);
+		}
+
+		ANKI_TEST_EXPECT_EQ(atomic.load(), kThreadCount);
+	}
+
 	DefaultMemoryPool::freeSingleton();
 }
 
@@ -43,15 +120,18 @@ ANKI_TEST(Util, ThreadJobManagerBench)
 {
 	DefaultMemoryPool::allocateSingleton(allocAligned, nullptr);
 
-	const U64 time = HighRezTimer::getCurrentTimeUs();
+	constexpr U32 kTaskCount = 4 * 1024 * 1024;
 
+	// Measure the throughput of tiny tasks for different number of worker threads
+	U32 threadCount = 1;
+	while(true)
 	{
-		constexpr U32 kTaskCount = 20 * 1024 * 1024;
-
-		ThreadJobManager manager(getCpuCoresCount(), true, 256);
+		ThreadJobManager manager(threadCount, true, 256);
 
 		Atomic<U32> atomic(0);
 
+		const Second time = HighRezTimer::getCurrentTime();
+
 		for(U32 i = 0; i < kTaskCount; ++i)
 		{
 			manager.dispatchTask([&atomic]([[maybe_unused]] U32 tid) {
@@ -61,11 +141,18 @@ ANKI_TEST(Util, ThreadJobManagerBench)
 
 		manager.waitForAllTasksToFinish();
 
+		const Second timeDiff = HighRezTimer::getCurrentTime() - time;
+
 		ANKI_TEST_EXPECT_EQ(atomic.load(), kTaskCount);
-	}
 
-	const U64 timeDiff = HighRezTimer::getCurrentTimeUs() - time;
-	ANKI_TEST_LOGI("Time spent %lu us / %lu ms", timeDiff, timeDiff / 1000);
+		ANKI_TEST_LOGI("%u worker threads: %f sec, %.2f Mjobs/sec", threadCount, timeDiff, F64(kTaskCount) / (timeDiff * 1000000.0));
+
+		if(threadCount == getCpuCoresCount())
+		{
+			break;
+		}
+		threadCount = min(threadCount * 2, getCpuCoresCount());
+	}
 
 	DefaultMemoryPool::freeSingleton();
 }
@@ -0,0 +1,138 @@
+// Copyright (C) 2009-present, Panagiotis Christopoulos Charitos and contributors.
+// All rights reserved.
+// Code licensed under the BSD License.
+// http://www.anki3d.org/LICENSE
+
+#include <AnKi/AnKi.h>
+
+using namespace anki;
+
+static const char* kUsage = R"(Convert a scene between the text (.ankiscene) and the binary (.ankiscenebin) formats
+Usage: %s input_scene output_scene [options] [cvars]
+Options:
+-bench <count> : After the conversion load the input and the output scenes <count> times each and print the load times. Default 0
+)";
+
+class MyApp : public App
+{
+public:
+	CString m_input;
+	CString m_output;
+	U32 m_benchCount = 0;
+
+	MyApp(U32 argc, Char** argv, CString input, CString output, U32 benchCount)
+		: App("SceneConverter", argc, argv)
+		, m_input(input)
+		, m_output(output)
+		, m_benchCount(benchCount)
+	{
+	}
+
+	Error userPreInit() override
+	{
+		g_cvarWindowFullscreen = 0;
+		g_cvarWindowBorderless = 0;
+
+		return Error::kNone;
+	}
+
+	Error userPostInit() override
+	{
+		ANKI_CHECK(SceneGraph::getSingleton().loadScene(m_input, m_scene));
+		return Error::kNone;
+	}
+
+	Error userMainLoop(Bool& quit, [[maybe_unused]] Second elapsedTime) override
+	{
+		// The scene nodes get registered in the scene update so do the work in the frame after a load
+		SceneGraph& scene = SceneGraph::getSingleton();
+		const U32 frame = m_frame++;
+		if(frame == 0)
+		{
+			return Error::kNone;
+		}
+
+		if(frame == 1)
+		{
+			ANKI_CHECK(scene.saveScene(m_output, *m_scene));
+			scene.deleteScene(m_scene);
+			m_scene = nullptr;
+			quit = m_benchCount == 0;
+			return Error::kNone;
+		}
+
+		// Bench. Even frames load one of the 2 scenes and odd frames delete it
+		const U32 benchFrame = frame - 2;
+		const U32 format = (benchFrame / 2) % 2;
+		if((benchFrame % 2) == 0)
+		{
+			const Second begin = HighRezTimer::getCurrentTime();
+			ANKI_CHECK(scene.loadScene((format == 0) ? m_input : m_output, m_scene));
+			m_loadTimes[format] += HighRezTimer::getCurrentTime() - begin;
+		}
+		else
+		{
+			scene.deleteScene(m_scene);
+			m_scene = nullptr;
+		}
+
+		if(benchFrame + 1 == m_benchCount * 4)
+		{
+			ANKI_LOGI("Average load time: %s %fms, %s %fms", m_input.cstr(), m_loadTimes[0] * 1000.0 / m_benchCount, m_output.cstr(),
+					  m_loadTimes[1] * 1000.0 / m_benchCount);
+			quit = true;
+		}
+
+		return Error::kNone;
+	}
+
+private:
+	Scene* m_scene = nullptr;
+	U32 m_frame = 0;
+	Array<Second, 2> m_loadTimes = {};
+};
+
+ANKI_MAIN_FUNCTION(myMain)
+int myMain(int argc, char* argv[])
+{
+	if(argc < 3)
+	{
+		ANKI_LOGE(kUsage, argv[0]);
+		return 1;
+	}
+
+	U32 benchCount = 0;
+	Array<Char*, 32> args;
+	U32 argCount = 0;
+	args[argCount++] = argv[0];
+	for(I32 i = 3; i < argc; ++i)
+	{
+		if(CString(argv[i]) == "-bench" && i + 1 < argc)
+		{
+			if(CString(argv[++i]).toNumber(benchCount))
+			{
+				ANKI_LOGE(kUsage, argv[0]);
+				return 1;
+			}
+		}
+		else if(argCount < args.getSize())
+		{
+			args[argCount++] = argv[i];
+		}
+	}
+
+	MyApp* app = new MyApp(argCount, args.getBegin(), argv[1], argv[2], benchCount);
+	const Error err = app->mainLoop();
+	delete app;
+
+	if(err)
+	{
+		ANKI_LOGE("Error reported. Bye!!");
+		return 1;
+	}
+	else
+	{
+		ANKI_LOGI("Bye!!");
+		return 0;
+	}
+}
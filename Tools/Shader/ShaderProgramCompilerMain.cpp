@@ -4,6 +4,7 @@
 // http://www.anki3d.org/LICENSE
 
 #include <AnKi/ShaderCompiler/ShaderCompiler.h>
+#include <AnKi/ShaderCompiler/ShaderVariantCache.h>
 #include <AnKi/Util.h>
 using namespace anki;
 
@@ -18,6 +19,7 @@ Options:
 -dxil                : Compile DXIL
 -g                   : Include debug info
 -sm                  : Shader mode. "6_7" or "6_8". Default "6_8"
+-cache <dir>         : Directory to cache the compiled variants. Can be shared between programs and runs
 )";
 
 class CmdLineArgs
@@ -26,6 +28,7 @@ public:
 	String m_inputFname;
 	String m_outFname;
 	String m_includePath;
+	String m_cacheDir;
 	U32 m_threadCount = getCpuCoresCount();
 	DynamicArray<String> m_defineNames;
 	DynamicArray<ShaderCompilerDefine> m_defines;
@@ -138,6 +141,26 @@ static Error parseCommandLineArgs(int argc, char** argv, CmdLineArgs& info)
 		{
 			info.m_debugInfo = true;
 		}
+		else if(strcmp(argv[i], "-cache") == 0)
+		{
+			++i;
+
+			if(i < argc)
+			{
+				if(std::strlen(argv[i]) > 0)
+				{
+					info.m_cacheDir.sprintf("%s", argv[i]);
+				}
+				else
+				{
+					return Error::kUserData;
+				}
+			}
+			else
+			{
+				return Error::kUserData;
+			}
+		}
 		else if(strcmp(argv[i], "-sm") == 0)
 		{
 			++i;
@@ -240,10 +263,25 @@ static Error work(const CmdLineArgs& info)
 	taskManager.m_jobManager.reset((info.m_threadCount) ? newInstance<ThreadJobManager>(DefaultMemoryPool::getSingleton(), info.m_threadCount, true)
 														: nullptr);
 
+	// Variant cache
+	ShaderVariantDiskCache cache;
+	if(!info.m_cacheDir.isEmpty())
+	{
+		ANKI_CHECK(cache.init(info.m_cacheDir));
+	}
+
 	// Compile
 	ShaderBinary* binary = nullptr;
 	ANKI_CHECK(compileShaderProgram(info.m_inputFname, info.m_spirv, info.m_debugInfo, info.m_sm, fsystem, nullptr,
-									(info.m_threadCount) ? &taskManager : nullptr, info.m_defines, binary));
+									(info.m_threadCount) ? &taskManager : nullptr, (!info.m_cacheDir.isEmpty()) ? &cache : nullptr, info.m_defines,
+									binary));
+
+	if(!info.m_cacheDir.isEmpty())
+	{
+		const U32 lookups = cache.getHitCount() + cache.getMissCount();
+		ANKI_LOGI("Variant cache: %u hits, %u misses (%.1f%% hit rate), %u stored, %zuKB read", cache.getHitCount(), cache.getMissCount(),
+				  (lookups) ? F64(cache.getHitCount()) * 100.0 / F64(lookups) : 0.0, cache.getStoreCount(), cache.getHitByteCount() / 1024);
+	}
 
 	class Dummy
 	{